@@ -103,10 +103,11 @@ time warp info and AudioIOListener and whether the playback is looped.
 #include "Meter.h"
 #include "Mix.h"
 #include "Resample.h"
-#include "RingBuffer.h"
+#include "MultiChannelRingBuffer.h"
 #include "Decibels.h"
 #include "Prefs.h"
 #include "Project.h"
+#include "RealtimeSafety.h"
 #include "TransactionScope.h"
 
 #include "RealtimeEffectManager.h"
@@ -251,8 +252,6 @@ AudioIO::AudioIO()
    mAudioThreadSequenceBufferExchangeLoopActive
       .store(false, std::memory_order_relaxed);
 
-   mAudioThreadAcknowledge.store(Acknowledge::eNone, std::memory_order_relaxed);
-
    mPortStreamV19 = NULL;
 
    mNumPauseFrames = 0;
@@ -340,6 +339,7 @@ AudioIO::~AudioIO()
    // wxTheApp->Yield();
 
    mFinishAudioThread.store(true, std::memory_order_release);
+   mAudioThreadWakeup.Post();
    mAudioThread.join();
 }
 
@@ -926,8 +926,9 @@ int AudioIO::StartStream(const TransportSequences &sequences,
    mPlaybackBuffers.clear();
    mScratchBuffers.clear();
    mScratchPointers.clear();
+   mPlaybackPrefetchers.clear();
    mPlaybackMixers.clear();
-   mCaptureBuffers.clear();
+   mCaptureBuffer.reset();
    mResample.clear();
    mPlaybackSchedule.mTimeQueue.Clear();
 
@@ -1037,18 +1038,22 @@ int AudioIO::StartStream(const TransportSequences &sequences,
    // so that they will have data in them when the stream starts.  Having the
    // audio thread call SequenceBufferExchange here makes the code more predictable, since
    // SequenceBufferExchange will ALWAYS get called from the Audio thread.
-   mAudioThreadShouldCallSequenceBufferExchangeOnce
-      .store(true, std::memory_order_release);
-
-   while( mAudioThreadShouldCallSequenceBufferExchangeOnce
-      .load(std::memory_order_acquire)) {
-      using namespace std::chrono;
-      auto interval = 50ms;
-      if (options.playbackStreamPrimer) {
-         interval = options.playbackStreamPrimer();
+   if (options.playbackStreamPrimer) {
+      mAudioThreadShouldCallSequenceBufferExchangeOnce
+         .store(true, std::memory_order_release);
+      mAudioThreadWakeup.Post();
+      // Call the primer repeatedly while waiting
+      while (true) {
+         const auto interval = options.playbackStreamPrimer();
+         auto lock = std::unique_lock{ mAudioThreadMutex };
+         if (mAudioThreadCondition.wait_for(lock, interval, [this]{
+            return !mAudioThreadShouldCallSequenceBufferExchangeOnce
+               .load(std::memory_order_acquire); }))
+            break;
       }
-      std::this_thread::sleep_for(interval);
    }
+   else
+      ProcessOnceAndWait();
 
    if(mNumPlaybackChannels > 0 || mNumCaptureChannels > 0) {
 
@@ -1163,6 +1168,9 @@ void AudioIO::CallAfterRecording(PostRecordingAction action)
    BasicUI::CallAfter(move(action));
 }
 
+//! How many playback ring buffers' worth of time to read ahead from storage
+static constexpr double PrefetchRingBuffers = 4.0;
+
 bool AudioIO::AllocateBuffers(
    const AudioIOStartStreamOptions &options,
    const TransportSequences &sequences, double t0, double t1, double sampleRate)
@@ -1182,7 +1190,7 @@ bool AudioIO::AllocateBuffers(
    //
 
    //
-   // The RingBuffer sizes, and the max amount of the buffer to
+   // The ring buffer sizes, and the max amount of the buffer to
    // fill at a time, both grow linearly with the number of
    // sequences.  This allows us to scale up to many sequences without
    // killing performance.
@@ -1225,18 +1233,13 @@ bool AudioIO::AllocateBuffers(
             // Adjust mPlaybackRingBufferSecs correspondingly
             mPlaybackRingBufferSecs = PlaybackPolicy::Duration { playbackBufferSize / mRate };
 
-            const size_t totalWidth = std::accumulate(
-               mPlaybackSequences.begin(), mPlaybackSequences.end(), 0,
-               [](size_t acc, const auto &pSequence){
-                  return acc + pSequence->NChannels(); });
-
-            // mPlaybackBuffers buffers correspond many-to-one with
+            // mPlaybackBuffers correspond one-to-one with
             // mPlaybackSequences
             // Except, always make at least one playback buffer, in case of
             // MIDI playback without any audio
             mPlaybackBuffers.resize(0);
             mPlaybackBuffers.resize(
-               std::max<size_t>(1, totalWidth));
+               std::max<size_t>(1, mPlaybackSequences.size()));
             // Number of scratch buffers depends on device playback channels
             if (mNumPlaybackChannels > 0) {
                mScratchBuffers.resize(mNumPlaybackChannels * 2 + 1);
@@ -1247,6 +1250,7 @@ bool AudioIO::AllocateBuffers(
                      reinterpret_cast<float*>(buffer.ptr()));
                }
             }
+            mPlaybackPrefetchers.clear();
             mPlaybackMixers.clear();
 
             const auto &warpOptions =
@@ -1266,22 +1270,18 @@ bool AudioIO::AllocateBuffers(
 
             if (mPlaybackSequences.empty())
                // Make at least one playback buffer
-               mPlaybackBuffers[0] =
-                  std::make_unique<RingBuffer>(floatSample, playbackBufferSize);
+               mPlaybackBuffers[0] = std::make_unique<MultiChannelRingBuffer>(
+                  floatSample, 1, playbackBufferSize);
 
             mOldChannelGains.resize(mPlaybackSequences.size());
-            size_t iBuffer = 0;
             for (unsigned int i = 0; i < mPlaybackSequences.size(); i++) {
                const auto &pSequence = mPlaybackSequences[i];
                // Bug 1763 - We must fade in from zero to avoid a click on starting.
                mOldChannelGains[i][0] = 0.0;
                mOldChannelGains[i][1] = 0.0;
 
-               for (size_t jj = 0, nChannels = pSequence->NChannels();
-                  jj < nChannels; ++jj
-               )
-                  mPlaybackBuffers[iBuffer++] = std::make_unique<RingBuffer>(
-                     floatSample, playbackBufferSize);
+               mPlaybackBuffers[i] = std::make_unique<MultiChannelRingBuffer>(
+                  floatSample, pSequence->NChannels(), playbackBufferSize);
 
                // By the precondition of StartStream which is sole caller of
                // this function:
@@ -1318,6 +1318,12 @@ bool AudioIO::AllocateBuffers(
                   nullptr, // no custom mix-down
                   Mixer::ApplyGain::Discard // don't apply gains
                ));
+
+               // Read ahead a few ring buffers' worth
+               mPlaybackPrefetchers.emplace_back(
+                  std::make_unique<SequencePrefetcher>(
+                     SequencePrefetcher::Sequences{ pSequence },
+                     PrefetchRingBuffers * mPlaybackRingBufferSecs.count()));
             }
 
             const auto timeQueueSize = 1 +
@@ -1341,15 +1347,14 @@ bool AudioIO::AllocateBuffers(
                return false;
             }
 
-            mCaptureBuffers.resize(0);
-            mCaptureBuffers.resize(mNumCaptureChannels);
+            mCaptureBuffer.reset();
+            mCaptureBuffer = std::make_unique<MultiChannelRingBuffer>(
+               mCaptureFormat, mNumCaptureChannels, captureBufferSize);
             mResample.resize(0);
             mResample.resize(mNumCaptureChannels);
             mFactor = sampleRate / mRate;
 
             for (unsigned int i = 0; i < mNumCaptureChannels; ++i) {
-               mCaptureBuffers[i] = std::make_unique<RingBuffer>(
-                  mCaptureFormat, captureBufferSize);
                mResample[i] =
                   std::make_unique<Resample>(true, mFactor, mFactor);
                   // constant rate resampling
@@ -1390,8 +1395,9 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
    mPlaybackBuffers.clear();
    mScratchBuffers.clear();
    mScratchPointers.clear();
+   mPlaybackPrefetchers.clear();
    mPlaybackMixers.clear();
-   mCaptureBuffers.clear();
+   mCaptureBuffer.reset();
    mResample.clear();
    mPlaybackSchedule.mTimeQueue.Clear();
 
@@ -1546,6 +1552,9 @@ void AudioIO::StopStream()
    // to prevent the callback from being invoked after the effects are finalized.
    mpTransportState.reset();
 
+   // In debug builds, tell of anything that could have blocked the callback
+   RealtimeSafety::Report();
+
    //
    // Everything is taken care of.  Now, just free all the resources
    // we allocated in StartStream()
@@ -1553,6 +1562,7 @@ void AudioIO::StopStream()
    mPlaybackBuffers.clear();
    mScratchBuffers.clear();
    mScratchPointers.clear();
+   mPlaybackPrefetchers.clear();
    mPlaybackMixers.clear();
    mPlaybackSchedule.mTimeQueue.Clear();
 
@@ -1562,7 +1572,7 @@ void AudioIO::StopStream()
       // Offset all recorded sequences to account for latency
       //
       if (mCaptureSequences.size() > 0) {
-         mCaptureBuffers.clear();
+         mCaptureBuffer.reset();
          mResample.clear();
 
          //
@@ -1811,8 +1821,12 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
          .load(std::memory_order_acquire) )
       {
          gAudioIO->SequenceBufferExchange();
-         gAudioIO->mAudioThreadShouldCallSequenceBufferExchangeOnce
-            .store(false, std::memory_order_release);
+         {
+            auto lock = std::lock_guard{ gAudioIO->mAudioThreadMutex };
+            gAudioIO->mAudioThreadShouldCallSequenceBufferExchangeOnce
+               .store(false, std::memory_order_release);
+         }
+         gAudioIO->mAudioThreadCondition.notify_all();
 
          lastState = State::eOnce;
       }
@@ -1822,8 +1836,7 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
          if (lastState != State::eLoopRunning)
          {
             // Main thread has told us to start - acknowledge that we do
-            gAudioIO->mAudioThreadAcknowledge.store(Acknowledge::eStart,
-                                                    std::memory_order::memory_order_release);
+            gAudioIO->SetAcknowledge(Acknowledge::eStart);
          }
          lastState = State::eLoopRunning;
 
@@ -1837,14 +1850,11 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
       }
       else
       {
-         if (    (lastState == State::eLoopRunning)
-              || (lastState == State::eMonitoring ) )
-         {
-            // Main thread has told us to stop; (actually: to neither process "once" nor "loop running")
-            // acknowledge that we received the order and that no more processing will be done.
-            gAudioIO->mAudioThreadAcknowledge.store(Acknowledge::eStop,
-                                                    std::memory_order::memory_order_release);
-         }
+         // Main thread has told us to stop; (actually: to neither process "once" nor "loop running")
+         // acknowledge that we received the order and that no more processing will be done.
+         // Do so at every such pass, because passes happen only when the thread
+         // is woken, and a pass might not have observed the monitoring state
+         gAudioIO->SetAcknowledge(Acknowledge::eStop);
          lastState = State::eDoNothing;
 
          if (gAudioIO->IsMonitoring())
@@ -1853,15 +1863,31 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
          }
       }
 
-      gAudioIO->mAudioThreadSequenceBufferExchangeLoopActive
-         .store(false, std::memory_order_relaxed);
-
-      std::this_thread::sleep_until( loopPassStart + interval );
+      {
+         auto lock = std::lock_guard{ gAudioIO->mAudioThreadMutex };
+         gAudioIO->mAudioThreadSequenceBufferExchangeLoopActive
+            .store(false, std::memory_order_relaxed);
+      }
+      gAudioIO->mAudioThreadCondition.notify_all();
+
+      // Sleep until another thread or the PortAudio callback has work for us.
+      // While the loop runs, wake anyway after the interval, for policies
+      // that poll other sources of work; otherwise there is nothing to poll.
+      auto &wakeup = gAudioIO->mAudioThreadWakeup;
+      if (gAudioIO->mAudioThreadSequenceBufferExchangeLoopRunning
+         .load(std::memory_order_relaxed)) {
+         const auto remaining = std::chrono::duration_cast<
+            std::chrono::milliseconds>(loopPassStart + interval - Clock::now());
+         if (remaining.count() > 0)
+            wakeup.WaitFor(remaining);
+      }
+      else
+         wakeup.Wait();
    }
 }
 
-size_t AudioIoCallback::MinValue(
-   const RingBuffers &buffers, size_t (RingBuffer::*pmf)() const)
+size_t AudioIoCallback::MinValue(const RingBuffers &buffers,
+   size_t (MultiChannelRingBuffer::*pmf)() const)
 {
    return std::accumulate(buffers.begin(), buffers.end(),
       std::numeric_limits<size_t>::max(),
@@ -1871,7 +1897,8 @@ size_t AudioIoCallback::MinValue(
 
 size_t AudioIO::GetCommonlyFreePlayback()
 {
-   auto commonlyAvail = MinValue(mPlaybackBuffers, &RingBuffer::AvailForPut);
+   auto commonlyAvail =
+      MinValue(mPlaybackBuffers, &MultiChannelRingBuffer::AvailForPut);
    // MB: subtract a few samples because the code in SequenceBufferExchange has rounding
    // errors
    return commonlyAvail - std::min(size_t(10), commonlyAvail);
@@ -1879,17 +1906,17 @@ size_t AudioIO::GetCommonlyFreePlayback()
 
 size_t AudioIoCallback::GetCommonlyReadyPlayback()
 {
-   return MinValue(mPlaybackBuffers, &RingBuffer::AvailForGet);
+   return MinValue(mPlaybackBuffers, &MultiChannelRingBuffer::AvailForGet);
 }
 
 size_t AudioIoCallback::GetCommonlyWrittenForPlayback()
 {
-   return MinValue(mPlaybackBuffers, &RingBuffer::WrittenForGet);
+   return MinValue(mPlaybackBuffers, &MultiChannelRingBuffer::WrittenForGet);
 }
 
 size_t AudioIO::GetCommonlyAvailCapture()
 {
-   return MinValue(mCaptureBuffers, &RingBuffer::AvailForGet);
+   return mCaptureBuffer->AvailForGet();
 }
 
 // This method is the data gateway between the audio thread (which
@@ -2005,11 +2032,11 @@ bool AudioIO::ProcessPlaybackSlices(
       // atomic variables, the time queue doesn't.
       mPlaybackSchedule.mTimeQueue.Producer(mPlaybackSchedule, slice);
 
-      // mPlaybackMixers correspond one-to-one with mPlaybackSequences
-      size_t iSequence = 0;
-      // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
+      // mPlaybackMixers and mPlaybackBuffers correspond one-to-one with
+      // mPlaybackSequences
       size_t iBuffer = 0;
       for (auto &mixer : mPlaybackMixers) {
+         auto &ringBuffer = *mPlaybackBuffers[iBuffer++];
          // The mixer here isn't actually mixing: it's just doing
          // resampling, format conversion, and possibly time track
          // warping
@@ -2018,22 +2045,29 @@ bool AudioIO::ProcessPlaybackSlices(
             if (toProduce)
                produced = mixer->Process(toProduce);
             //wxASSERT(produced <= toProduce);
-            // Copy (non-interleaved) mixer outputs to one or more ring buffers
-            const auto nChannels = mPlaybackSequences[iSequence++]->NChannels();
-            for (size_t j = 0; j < nChannels; ++j) {
-               auto warpedSamples = mixer->GetBuffer(j);
-               const auto put = mPlaybackBuffers[iBuffer++]->Put(
-                  warpedSamples, floatSample, produced, frames - produced);
-               // wxASSERT(put == frames);
-               // but we can't assert in this thread
-               wxUnusedVar(put);
-            }
+            // Copy (non-interleaved) mixer outputs into the spans of all
+            // channels of the ring buffer, then publish them at once
+            const auto spans = ringBuffer.GetWritable(frames);
+            for (size_t j = 0, nChannels = ringBuffer.Channels();
+               j < nChannels; ++j
+            )
+               ringBuffer.Write(j, spans,
+                  mixer->GetBuffer(j), floatSample, produced);
+            const auto put = ringBuffer.Produce(
+               MultiChannelRingBuffer::TotalLength(spans), frames - produced);
+            // wxASSERT(put == frames);
+            // but we can't assert in this thread
+            wxUnusedVar(put);
          }
       }
 
-      if (mPlaybackSequences.empty())
+      if (mPlaybackSequences.empty()) {
          // Produce silence in the single ring buffer
-         mPlaybackBuffers[0]->Put(nullptr, floatSample, 0, frames);
+         auto &ringBuffer = *mPlaybackBuffers[0];
+         const auto spans = ringBuffer.GetWritable(frames);
+         ringBuffer.Write(0, spans, nullptr, floatSample, 0);
+         ringBuffer.Produce(MultiChannelRingBuffer::TotalLength(spans), frames);
+      }
 
       available -= frames;
       // wxASSERT(available >= 0); // don't assert on this thread
@@ -2042,26 +2076,76 @@ bool AudioIO::ProcessPlaybackSlices(
          frames, available );
    } while (available && !done);
 
+   PrefetchPlayback();
+
    // Do any realtime effect processing, more efficiently in at most
    // two buffers per sequence, after all the little slices have been written.
    TransformPlayBuffers(pScope);
    return progress;
 }
 
+void AudioIO::PrefetchPlayback()
+{
+   const auto &schedule = mPlaybackSchedule;
+   // The time following the last sample written to the ring buffers
+   const auto time = schedule.mTimeQueue.GetLastTime();
+   const auto limit = schedule.mT1;
+   const auto looping = schedule.GetPolicy().Looping(schedule);
+   for (auto &pPrefetcher : mPlaybackPrefetchers) {
+      pPrefetcher->Advance(time, limit);
+      // When looping, the start of the play region comes after its end
+      const auto lookAhead = pPrefetcher->LookAhead();
+      const auto remaining = std::abs(limit - time);
+      if (looping && remaining < lookAhead) {
+         const auto wrapped = lookAhead - remaining;
+         pPrefetcher->Request(schedule.mT0, schedule.ReversedTime()
+            ? schedule.mT0 - wrapped
+            : schedule.mT0 + wrapped);
+      }
+   }
+}
+
+std::vector<SequencePrefetcher::Statistics>
+AudioIO::GetPrefetchStatistics() const
+{
+   std::vector<SequencePrefetcher::Statistics> result;
+   for (auto &pPrefetcher : mPlaybackPrefetchers)
+      result.push_back(pPrefetcher->GetStatistics());
+   return result;
+}
+
+std::vector<MultiChannelRingBuffer::Statistics>
+AudioIO::GetPlaybackBufferStatistics() const
+{
+   std::vector<MultiChannelRingBuffer::Statistics> result;
+   for (auto &pBuffer : mPlaybackBuffers)
+      result.push_back(pBuffer->GetStatistics());
+   return result;
+}
+
+std::optional<MultiChannelRingBuffer::Statistics>
+AudioIO::GetCaptureBufferStatistics() const
+{
+   if (!mCaptureBuffer)
+      return {};
+   return mCaptureBuffer->GetStatistics();
+}
+
 #define stackAllocate(T, count) static_cast<T*>(alloca(count * sizeof(T)))
 
 void AudioIO::TransformPlayBuffers(
    std::optional<RealtimeEffects::ProcessingScope> &pScope)
 {
    // Transform written but un-flushed samples in the RingBuffers in-place.
+   RealtimeSafety::Scope realtimeSafety;
 
    // Avoiding std::vector
    const auto pointers = stackAllocate(float*, mNumPlaybackChannels);
 
-   const auto numPlaybackSequences = mPlaybackSequences.size();
-   // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
+   // mPlaybackBuffers correspond one-to-one with mPlaybackSequences
    size_t iBuffer = 0;
-   for (const auto vt : mPlaybackSequences) {
+   for (const auto &vt : mPlaybackSequences) {
+      auto &ringBuffer = *mPlaybackBuffers[iBuffer++];
       if (!vt)
          continue;
       const auto pGroup = vt->FindChannelGroup();
@@ -2073,20 +2157,14 @@ void AudioIO::TransformPlayBuffers(
 
       // Loop over the blocks of unflushed data, at most two
       for (unsigned iBlock : {0, 1}) {
-         size_t len = 0;
+         // The unflushed span is the same for all channels
+         const auto span = ringBuffer.GetUnflushed(iBlock);
+         const auto len = span.length;
          size_t iChannel = 0;
-         for (; iChannel < nChannels; ++iChannel) {
-            auto &ringBuffer = *mPlaybackBuffers[iBuffer + iChannel];
-            const auto pair = ringBuffer.GetUnflushed(iBlock);
-            // Playback RingBuffers have float format: see AllocateBuffers
-            pointers[iChannel] = reinterpret_cast<float*>(pair.first);
-            // The lengths of corresponding unflushed blocks should be
-            // the same for all channels
-            if (len == 0)
-               len = pair.second;
-            else
-               assert(len == pair.second);
-         }
+         for (; iChannel < nChannels; ++iChannel)
+            // Playback buffers have float format: see AllocateBuffers
+            pointers[iChannel] = reinterpret_cast<float*>(
+               ringBuffer.GetPointer(iChannel, span.offset));
 
          // Are there more output device channels than channels of vt?
          // Such as when a mono sequence is processed for stereo play?
@@ -2103,15 +2181,10 @@ void AudioIO::TransformPlayBuffers(
                // The single dummy output buffer:
                mScratchPointers[mNumPlaybackChannels],
                mNumPlaybackChannels, len);
-            iChannel = 0;
-            for (; iChannel < nChannels; ++iChannel) {
-               auto &ringBuffer = *mPlaybackBuffers[iBuffer + iChannel];
-               auto discarded = ringBuffer.Unput(discardable);
-               // assert(discarded == discardable);
-            }
+            auto discarded = ringBuffer.Unput(discardable);
+            // assert(discarded == discardable);
          }
       }
-      iBuffer += vt->NChannels();
    }
 }
 
@@ -2158,6 +2231,30 @@ void AudioIO::DrainRecordBuffers()
       {
          bool newBlocks = false;
 
+         size_t discarded = 0;
+         if (!mRecordingSchedule.mLatencyCorrected &&
+             mRecordingSchedule.TotalCorrection() < 0) {
+            // Leftward shift
+            // discard some samples from all channels of the ring buffer.
+            size_t size = floor(
+               mRecordingSchedule.ToDiscard() * mRate );
+
+            // The ring buffer might have grown concurrently -- don't discard more
+            // than the "avail" value noted above.
+            discarded = mCaptureBuffer->Discard(std::min(avail, size));
+
+            if (discarded < size)
+               // We need to visit this again to complete the
+               // discarding.
+               latencyCorrected = false;
+         }
+
+         wxASSERT(discarded <= avail);
+         const size_t toConsume = avail - discarded;
+         // Release the captured samples from all channels at once, after all
+         // are appended
+         auto consume = finally([&]{ mCaptureBuffer->Consume(toConsume); });
+
          // Append captured samples to the end of the RecordableSequences.
          // (WaveTracks have their own buffering for efficiency.)
          auto iter = mCaptureSequences.begin();
@@ -2172,7 +2269,6 @@ void AudioIO::DrainRecordBuffers()
                      width = (*iter)->NChannels();
                }
             }};
-            size_t discarded = 0;
 
             if (!mRecordingSchedule.mLatencyCorrected) {
                const auto correction = mRecordingSchedule.TotalCorrection();
@@ -2187,21 +2283,6 @@ void AudioIO::DrainRecordBuffers()
                      // Do not dither recordings
                      narrowestSampleFormat);
                }
-               else {
-                  // Leftward shift
-                  // discard some samples from the ring buffers.
-                  size_t size = floor(
-                     mRecordingSchedule.ToDiscard() * mRate );
-
-                  // The ring buffer might have grown concurrently -- don't discard more
-                  // than the "avail" value noted above.
-                  discarded = mCaptureBuffers[i]->Discard(std::min(avail, size));
-
-                  if (discarded < size)
-                     // We need to visit this again to complete the
-                     // discarding.
-                     latencyCorrected = false;
-               }
             }
 
             const float *pCrossfadeSrc = nullptr;
@@ -2221,8 +2302,7 @@ void AudioIO::DrainRecordBuffers()
                }
             }
 
-            wxASSERT(discarded <= avail);
-            size_t toGet = avail - discarded;
+            size_t toGet = toConsume;
             SampleBuffer temp;
             size_t size;
             sampleFormat format;
@@ -2237,7 +2317,7 @@ void AudioIO::DrainRecordBuffers()
                   format = mCaptureFormat;
                temp.Allocate(size, format);
                const auto got =
-                  mCaptureBuffers[i]->Get(temp.ptr(), format, toGet);
+                  mCaptureBuffer->Peek(i, temp.ptr(), format, toGet);
                // wxASSERT(got == toGet);
                // but we can't assert in this thread
                wxUnusedVar(got);
@@ -2251,7 +2331,7 @@ void AudioIO::DrainRecordBuffers()
                SampleBuffer temp1(toGet, floatSample);
                temp.Allocate(size, format);
                const auto got =
-                  mCaptureBuffers[i]->Get(temp1.ptr(), floatSample, toGet);
+                  mCaptureBuffer->Peek(i, temp1.ptr(), floatSample, toGet);
                // wxASSERT(got == toGet);
                // but we can't assert in this thread
                wxUnusedVar(got);
@@ -2569,7 +2649,8 @@ void AudioIoCallback::CheckSoundActivatedRecordingLevel(
 void AudioIoCallback::AddToOutputChannel(unsigned int chan,
    float * outputMeterFloats,
    float * outputFloats,
-   const float * tempBuf,
+   const float * source,
+   const MultiChannelRingBuffer::Spans &spans,
    bool drop,
    const unsigned long len,
    const PlayableSequence &ps,
@@ -2583,10 +2664,21 @@ void AudioIoCallback::AddToOutputChannel(unsigned int chan,
 
    // Output volume emulation: possibly copy meter samples, then
    // apply volume, then copy to the output buffer
+   // Visit the samples in place in the ring buffer, in at most two spans,
+   // and not past len
+   const auto forEachSample = [&](auto f){
+      unsigned i = 0;
+      for (const auto &span : spans) {
+         const auto samples = source + span.offset;
+         for (size_t j = 0; j < span.length && i < len; ++i, ++j)
+            f(i, samples[j]);
+      }
+   };
+
    if (outputMeterFloats != outputFloats)
-      for ( unsigned i = 0; i < len; ++i)
-         outputMeterFloats[numPlaybackChannels*i+chan] +=
-            gain*tempBuf[i];
+      forEachSample([&](unsigned i, float sample){
+         outputMeterFloats[numPlaybackChannels*i+chan] += gain*sample;
+      });
 
    // DV: We use gain to emulate panning.
    // Let's keep the old behavior for panning.
@@ -2604,8 +2696,10 @@ void AudioIoCallback::AddToOutputChannel(unsigned int chan,
    // framesPerBuffer, which is influenced by the portAudio implementation in
    // opaque ways
    float deltaGain = (gain - oldGain) / len;
-   for (unsigned i = 0; i < len; i++)
-      outputFloats[numPlaybackChannels*i+chan] += (oldGain + deltaGain * i) *tempBuf[i];
+   forEachSample([&](unsigned i, float sample){
+      outputFloats[numPlaybackChannels*i+chan] +=
+         (oldGain + deltaGain * i) * sample;
+   });
 };
 
 // Limit values to -1.0..+1.0
@@ -2652,15 +2746,6 @@ bool AudioIoCallback::FillOutputBuffers(
       return true;
    }
 
-   // ------ MEMORY ALLOCATION ----------------------
-   // These are small structures.
-   const auto tempBufs = stackAllocate(float *, numPlaybackChannels);
-
-   // And these are larger structures....
-   for (unsigned int c = 0; c < numPlaybackChannels; c++)
-      tempBufs[c] = stackAllocate(float, framesPerBuffer);
-   // ------ End of MEMORY ALLOCATION ---------------
-
    // Choose a common size to take from all ring buffers
    const auto toGet =
       std::min<size_t>(framesPerBuffer, GetCommonlyReadyPlayback());
@@ -2680,17 +2765,12 @@ bool AudioIoCallback::FillOutputBuffers(
 
    bool drop = false;        // Sequence should become silent.
    bool discardable = false; // Sequence has already been faded to silence.
-   // mPlaybackBuffers buffers correspond many-to-one with mPlaybackSequences
-   size_t iBuffer = 0;
+   // mPlaybackBuffers correspond one-to-one with mPlaybackSequences
    for (unsigned tt = 0; tt < numPlaybackSequences; ++tt) {
       auto vt = mPlaybackSequences[tt].get();
+      auto &ringBuffer = *mPlaybackBuffers[tt];
       const auto width = vt->NChannels();
 
-      // IF mono THEN clear 'the other' channel.
-      if (width < numPlaybackChannels)
-         // TODO: more-than-two-channels
-         memset(tempBufs[1], 0, framesPerBuffer * sizeof(float));
-
       // Check for asynchronous user changes in mute, solo, pause status
       discardable = drop = SequenceShouldBeSilent(*vt);
 
@@ -2701,30 +2781,26 @@ bool AudioIoCallback::FillOutputBuffers(
 
       decltype(framesPerBuffer) len = 0;
 
-      for (size_t c = 0; c < width; ++c) {
-         if (discardable) {
-            len = mPlaybackBuffers[iBuffer]->Discard(toGet);
-            // keep going here.
-            // we may still need to issue a paComplete.
-
-            // Keep tempBufs initialized to avoid NaNs and Infs
-            memset(tempBufs[c], 0, framesPerBuffer * sizeof(float));
-         }
-         else {
-            len = mPlaybackBuffers[iBuffer]
-               ->Get((samplePtr)tempBufs[c], floatSample, toGet);
-            // wxASSERT( len == toGet );
-            if (len < framesPerBuffer)
-               // This used to happen normally at the end of non-looping
-               // plays, but it can also be an anomalous case where the
-               // supply from SequenceBufferExchange fails to keep up with the
-               // real-time demand in this thread (see bug 1932).  We
-               // must supply something to the sound card, so pad it with
-               // zeroes and not random garbage.
-               memset((void*)&tempBufs[c][len], 0,
-                  (framesPerBuffer - len) * sizeof(float));
-         }
-         ++iBuffer;
+      // Samples are used in place; spans stay empty for discarded samples
+      MultiChannelRingBuffer::Spans spans{};
+      if (discardable) {
+         len = ringBuffer.Discard(toGet);
+         // keep going here.
+         // we may still need to issue a paComplete.
+      }
+      else {
+         // Asking for the whole buffer counts the underruns
+         spans = ringBuffer.GetReadable(framesPerBuffer);
+         len = std::min<size_t>(
+            toGet, MultiChannelRingBuffer::TotalLength(spans));
+         // wxASSERT( len == toGet );
+         // If len < framesPerBuffer:
+         // This used to happen normally at the end of non-looping
+         // plays, but it can also be an anomalous case where the
+         // supply from SequenceBufferExchange fails to keep up with the
+         // real-time demand in this thread (see bug 1932).  We
+         // must supply something to the sound card; the frames past the
+         // spans add nothing to the zeroes or playthrough already there.
       }
 
       // PRL:  More recent rewrites of SequenceBufferExchange should guarantee a
@@ -2735,7 +2811,7 @@ bool AudioIoCallback::FillOutputBuffers(
       len = mMaxFramesOutput;
 
       // Realtime effect transformation of the sound used to happen here
-      // but it is now done already on the producer side of the RingBuffer
+      // but it is now done already on the producer side of the ring buffer
 
       // Mix the results with the existing output (software playthrough) and
       // apply panning.  If post panning effects are desired, the panning would
@@ -2747,17 +2823,25 @@ bool AudioIoCallback::FillOutputBuffers(
       // the device. For example mono channels output to both left and right
       // output channels.
       if (len > 0) {
+         // Playback buffers have float format: see AllocateBuffers
+         const auto channel = [&](size_t c){
+            return reinterpret_cast<const float*>(ringBuffer.GetPointer(c, 0));
+         };
          auto &gains = mOldChannelGains[tt];
          AddToOutputChannel(0, outputMeterFloats, outputFloats,
-            tempBufs[0], drop, len, *vt, gains[0]);
+            channel(0), spans, drop, len, *vt, gains[0]);
 
          // If one of mPlaybackSequences is mono, this replicates it in both
          // device channels
-         const auto iBuffer = std::min<size_t>(1, width - 1);
+         const auto iChannel = std::min<size_t>(1, width - 1);
          AddToOutputChannel(1, outputMeterFloats, outputFloats,
-            tempBufs[iBuffer], drop, len, *vt, gains[1]);
+            channel(iChannel), spans, drop, len, *vt, gains[1]);
       }
 
+      // Release the samples only after using them in place
+      if (!discardable)
+         ringBuffer.Consume(toGet);
+
       CallbackCheckCompletion(mCallbackReturn, len);
       if (discardable) // no samples to process, they've been discarded
          continue;
@@ -2798,11 +2882,10 @@ void AudioIoCallback::UpdateTimePosition(unsigned long framesPerBuffer)
 //
 // Copy from PortAudio input buffers to our intermediate recording buffers.
 //
-void AudioIoCallback::DrainInputBuffers(
+size_t AudioIoCallback::DrainInputBuffers(
    constSamplePtr inputBuffer,
    unsigned long framesPerBuffer,
-   const PaStreamCallbackFlags statusFlags,
-   float * tempFloats
+   const PaStreamCallbackFlags statusFlags
 )
 {
    const auto numPlaybackChannels = mNumPlaybackChannels;
@@ -2810,11 +2893,11 @@ void AudioIoCallback::DrainInputBuffers(
 
    // Quick returns if next to nothing to do.
    if (mStreamToken <= 0)
-      return;
+      return 0;
    if( !inputBuffer )
-      return;
+      return 0;
    if( numCaptureChannels <= 0 )
-      return;
+      return 0;
 
    // If there are no playback sequences, and we are recording, then the
    // earlier checks for being past the end won't happen, so do it here.
@@ -2832,9 +2915,8 @@ void AudioIoCallback::DrainInputBuffers(
    // So we have not decided to enable this extra detection yet in
    // production
 
-   size_t len = framesPerBuffer;
-   for(unsigned t = 0; t < numCaptureChannels; t++)
-      len = std::min( len, mCaptureBuffers[t]->AvailForPut() );
+   size_t len = std::min<size_t>(
+      framesPerBuffer, mCaptureBuffer->AvailForPut() );
 
    if (mSimulateRecordingErrors && 100LL * rand() < RAND_MAX)
       // Make spurious errors for purposes of testing the error
@@ -2843,7 +2925,7 @@ void AudioIoCallback::DrainInputBuffers(
 
    // A different symptom is that len < framesPerBuffer because
    // the other thread, executing SequenceBufferExchange, isn't consuming fast
-   // enough from mCaptureBuffers; maybe it's CPU-bound, or maybe the
+   // enough from mCaptureBuffer; maybe it's CPU-bound, or maybe the
    // storage device it writes is too slow
    if (mDetectDropouts &&
          ((mDetectUpstreamDropouts.load(std::memory_order_relaxed)
@@ -2871,55 +2953,58 @@ void AudioIoCallback::DrainInputBuffers(
    }
 
    if (len <= 0)
-      return;
+      return 0;
 
-   // We have an ASSERT in the AudioIO constructor to alert us to
-   // possible issues with the (short*) cast.  We'd have a problem if
-   // sizeof(short) > sizeof(float) since our buffers are sized for floats.
+   // Un-interleave directly into the ring buffer, in at most two spans
+   // common to all channels
+   const auto spans = mCaptureBuffer->GetWritable(len);
    for(unsigned t = 0; t < numCaptureChannels; t++) {
-
-      // dmazzoni:
-      // Un-interleave.  Ugly special-case code required because the
-      // capture channels could be in three different sample formats;
-      // it'd be nice to be able to call CopySamples, but it can't
-      // handle multiplying by the gain and then clipping.  Bummer.
-
-      switch(mCaptureFormat) {
-         case floatSample: {
-            auto inputFloats = (const float *)inputBuffer;
-            for(unsigned i = 0; i < len; i++)
-               tempFloats[i] =
-                  inputFloats[numCaptureChannels*i+t];
-         } break;
-         case int24Sample:
-            // We should never get here. Audacity's int24Sample format
-            // is different from PortAudio's sample format and so we
-            // make PortAudio return float samples when recording in
-            // 24-bit samples.
-            wxASSERT(false);
-            break;
-         case int16Sample: {
-            auto inputShorts = (const short *)inputBuffer;
-            short *tempShorts = (short *)tempFloats;
-            for( unsigned i = 0; i < len; i++) {
-               float tmp = inputShorts[numCaptureChannels*i+t];
-               tmp = std::clamp(tmp, -32768.0f, 32767.0f);
-               tempShorts[i] = (short)(tmp);
-            }
-         } break;
-      } // switch
-
-      // JKC: mCaptureFormat must be for samples with sizeof(float) or
-      // fewer bytes (because tempFloats is sized for floats).  All
-      // formats are 2 or 4 bytes, so we are OK.
-      const auto put =
-         mCaptureBuffers[t]->Put(
-            (samplePtr)tempFloats, mCaptureFormat, len);
-      // wxASSERT(put == len);
-      // but we can't assert in this thread
-      wxUnusedVar(put);
-      mCaptureBuffers[t]->Flush();
+      size_t i = 0;
+      for (const auto &span : spans) {
+         const auto dest = mCaptureBuffer->GetPointer(t, span.offset);
+
+         // dmazzoni:
+         // Un-interleave.  Ugly special-case code required because the
+         // capture channels could be in three different sample formats;
+         // it'd be nice to be able to call CopySamples, but it can't
+         // handle multiplying by the gain and then clipping.  Bummer.
+
+         switch(mCaptureFormat) {
+            case floatSample: {
+               auto inputFloats = (const float *)inputBuffer;
+               auto destFloats = (float *)dest;
+               for(size_t j = 0; j < span.length; j++)
+                  destFloats[j] =
+                     inputFloats[numCaptureChannels*(i+j)+t];
+            } break;
+            case int24Sample:
+               // We should never get here. Audacity's int24Sample format
+               // is different from PortAudio's sample format and so we
+               // make PortAudio return float samples when recording in
+               // 24-bit samples.
+               wxASSERT(false);
+               break;
+            case int16Sample: {
+               auto inputShorts = (const short *)inputBuffer;
+               auto destShorts = (short *)dest;
+               for(size_t j = 0; j < span.length; j++) {
+                  float tmp = inputShorts[numCaptureChannels*(i+j)+t];
+                  tmp = std::clamp(tmp, -32768.0f, 32767.0f);
+                  destShorts[j] = (short)(tmp);
+               }
+            } break;
+         } // switch
+         i += span.length;
+      }
    }
+
+   // Publish all channels at once
+   const auto put =
+      mCaptureBuffer->Produce(MultiChannelRingBuffer::TotalLength(spans));
+   // wxASSERT(put == len);
+   // but we can't assert in this thread
+   mCaptureBuffer->Flush();
+   return put;
 }
 
 
@@ -3076,7 +3161,7 @@ bool AudioIoCallback::SequenceHasBeenFadedOut(const OldChannelGains &gains)
 bool AudioIoCallback::AllSequencesAlreadySilent()
 {
    for (size_t ii = 0, nn = mPlaybackSequences.size(); ii < nn; ++ii) {
-      auto vt = mPlaybackSequences[ii];
+      const auto &vt = mPlaybackSequences[ii];
       const auto &oldGains = mOldChannelGains[ii];
       if (!(SequenceShouldBeSilent(*vt) && SequenceHasBeenFadedOut(oldGains)))
          return false;
@@ -3104,6 +3189,9 @@ int AudioIoCallback::AudioCallback(
    const PaStreamCallbackTimeInfo *timeInfo,
    const PaStreamCallbackFlags statusFlags, void * WXUNUSED(userData) )
 {
+   // Nothing here should allocate or lock
+   RealtimeSafety::Scope realtimeSafety;
+
    // Poll sequences for change of state.
    // (User might click mute and solo buttons.)
    mbHasSoloSequences = CountSoloingSequences() > 0 ;
@@ -3127,8 +3215,8 @@ int AudioIoCallback::AudioCallback(
    }
 
    // ------ MEMORY ALLOCATIONS -----------------------------------------------
-   // tempFloats will be a reusable scratch pad for (possibly format converted)
-   // audio data.  One temporary use is for the InputMeter data.
+   // tempFloats will be a scratch pad for (possibly format converted)
+   // audio data for the InputMeter.
    const auto numPlaybackChannels = mNumPlaybackChannels;
    const auto numCaptureChannels = mNumCaptureChannels;
    const auto tempFloats = stackAllocate(float,
@@ -3198,11 +3286,13 @@ int AudioIoCallback::AudioCallback(
    UpdateTimePosition(framesPerBuffer);
 
    // To capture input into sequence (sound from microphone)
-   DrainInputBuffers(
+   const auto captured = DrainInputBuffers(
       inputBuffer,
       framesPerBuffer,
-      statusFlags,
-      tempFloats);
+      statusFlags);
+
+   // Let the audio thread replenish and drain the buffers
+   WakeAudioThreadForFrames(mMaxFramesOutput, captured);
 
    SendVuOutputMeterData( outputMeterFloats, framesPerBuffer);
 
@@ -3215,6 +3305,10 @@ int AudioIoCallback::AudioCallback(
 
 int AudioIoCallback::CallbackDoSeek()
 {
+   // A seek deliberately stalls the callback, until the audio thread has
+   // refilled the buffers
+   RealtimeSafety::Exemption realtimeSafetyExemption;
+
    const int token = mStreamToken;
    wxMutexLocker locker(mSuspendAudioThread);
    if (token != mStreamToken)
@@ -3235,11 +3329,11 @@ int AudioIoCallback::CallbackDoSeek()
    mAudioThreadSequenceBufferExchangeLoopRunning
       .store(false, std::memory_order_relaxed);
 
-   while( mAudioThreadSequenceBufferExchangeLoopActive
-      .load(std::memory_order_relaxed ) )
    {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
+      auto lock = std::unique_lock{ mAudioThreadMutex };
+      mAudioThreadCondition.wait(lock, [this]{
+         return !mAudioThreadSequenceBufferExchangeLoopActive
+            .load(std::memory_order_relaxed); });
    }
 
    // Calculate the NEW time position, in the PortAudio callback
@@ -3269,6 +3363,7 @@ int AudioIoCallback::CallbackDoSeek()
    // Reenable the audio thread
    mAudioThreadSequenceBufferExchangeLoopRunning
       .store(true, std::memory_order_relaxed);
+   mAudioThreadWakeup.Post();
 
    return paContinue;
 }
@@ -3300,43 +3395,61 @@ auto AudioIoCallback::AudioIOExtIterator::operator *() const -> AudioIOExt &
 void AudioIoCallback::StartAudioThread()
 {
    mAudioThreadSequenceBufferExchangeLoopRunning.store(true, std::memory_order_release);
+   mAudioThreadWakeup.Post();
 }
 
 void AudioIoCallback::WaitForAudioThreadStarted()
 {
-   while (mAudioThreadAcknowledge.load(std::memory_order_acquire) != Acknowledge::eStart)
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
-   }
-   mAudioThreadAcknowledge.store(Acknowledge::eNone, std::memory_order_release);
+   auto lock = std::unique_lock{ mAudioThreadMutex };
+   mAudioThreadCondition.wait(lock, [this]{
+      return mAudioThreadAcknowledge == Acknowledge::eStart; });
+   mAudioThreadAcknowledge = Acknowledge::eNone;
 }
 
 void AudioIoCallback::StopAudioThread()
 {
    mAudioThreadSequenceBufferExchangeLoopRunning.store(false, std::memory_order_release);
+   mAudioThreadWakeup.Post();
 }
 
 void AudioIoCallback::WaitForAudioThreadStopped()
 {
-   while (mAudioThreadAcknowledge.load(std::memory_order_acquire) != Acknowledge::eStop)
+   auto lock = std::unique_lock{ mAudioThreadMutex };
+   mAudioThreadCondition.wait(lock, [this]{
+      return mAudioThreadAcknowledge == Acknowledge::eStop; });
+   mAudioThreadAcknowledge = Acknowledge::eNone;
+}
+
+void AudioIoCallback::SetAcknowledge(Acknowledge acknowledge)
+{
    {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
+      auto lock = std::lock_guard{ mAudioThreadMutex };
+      mAudioThreadAcknowledge = acknowledge;
    }
-   mAudioThreadAcknowledge.store(Acknowledge::eNone, std::memory_order_release);
+   mAudioThreadCondition.notify_all();
 }
 
-void AudioIoCallback::ProcessOnceAndWait(std::chrono::milliseconds sleepTime)
+void AudioIoCallback::ProcessOnceAndWait()
 {
    mAudioThreadShouldCallSequenceBufferExchangeOnce
       .store(true, std::memory_order_release);
+   mAudioThreadWakeup.Post();
 
-   while (mAudioThreadShouldCallSequenceBufferExchangeOnce
-      .load(std::memory_order_acquire))
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(sleepTime);
+   auto lock = std::unique_lock{ mAudioThreadMutex };
+   mAudioThreadCondition.wait(lock, [this]{
+      return !mAudioThreadShouldCallSequenceBufferExchangeOnce
+         .load(std::memory_order_acquire); });
+}
+
+void AudioIoCallback::WakeAudioThreadForFrames(size_t played, size_t captured)
+{
+   // Post only once per batch of work, not at every callback
+   mPlaybackFramesSinceWakeup += played;
+   mCaptureFramesSinceWakeup += captured;
+   if (mPlaybackFramesSinceWakeup >= mPlaybackSamplesToCopy ||
+       mCaptureFramesSinceWakeup >= mMinCaptureSecsToCopy * mRate) {
+      mPlaybackFramesSinceWakeup = mCaptureFramesSinceWakeup = 0;
+      mAudioThreadWakeup.Post();
    }
 }
 
@@ -17,9 +17,11 @@
 #include "AudioIOSequences.h"
 #include "PlaybackSchedule.h" // member variable
 
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <utility>
 #include <wx/atomic.h> // member variable
@@ -27,12 +29,14 @@
 #include "PluginProvider.h" // for PluginID
 #include "Observer.h"
 #include "SampleCount.h"
+#include "MultiChannelRingBuffer.h"
 #include "SampleFormat.h"
+#include "SequencePrefetcher.h"
+#include "concurrency/Semaphore.h"
 
 class wxArrayString;
 class AudioIOBase;
 class AudioIO;
-class RingBuffer;
 class Mixer;
 class OtherPlayableSequence;
 class RealtimeEffectState;
@@ -194,12 +198,15 @@ public:
    );
 
    /*!
+    @param source the storage of the channel in a playback buffer, at offsets
+    given by `spans`; frames past the spans, up to `len`, count as zeroes
     @param[in,out] channelGain
     */
    void AddToOutputChannel( unsigned int chan, // index into gains
       float * outputMeterFloats,
       float * outputFloats,
-      const float * tempBuf,
+      const float * source,
+      const MultiChannelRingBuffer::Spans &spans,
       bool drop,
       unsigned long len,
       const PlayableSequence &ps,
@@ -210,11 +217,11 @@ public:
       unsigned long framesPerBuffer,
       float *outputMeterFloats
    );
-   void DrainInputBuffers(
+   //! @return how many frames were queued for the audio thread
+   size_t DrainInputBuffers(
       constSamplePtr inputBuffer, 
       unsigned long framesPerBuffer,
-      const PaStreamCallbackFlags statusFlags,
-      float * tempFloats
+      const PaStreamCallbackFlags statusFlags
    );
    void UpdateTimePosition(
       unsigned long framesPerBuffer
@@ -268,10 +275,14 @@ public:
 
    std::vector<std::unique_ptr<Resample>> mResample;
 
-   using RingBuffers = std::vector<std::unique_ptr<RingBuffer>>;
-   RingBuffers mCaptureBuffers;
+   //! One channel for each of mNumCaptureChannels
+   std::unique_ptr<MultiChannelRingBuffer> mCaptureBuffer;
    RecordableSequences mCaptureSequences;
-   /*! Read by worker threads but unchanging during playback */
+   using RingBuffers = std::vector<std::unique_ptr<MultiChannelRingBuffer>>;
+   /*! Correspond one-to-one with mPlaybackSequences, each with the same
+    number of channels, except that there is one buffer when there are no
+    sequences.
+    Read by worker threads but unchanging during playback */
    RingBuffers mPlaybackBuffers;
    ConstPlayableSequences      mPlaybackSequences;
    // Old gain is used in playback in linearly interpolating
@@ -282,6 +293,8 @@ public:
    std::vector<float *> mScratchPointers; //!< pointing into mScratchBuffers
 
    std::vector<std::unique_ptr<Mixer>> mPlaybackMixers;
+   //! Correspond one-to-one with mPlaybackSequences; read ahead of the mixers
+   std::vector<std::unique_ptr<SequencePrefetcher>> mPlaybackPrefetchers;
 
    std::atomic<float>  mMixerOutputVol{ 1.0 };
    static int          mNextStreamToken;
@@ -294,7 +307,7 @@ public:
    PlaybackPolicy::Duration mPlaybackRingBufferSecs;
    double              mCaptureRingBufferSecs;
 
-   /// Preferred batch size for replenishing the playback RingBuffer
+   /// Preferred batch size for replenishing the playback ring buffers
    size_t              mPlaybackSamplesToCopy;
    /// Hardware output latency in frames
    size_t              mHardwarePlaybackLatencyFrames {};
@@ -318,8 +331,26 @@ public:
    std::atomic<bool>   mAudioThreadShouldCallSequenceBufferExchangeOnce;
    std::atomic<bool>   mAudioThreadSequenceBufferExchangeLoopRunning;
    std::atomic<bool>   mAudioThreadSequenceBufferExchangeLoopActive;
-      
-   std::atomic<Acknowledge>  mAudioThreadAcknowledge;
+
+   //! Guards mAudioThreadAcknowledge, and the ends of passes of the audio
+   //! thread that other threads wait for with mAudioThreadCondition
+   std::mutex          mAudioThreadMutex;
+   std::condition_variable mAudioThreadCondition;
+   Acknowledge         mAudioThreadAcknowledge{ Acknowledge::eNone };
+
+   //! Ends the wait of the audio thread between passes early
+   audacity::concurrency::Semaphore mAudioThreadWakeup;
+   //! Frames played and captured by the PortAudio callback since it last
+   //! posted mAudioThreadWakeup; used only by the callback
+   size_t              mPlaybackFramesSinceWakeup{ 0 };
+   size_t              mCaptureFramesSinceWakeup{ 0 };
+
+   //! Called by the PortAudio callback; wakes the audio thread when it has
+   //! a batch of samples to replenish or to drain
+   void WakeAudioThreadForFrames(size_t played, size_t captured);
+   //! Called by the audio thread to answer StartAudioThread() or
+   //! StopAudioThread()
+   void SetAcknowledge(Acknowledge acknowledge);
 
    // Async start/stop + wait of AudioThread processing.
    // Provided to allow more flexibility, however use with caution:
@@ -329,7 +360,7 @@ public:
    void StopAudioThread();
    void WaitForAudioThreadStopped();
 
-   void ProcessOnceAndWait( std::chrono::milliseconds sleepTime = std::chrono::milliseconds(50) );
+   void ProcessOnceAndWait();
 
 
 
@@ -342,8 +373,8 @@ public:
    PaError             mLastPaError;
 
 protected:
-   static size_t MinValue(
-      const RingBuffers &buffers, size_t (RingBuffer::*pmf)() const);
+   static size_t MinValue(const RingBuffers &buffers,
+      size_t (MultiChannelRingBuffer::*pmf)() const);
 
    float GetMixerOutputVol() {
       return mMixerOutputVol.load(std::memory_order_relaxed); }
@@ -489,6 +520,20 @@ public:
     * by the specified amount from where it is now */
    void SeekStream(double seconds) { mSeek = seconds; }
 
+   //! Look-ahead depth and stall counts of the read-ahead of each playback
+   //! sequence of the current stream
+   std::vector<SequencePrefetcher::Statistics> GetPrefetchStatistics() const;
+
+   //! Occupancy and underruns of the buffer of each playback sequence of the
+   //! current stream
+   std::vector<MultiChannelRingBuffer::Statistics>
+      GetPlaybackBufferStatistics() const;
+
+   //! Occupancy and underruns of the recording buffer of the current stream,
+   //! if recording
+   std::optional<MultiChannelRingBuffer::Statistics>
+      GetCaptureBufferStatistics() const;
+
    using PostRecordingAction = std::function<void()>;
    
    //! Enqueue action for main thread idle time, not before the end of any recording in progress
@@ -611,8 +656,8 @@ private:
    /*!
     Called in a loop from another worker thread that does not have the low-latency constraints
     of the PortAudio callback thread.  Does less frequent and larger batches of work that may
-    include memory allocations and database operations.  RingBuffer objects mediate the transfer
-    between threads, to overcome the mismatch of their batch sizes.
+    include memory allocations and database operations.  MultiChannelRingBuffer objects mediate the
+    transfer between threads, to overcome the mismatch of their batch sizes.
     */
    void SequenceBufferExchange();
 
@@ -623,6 +668,9 @@ private:
    bool ProcessPlaybackSlices(
       std::optional<RealtimeEffects::ProcessingScope> &pScope,
       size_t available);
+   //! Request read-ahead of the sequences beyond the time last produced,
+   //! as predicted by the playback schedule
+   void PrefetchPlayback();
 
    //! Second part of SequenceBufferExchange
    void DrainRecordBuffers();
@@ -642,7 +690,7 @@ private:
     * all record buffers without underflow). */
    size_t GetCommonlyAvailCapture();
 
-   /** \brief Allocate RingBuffer structures, and others, needed for playback
+   /** \brief Allocate ring buffers, and others, needed for playback
      * and recording.
      *
      * Returns true iff successful.
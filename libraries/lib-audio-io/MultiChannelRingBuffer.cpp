@@ -0,0 +1,267 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file MultiChannelRingBuffer.cpp
+
+  Assuming that there is only one thread writing, and one thread reading,
+  this class implements a lock-free thread-safe bounded queue of frames
+  with atomic variables that contain the first filled and free positions,
+  common to all channels.
+
+  AvailForPut and AvailForGet may underestimate but will never
+  overestimate.
+
+**********************************************************************/
+#include "MultiChannelRingBuffer.h"
+#include "Dither.h"
+#include <algorithm>
+#include <cstring>
+
+MultiChannelRingBuffer::MultiChannelRingBuffer(
+   sampleFormat format, size_t nChannels, size_t size)
+   : mBufferSize{ std::max<size_t>(size, 64) }
+   , mChannels{ std::max<size_t>(nChannels, 1) }
+   , mFormat{ format }
+   , mBuffer{ mChannels * mBufferSize, mFormat }
+{
+}
+
+MultiChannelRingBuffer::~MultiChannelRingBuffer()
+{
+}
+
+samplePtr MultiChannelRingBuffer::GetPointer(
+   size_t iChannel, size_t offset) const
+{
+   return mBuffer.ptr() +
+      (iChannel * mBufferSize + offset) * SAMPLE_SIZE(mFormat);
+}
+
+// Calculations of free and filled space, given snapshots taken of the start
+// and end values
+
+size_t MultiChannelRingBuffer::Filled(size_t start, size_t end) const
+{
+   return (end + mBufferSize - start) % mBufferSize;
+}
+
+size_t MultiChannelRingBuffer::Free(size_t start, size_t end) const
+{
+   return std::max<size_t>(mBufferSize - Filled( start, end ), 4) - 4;
+}
+
+auto MultiChannelRingBuffer::MakeSpans(size_t pos, size_t frames) const
+   -> Spans
+{
+   const auto length0 = std::min(frames, mBufferSize - pos);
+   return {{ { pos, length0 }, { 0, frames - length0 } }};
+}
+
+//
+// For the writer only:
+// Only writer reads or writes mWritten
+// Only writer writes the end, so it can read it again relaxed
+// And it reads the start written by reader, with acquire order,
+// so that any reading done before Consume() happens-before any reuse of the
+// space.
+//
+
+size_t MultiChannelRingBuffer::AvailForPut() const
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Free( start, mWritten );
+}
+
+size_t MultiChannelRingBuffer::WrittenForGet() const
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Filled( start, mWritten );
+}
+
+auto MultiChannelRingBuffer::GetWritable(size_t frames) const -> Spans
+{
+   auto start = mStart.load( std::memory_order_acquire );
+   return MakeSpans(mWritten, std::min(frames, Free( start, mWritten )));
+}
+
+void MultiChannelRingBuffer::Write(size_t iChannel, const Spans &spans,
+   constSamplePtr buffer, sampleFormat format, size_t count)
+{
+   auto src = buffer;
+   for (const auto &span : spans) {
+      const auto block = std::min(count, span.length);
+      if (src) {
+         CopySamples(src, format,
+            GetPointer(iChannel, span.offset), mFormat,
+            block, DitherType::none);
+         src += block * SAMPLE_SIZE(format);
+      }
+      else
+         ClearSamples(GetPointer(iChannel, 0), mFormat, span.offset, block);
+      // Pad
+      ClearSamples(GetPointer(iChannel, 0), mFormat,
+         span.offset + block, span.length - block);
+      count -= block;
+   }
+}
+
+size_t MultiChannelRingBuffer::Produce(size_t frames, size_t padding)
+{
+   auto start = mStart.load( std::memory_order_acquire );
+   frames = std::min( frames, Free( start, mWritten ) );
+   mLastPadding = std::min( padding, frames );
+   mWritten = (mWritten + frames) % mBufferSize;
+   return frames;
+}
+
+size_t MultiChannelRingBuffer::Unput(size_t size)
+{
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+
+   // un-put some of the un-flushed data which is from mEnd to mWritten
+   // bound the result
+   const auto end = mEnd.load(std::memory_order_relaxed);
+   size = std::min(size, Filled(end, mWritten));
+   const auto result = size;
+
+   // The same moves in every channel
+   // First memmove
+   const auto limit = end < mWritten ? mWritten : mBufferSize;
+   // Source offset for move
+   const auto source = std::min(end + size, limit);
+   // How many to move
+   const auto count = limit - source;
+   // Discount how many really discarded
+   size -= (source - end);
+
+   for (size_t iChannel = 0; iChannel < mChannels; ++iChannel) {
+      const auto buffer = GetPointer(iChannel, 0);
+      auto pDst = buffer + end * sampleSize;
+      auto pSrc = buffer + source * sampleSize;
+      memmove(pDst, pSrc, count * sampleSize);
+
+      if (end >= mWritten) {
+         // The unflushed data were wrapped around, not contiguous
+         // Rotate some samples from start of buffer, but discarding
+         // any remaining number that must be un-put
+         // Then shift samples near the start of buffer
+         pDst = buffer + (end + count) * sampleSize;
+         pSrc = buffer + size * sampleSize;
+         auto toMove = mWritten - size;
+         auto toMove1 = std::min(toMove, mBufferSize - (end + count));
+         auto toMove2 = toMove - toMove1;
+         memmove(pDst, pSrc, toMove1 * sampleSize);
+         memmove(buffer, pSrc + toMove1 * sampleSize, toMove2 * sampleSize);
+      }
+   }
+
+   // Move mWritten backwards by result
+   mWritten = (mWritten + (mBufferSize - result)) % mBufferSize;
+
+   // Adjust mLastPadding
+   mLastPadding = std::min(mLastPadding, Filled(end, mWritten));
+
+   return result;
+}
+
+auto MultiChannelRingBuffer::GetUnflushed(unsigned iBlock) const -> Span
+{
+   // Find total number of frames unflushed:
+   auto end = mEnd.load(std::memory_order_relaxed);
+   const auto spans = MakeSpans(end, Filled(end, mWritten) - mLastPadding);
+   return spans[iBlock ? 1 : 0];
+}
+
+void MultiChannelRingBuffer::Flush()
+{
+   // Atomically update the end pointer with release, so the nonatomic writes
+   // just done to the buffer don't get reordered after
+   mEnd.store(mWritten, std::memory_order_release);
+   mLastPadding = 0;
+
+   const auto filled =
+      Filled( mStart.load( std::memory_order_relaxed ), mWritten );
+   if (filled > mHighWater.load( std::memory_order_relaxed ))
+      mHighWater.store( filled, std::memory_order_relaxed );
+}
+
+//
+// For the reader only:
+// Only reader writes the start, so it can read it again relaxed
+// But it reads the end written by the writer, who also sends sample data
+// with the changes of end; therefore that must be read with acquire order
+// if we do more than merely query the size or throw samples away
+//
+
+size_t MultiChannelRingBuffer::AvailForGet() const
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   return Filled( start, end );
+}
+
+auto MultiChannelRingBuffer::GetReadable(size_t frames) -> Spans
+{
+   // Must match the writer's release with acquire for well defined reads of
+   // the buffer
+   auto end = mEnd.load( std::memory_order_acquire );
+   auto start = mStart.load( std::memory_order_relaxed );
+   const auto filled = Filled( start, end );
+   if (filled < frames) {
+      mUnderruns.store(
+         mUnderruns.load( std::memory_order_relaxed ) + 1,
+         std::memory_order_relaxed );
+      frames = filled;
+   }
+   return MakeSpans(start, frames);
+}
+
+size_t MultiChannelRingBuffer::Peek(size_t iChannel,
+   samplePtr buffer, sampleFormat format, size_t frames) const
+{
+   auto end = mEnd.load( std::memory_order_acquire );
+   auto start = mStart.load( std::memory_order_relaxed );
+   frames = std::min( frames, Filled( start, end ) );
+   auto dest = buffer;
+   for (const auto &span : MakeSpans(start, frames)) {
+      CopySamples(GetPointer(iChannel, span.offset), mFormat,
+         dest, format, span.length, DitherType::none);
+      dest += span.length * SAMPLE_SIZE(format);
+   }
+   return frames;
+}
+
+size_t MultiChannelRingBuffer::Consume(size_t frames)
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   frames = std::min( frames, Filled( start, end ) );
+
+   // Communicate to writer that we have consumed some data,
+   // with nonrelaxed ordering
+   mStart.store((start + frames) % mBufferSize, std::memory_order_release);
+
+   return frames;
+}
+
+size_t MultiChannelRingBuffer::Discard(size_t frames)
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   frames = std::min( frames, Filled( start, end ) );
+
+   // Communicate to writer that we have skipped some data, and that's all
+   mStart.store((start + frames) % mBufferSize, std::memory_order_relaxed);
+
+   return frames;
+}
+
+auto MultiChannelRingBuffer::GetStatistics() const -> Statistics
+{
+   return {
+      mBufferSize - 4,
+      mHighWater.load( std::memory_order_relaxed ),
+      mUnderruns.load( std::memory_order_relaxed ),
+   };
+}
@@ -0,0 +1,140 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file MultiChannelRingBuffer.h
+  @brief Lock-free queue of planar samples for several channels at once
+
+**********************************************************************/
+
+#ifndef __AUDACITY_MULTI_CHANNEL_RING_BUFFER__
+#define __AUDACITY_MULTI_CHANNEL_RING_BUFFER__
+
+#include "SampleFormat.h"
+#include <array>
+#include <atomic>
+
+//! Single-producer, single-consumer queue of samples in planar channels that
+//! share one pair of positions
+/*!
+ Besides copying samples in and out, the writer can render directly
+ into the storage through writable spans, then publish them with Produce()
+ and Flush(); and the reader can use samples in place through readable spans,
+ then release them with Consume().  A span is the same for every channel, and
+ at most two spans describe any region, because of the wrap-around.
+
+ Only one atomic store publishes the writes to all channels, and only one
+ releases the reads.
+ */
+class MultiChannelRingBuffer final : public NonInterferingBase {
+ public:
+   //! A contiguous region of every channel
+   struct Span {
+      size_t offset{ 0 };
+      size_t length{ 0 };
+   };
+   //! The region after the wrap-around, if any, is second
+   using Spans = std::array<Span, 2>;
+
+   static size_t TotalLength(const Spans &spans)
+   { return spans[0].length + spans[1].length; }
+
+   //! Counters for diagnosis of the real-time path; may be read by any thread
+   struct Statistics {
+      //! Usable size of each channel, in frames
+      size_t capacity{ 0 };
+      //! Most frames ever flushed and not yet consumed
+      size_t highWater{ 0 };
+      //! Number of times the reader asked for more frames than were ready
+      size_t underruns{ 0 };
+   };
+
+   MultiChannelRingBuffer(
+      sampleFormat format, size_t nChannels, size_t size);
+   ~MultiChannelRingBuffer();
+
+   size_t Channels() const { return mChannels; }
+   sampleFormat Format() const { return mFormat; }
+
+   //! Address of a sample in the storage of a channel
+   samplePtr GetPointer(size_t iChannel, size_t offset) const;
+
+   //
+   // For the writer only:
+   //
+
+   size_t AvailForPut() const;
+   //! Reader may concurrently cause a decrease of what this returns
+   size_t WrittenForGet() const;
+   //! Spans for up to `frames` frames following what was written
+   Spans GetWritable(size_t frames) const;
+   //! Copy `count` samples into one channel of `spans`, which came from
+   //! GetWritable(), and fill the rest of the spans with zeroes
+   /*! Does not apply dithering.  A null `buffer` writes only zeroes */
+   void Write(size_t iChannel, const Spans &spans,
+      constSamplePtr buffer, sampleFormat format, size_t count);
+   //! Advance past frames written in all channels through GetWritable()
+   /*!
+    @param padding how many of the frames are trailing zeroes
+    @return how many were produced, which may be fewer if space is lacking
+    */
+   size_t Produce(size_t frames, size_t padding = 0);
+   //! Remove an initial segment of data that has been produced but not
+   //! Flushed yet, in all channels
+   /*!
+    @return how many were unput
+    */
+   size_t Unput(size_t size);
+   //! Get the span of written but unflushed data, which is in at most two
+   //! spans; excludes the padding of the most recent Produce()
+   Span GetUnflushed(unsigned iBlock) const;
+   //! Flush after a sequence of Produce (and Unput) calls to let consumer see
+   void Flush();
+
+   //
+   // For the reader only:
+   //
+
+   size_t AvailForGet() const;
+   //! Spans for up to `frames` frames that are ready; counts an underrun if
+   //! fewer are ready
+   Spans GetReadable(size_t frames);
+   //! Copy samples out of one channel without consuming them
+   /*! Does not apply dithering */
+   size_t Peek(size_t iChannel,
+      samplePtr buffer, sampleFormat format, size_t frames) const;
+   //! Release frames in all channels that were read in place or by Peek()
+   size_t Consume(size_t frames);
+   //! Throw away ready frames in all channels without reading them
+   size_t Discard(size_t frames);
+
+   //
+   // For any thread:
+   //
+
+   Statistics GetStatistics() const;
+
+ private:
+   size_t Filled(size_t start, size_t end) const;
+   size_t Free(size_t start, size_t end) const;
+   Spans MakeSpans(size_t pos, size_t frames) const;
+
+   size_t mWritten{ 0 };
+   size_t mLastPadding{ 0 };
+
+   // Align the two atomics to avoid false sharing
+   NonInterfering< std::atomic<size_t> > mStart{ 0 }, mEnd{ 0 };
+
+   // Each counter is written by only one of the two threads
+   std::atomic<size_t> mHighWater{ 0 };
+   std::atomic<size_t> mUnderruns{ 0 };
+
+   const size_t mBufferSize;
+   const size_t mChannels;
+
+   const sampleFormat mFormat;
+   //! Channels one after another, each of mBufferSize samples
+   const SampleBuffer mBuffer;
+};
+
+#endif
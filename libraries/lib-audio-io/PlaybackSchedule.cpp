@@ -84,6 +84,7 @@ double PlaybackPolicy::OffsetSequenceTime(
 std::chrono::milliseconds PlaybackPolicy::SleepInterval(PlaybackSchedule &)
 {
    using namespace std::chrono;
+   // The PortAudio callback may wake the audio thread sooner
    return 10ms;
 }
 
@@ -287,7 +288,7 @@ void PlaybackSchedule::TimeQueue::Producer(
       return;
 
    // Don't check available space:  assume it is enough because of coordination
-   // with RingBuffer.
+   // with the ring buffer.
    auto index = mTail.mIndex;
    auto time = mLastTime;
    auto remainder = mTail.mRemainder;
@@ -350,7 +351,7 @@ double PlaybackSchedule::TimeQueue::Consumer( size_t nSamples, double rate )
    }
 
    // Don't check available space:  assume it is enough because of coordination
-   // with RingBuffer.
+   // with the ring buffer.
    auto remainder = mHead.mRemainder;
    auto space = TimeQueueGrainSize - remainder;
    const auto size = mData.size();
@@ -91,7 +91,7 @@ public:
       Duration latency; //!< Try not to let ring buffer contents fall below this
       Duration ringBufferDelay; //!< Length of ring buffer
    };
-   //! Provide hints for construction of playback RingBuffer objects
+   //! Provide hints for construction of playback ring buffers
    virtual BufferTimes SuggestedBufferTimes(PlaybackSchedule &schedule);
 
    //! @section Called by the PortAudio callback thread
@@ -112,7 +112,9 @@ public:
 
    //! @section Called by the AudioIO::SequenceBufferExchange thread
 
-   //! How long to wait between calls to AudioIO::SequenceBufferExchange
+   //! Longest wait between calls to AudioIO::SequenceBufferExchange
+   /*! The PortAudio callback also wakes the audio thread early, when it has
+    consumed a batch of samples */
    virtual std::chrono::milliseconds
       SleepInterval( PlaybackSchedule &schedule );
 
@@ -194,11 +196,11 @@ struct AUDIO_IO_API PlaybackSchedule {
     playback buffers, for the large n == TimeQueueGrainSize.
 
     The "producer" is the Audio thread that fetches samples from tracks and
-    fills the playback RingBuffers.  The "consumer" is the high-latency
-    PortAudio thread that drains the RingBuffers.  The atomics in the
-    RingBuffer implement lock-free synchronization.
+    fills the playback ring buffers.  The "consumer" is the high-latency
+    PortAudio thread that drains the ring buffers.  The atomics in the
+    MultiChannelRingBuffer implement lock-free synchronization.
 
-    This other structure relies on the RingBuffer's synchronization, and adds
+    This other structure relies on the ring buffer's synchronization, and adds
     other information to the stream of samples:  which track times they
     correspond to.
 
@@ -0,0 +1,252 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MultiChannelRingBufferTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "MultiChannelRingBuffer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+using Spans = MultiChannelRingBuffer::Spans;
+using Samples = std::vector<float>;
+
+namespace {
+// The smallest size that the buffer allows; four frames are never usable
+constexpr size_t Size = 64;
+constexpr size_t Capacity = Size - 4;
+constexpr size_t NChannels = 2;
+
+//! Distinct values in each channel, counting from `first`
+Samples Ramp(size_t iChannel, size_t first, size_t count)
+{
+   Samples result(count);
+   std::iota(result.begin(), result.end(), 1000.0f * iChannel + first);
+   return result;
+}
+
+//! Write ramps into all channels through writable spans, and produce them
+size_t Put(MultiChannelRingBuffer &buffer, size_t first, size_t count,
+   size_t padding = 0)
+{
+   const auto spans = buffer.GetWritable(count + padding);
+   for (size_t iChannel = 0; iChannel < buffer.Channels(); ++iChannel) {
+      const auto samples = Ramp(iChannel, first, count);
+      buffer.Write(iChannel, spans,
+         reinterpret_cast<constSamplePtr>(samples.data()), floatSample,
+         count);
+   }
+   return buffer.Produce(
+      MultiChannelRingBuffer::TotalLength(spans), padding);
+}
+
+Samples Peek(const MultiChannelRingBuffer &buffer, size_t iChannel,
+   size_t frames)
+{
+   Samples result(frames);
+   result.resize(buffer.Peek(iChannel,
+      reinterpret_cast<samplePtr>(result.data()), floatSample, frames));
+   return result;
+}
+
+//! Gather samples of a channel from spans, reading in place
+Samples Gather(const MultiChannelRingBuffer &buffer, size_t iChannel,
+   const Spans &spans)
+{
+   Samples result;
+   for (const auto &span : spans) {
+      const auto p = reinterpret_cast<const float*>(
+         buffer.GetPointer(iChannel, span.offset));
+      result.insert(result.end(), p, p + span.length);
+   }
+   return result;
+}
+
+//! Move both positions to `offset` in an empty buffer
+void Skip(MultiChannelRingBuffer &buffer, size_t offset)
+{
+   // In steps, which the capacity might not allow at once
+   while (offset > 0) {
+      const auto step = std::min<size_t>(offset, Capacity / 2);
+      REQUIRE(Put(buffer, 0, step) == step);
+      buffer.Flush();
+      REQUIRE(buffer.Consume(step) == step);
+      offset -= step;
+   }
+}
+}
+
+TEST_CASE("MultiChannelRingBuffer copy in and out", "[MultiChannelRingBuffer]")
+{
+   MultiChannelRingBuffer buffer{ floatSample, NChannels, Size };
+   REQUIRE(buffer.Channels() == NChannels);
+   REQUIRE(buffer.Format() == floatSample);
+   REQUIRE(buffer.AvailForPut() == Capacity);
+   REQUIRE(buffer.GetStatistics().capacity == Capacity);
+
+   REQUIRE(Put(buffer, 0, 20) == 20);
+   REQUIRE(buffer.WrittenForGet() == 20);
+   // Nothing is visible to the reader before the flush
+   REQUIRE(buffer.AvailForGet() == 0);
+
+   buffer.Flush();
+   REQUIRE(buffer.AvailForGet() == 20);
+   REQUIRE(buffer.AvailForPut() == Capacity - 20);
+   for (size_t iChannel = 0; iChannel < NChannels; ++iChannel)
+      REQUIRE(Peek(buffer, iChannel, 30) == Ramp(iChannel, 0, 20));
+   // Peek does not consume
+   REQUIRE(buffer.AvailForGet() == 20);
+
+   REQUIRE(buffer.Consume(5) == 5);
+   REQUIRE(Peek(buffer, 1, 15) == Ramp(1, 5, 15));
+   REQUIRE(buffer.Discard(100) == 15);
+   REQUIRE(buffer.AvailForGet() == 0);
+   REQUIRE(buffer.AvailForPut() == Capacity);
+}
+
+TEST_CASE("MultiChannelRingBuffer spans", "[MultiChannelRingBuffer]")
+{
+   MultiChannelRingBuffer buffer{ floatSample, NChannels, Size };
+
+   SECTION("Writable spans are limited by free space")
+   {
+      REQUIRE(MultiChannelRingBuffer::TotalLength(
+         buffer.GetWritable(Size)) == Capacity);
+      REQUIRE(Put(buffer, 0, Capacity) == Capacity);
+      REQUIRE(MultiChannelRingBuffer::TotalLength(
+         buffer.GetWritable(1)) == 0);
+      REQUIRE(buffer.Produce(1) == 0);
+   }
+
+   SECTION("Write pads the rest of the spans with zeroes")
+   {
+      const auto spans = buffer.GetWritable(10);
+      const auto samples = Ramp(0, 1, 4);
+      buffer.Write(0, spans,
+         reinterpret_cast<constSamplePtr>(samples.data()), floatSample, 4);
+      buffer.Write(1, spans, nullptr, floatSample, 10);
+      buffer.Produce(10);
+      buffer.Flush();
+      REQUIRE(Peek(buffer, 0, 10) == Samples{ 1, 2, 3, 4, 0, 0, 0, 0, 0, 0 });
+      REQUIRE(Peek(buffer, 1, 10) == Samples(10, 0.0f));
+   }
+
+   SECTION("Spans wrap around the end of the storage")
+   {
+      Skip(buffer, 50);
+      const auto writable = buffer.GetWritable(30);
+      REQUIRE(writable[0].offset == 50);
+      REQUIRE(writable[0].length == Size - 50);
+      REQUIRE(writable[1].offset == 0);
+      REQUIRE(writable[1].length == 30 - (Size - 50));
+
+      REQUIRE(Put(buffer, 0, 30) == 30);
+      buffer.Flush();
+      const auto readable = buffer.GetReadable(30);
+      for (size_t ii : { 0, 1 }) {
+         REQUIRE(readable[ii].offset == writable[ii].offset);
+         REQUIRE(readable[ii].length == writable[ii].length);
+      }
+      for (size_t iChannel = 0; iChannel < NChannels; ++iChannel) {
+         REQUIRE(Gather(buffer, iChannel, readable) == Ramp(iChannel, 0, 30));
+         REQUIRE(Peek(buffer, iChannel, 30) == Ramp(iChannel, 0, 30));
+      }
+      REQUIRE(buffer.Consume(30) == 30);
+      REQUIRE(buffer.AvailForGet() == 0);
+   }
+
+   SECTION("A second span is empty when there is no wrap-around")
+   {
+      Skip(buffer, 10);
+      const auto writable = buffer.GetWritable(20);
+      REQUIRE(writable[0].offset == 10);
+      REQUIRE(writable[0].length == 20);
+      REQUIRE(writable[1].length == 0);
+   }
+
+   SECTION("Readable spans count underruns")
+   {
+      REQUIRE(MultiChannelRingBuffer::TotalLength(
+         buffer.GetReadable(10)) == 0);
+      REQUIRE(buffer.GetStatistics().underruns == 1);
+
+      Put(buffer, 0, 20);
+      buffer.Flush();
+      REQUIRE(MultiChannelRingBuffer::TotalLength(
+         buffer.GetReadable(10)) == 10);
+      REQUIRE(buffer.GetStatistics().underruns == 1);
+      REQUIRE(MultiChannelRingBuffer::TotalLength(
+         buffer.GetReadable(30)) == 20);
+      REQUIRE(buffer.GetStatistics().underruns == 2);
+   }
+
+   SECTION("High water mark")
+   {
+      Put(buffer, 0, 20);
+      REQUIRE(buffer.GetStatistics().highWater == 0);
+      buffer.Flush();
+      REQUIRE(buffer.GetStatistics().highWater == 20);
+      buffer.Consume(15);
+      Put(buffer, 0, 5);
+      buffer.Flush();
+      REQUIRE(buffer.GetStatistics().highWater == 20);
+   }
+}
+
+TEST_CASE("MultiChannelRingBuffer::Unput", "[MultiChannelRingBuffer]")
+{
+   MultiChannelRingBuffer buffer{ floatSample, NChannels, Size };
+   // With or without wrap-around of the unflushed data
+   const size_t offset = GENERATE(0, 10, 40, 50, Size - 1);
+   Skip(buffer, offset);
+
+   SECTION("Removes an initial segment of the unflushed frames")
+   {
+      constexpr size_t count = 30;
+      const auto unput = GENERATE(range(size_t{ 0 }, count + 1));
+      REQUIRE(Put(buffer, 0, count) == count);
+      REQUIRE(buffer.Unput(unput) == unput);
+      REQUIRE(buffer.WrittenForGet() == count - unput);
+      buffer.Flush();
+      for (size_t iChannel = 0; iChannel < NChannels; ++iChannel)
+         REQUIRE(Peek(buffer, iChannel, count) ==
+            Ramp(iChannel, unput, count - unput));
+   }
+
+   SECTION("Does not remove flushed frames")
+   {
+      Put(buffer, 0, 10);
+      buffer.Flush();
+      Put(buffer, 10, 5);
+      REQUIRE(buffer.Unput(20) == 5);
+      buffer.Flush();
+      REQUIRE(Peek(buffer, 0, 20) == Ramp(0, 0, 10));
+   }
+
+   SECTION("Unflushed spans exclude trailing padding")
+   {
+      REQUIRE(Put(buffer, 0, 20, 5) == 25);
+      const auto first = buffer.GetUnflushed(0), second = buffer.GetUnflushed(1);
+      REQUIRE(first.offset == offset);
+      REQUIRE(first.length + second.length == 20);
+      REQUIRE(first.length == std::min<size_t>(20, Size - offset));
+      for (size_t iChannel = 0; iChannel < NChannels; ++iChannel)
+         REQUIRE(Gather(buffer, iChannel, { first, second }) ==
+            Ramp(iChannel, 0, 20));
+
+      // Unput of some of the data leaves the padding after it
+      REQUIRE(buffer.Unput(8) == 8);
+      REQUIRE(MultiChannelRingBuffer::TotalLength(
+         { buffer.GetUnflushed(0), buffer.GetUnflushed(1) }) == 12);
+      buffer.Flush();
+      auto expected = Ramp(1, 8, 12);
+      expected.resize(17);
+      REQUIRE(Peek(buffer, 1, 30) == expected);
+   }
+}
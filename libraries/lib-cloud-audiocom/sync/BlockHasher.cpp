@@ -22,10 +22,18 @@
 
 namespace audacity::cloud::audiocom::sync
 {
+namespace
+{
+//! Blocks read before hashing them together; enough to fill the lanes of
+//! crypto::sha256_many
+constexpr size_t HashBatchSize = 8;
+} // namespace
+
 class BlockHasher::Workers final
 {
 public:
    using SampleData = std::vector<std::remove_pointer_t<samplePtr>>;
+   using Result = std::unordered_map<int64_t, std::pair<std::string, bool>>;
 
    explicit Workers(
       BlockHashCache& cache, const std::vector<LockedBlock> blocks,
@@ -58,10 +66,13 @@ public:
             [this, threadBlocks = std::move(threadBlocks)]()
             {
                Result result;
-               SampleData sampleData;
+               std::vector<SampleData> sampleData(HashBatchSize);
 
-               for (const auto& block : threadBlocks)
-                  result.emplace(block.Id, ComputeHash(sampleData, block));
+               for (size_t first = 0; first < threadBlocks.size();
+                    first += HashBatchSize)
+                  ComputeHashes(
+                     result, sampleData, threadBlocks.data() + first,
+                     std::min(HashBatchSize, threadBlocks.size() - first));
 
                return result;
             }));
@@ -89,29 +100,51 @@ public:
          });
    }
 
-   std::pair<std::string, bool>
-   ComputeHash(SampleData& sampleData, const LockedBlock& block) const
+   //! Hashes blocks missing from the cache together, which lets
+   //! crypto::sha256_many use several lanes of vector registers at once
+   void ComputeHashes(
+      Result& result, std::vector<SampleData>& sampleData,
+      const LockedBlock* blocks, size_t count) const
    {
-      std::string hash;
+      std::vector<crypto::HashInput> inputs;
+      std::vector<int64_t> ids;
 
-      if (mCache.GetHash(block.Id, hash))
-         return { hash, false };
+      for (size_t i = 0; i < count; ++i)
+      {
+         const auto& block = blocks[i];
 
-      const auto sampleFormat = block.Format;
-      const auto sampleCount  = block.Block->GetSampleCount();
-      const auto dataSize     = sampleCount * SAMPLE_SIZE(sampleFormat);
+         std::string hash;
 
-      sampleData.resize(dataSize);
+         if (mCache.GetHash(block.Id, hash))
+         {
+            result.emplace(block.Id, std::make_pair(hash, false));
+            continue;
+         }
 
-      const size_t samplesRead = block.Block->GetSamples(
-         sampleData.data(), sampleFormat, 0, sampleCount, false);
+         const auto sampleFormat = block.Format;
+         const auto sampleCount  = block.Block->GetSampleCount();
+         const auto dataSize     = sampleCount * SAMPLE_SIZE(sampleFormat);
 
-      if (samplesRead != sampleCount)
-         return { {}, false };
+         auto& data = sampleData[i];
+         data.resize(dataSize);
 
-      hash = crypto::sha256(sampleData);
+         const size_t samplesRead = block.Block->GetSamples(
+            data.data(), sampleFormat, 0, sampleCount, false);
 
-      return { hash, true };
+         if (samplesRead != sampleCount)
+         {
+            result.emplace(block.Id, std::make_pair(std::string {}, false));
+            continue;
+         }
+
+         inputs.push_back({ data.data(), data.size() });
+         ids.push_back(block.Id);
+      }
+
+      auto hashes = crypto::sha256_many(inputs);
+
+      for (size_t i = 0; i < ids.size(); ++i)
+         result.emplace(ids[i], std::make_pair(std::move(hashes[i]), true));
    }
 
    void NotifyReady()
@@ -147,7 +180,6 @@ private:
 
    BlockHashCache& mCache;
 
-   using Result = std::unordered_map<int64_t, std::pair<std::string, bool>>;
    std::vector<std::future<Result>> mResults;
    std::future<void> mWaiter;
 
@@ -102,8 +102,14 @@ const auto addProjectSyncedDialogShownColumn = R"(
 ALTER TABLE projects ADD COLUMN synced_dialog_shown INTEGER DEFAULT 1;
 )";
 
+// Hashes stored before have no signature, and are computed again once
+const auto addBlockSignatureColumn = R"(
+ALTER TABLE block_hashes ADD COLUMN block_signature TEXT;
+)";
+
 const char* migrations[] = {
    addProjectSyncedDialogShownColumn,
+   addBlockSignatureColumn,
 };
 } // namespace
 
@@ -254,38 +260,42 @@ void CloudProjectsDatabase::UpdateProjectBlockList(
    }
 }
 
-std::optional<std::string> CloudProjectsDatabase::GetBlockHash(
-   std::string_view projectId, int64_t blockId) const
+std::unordered_map<int64_t, DBBlockHash>
+CloudProjectsDatabase::GetBlockHashes(std::string_view projectId) const
 {
+   std::unordered_map<int64_t, DBBlockHash> hashes;
+
    auto connection = GetConnection();
 
    if (!connection)
-      return {};
+      return hashes;
 
    auto statement = connection->CreateStatement(
-      "SELECT hash FROM block_hashes WHERE project_id = ? AND block_id = ? LIMIT 1");
+      "SELECT block_id, hash, block_signature FROM block_hashes WHERE project_id = ? AND block_signature IS NOT NULL");
 
    if (!statement)
-      return {};
+      return hashes;
 
-   auto result = statement->Prepare(projectId, blockId).Run();
+   auto result = statement->Prepare(projectId).Run();
 
    for (auto row : result)
    {
-      std::string hash;
+      int64_t blockId;
+      DBBlockHash hash;
 
-      if (!row.Get(0, hash))
-         return {};
+      if (!row.Get(0, blockId) || !row.Get(1, hash.Hash) ||
+          !row.Get(2, hash.Signature))
+         continue;
 
-      return hash;
+      hashes.emplace(blockId, std::move(hash));
    }
 
-   return {};
+   return hashes;
 }
 
 void CloudProjectsDatabase::UpdateBlockHashes(
    std::string_view projectId,
-   const std::vector<std::pair<int64_t, std::string>>& hashes)
+   const std::vector<std::pair<int64_t, DBBlockHash>>& hashes)
 {
    auto connection = GetConnection();
 
@@ -298,10 +308,10 @@ void CloudProjectsDatabase::UpdateBlockHashes(
       std::to_string(reinterpret_cast<size_t>(&localVar)));
 
    auto statement = connection->CreateStatement(
-      "INSERT OR REPLACE INTO block_hashes (project_id, block_id, hash) VALUES (?, ?, ?)");
+      "INSERT OR REPLACE INTO block_hashes (project_id, block_id, hash, block_signature) VALUES (?, ?, ?, ?)");
 
    for (const auto& [blockId, hash] : hashes)
-      statement->Prepare(projectId, blockId, hash).Run();
+      statement->Prepare(projectId, blockId, hash.Hash, hash.Signature).Run();
 
    transaction.Commit();
 }
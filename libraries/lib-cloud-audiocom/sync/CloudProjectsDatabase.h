@@ -13,6 +13,7 @@
 #include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "sqlite/SafeConnection.h"
@@ -75,6 +76,14 @@ struct PendingProjectBlockData final
    std::string BlockHash;
 };
 
+struct DBBlockHash final
+{
+   std::string Hash;
+   //! Describes the block the hash was computed for, so that a different
+   //! block reusing the ID is not mistaken for it
+   std::string Signature;
+};
+
 class CloudProjectsDatabase final
 {
    CloudProjectsDatabase() = default;
@@ -101,12 +110,13 @@ public:
    void UpdateProjectBlockList(
       std::string_view projectId, const SampleBlockIDSet& blockSet);
 
-   std::optional<std::string>
-   GetBlockHash(std::string_view projectId, int64_t blockId) const;
+   //! Hashes of all blocks of the project, read in one query
+   std::unordered_map<int64_t, DBBlockHash>
+   GetBlockHashes(std::string_view projectId) const;
 
    void UpdateBlockHashes(
       std::string_view projectId,
-      const std::vector<std::pair<int64_t, std::string>>& hashes);
+      const std::vector<std::pair<int64_t, DBBlockHash>>& hashes);
 
    bool UpdateProjectData(const DBProjectData& projectData);
 
@@ -11,6 +11,7 @@
 #include "LocalProjectSnapshot.h"
 
 #include <algorithm>
+#include <cstring>
 #include <future>
 
 #include "../OAuthService.h"
@@ -57,10 +58,13 @@ struct LocalProjectSnapshot::ProjectBlocksLock final : private BlockHashCache
    std::unordered_map<int64_t, size_t> BlockIdToIndex;
    std::unordered_map<std::string, size_t> BlockHashToIndex;
 
+   // Read once, before hashing starts, and not changed while it runs
+   std::unordered_map<int64_t, DBBlockHash> CachedHashes;
+
    std::unique_ptr<BlockHasher> Hasher;
 
    std::future<void> UpdateCacheFuture;
-   std::vector<std::pair<int64_t, std::string>> NewHashes;
+   std::vector<std::pair<int64_t, DBBlockHash>> NewHashes;
 
    std::function<void()> OnBlocksLocked;
 
@@ -74,8 +78,11 @@ struct LocalProjectSnapshot::ProjectBlocksLock final : private BlockHashCache
 
       if (Extension.IsCloudProject())
       {
-         CloudProjectsDatabase::Get().UpdateProjectBlockList(
+         auto& database = CloudProjectsDatabase::Get();
+         database.UpdateProjectBlockList(
             Extension.GetCloudProjectId(), BlockIds);
+         CachedHashes =
+            database.GetBlockHashes(Extension.GetCloudProjectId());
       }
 
       Hasher = std::make_unique<BlockHasher>();
@@ -146,25 +153,55 @@ struct LocalProjectSnapshot::ProjectBlocksLock final : private BlockHashCache
          });
    }
 
+   //! Format, length and extremes of the block, which are known without
+   //! reading its samples.  Block IDs may be reused after compaction, or by
+   //! a copy of the project file; hashes are trusted only for blocks with
+   //! the same signature
+   static std::string GetSignature(const LockedBlock& block)
+   {
+      const auto minMaxRMS = block.Block->GetMinMaxRMS(false);
+
+      const auto bits = [](float value)
+      {
+         uint32_t result;
+         std::memcpy(&result, &value, sizeof(result));
+         return std::to_string(result);
+      };
+
+      return std::to_string(static_cast<int>(block.Format)) + ":" +
+             std::to_string(block.Block->GetSampleCount()) + ":" +
+             bits(minMaxRMS.min) + ":" + bits(minMaxRMS.max) + ":" +
+             bits(minMaxRMS.RMS);
+   }
+
    bool GetHash(int64_t blockId, std::string& hash) const override
    {
-      if (!Extension.IsCloudProject())
+      const auto cached = CachedHashes.find(blockId);
+
+      if (cached == CachedHashes.end())
          return false;
 
-      auto cachedResult = CloudProjectsDatabase::Get().GetBlockHash(
-         Extension.GetCloudProjectId(), blockId);
+      const auto index = BlockIdToIndex.find(blockId);
 
-      if (!cachedResult)
+      if (
+         index == BlockIdToIndex.end() ||
+         cached->second.Signature != GetSignature(Blocks[index->second]))
          return false;
 
-      hash = std::move(*cachedResult);
+      hash = cached->second.Hash;
 
       return true;
    }
 
    void UpdateHash(int64_t blockId, const std::string& hash) override
    {
-      NewHashes.emplace_back(blockId, hash);
+      const auto index = BlockIdToIndex.find(blockId);
+
+      if (index == BlockIdToIndex.end())
+         return;
+
+      NewHashes.emplace_back(
+         blockId, DBBlockHash { hash, GetSignature(Blocks[index->second]) });
    }
 
    void FillMissingBlocks(const std::vector<UploadUrls>& missingBlockUrls)
@@ -499,8 +499,9 @@ void RemoteProjectSnapshot::OnProjectBlobDownloaded(
       return;
    }
 
+   // Autosave deltas, in rows after the first, also go
    auto deleteAutosaveStatement = db->CreateStatement(
-      "DELETE FROM " + mSnapshotDBName + ".autosave WHERE id = 1");
+      "DELETE FROM " + mSnapshotDBName + ".autosave");
 
    if (!deleteAutosaveStatement)
    {
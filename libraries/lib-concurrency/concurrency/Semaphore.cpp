@@ -0,0 +1,170 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: Semaphore.cpp
+ */
+
+#include "Semaphore.h"
+
+#include <algorithm>
+#include <new>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#  include <climits>
+#elif defined(__APPLE__)
+#  include <dispatch/dispatch.h>
+#else
+#  include <cerrno>
+#  include <ctime>
+#  include <semaphore.h>
+#endif
+
+namespace audacity::concurrency
+{
+#if defined(_WIN32)
+
+struct Semaphore::Impl final
+{
+   Impl()
+       : handle { CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr) }
+   {
+      if (!handle)
+         throw std::bad_alloc {};
+   }
+
+   ~Impl()
+   {
+      CloseHandle(handle);
+   }
+
+   void Post() noexcept
+   {
+      ReleaseSemaphore(handle, 1, nullptr);
+   }
+
+   bool Wait(DWORD milliseconds) noexcept
+   {
+      return WaitForSingleObject(handle, milliseconds) == WAIT_OBJECT_0;
+   }
+
+   const HANDLE handle;
+};
+
+void Semaphore::Wait() noexcept
+{
+   mpImpl->Wait(INFINITE);
+}
+
+bool Semaphore::WaitFor(std::chrono::milliseconds timeout) noexcept
+{
+   const auto count = std::clamp<long long>(timeout.count(), 0, INFINITE - 1);
+   return mpImpl->Wait(static_cast<DWORD>(count));
+}
+
+#elif defined(__APPLE__)
+
+// Unnamed POSIX semaphores are not implemented on macOS
+struct Semaphore::Impl final
+{
+   Impl()
+       : semaphore { dispatch_semaphore_create(0) }
+   {
+      if (!semaphore)
+         throw std::bad_alloc {};
+   }
+
+   ~Impl()
+   {
+      dispatch_release(semaphore);
+   }
+
+   void Post() noexcept
+   {
+      dispatch_semaphore_signal(semaphore);
+   }
+
+   bool Wait(dispatch_time_t time) noexcept
+   {
+      return dispatch_semaphore_wait(semaphore, time) == 0;
+   }
+
+   const dispatch_semaphore_t semaphore;
+};
+
+void Semaphore::Wait() noexcept
+{
+   mpImpl->Wait(DISPATCH_TIME_FOREVER);
+}
+
+bool Semaphore::WaitFor(std::chrono::milliseconds timeout) noexcept
+{
+   const auto ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+   return mpImpl->Wait(
+      dispatch_time(DISPATCH_TIME_NOW, std::max<int64_t>(0, ns)));
+}
+
+#else
+
+struct Semaphore::Impl final
+{
+   Impl()
+   {
+      if (sem_init(&semaphore, 0, 0) != 0)
+         throw std::bad_alloc {};
+   }
+
+   ~Impl()
+   {
+      sem_destroy(&semaphore);
+   }
+
+   void Post() noexcept
+   {
+      sem_post(&semaphore);
+   }
+
+   sem_t semaphore;
+};
+
+void Semaphore::Wait() noexcept
+{
+   while (sem_wait(&mpImpl->semaphore) != 0 && errno == EINTR)
+      ;
+}
+
+bool Semaphore::WaitFor(std::chrono::milliseconds timeout) noexcept
+{
+   // sem_timedwait takes an absolute time on the realtime clock
+   timespec deadline;
+   clock_gettime(CLOCK_REALTIME, &deadline);
+   const auto ms = std::max<long long>(0, timeout.count());
+   deadline.tv_sec += ms / 1000;
+   deadline.tv_nsec += (ms % 1000) * 1000000;
+   if (deadline.tv_nsec >= 1000000000)
+   {
+      ++deadline.tv_sec;
+      deadline.tv_nsec -= 1000000000;
+   }
+
+   int result;
+   while ((result = sem_timedwait(&mpImpl->semaphore, &deadline)) != 0 &&
+          errno == EINTR)
+      ;
+   return result == 0;
+}
+
+#endif
+
+Semaphore::Semaphore()
+    : mpImpl { std::make_unique<Impl>() }
+{
+}
+
+Semaphore::~Semaphore() = default;
+
+void Semaphore::Post() noexcept
+{
+   mpImpl->Post();
+}
+} // namespace audacity::concurrency
@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: Semaphore.h
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+namespace audacity::concurrency
+{
+//! A counting semaphore on the primitive of the operating system
+/*!
+ Post() takes no locks and allocates nothing, so a real-time thread, such as
+ an audio device callback, may use it to wake a waiting thread.
+ */
+class CONCURRENCY_API Semaphore final
+{
+public:
+   Semaphore();
+   ~Semaphore();
+
+   Semaphore(const Semaphore&)            = delete;
+   Semaphore(Semaphore&&)                 = delete;
+   Semaphore& operator=(const Semaphore&) = delete;
+   Semaphore& operator=(Semaphore&&)      = delete;
+
+   //! Increment the count, waking one waiting thread
+   void Post() noexcept;
+
+   //! Wait until the count is positive, then decrement it
+   void Wait() noexcept;
+
+   //! Like Wait(), but give up after `timeout`
+   /*! @return whether the count was decremented */
+   bool WaitFor(std::chrono::milliseconds timeout) noexcept;
+
+private:
+   struct Impl;
+   const std::unique_ptr<Impl> mpImpl;
+};
+} // namespace audacity::concurrency
@@ -0,0 +1,169 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: ThreadPool.cpp
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace audacity::concurrency
+{
+namespace
+{
+size_t DefaultThreadCount()
+{
+   const auto hardware = std::thread::hardware_concurrency();
+   return std::max<size_t>(1, hardware > 1 ? hardware - 1 : 1);
+}
+} // namespace
+
+ThreadPool::ThreadPool(size_t nThreads)
+{
+   if (nThreads == 0)
+      nThreads = DefaultThreadCount();
+
+   mThreads.reserve(nThreads);
+   for (size_t ii = 0; ii < nThreads; ++ii)
+      mThreads.emplace_back([this] { Work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      auto lock = std::lock_guard { mMutex };
+      mStopping = true;
+      mTasks.clear();
+   }
+   mCondition.notify_all();
+
+   for (auto& thread : mThreads)
+      thread.join();
+}
+
+ThreadPool& ThreadPool::Get()
+{
+   static ThreadPool pool;
+   return pool;
+}
+
+size_t ThreadPool::Size() const noexcept
+{
+   return mThreads.size();
+}
+
+void ThreadPool::Enqueue(Task task)
+{
+   {
+      auto lock = std::lock_guard { mMutex };
+      if (mStopping)
+         return;
+      mTasks.push_back(std::move(task));
+   }
+   mCondition.notify_one();
+}
+
+void ThreadPool::Work()
+{
+   while (true)
+   {
+      Task task;
+      {
+         auto lock = std::unique_lock { mMutex };
+         mCondition.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+         if (mStopping)
+            return;
+         task = std::move(mTasks.front());
+         mTasks.pop_front();
+      }
+
+      try
+      {
+         task();
+      }
+      catch (...)
+      {
+      }
+   }
+}
+
+void ThreadPool::ParallelFor(
+   size_t count, const std::function<void(size_t)>& f, size_t maxThreads)
+{
+   if (count == 0)
+      return;
+
+   auto nThreads = std::min(count, Size() + 1);
+   if (maxThreads > 0)
+      nThreads = std::min(nThreads, maxThreads);
+
+   if (nThreads <= 1)
+   {
+      for (size_t ii = 0; ii < count; ++ii)
+         f(ii);
+      return;
+   }
+
+   // Shared with helper tasks, which may start only after this returns
+   struct State final
+   {
+      State(const std::function<void(size_t)>& f, size_t count)
+          : pFunction { &f }
+          , count { count }
+      {
+      }
+
+      const std::function<void(size_t)>* const pFunction;
+      const size_t count;
+      std::atomic<size_t> next { 0 };
+      std::atomic<bool> failed { false };
+
+      std::mutex mutex;
+      std::condition_variable condition;
+      size_t finished { 0 };
+      std::exception_ptr exception;
+
+      void Run()
+      {
+         size_t nFinished = 0;
+         for (size_t ii; (ii = next.fetch_add(1)) < count; ++nFinished)
+         {
+            if (failed.load(std::memory_order_relaxed))
+               continue;
+            try
+            {
+               (*pFunction)(ii);
+            }
+            catch (...)
+            {
+               auto lock = std::lock_guard { mutex };
+               if (!exception)
+                  exception = std::current_exception();
+               failed.store(true, std::memory_order_relaxed);
+            }
+         }
+         if (nFinished > 0)
+         {
+            auto lock = std::lock_guard { mutex };
+            finished += nFinished;
+            if (finished == count)
+               condition.notify_all();
+         }
+      }
+   };
+
+   const auto pState = std::make_shared<State>(f, count);
+   for (size_t ii = 1; ii < nThreads; ++ii)
+      Enqueue([pState] { pState->Run(); });
+
+   pState->Run();
+
+   auto lock = std::unique_lock { pState->mutex };
+   pState->condition.wait(lock, [&] { return pState->finished == count; });
+   if (pState->exception)
+      std::rethrow_exception(pState->exception);
+}
+} // namespace audacity::concurrency
@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: ThreadPool.h
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace audacity::concurrency
+{
+//! A fixed set of worker threads executing queued tasks in FIFO order
+class CONCURRENCY_API ThreadPool final
+{
+public:
+   using Task = std::function<void()>;
+
+   //! @param nThreads if zero, one less than the hardware concurrency, but
+   //! at least one
+   explicit ThreadPool(size_t nThreads = 0);
+
+   //! Waits for tasks already started; discards those not yet started
+   ~ThreadPool();
+
+   ThreadPool(const ThreadPool&)            = delete;
+   ThreadPool(ThreadPool&&)                 = delete;
+   ThreadPool& operator=(const ThreadPool&) = delete;
+   ThreadPool& operator=(ThreadPool&&)      = delete;
+
+   //! A pool shared by the whole application, created on first use
+   static ThreadPool& Get();
+
+   size_t Size() const noexcept;
+
+   //! Queue a task to run on some worker thread
+   /*! Exceptions escaping the task are swallowed */
+   void Enqueue(Task task);
+
+   //! Call `f(ii)` for every `ii` in [0, `count`), and return when all calls
+   //! are complete
+   /*!
+    The calling thread participates, so this does not deadlock when called
+    from a task of the same pool.  Indices are claimed dynamically, so a slow
+    iteration does not hold up the others.  The first exception thrown by any
+    call is rethrown here, after the remaining iterations are skipped.
+
+    @param maxThreads limits the number of threads working at once, including
+    the caller; zero means no limit beyond the size of the pool
+    */
+   void ParallelFor(
+      size_t count, const std::function<void(size_t)>& f,
+      size_t maxThreads = 0);
+
+private:
+   void Work();
+
+   std::vector<std::thread> mThreads;
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque<Task> mTasks;
+   bool mStopping { false };
+};
+} // namespace audacity::concurrency
@@ -0,0 +1,110 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPoolTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "concurrency/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+using audacity::concurrency::ThreadPool;
+
+TEST_CASE("ThreadPool::Enqueue", "[ThreadPool]")
+{
+   ThreadPool pool{ 2 };
+   REQUIRE(pool.Size() == 2);
+
+   std::promise<std::thread::id> promise;
+   auto future = promise.get_future();
+   // An exception from a task must not take down the worker
+   pool.Enqueue([]{ throw std::runtime_error{ "swallowed" }; });
+   pool.Enqueue([&]{ promise.set_value(std::this_thread::get_id()); });
+   REQUIRE(future.get() != std::this_thread::get_id());
+}
+
+TEST_CASE("ThreadPool::ParallelFor", "[ThreadPool]")
+{
+   ThreadPool pool{ 4 };
+
+   SECTION("Visits every index once")
+   {
+      for (const size_t count : { 0, 1, 3, 1000 }) {
+         std::vector<std::atomic<int>> visits(count);
+         pool.ParallelFor(count, [&](size_t ii){ ++visits[ii]; });
+         REQUIRE(std::all_of(visits.begin(), visits.end(),
+            [](const std::atomic<int> &n){ return n == 1; }));
+      }
+   }
+
+   SECTION("maxThreads of one runs on the caller's thread")
+   {
+      std::atomic<int> others{ 0 };
+      const auto caller = std::this_thread::get_id();
+      pool.ParallelFor(100, [&](size_t){
+         if (std::this_thread::get_id() != caller)
+            ++others;
+      }, 1);
+      REQUIRE(others == 0);
+   }
+
+   SECTION("maxThreads limits the threads working at once")
+   {
+      for (const size_t maxThreads : { 2, 3 }) {
+         std::atomic<size_t> busy{ 0 };
+         std::atomic<size_t> peak{ 0 };
+         pool.ParallelFor(200, [&](size_t){
+            const auto now = ++busy;
+            auto old = peak.load();
+            while (old < now && !peak.compare_exchange_weak(old, now))
+               ;
+            std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+            --busy;
+         }, maxThreads);
+         REQUIRE(peak <= maxThreads);
+      }
+   }
+
+   SECTION("The first exception propagates and stops the loop")
+   {
+      constexpr size_t count = 10000;
+      std::atomic<size_t> calls{ 0 };
+      REQUIRE_THROWS_AS(pool.ParallelFor(count, [&](size_t ii){
+         ++calls;
+         if (ii == 10)
+            throw std::invalid_argument{ "stop" };
+         std::this_thread::sleep_for(std::chrono::microseconds{ 10 });
+      }), std::invalid_argument);
+      REQUIRE(calls < count);
+
+      // The pool remains usable
+      std::atomic<size_t> total{ 0 };
+      pool.ParallelFor(100, [&](size_t ii){ total += ii; });
+      REQUIRE(total == 4950);
+   }
+
+   SECTION("Nesting in a task of the same pool does not deadlock")
+   {
+      ThreadPool single{ 1 };
+      std::atomic<size_t> total{ 0 };
+      std::promise<void> promise;
+      auto future = promise.get_future();
+      single.Enqueue([&]{
+         single.ParallelFor(10, [&](size_t){
+            single.ParallelFor(10, [&](size_t){ ++total; });
+         });
+         promise.set_value();
+      });
+      future.get();
+      REQUIRE(total == 100);
+   }
+}
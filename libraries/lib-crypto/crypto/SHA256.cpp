@@ -4,13 +4,39 @@
  * SPDX-FileContributor: Dmitry Vedenko
  *
  * Based on a public domain code by Brad Conte.
+ *
+ * The compression function has a portable implementation, one with the SHA
+ * extensions of x86, and one that compresses blocks of eight independent
+ * messages at once in the lanes of AVX2 registers.  The instruction sets are
+ * checked once, at run time.
  */
 
 #include "SHA256.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstring>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#     include <intrin.h>
+#  else
+#     include <cpuid.h>
+#  endif
+#  if defined(_MSC_VER) || defined(__GNUC__)
+#     define SHA256_X86
+#  endif
+#  if defined(__GNUC__)
+#     define TARGET_SHA __attribute__((target("sha,sse4.1,ssse3")))
+#     define TARGET_AVX2 __attribute__((target("avx2")))
+#  else
+#     define TARGET_SHA
+#     define TARGET_AVX2
+#  endif
+#endif
+
 namespace crypto
 {
 
@@ -40,7 +66,10 @@ constexpr uint32_t K[64] = {
 #define SIG0(x) (ROTRIGHT(x, 7) ^ ROTRIGHT(x, 18) ^ ((x) >> 3))
 #define SIG1(x) (ROTRIGHT(x, 17) ^ ROTRIGHT(x, 19) ^ ((x) >> 10))
 
-void sha256_transform(uint32_t state[8], const uint8_t data[64])
+//! Compresses consecutive blocks of one message into the state
+using Transform = void (*)(uint32_t* state, const uint8_t* data, std::size_t nBlocks);
+
+void sha256_block(uint32_t state[8], const uint8_t data[64])
 {
    uint32_t m[SHA256::BLOCK_SIZE];
 
@@ -88,6 +117,416 @@ void sha256_transform(uint32_t state[8], const uint8_t data[64])
    state[7] += h;
 }
 
+void sha256_transform(uint32_t* state, const uint8_t* data, std::size_t nBlocks)
+{
+   for (; nBlocks > 0; --nBlocks, data += SHA256::BLOCK_SIZE)
+      sha256_block(state, data);
+}
+
+#if defined(SHA256_X86)
+TARGET_SHA void
+sha256_transform_shani(uint32_t* state, const uint8_t* data, std::size_t nBlocks)
+{
+   // Reverses the bytes of each word
+   const __m128i byteSwap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+   // The instructions want the state as ABEF and CDGH
+   __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+   __m128i state1 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+   tmp = _mm_shuffle_epi32(tmp, 0xB1);
+   state1 = _mm_shuffle_epi32(state1, 0x1B);
+   __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+   state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+   for (; nBlocks > 0; --nBlocks, data += SHA256::BLOCK_SIZE)
+   {
+      const __m128i abefSave = state0;
+      const __m128i cdghSave = state1;
+
+      // Four words of the message schedule in each
+      __m128i w[4];
+      for (int i = 0; i < 4; ++i)
+         w[i] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)),
+            byteSwap);
+
+      for (int i = 0; i < 16; ++i)
+      {
+         if (i >= 4)
+            w[i & 3] = _mm_sha256msg2_epu32(
+               _mm_add_epi32(
+                  _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+                  _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4)),
+               w[(i + 3) & 3]);
+
+         __m128i msg = _mm_add_epi32(
+            w[i & 3],
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(K + 4 * i)));
+         state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+         msg = _mm_shuffle_epi32(msg, 0x0E);
+         state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      }
+
+      state0 = _mm_add_epi32(state0, abefSave);
+      state1 = _mm_add_epi32(state1, cdghSave);
+   }
+
+   // Back to ABCD and EFGH
+   tmp = _mm_shuffle_epi32(state0, 0x1B);
+   state1 = _mm_shuffle_epi32(state1, 0xB1);
+   state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+   state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+// Lambdas would not inherit the target attribute, so these are functions
+
+TARGET_AVX2 inline __m256i RotateRightAVX2(__m256i x, int n)
+{
+   return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+//! Transposes eight rows of eight words, so that each holds one word of each
+//! row
+TARGET_AVX2 inline void Transpose8x8AVX2(__m256i r[8])
+{
+   __m256i t[8];
+   for (int i = 0; i < 8; i += 2)
+   {
+      t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+      t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+   }
+   __m256i u[8];
+   for (int i = 0; i < 8; i += 4)
+   {
+      u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+      u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+      u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+      u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+   }
+   for (int i = 0; i < 4; ++i)
+   {
+      r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+      r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+   }
+}
+
+//! Compresses `nBlocks` consecutive blocks of each of eight messages
+TARGET_AVX2 void sha256_transform_avx2x8(
+   uint32_t* const states[8], const uint8_t* const data[8], std::size_t nBlocks)
+{
+   const __m256i byteSwap = _mm256_set_epi64x(
+      0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL,
+      0x0405060700010203ULL);
+
+   // Each vector holds one word of the state of each message
+   __m256i s[8];
+   for (int i = 0; i < 8; ++i)
+      s[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states[i]));
+   Transpose8x8AVX2(s);
+
+   for (std::size_t block = 0; block < nBlocks; ++block)
+   {
+      const auto offset = block * SHA256::BLOCK_SIZE;
+
+      __m256i m[SHA256::BLOCK_SIZE];
+      for (int half = 0; half < 2; ++half)
+      {
+         for (int i = 0; i < 8; ++i)
+            m[8 * half + i] = _mm256_shuffle_epi8(
+               _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+                  data[i] + offset + 32 * half)),
+               byteSwap);
+         Transpose8x8AVX2(m + 8 * half);
+      }
+
+      for (int i = 16; i < 64; ++i)
+      {
+         const auto w2 = m[i - 2];
+         const auto w15 = m[i - 15];
+         const auto sig1 = _mm256_xor_si256(
+            _mm256_xor_si256(RotateRightAVX2(w2, 17), RotateRightAVX2(w2, 19)),
+            _mm256_srli_epi32(w2, 10));
+         const auto sig0 = _mm256_xor_si256(
+            _mm256_xor_si256(RotateRightAVX2(w15, 7), RotateRightAVX2(w15, 18)),
+            _mm256_srli_epi32(w15, 3));
+         m[i] = _mm256_add_epi32(
+            _mm256_add_epi32(sig1, m[i - 7]),
+            _mm256_add_epi32(sig0, m[i - 16]));
+      }
+
+      __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+      __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+      for (int i = 0; i < 64; ++i)
+      {
+         const auto ep1 = _mm256_xor_si256(
+            _mm256_xor_si256(RotateRightAVX2(e, 6), RotateRightAVX2(e, 11)),
+            RotateRightAVX2(e, 25));
+         const auto ch = _mm256_xor_si256(
+            _mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+         const auto t1 = _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(h, ep1), ch),
+            _mm256_add_epi32(_mm256_set1_epi32(K[i]), m[i]));
+         const auto ep0 = _mm256_xor_si256(
+            _mm256_xor_si256(RotateRightAVX2(a, 2), RotateRightAVX2(a, 13)),
+            RotateRightAVX2(a, 22));
+         const auto maj = _mm256_xor_si256(
+            _mm256_and_si256(a, _mm256_xor_si256(b, c)), _mm256_and_si256(b, c));
+         const auto t2 = _mm256_add_epi32(ep0, maj);
+
+         h = g;
+         g = f;
+         f = e;
+         e = _mm256_add_epi32(d, t1);
+         d = c;
+         c = b;
+         b = a;
+         a = _mm256_add_epi32(t1, t2);
+      }
+
+      s[0] = _mm256_add_epi32(s[0], a);
+      s[1] = _mm256_add_epi32(s[1], b);
+      s[2] = _mm256_add_epi32(s[2], c);
+      s[3] = _mm256_add_epi32(s[3], d);
+      s[4] = _mm256_add_epi32(s[4], e);
+      s[5] = _mm256_add_epi32(s[5], f);
+      s[6] = _mm256_add_epi32(s[6], g);
+      s[7] = _mm256_add_epi32(s[7], h);
+   }
+
+   Transpose8x8AVX2(s);
+   for (int i = 0; i < 8; ++i)
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(states[i]), s[i]);
+   _mm256_zeroupper();
+}
+
+bool HaveSHA()
+{
+   // SHA in EBX of leaf 7; SSSE3 and SSE4.1 in ECX of leaf 1
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuidex(info, 7, 0);
+   const bool sha = (info[1] & (1 << 29)) != 0;
+   __cpuid(info, 1);
+   return sha && (info[2] & (1 << 9)) && (info[2] & (1 << 19));
+#else
+   unsigned eax, ebx, ecx, edx;
+   if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+      return false;
+   return (ebx & (1u << 29)) && __builtin_cpu_supports("ssse3") &&
+          __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+bool HaveAVX2()
+{
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   __cpuidex(info, 7, 0);
+   const bool avx2 = (info[1] & (1 << 5)) != 0;
+   // The operating system must also save the upper halves of registers
+   return osxsave && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+//! The compression function for one message at a time
+Transform BestTransform()
+{
+#if defined(SHA256_X86)
+   static const Transform transform =
+      HaveSHA() ? sha256_transform_shani : sha256_transform;
+   return transform;
+#else
+   return sha256_transform;
+#endif
+}
+
+//! Pads the last `length` bytes of a message of `bitLength` bits, already in
+//! `buffer`, compresses them and formats the result
+std::string FinishHash(
+   Transform transform, uint32_t state[8], uint8_t buffer[SHA256::BLOCK_SIZE],
+   std::size_t length, uint64_t bitLength)
+{
+   assert(length < SHA256::BLOCK_SIZE);
+
+   buffer[length++] = 0x80;
+
+   if (length > 56)
+   {
+      std::memset(buffer + length, 0, SHA256::BLOCK_SIZE - length);
+      transform(state, buffer, 1);
+      length = 0;
+   }
+
+   std::memset(buffer + length, 0, 56 - length);
+
+   for (int i = 0; i < 8; ++i)
+      buffer[56 + i] = (bitLength >> (56 - 8 * i)) & 0xff;
+
+   transform(state, buffer, 1);
+
+   // Convert to hex string
+   constexpr char hexChars[] = "0123456789ABCDEF";
+   std::string resultStr;
+   resultStr.resize(SHA256::HASH_SIZE * 2);
+
+   for (int i = 0; i < 8; ++i)
+   {
+      for (int j = 0; j < 4; ++j)
+      {
+         const uint8_t byte = (state[i] >> (24 - 8 * j)) & 0xff;
+         resultStr[i * 8 + j * 2 + 0] = hexChars[(byte >> 4) & 0xf];
+         resultStr[i * 8 + j * 2 + 1] = hexChars[byte & 0xf];
+      }
+   }
+
+   return resultStr;
+}
+
+constexpr uint32_t InitialState[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                       0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                       0x1f83d9ab, 0x5be0cd19 };
+
+//! Hashes the bytes after the last whole block of a message
+std::string FinishInput(
+   Transform transform, uint32_t state[8], const HashInput& input)
+{
+   uint8_t buffer[SHA256::BLOCK_SIZE];
+   const auto tail = input.size % SHA256::BLOCK_SIZE;
+   // The data of an empty input may be null
+   if (tail > 0)
+      std::memcpy(
+         buffer, static_cast<const uint8_t*>(input.data) + input.size - tail,
+         tail);
+   return FinishHash(transform, state, buffer, tail, uint64_t(input.size) * 8);
+}
+
+template<Transform transform>
+void HashEach(const HashInput* inputs, std::size_t count, std::string* results)
+{
+   for (std::size_t i = 0; i < count; ++i)
+   {
+      uint32_t state[8];
+      std::copy(std::begin(InitialState), std::end(InitialState), state);
+      transform(
+         state, static_cast<const uint8_t*>(inputs[i].data),
+         inputs[i].size / SHA256::BLOCK_SIZE);
+      results[i] = FinishInput(transform, state, inputs[i]);
+   }
+}
+
+#if defined(SHA256_X86)
+//! Hashes the inputs eight at a time in the lanes of the AVX2 transform
+/*!
+ A lane that runs out of whole blocks finishes its message with the scalar
+ transform and takes the next input, so that inputs of different sizes
+ still keep the lanes busy.  When too few inputs remain to fill the lanes,
+ the rest are finished one at a time.
+ */
+void HashManyAVX2(const HashInput* inputs, std::size_t count, std::string* results)
+{
+   constexpr std::size_t nLanes = 8;
+   // Below this many busy lanes the scalar transform is faster
+   constexpr std::size_t minLanes = 3;
+
+   struct Lane
+   {
+      std::size_t input;
+      const uint8_t* data;
+      std::size_t blocks;
+      uint32_t state[8];
+   };
+   std::array<Lane, nLanes> lanes;
+   std::size_t nBusy = 0;
+   std::size_t nextInput = 0;
+
+   while (true)
+   {
+      // Fill the idle lanes, which come after the busy ones
+      while (nBusy < nLanes && nextInput < count)
+      {
+         auto& lane = lanes[nBusy];
+         lane.input = nextInput++;
+         lane.data = static_cast<const uint8_t*>(inputs[lane.input].data);
+         lane.blocks = inputs[lane.input].size / SHA256::BLOCK_SIZE;
+         std::copy(
+            std::begin(InitialState), std::end(InitialState), lane.state);
+         if (lane.blocks == 0)
+            results[lane.input] =
+               FinishInput(sha256_transform, lane.state, inputs[lane.input]);
+         else
+            ++nBusy;
+      }
+
+      if (nBusy < minLanes)
+         break;
+
+      std::size_t nBlocks = lanes[0].blocks;
+      for (std::size_t i = 1; i < nBusy; ++i)
+         nBlocks = std::min(nBlocks, lanes[i].blocks);
+
+      // Idle lanes repeat the work of the first, which is discarded
+      uint32_t* states[nLanes];
+      const uint8_t* data[nLanes];
+      uint32_t discarded[nLanes][8];
+      for (std::size_t i = 0; i < nLanes; ++i)
+      {
+         if (i < nBusy)
+         {
+            states[i] = lanes[i].state;
+            data[i] = lanes[i].data;
+         }
+         else
+         {
+            states[i] = discarded[i];
+            data[i] = lanes[0].data;
+         }
+      }
+      sha256_transform_avx2x8(states, data, nBlocks);
+
+      for (std::size_t i = 0; i < nBusy;)
+      {
+         auto& lane = lanes[i];
+         lane.data += nBlocks * SHA256::BLOCK_SIZE;
+         lane.blocks -= nBlocks;
+         if (lane.blocks > 0)
+         {
+            ++i;
+            continue;
+         }
+         results[lane.input] =
+            FinishInput(sha256_transform, lane.state, inputs[lane.input]);
+         // Keep the busy lanes first
+         lane = lanes[--nBusy];
+      }
+   }
+
+   for (std::size_t i = 0; i < nBusy; ++i)
+   {
+      auto& lane = lanes[i];
+      sha256_transform(lane.state, lane.data, lane.blocks);
+      results[lane.input] =
+         FinishInput(sha256_transform, lane.state, inputs[lane.input]);
+   }
+}
+#endif
+
 } // namespace
 
 SHA256::SHA256()
@@ -98,9 +537,21 @@ SHA256::SHA256()
 void SHA256::Update(const void* data, std::size_t size)
 {
    const uint8_t* dataPtr = static_cast<const uint8_t*>(data);
+   const auto transform = BestTransform();
 
    while (size > 0)
    {
+      // Whole blocks need no copy into the buffer
+      if (mBufferLength == 0 && size >= SHA256::BLOCK_SIZE)
+      {
+         const auto nBlocks = size / SHA256::BLOCK_SIZE;
+         transform(mState, dataPtr, nBlocks);
+         mBitLength += 512 * nBlocks;
+         dataPtr += nBlocks * SHA256::BLOCK_SIZE;
+         size -= nBlocks * SHA256::BLOCK_SIZE;
+         continue;
+      }
+
       std::size_t blockSize =
          std::min<size_t>(size, SHA256::BLOCK_SIZE - mBufferLength);
 
@@ -112,7 +563,7 @@ void SHA256::Update(const void* data, std::size_t size)
 
       if (mBufferLength == SHA256::BLOCK_SIZE)
       {
-         sha256_transform(mState, mBuffer);
+         transform(mState, mBuffer, 1);
          mBitLength += 512;
          mBufferLength = 0;
       }
@@ -126,64 +577,13 @@ void SHA256::Update(const char* zString)
 
 std::string SHA256::Finalize()
 {
-   uint8_t pad[SHA256::BLOCK_SIZE];
-   std::size_t padLength;
-
-   // `mBufferLength` is always less than SHA256::BLOCK_SIZE. See `Update`
-   // method.
-   assert(mBufferLength < SHA256::BLOCK_SIZE);
-
    mBitLength += mBufferLength * 8;
 
-   if (mBufferLength < 56)
-   {
-      mBuffer[mBufferLength++] = 0x80;
-      std::memset(mBuffer + mBufferLength, 0, 56 - mBufferLength);
-   }
-   else
-   {
-      mBuffer[mBufferLength++] = 0x80;
-      std::memset(
-         mBuffer + mBufferLength, 0, SHA256::BLOCK_SIZE - mBufferLength);
-      sha256_transform(mState, mBuffer);
-      std::memset(mBuffer, 0, 56);
-   }
-
-
-   mBuffer[56] = (mBitLength >> 56) & 0xff;
-   mBuffer[57] = (mBitLength >> 48) & 0xff;
-   mBuffer[58] = (mBitLength >> 40) & 0xff;
-   mBuffer[59] = (mBitLength >> 32) & 0xff;
-   mBuffer[60] = (mBitLength >> 24) & 0xff;
-   mBuffer[61] = (mBitLength >> 16) & 0xff;
-   mBuffer[62] = (mBitLength >> 8) & 0xff;
-   mBuffer[63] = (mBitLength >> 0) & 0xff;
-
-   sha256_transform(mState, mBuffer);
-
-   uint8_t result[SHA256::HASH_SIZE];
-
-   for (int i = 0; i < 8; ++i)
-   {
-      result[i * 4 + 0] = (mState[i] >> 24) & 0xff;
-      result[i * 4 + 1] = (mState[i] >> 16) & 0xff;
-      result[i * 4 + 2] = (mState[i] >> 8) & 0xff;
-      result[i * 4 + 3] = (mState[i] >> 0) & 0xff;
-   }
+   auto resultStr =
+      FinishHash(BestTransform(), mState, mBuffer, mBufferLength, mBitLength);
 
    Reset();
 
-   // Convert to hex string
-   constexpr char hexChars[] = "0123456789ABCDEF";
-   std::string resultStr;
-   resultStr.resize(HASH_SIZE * 2);
-
-   for (int i = 0; i < SHA256::HASH_SIZE; ++i)
-   {
-      resultStr[i * 2 + 0] = hexChars[(result[i] >> 4) & 0xf];
-      resultStr[i * 2 + 1] = hexChars[result[i] & 0xf];
-   }
-
    return resultStr;
 }
 
@@ -191,17 +591,35 @@ void SHA256::Reset()
 {
    mBitLength = 0;
 
-   mState[0] = 0x6a09e667;
-   mState[1] = 0xbb67ae85;
-   mState[2] = 0x3c6ef372;
-   mState[3] = 0xa54ff53a;
-   mState[4] = 0x510e527f;
-   mState[5] = 0x9b05688c;
-   mState[6] = 0x1f83d9ab;
-   mState[7] = 0x5be0cd19;
+   std::copy(std::begin(InitialState), std::end(InitialState), mState);
 
    std::memset(mBuffer, 0, sizeof(mBuffer));
    mBufferLength = 0;
 }
 
+const std::vector<SHA256Batcher>& GetSHA256Batchers()
+{
+   static const auto batchers = []{
+      std::vector<SHA256Batcher> result { { "scalar",
+                                            HashEach<sha256_transform> } };
+#if defined(SHA256_X86)
+      if (HaveAVX2())
+         result.push_back({ "AVX2 x8", HashManyAVX2 });
+      // One message at a time with the SHA extensions beats eight with AVX2
+      if (HaveSHA())
+         result.push_back({ "SHA-NI", HashEach<sha256_transform_shani> });
+#endif
+      return result;
+   }();
+   return batchers;
+}
+
+std::vector<std::string> sha256_many(const std::vector<HashInput>& inputs)
+{
+   static const auto hash = GetSHA256Batchers().back().hash;
+   std::vector<std::string> results(inputs.size());
+   hash(inputs.data(), inputs.size(), results.data());
+   return results;
+}
+
 } // namespace crypto
@@ -10,6 +10,7 @@
 #include <cstddef>
 
 #include <string>
+#include <vector>
 
 namespace crypto
 {
@@ -53,4 +54,31 @@ std::string sha256(const T& data)
    hasher.Update(data);
    return hasher.Finalize();
 }
+
+//! One of the buffers hashed by sha256_many
+struct HashInput final
+{
+   const void* data;
+   std::size_t size;
+};
+
+//! Computes the hashes of independent buffers, as sha256 would for each
+/*!
+ On x86 the buffers are hashed with the SHA extensions when the CPU has
+ them, or else eight at a time in the lanes of AVX2 registers, which is
+ fastest when the batch has at least eight buffers of similar size.
+ */
+CRYPTO_API std::vector<std::string>
+sha256_many(const std::vector<HashInput>& inputs);
+
+//! One implementation of sha256_many, for testing and benchmarking
+struct SHA256Batcher final
+{
+   const char* name;
+   void (*hash)(const HashInput* inputs, std::size_t count, std::string* results);
+};
+
+//! Implementations usable on this machine; the portable one comes first, and
+//! sha256_many uses the last
+CRYPTO_API const std::vector<SHA256Batcher>& GetSHA256Batchers();
 } // namespace crypto
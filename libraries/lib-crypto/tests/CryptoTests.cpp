@@ -6,6 +6,9 @@
 
 #include <catch2/catch.hpp>
 
+#include <cstdint>
+#include <vector>
+
 #include "crypto/SHA256.h"
 
 TEST_CASE("SHA256", "")
@@ -35,3 +38,56 @@ TEST_CASE("SHA256", "")
          " is a free, open source, cross-platform audio software for multi-track recording and editing.") ==
          "00E7C81A5357B1734035CE4CAE5DC0B3F886D22C8AF2E3952E2F5569A994B8A8");
 }
+
+TEST_CASE("sha256_many", "")
+{
+   // Sizes around the block boundaries and the padding limit, and a few
+   // large ones of different lengths, so that lanes finish at different
+   // times
+   std::vector<std::vector<uint8_t>> buffers;
+   for (std::size_t size = 0; size <= 3 * crypto::SHA256::BLOCK_SIZE; ++size)
+   {
+      buffers.emplace_back(size);
+      for (std::size_t i = 0; i < size; ++i)
+         buffers.back()[i] = static_cast<uint8_t>(i * 31 + size);
+   }
+   for (std::size_t size : { 100000, 262144, 262145, 70000, 1000000 })
+   {
+      buffers.emplace_back(size);
+      for (std::size_t i = 0; i < size; ++i)
+         buffers.back()[i] = static_cast<uint8_t>(i ^ (i >> 8) ^ size);
+   }
+
+   std::vector<crypto::HashInput> inputs;
+   std::vector<std::string> expected;
+   for (const auto& buffer : buffers)
+   {
+      inputs.push_back({ buffer.data(), buffer.size() });
+      // Byte by byte, unlike any batcher
+      crypto::SHA256 hasher;
+      for (auto byte : buffer)
+         hasher.Update(&byte, 1);
+      expected.push_back(hasher.Finalize());
+   }
+
+   REQUIRE(crypto::sha256_many(inputs) == expected);
+
+   for (const auto& batcher : crypto::GetSHA256Batchers())
+   {
+      INFO(batcher.name);
+      std::vector<std::string> results(inputs.size());
+      batcher.hash(inputs.data(), inputs.size(), results.data());
+      REQUIRE(results == expected);
+
+      // Fewer inputs than lanes
+      std::vector<std::string> few(3);
+      batcher.hash(inputs.data() + 60, few.size(), few.data());
+      REQUIRE(few == std::vector<std::string>(
+                        expected.begin() + 60, expected.begin() + 63));
+   }
+
+   REQUIRE(
+      crypto::sha256_many({ { "abc", 3 } }) ==
+      std::vector<std::string> {
+         "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD" });
+}
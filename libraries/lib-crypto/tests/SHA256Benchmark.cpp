@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: SHA256Benchmark.cpp
+ */
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "crypto/SHA256.h"
+
+TEST_CASE("sha256_many benchmark", "[.][benchmark]")
+{
+   // As many sample blocks of the default size as in a minute of float
+   // samples at 44.1 kHz, hashed in batches as BlockHasher does
+   constexpr std::size_t blockSize = 262144 * 4;
+   constexpr std::size_t nBlocks = 44100 * 60 * 4 / blockSize + 1;
+   constexpr std::size_t batchSize = 8;
+
+   std::vector<std::vector<uint8_t>> blocks(nBlocks);
+   std::mt19937 engine { 1 };
+   for (auto& block : blocks)
+   {
+      block.resize(blockSize);
+      for (auto& byte : block)
+         byte = static_cast<uint8_t>(engine());
+   }
+
+   constexpr int nTrials = 5;
+   for (const auto& batcher : crypto::GetSHA256Batchers())
+   {
+      using namespace std::chrono;
+      std::vector<crypto::HashInput> inputs;
+      std::vector<std::string> results(batchSize);
+      const auto start = steady_clock::now();
+      for (int trial = 0; trial < nTrials; ++trial)
+      {
+         for (std::size_t first = 0; first < nBlocks; first += batchSize)
+         {
+            inputs.clear();
+            for (auto i = first; i < std::min(first + batchSize, nBlocks); ++i)
+               inputs.push_back({ blocks[i].data(), blocks[i].size() });
+            batcher.hash(inputs.data(), inputs.size(), results.data());
+         }
+      }
+      const auto elapsed =
+         duration<double>(steady_clock::now() - start).count() / nTrials;
+      const auto megabytes = double(nBlocks * blockSize) / (1 << 20);
+      std::cout << batcher.name << ": " << elapsed * 1000 << " ms per "
+                << "minute of audio, " << megabytes / elapsed
+                << " MB per second\n";
+      REQUIRE(elapsed > 0);
+   }
+}
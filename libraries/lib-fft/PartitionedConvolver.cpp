@@ -0,0 +1,124 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PartitionedConvolver.cpp
+
+  Each block of output is the second half of the circular convolution of the
+  last two blocks of input with each partition of the impulse, zero padded to
+  twice the block size; the first half, which wraps around, is discarded.
+  pffft's unordered transforms suffice, because spectra are only multiplied
+  and accumulated, never inspected.
+
+**********************************************************************/
+#include "PartitionedConvolver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <pffft.h>
+
+PartitionedConvolver::PartitionedConvolver(
+   const float *impulse, size_t impulseLength, size_t blockSize)
+   : mBlockSize{ blockSize }
+   , mImpulseLength{ impulseLength }
+   , mPartitions{ (impulseLength + blockSize - 1) / blockSize }
+   , mFFTSize{ 2 * blockSize }
+   , mSetup{ pffft_new_setup(mFFTSize, PFFFT_REAL) }
+   , mImpulseSpectra(mPartitions * mFFTSize)
+   , mInputSpectra(mPartitions * mFFTSize)
+   , mInput(mFFTSize)
+   , mAccumulator(mFFTSize)
+   , mWork(mFFTSize)
+   , mPendingInput(mBlockSize)
+   , mPendingOutput(mBlockSize)
+{
+   assert(impulseLength > 0);
+   // pffft requires real transforms of multiples of 32 points
+   assert(blockSize >= 16 && (blockSize & (blockSize - 1)) == 0);
+   assert(mSetup);
+
+   // The inverse transform is not normalized; scale the impulse instead
+   const auto scale = 1.0f / mFFTSize;
+   for (size_t ii = 0; ii < mPartitions; ++ii) {
+      const auto first = ii * mBlockSize;
+      const auto last = std::min(impulseLength, first + mBlockSize);
+      auto &buffer = mAccumulator;
+      std::fill(buffer.begin(), buffer.end(), 0.0f);
+      std::transform(impulse + first, impulse + last, buffer.begin(),
+         [scale](float coefficient){ return coefficient * scale; });
+      pffft_transform(mSetup.get(), buffer.data(),
+         mImpulseSpectra.data() + ii * mFFTSize, mWork.data(), PFFFT_FORWARD);
+   }
+}
+
+PartitionedConvolver::~PartitionedConvolver() = default;
+
+size_t PartitionedConvolver::FastBlockSize(size_t impulseLength)
+{
+   // Fewer partitions need fewer multiply-accumulates, but transforms cost
+   // more per sample as blocks grow, and much more beyond a few thousand
+   // points, when they fall out of cache.  So blocks near half the length of
+   // the impulse are best, up to that limit, unless partitions become many.
+   size_t result = 256;
+   while (result < 2048 && 2 * result < impulseLength)
+      result *= 2;
+   while (result < 16384 && 8 * result < impulseLength)
+      result *= 2;
+   return result;
+}
+
+void PartitionedConvolver::ProcessBlock(const float *input, float *output)
+{
+   const auto pInput = mInput.data();
+   std::copy(pInput + mBlockSize, pInput + mFFTSize, pInput);
+   std::copy(input, input + mBlockSize, pInput + mBlockSize);
+
+   // The delay line is indexed so that the partition of index ii meets the
+   // spectrum of the input of ii blocks ago
+   mNewest = (mNewest + mPartitions - 1) % mPartitions;
+   pffft_transform(mSetup.get(), pInput,
+      mInputSpectra.data() + mNewest * mFFTSize, mWork.data(), PFFFT_FORWARD);
+
+   const auto pAccumulator = mAccumulator.data();
+   std::fill(pAccumulator, pAccumulator + mFFTSize, 0.0f);
+   for (size_t ii = 0, index = mNewest; ii < mPartitions; ++ii) {
+      pffft_zconvolve_accumulate(mSetup.get(),
+         mInputSpectra.data() + index * mFFTSize,
+         mImpulseSpectra.data() + ii * mFFTSize, pAccumulator, 1.0f);
+      if (++index == mPartitions)
+         index = 0;
+   }
+   pffft_transform(mSetup.get(),
+      pAccumulator, pAccumulator, mWork.data(), PFFFT_BACKWARD);
+
+   std::copy(pAccumulator + mBlockSize, pAccumulator + mFFTSize, output);
+}
+
+void PartitionedConvolver::Process(
+   const float *input, float *output, size_t len)
+{
+   while (len > 0) {
+      const auto count = std::min(len, mBlockSize - mPending);
+      // Take the input before overwriting it with output
+      std::copy(input, input + count, mPendingInput.data() + mPending);
+      std::copy(mPendingOutput.data() + mPending,
+         mPendingOutput.data() + mPending + count, output);
+      input += count;
+      output += count;
+      len -= count;
+      if ((mPending += count) == mBlockSize) {
+         ProcessBlock(mPendingInput.data(), mPendingOutput.data());
+         mPending = 0;
+      }
+   }
+}
+
+void PartitionedConvolver::Reset()
+{
+   std::fill(mInputSpectra.begin(), mInputSpectra.end(), 0.0f);
+   std::fill(mInput.begin(), mInput.end(), 0.0f);
+   std::fill(mPendingOutput.begin(), mPendingOutput.end(), 0.0f);
+   mNewest = 0;
+   mPending = 0;
+}
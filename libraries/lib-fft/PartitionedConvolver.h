@@ -0,0 +1,92 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PartitionedConvolver.h
+
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+
+#include "PowerSpectrumGetter.h" // for PffftSetupHolder, PffftFloatVector
+
+//! Convolution with a fixed impulse response, by uniformly partitioned
+//! overlap-save in the frequency domain
+/*!
+ The impulse response is cut into partitions of the block size, each
+ transformed once.  Each block of input is transformed once, into a delay
+ line of spectra.  The spectra are multiplied by those of the partitions and
+ accumulated, with pffft's vectorized complex multiply-accumulate, and one
+ inverse transform then yields a block of output.
+
+ Delay does not grow with the length of the response, only the number of
+ multiply-accumulates per block, so long responses are cheap and the block
+ size can be chosen for latency.
+ */
+class FFT_API PartitionedConvolver final
+{
+public:
+   /*!
+    @param impulse `impulseLength` coefficients, copied
+    @pre `impulseLength > 0`
+    @pre `blockSize` is a power of 2, at least 16
+    */
+   PartitionedConvolver(
+      const float *impulse, size_t impulseLength, size_t blockSize);
+   ~PartitionedConvolver();
+
+   PartitionedConvolver(const PartitionedConvolver&) = delete;
+   PartitionedConvolver &operator=(const PartitionedConvolver&) = delete;
+
+   //! A power of 2 block size that makes processing fast for a given length
+   //! of impulse response, when latency does not matter
+   static size_t FastBlockSize(size_t impulseLength);
+
+   size_t BlockSize() const { return mBlockSize; }
+   size_t ImpulseLength() const { return mImpulseLength; }
+
+   //! Samples by which Process() delays its output
+   size_t Latency() const { return mBlockSize; }
+
+   //! Convolve exactly BlockSize() samples, without delay
+   /*!
+    Output is the convolution of all input since construction or Reset().
+    `input` and `output` may be the same.
+    */
+   void ProcessBlock(const float *input, float *output);
+
+   //! Convolve any number of samples, with output delayed by Latency()
+   /*! `input` and `output` may be the same. */
+   void Process(const float *input, float *output, size_t len);
+
+   //! Forget all past input
+   void Reset();
+
+private:
+   const size_t mBlockSize;
+   const size_t mImpulseLength;
+   const size_t mPartitions;
+   //! Size of the transforms, twice the block size
+   const size_t mFFTSize;
+
+   PffftSetupHolder mSetup;
+   //! Spectra of the partitions of the impulse, scaled to normalize the
+   //! inverse transform, in pffft's internal order
+   PffftFloatVector mImpulseSpectra;
+   //! Spectra of recent blocks of input, a circular buffer of mPartitions
+   PffftFloatVector mInputSpectra;
+   //! Index in mInputSpectra of the newest spectrum
+   size_t mNewest{ 0 };
+
+   //! The previous block of input, then the current one
+   PffftFloatVector mInput;
+   PffftFloatVector mAccumulator;
+   PffftFloatVector mWork;
+
+   //! For Process(): input not yet making a block, and output not yet taken
+   PffftFloatVector mPendingInput;
+   PffftFloatVector mPendingOutput;
+   size_t mPending{ 0 };
+};
@@ -19,6 +19,11 @@
 *                   and recomputed on every call.
 *                 - Added Reorder* functions to undo the bit-reversal
 *
+*              The transforms may instead be done by pffft, with SIMD
+*              instructions.  Its output is in natural order, so that the
+*              BitReversed table of such an FFTParam is the identity, and
+*              callers need not know which backend they use.
+*
 *  Copyright (C) 2009  Philip VanBaren
 *
 *  This program is free software; you can redistribute it and/or modify
@@ -38,21 +43,38 @@
 
 #include "RealFFTf.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <stdlib.h>
 #include <math.h>
 
-#include <wx/thread.h>
+#include "PowerSpectrumGetter.h"
 
 #ifndef M_PI
 #define	M_PI		3.14159265358979323846  /* pi */
 #endif
 
+namespace {
+//! pffft handles real transforms of multiples of this size
+size_t PffftMinimumSize()
+{
+   static const size_t result = 2 * pffft_simd_size() * pffft_simd_size();
+   return result;
+}
+
+bool PffftAligned(const fft_type *buffer)
+{
+   static const auto alignment = pffft_simd_size() * sizeof(fft_type);
+   return reinterpret_cast<std::uintptr_t>(buffer) % alignment == 0;
+}
+
 /*
 *  Initialize the Sine table and Twiddle pointers (bit-reversed pointers)
 *  for the FFT routine.
 */
-HFFT InitializeFFT(size_t fftlen)
+HFFT InitializeFFT(size_t fftlen, FFTBackend backend)
 {
    int temp;
    HFFT h{ safenew FFTParam };
@@ -64,10 +86,18 @@ HFFT InitializeFFT(size_t fftlen)
    */
    h->Points = fftlen / 2;
 
-   h->SinTable.reinit(2*h->Points);
-
    h->BitReversed.reinit(h->Points);
 
+   if (backend == FFTBackend::Pffft) {
+      // Bins come out of pffft in order, two floats each
+      for(size_t i = 0; i < h->Points; i++)
+         h->BitReversed[i] = 2 * i;
+      h->pSetup = { pffft_new_setup(fftlen, PFFFT_REAL), pffft_destroy_setup };
+      return h;
+   }
+
+   h->SinTable.reinit(2*h->Points);
+
    for(size_t i = 0; i < h->Points; i++)
    {
       temp = 0;
@@ -93,53 +123,120 @@ HFFT InitializeFFT(size_t fftlen)
    return h;
 }
 
-enum : size_t { MAX_HFFT = 10 };
+//! Tables of each backend for each power of two size, made when first
+//! needed, and kept until exit
+/*!
+ Tables are not changed after they are made, so that threads may share them.
+ Two threads making the same tables at once both succeed, but only one
+ keeps them; so there is no lock.
+ */
+struct Pool {
+   enum : size_t { MaxBits = 8 * sizeof(size_t) };
+
+   ~Pool()
+   {
+      for (auto &row : entries)
+         for (auto &entry : row)
+            delete entry.load();
+   }
+
+   //! @return null if the tables for `fftlen` are not pooled
+   std::atomic<FFTParam*> *Find(size_t fftlen, FFTBackend backend)
+   {
+      if (fftlen == 0 || (fftlen & (fftlen - 1)))
+         return nullptr;
+      size_t bits = 0;
+      while ((size_t{ 1 } << bits) < fftlen)
+         ++bits;
+      return &entries[static_cast<size_t>(backend)][bits];
+   }
 
-// Maintain a pool:
-static std::vector< std::unique_ptr<FFTParam> > hFFTArray(MAX_HFFT);
-wxCriticalSection getFFTMutex;
+   std::atomic<FFTParam*> entries[2][MaxBits]{};
+};
+
+Pool sPool;
+}
+
+HFFT GetFFT(size_t fftlen, FFTBackend backend)
+{
+   if (backend == FFTBackend::Pffft &&
+       (fftlen < PffftMinimumSize() || fftlen % PffftMinimumSize()))
+      backend = FFTBackend::Radix2;
+
+   const auto pEntry = sPool.Find(fftlen, backend);
+   if (!pEntry)
+      // Not a power of two; allocate a NEW set of tables
+      return InitializeFFT(fftlen, backend);
+
+   if (const auto p = pEntry->load(std::memory_order_acquire))
+      return HFFT{ p };
+
+   auto h = InitializeFFT(fftlen, backend);
+   FFTParam *expected = nullptr;
+   if (pEntry->compare_exchange_strong(expected, h.get(),
+      std::memory_order_acq_rel))
+      // The pool owns it now, and FFTDeleter will find it there
+      return HFFT{ h.release() };
+   // Another thread made the same tables first
+   return HFFT{ expected };
+}
 
 /* Get a handle to the FFT tables of the desired length */
 /* This version keeps common tables rather than allocating a NEW table every time */
 HFFT GetFFT(size_t fftlen)
 {
-   // To do:  smarter policy about when to retain in the pool and when to
-   // allocate a unique instance.
-
-   wxCriticalSectionLocker locker{ getFFTMutex };
-   
-   size_t h = 0;
-   auto n = fftlen/2;
-   auto size = hFFTArray.size();
-   for(;
-       (h < size) && hFFTArray[h] && (n != hFFTArray[h]->Points);
-       h++)
-      ;
-   if(h < size) {
-      if(hFFTArray[h] == NULL) {
-         hFFTArray[h].reset( InitializeFFT(fftlen).release() );
-      }
-      return HFFT{ hFFTArray[h].get() };
-   } else {
-      // All buffers used, so fall back to allocating a NEW set of tables
-      return InitializeFFT(fftlen);
-   }
+#ifdef EXPERIMENTAL_EQ_SSE_THREADED
+   // The SSE routines use the sine table of the portable backend
+   return GetFFT(fftlen, FFTBackend::Radix2);
+#else
+   return GetFFT(fftlen, FFTBackend::Pffft);
+#endif
 }
 
 /* Release a previously requested handle to the FFT tables */
 void FFTDeleter::operator() (FFTParam *hFFT) const
 {
-   wxCriticalSectionLocker locker{ getFFTMutex };
-
-   auto it = hFFTArray.begin(), end = hFFTArray.end();
-   while (it != end && it->get() != hFFT)
-      ++it;
-   if ( it != end )
+   const auto backend =
+      hFFT->pSetup ? FFTBackend::Pffft : FFTBackend::Radix2;
+   const auto pEntry = sPool.Find(hFFT->Points * 2, backend);
+   if (pEntry && pEntry->load(std::memory_order_acquire) == hFFT)
       ;
    else
       delete hFFT;
 }
 
+namespace {
+//! Transform with pffft, in place, through aligned scratch space of this
+//! thread if the buffer is not aligned as pffft requires
+void PffftTransform(
+   fft_type *buffer, const FFTParam *h, pffft_direction_t direction)
+{
+   const auto fftlen = h->Points * 2;
+   thread_local PffftFloatVector work, aligned;
+   if (work.size() < fftlen)
+      work.resize(fftlen);
+
+   auto data = buffer;
+   if (!PffftAligned(buffer)) {
+      if (aligned.size() < fftlen)
+         aligned.resize(fftlen);
+      data = aligned.data();
+      std::copy(buffer, buffer + fftlen, data);
+   }
+
+   pffft_transform_ordered(h->pSetup.get(), data, data, work.data(), direction);
+
+   if (direction == PFFFT_BACKWARD) {
+      // pffft does not scale, but InverseRealFFTf divides by the size
+      const auto scale = 1.0f / fftlen;
+      for (size_t i = 0; i < fftlen; ++i)
+         buffer[i] = data[i] * scale;
+   }
+   else if (data != buffer)
+      std::copy(data, data + fftlen, buffer);
+}
+}
+
 /*
 *  Forward FFT routine.  Must call GetFFT(fftlen) first!
 *
@@ -160,6 +257,9 @@ void FFTDeleter::operator() (FFTParam *hFFT) const
 */
 void RealFFTf(fft_type *buffer, const FFTParam *h)
 {
+   if (h->pSetup)
+      return PffftTransform(buffer, h, PFFFT_FORWARD);
+
    fft_type *A,*B;
    const fft_type *sptr;
    const fft_type *endptr1,*endptr2;
@@ -262,6 +362,9 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
 */
 void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
 {
+   if (h->pSetup)
+      return PffftTransform(buffer, h, PFFFT_BACKWARD);
+
    fft_type *A,*B;
    const fft_type *sptr;
    const fft_type *endptr1,*endptr2;
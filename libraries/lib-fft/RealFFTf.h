@@ -3,11 +3,25 @@
 
 #include "MemoryX.h"
 
+struct PFFFT_Setup;
+
 using fft_type = float;
+
+//! Implementations of RealFFTf and InverseRealFFTf
+enum class FFTBackend {
+   //! Portable; the output of the transforms is in bit-reversed order
+   Radix2,
+   //! Vectorized by pffft, for sizes that are multiples of 32; the output is
+   //! in order, and BitReversed maps each bin to its own place
+   Pffft,
+};
+
 struct FFTParam {
    ArrayOf<int> BitReversed;
    ArrayOf<fft_type> SinTable;
    size_t Points;
+   //! Not null when the backend is FFTBackend::Pffft
+   std::shared_ptr<PFFFT_Setup> pSetup;
 #ifdef EXPERIMENTAL_EQ_SSE_THREADED
    int pow2Bits;
 #endif
@@ -21,7 +35,14 @@ using HFFT = std::unique_ptr<
    FFTParam, FFTDeleter
 >;
 
-FFT_API HFFT GetFFT(size_t);
+//! Tables for the fastest backend that can transform `fftlen` points
+/*!
+ Tables are made once for each size, and shared by all threads without
+ locking
+ */
+FFT_API HFFT GetFFT(size_t fftlen);
+//! Tables for the given backend, or for Radix2 if it can't do the size
+FFT_API HFFT GetFFT(size_t fftlen, FFTBackend backend);
 FFT_API void RealFFTf(fft_type *, const FFTParam *);
 FFT_API void InverseRealFFTf(fft_type *, const FFTParam *);
 FFT_API void ReorderToTime(const FFTParam *hFFT, const fft_type *buffer, fft_type *TimeOut);
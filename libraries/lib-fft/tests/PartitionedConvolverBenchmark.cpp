@@ -0,0 +1,111 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PartitionedConvolverBenchmark.cpp
+
+**********************************************************************/
+#include "PartitionedConvolver.h"
+#include "RealFFTf.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+// Ten seconds of audio at 44.1 kHz
+constexpr size_t nSamples = 441000;
+
+std::vector<float> RandomSamples(size_t size, std::mt19937& engine)
+{
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+   std::vector<float> result(size);
+   for (auto& sample : result)
+      sample = distribution(engine);
+   return result;
+}
+
+//! Overlap-add of windows of one fixed size, as Equalization did
+double SingleWindowSeconds(
+   const std::vector<float>& samples, const std::vector<float>& impulse)
+{
+   constexpr size_t windowSize = 16384;
+   const auto L = windowSize - (impulse.size() - 1);
+   auto hFFT = GetFFT(windowSize);
+   std::vector<float> filter(windowSize), window(windowSize), last(windowSize);
+   std::copy(impulse.begin(), impulse.end(), filter.begin());
+   RealFFTf(filter.data(), hFFT.get());
+   std::vector<float> output(samples.size());
+
+   using namespace std::chrono;
+   const auto start = steady_clock::now();
+   for (size_t pos = 0; pos < samples.size(); pos += L)
+   {
+      const auto count = std::min(L, samples.size() - pos);
+      std::copy(
+         samples.begin() + pos, samples.begin() + pos + count, window.begin());
+      std::fill(window.begin() + count, window.end(), 0.0f);
+      RealFFTf(window.data(), hFFT.get());
+      for (size_t ii = 1; ii < windowSize / 2; ++ii)
+      {
+         const auto kk = hFFT->BitReversed[ii];
+         const auto re = window[kk], im = window[kk + 1];
+         window[kk] = re * filter[kk] - im * filter[kk + 1];
+         window[kk + 1] = re * filter[kk + 1] + im * filter[kk];
+      }
+      window[0] *= filter[0];
+      window[1] *= filter[1];
+      InverseRealFFTf(window.data(), hFFT.get());
+      for (size_t ii = 0; ii < count; ++ii)
+         output[pos + ii] = window[hFFT->BitReversed[ii / 2] + ii % 2] +
+                            (ii < impulse.size() - 1 ? last[L + ii] : 0);
+      std::swap(window, last);
+   }
+   const auto elapsed = duration<double>(steady_clock::now() - start);
+   REQUIRE(output.size() == samples.size());
+   return elapsed.count();
+}
+
+double PartitionedSeconds(
+   const std::vector<float>& samples, const std::vector<float>& impulse,
+   size_t blockSize)
+{
+   PartitionedConvolver convolver { impulse.data(), impulse.size(),
+                                    blockSize };
+   std::vector<float> buffer(blockSize);
+
+   using namespace std::chrono;
+   const auto start = steady_clock::now();
+   for (size_t pos = 0; pos + blockSize <= samples.size(); pos += blockSize)
+      convolver.ProcessBlock(&samples[pos], buffer.data());
+   const auto elapsed = duration<double>(steady_clock::now() - start);
+   return elapsed.count();
+}
+} // namespace
+
+TEST_CASE("PartitionedConvolver benchmark", "[.][benchmark]")
+{
+   std::mt19937 engine { 1 };
+   const auto samples = RandomSamples(nSamples, engine);
+
+   for (const size_t impulseLength : { 21, 1023, 8191, 65535 })
+   {
+      const auto impulse = RandomSamples(impulseLength, engine);
+      if (impulseLength < 16384)
+         std::cout << "impulse " << impulseLength << ", one window: "
+                   << SingleWindowSeconds(samples, impulse) * 1e3 << " ms\n";
+      for (size_t blockSize = 64; blockSize <= 16384; blockSize *= 4)
+         std::cout << "impulse " << impulseLength << ", blocks of "
+                   << blockSize << ": "
+                   << PartitionedSeconds(samples, impulse, blockSize) * 1e3
+                   << " ms\n";
+      const auto fast = PartitionedConvolver::FastBlockSize(impulseLength);
+      const auto seconds = PartitionedSeconds(samples, impulse, fast);
+      std::cout << "impulse " << impulseLength << ", fast blocks of " << fast
+                << ": " << seconds * 1e3 << " ms\n";
+      REQUIRE(seconds > 0);
+   }
+}
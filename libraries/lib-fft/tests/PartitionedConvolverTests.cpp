@@ -0,0 +1,130 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PartitionedConvolverTests.cpp
+
+**********************************************************************/
+#include "PartitionedConvolver.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+std::vector<float> RandomSamples(size_t size, unsigned seed)
+{
+   std::mt19937 engine { seed };
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+   std::vector<float> result(size);
+   for (auto& sample : result)
+      sample = distribution(engine);
+   return result;
+}
+
+//! First `size` samples of the convolution, computed directly
+std::vector<float> Convolve(
+   const std::vector<float>& input, const std::vector<float>& impulse,
+   size_t size)
+{
+   std::vector<float> result(size);
+   for (size_t ii = 0; ii < size; ++ii)
+   {
+      double sum = 0;
+      for (size_t jj = 0; jj < impulse.size() && jj <= ii; ++jj)
+         if (ii - jj < input.size())
+            sum += double(impulse[jj]) * input[ii - jj];
+      result[ii] = sum;
+   }
+   return result;
+}
+
+void RequireClose(
+   const std::vector<float>& expected, const float* actual,
+   size_t impulseLength)
+{
+   // Each output sums impulseLength products of magnitude at most one
+   const auto tolerance = 2e-6f * impulseLength;
+   for (size_t ii = 0; ii < expected.size(); ++ii)
+      REQUIRE(std::abs(actual[ii] - expected[ii]) <= tolerance);
+}
+} // namespace
+
+TEST_CASE("PartitionedConvolver")
+{
+   const auto input = RandomSamples(5000, 1);
+
+   for (const size_t impulseLength : { 1, 21, 64, 1000, 8191 })
+      for (const size_t blockSize : { 16, 64, 256, 4096 })
+      {
+         INFO("impulse " << impulseLength << " block " << blockSize);
+         const auto impulse = RandomSamples(impulseLength, 2);
+         const auto expected =
+            Convolve(input, impulse, input.size() + impulseLength - 1);
+
+         // Sections can't repeat in a loop, so each block has its own
+         // convolver
+         {
+            INFO("ProcessBlock has no delay");
+            PartitionedConvolver convolver {
+               impulse.data(), impulse.size(), blockSize
+            };
+            // Input and then zeros, in place
+            std::vector<float> buffer(
+               (expected.size() + blockSize - 1) / blockSize * blockSize);
+            std::copy(input.begin(), input.end(), buffer.begin());
+            for (size_t pos = 0; pos < buffer.size(); pos += blockSize)
+               convolver.ProcessBlock(&buffer[pos], &buffer[pos]);
+            RequireClose(expected, buffer.data(), impulseLength);
+         }
+
+         {
+            INFO("Process delays by the latency");
+            PartitionedConvolver convolver {
+               impulse.data(), impulse.size(), blockSize
+            };
+            const auto latency = convolver.Latency();
+            std::vector<float> padded(expected.size() + latency);
+            std::copy(input.begin(), input.end(), padded.begin());
+            std::vector<float> output(padded.size());
+            // Irregular lengths
+            for (size_t pos = 0, len = 1; pos < padded.size(); pos += len,
+                 len = (len * 7 + 3) % 500)
+            {
+               len = std::min(len, padded.size() - pos);
+               convolver.Process(&padded[pos], &output[pos], len);
+            }
+            for (size_t ii = 0; ii < latency; ++ii)
+               REQUIRE(output[ii] == 0.0f);
+            RequireClose(expected, output.data() + latency, impulseLength);
+         }
+
+         {
+            INFO("Reset forgets past input");
+            PartitionedConvolver convolver {
+               impulse.data(), impulse.size(), blockSize
+            };
+            std::vector<float> buffer(blockSize);
+            std::copy(input.begin(), input.begin() + blockSize, buffer.begin());
+            convolver.ProcessBlock(buffer.data(), buffer.data());
+            convolver.Reset();
+            std::copy(input.begin(), input.begin() + blockSize, buffer.begin());
+            convolver.ProcessBlock(buffer.data(), buffer.data());
+            RequireClose(
+               Convolve(input, impulse, blockSize), buffer.data(),
+               impulseLength);
+         }
+      }
+}
+
+TEST_CASE("PartitionedConvolver::FastBlockSize")
+{
+   for (const size_t impulseLength : { 1, 21, 1000, 8191, 1000000 })
+   {
+      const auto size = PartitionedConvolver::FastBlockSize(impulseLength);
+      REQUIRE(size >= 16);
+      REQUIRE((size & (size - 1)) == 0);
+   }
+}
@@ -0,0 +1,53 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealFFTfBenchmark.cpp
+
+**********************************************************************/
+#include "RealFFTf.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+TEST_CASE("RealFFTf benchmark", "[.][benchmark]")
+{
+   // A forward and an inverse transform of each window of about ten seconds
+   // of audio at 44.1 kHz, as for spectral effects
+   constexpr size_t nSamples = 441000;
+   std::mt19937 engine { 1 };
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+
+   for (size_t size = 256; size <= 65536; size *= 2)
+   {
+      std::vector<float> samples(size);
+      for (auto& sample : samples)
+         sample = distribution(engine);
+      std::vector<float> buffer(size);
+      const auto nWindows = nSamples / size + 1;
+
+      for (const auto &[name, backend] :
+           { std::pair { "Radix2", FFTBackend::Radix2 },
+             std::pair { "pffft", FFTBackend::Pffft } })
+      {
+         using namespace std::chrono;
+         auto hFFT = GetFFT(size, backend);
+         const auto start = steady_clock::now();
+         for (size_t window = 0; window < nWindows; ++window)
+         {
+            std::copy(samples.begin(), samples.end(), buffer.begin());
+            RealFFTf(buffer.data(), hFFT.get());
+            InverseRealFFTf(buffer.data(), hFFT.get());
+         }
+         const auto elapsed = duration<double>(steady_clock::now() - start);
+         std::cout << name << " " << size << ": "
+                   << elapsed.count() * 1e6 / nWindows
+                   << " us per forward and inverse transform\n";
+         REQUIRE(elapsed.count() > 0);
+      }
+   }
+}
@@ -0,0 +1,90 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealFFTfTests.cpp
+
+**********************************************************************/
+#include "RealFFTf.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+std::vector<float> RandomSamples(size_t size)
+{
+   std::mt19937 engine { static_cast<unsigned>(size) };
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+   std::vector<float> result(size);
+   for (auto& sample : result)
+      sample = distribution(engine);
+   return result;
+}
+
+//! Forward transform, then real and imaginary parts in natural order
+std::vector<float> Spectrum(const std::vector<float>& samples, FFTBackend backend)
+{
+   const auto size = samples.size();
+   auto hFFT = GetFFT(size, backend);
+   // One more float, so that the buffer may start misaligned
+   std::vector<float> buffer(size + 1);
+   std::copy(samples.begin(), samples.end(), buffer.begin() + 1);
+   RealFFTf(buffer.data() + 1, hFFT.get());
+   std::vector<float> result(size + 2);
+   ReorderToFreq(hFFT.get(), buffer.data() + 1, result.data(),
+      result.data() + size / 2 + 1);
+   return result;
+}
+}
+
+TEST_CASE("RealFFTf backends")
+{
+   for (size_t size = 8; size <= 65536; size *= 2)
+   {
+      INFO("size " << size);
+      const auto samples = RandomSamples(size);
+      const auto expected = Spectrum(samples, FFTBackend::Radix2);
+      const auto actual = Spectrum(samples, FFTBackend::Pffft);
+      // Rounding errors grow with the logarithm of the size, and bins of
+      // random samples have magnitudes near the square root of the size
+      const auto tolerance = 1e-5f * std::sqrt(float(size)) * std::log2(size);
+      for (size_t ii = 0; ii < expected.size(); ++ii)
+         REQUIRE(std::abs(actual[ii] - expected[ii]) <= tolerance);
+
+      for (const auto backend : { FFTBackend::Radix2, FFTBackend::Pffft })
+      {
+         // Inverse transform scales by the size, so it restores the samples
+         auto hFFT = GetFFT(size, backend);
+         std::vector<float> buffer = samples, restored(size);
+         RealFFTf(buffer.data(), hFFT.get());
+         // From bit-reversed order to natural order, when Radix2
+         std::vector<float> spectrum(size);
+         spectrum[0] = buffer[0];
+         spectrum[1] = buffer[1];
+         for (size_t ii = 1; ii < size / 2; ++ii)
+         {
+            spectrum[2 * ii] = buffer[hFFT->BitReversed[ii]];
+            spectrum[2 * ii + 1] = buffer[hFFT->BitReversed[ii] + 1];
+         }
+         InverseRealFFTf(spectrum.data(), hFFT.get());
+         ReorderToTime(hFFT.get(), spectrum.data(), restored.data());
+         for (size_t ii = 0; ii < size; ++ii)
+            REQUIRE(std::abs(restored[ii] - samples[ii]) <= 1e-5f);
+      }
+   }
+}
+
+TEST_CASE("GetFFT shares tables")
+{
+   auto h1 = GetFFT(1024);
+   auto h2 = GetFFT(1024);
+   REQUIRE(h1.get() == h2.get());
+   REQUIRE(h1->Points == 512);
+
+   // pffft can't do this size
+   auto small = GetFFT(16, FFTBackend::Pffft);
+   REQUIRE(!small->pSetup);
+}
@@ -13,12 +13,16 @@
 #include "ExportPluginHelpers.h"
 #include "Track.h"
 #include "Mix.h"
+#include "SequencePrefetcher.h"
 #include "WaveTrack.h"
 #include "MixAndRender.h"
 #include "ExportUtils.h"
 #include "ExportPlugin.h"
 #include "StretchingSequence.h"
 
+//! How many seconds beyond the export mixer to read ahead from storage
+static constexpr double ExportPrefetchSeconds = 10.0;
+
 //Create a mixer by computing the time warp factor
 std::unique_ptr<Mixer> ExportPluginHelpers::CreateMixer(const TrackList &tracks,
          bool selectionOnly,
@@ -28,13 +32,17 @@ std::unique_ptr<Mixer> ExportPluginHelpers::CreateMixer(const TrackList &tracks,
          MixerOptions::Downmix *mixerSpec)
 {
    Mixer::Inputs inputs;
+   SequencePrefetcher::Sequences sequences;
 
    for (auto pTrack: ExportUtils::FindExportWaveTracks(tracks, selectionOnly))
+   {
       inputs.emplace_back(
          StretchingSequence::Create(*pTrack, pTrack->GetClipInterfaces()),
          GetEffectStages(*pTrack));
+      sequences.push_back(inputs.back().pSequence);
+   }
    // MB: the stop time should not be warped, this was a bug.
-   return std::make_unique<Mixer>(move(inputs),
+   auto mixer = std::make_unique<Mixer>(move(inputs),
                   // Throw, to stop exporting, if read fails:
                   true,
                   Mixer::WarpOptions{ tracks.GetOwner() },
@@ -42,7 +50,13 @@ std::unique_ptr<Mixer> ExportPluginHelpers::CreateMixer(const TrackList &tracks,
                   numOutChannels, outBufferSize, outInterleaved,
                   outRate, outFormat,
                   true, mixerSpec,
-                  mixerSpec ? Mixer::ApplyGain::MapChannels : Mixer::ApplyGain::Mixdown);
+                  mixerSpec ? Mixer::ApplyGain::MapChannels : Mixer::ApplyGain::Mixdown,
+                  // Render the tracks on all available threads
+                  Mixer::Threading{ 0 });
+   // Read ahead of the mixer, so that it waits less on the project file
+   mixer->SetPrefetcher(std::make_unique<SequencePrefetcher>(
+      move(sequences), ExportPrefetchSeconds));
+   return mixer;
 }
 
 namespace
@@ -0,0 +1,557 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file BiquadCascade.cpp
+
+  Lanes are ordered by channel, then by section.  Each vector holds
+  consecutive lanes, so the input of each lane is the previous output of the
+  lane before, shifted in from the neighboring vector, unless the lane is the
+  first section of a channel; a mask selects the sample instead.
+
+  The vector implementations run only the steps where every lane is active.
+  In the first and last steps of each call, lanes at the head of the pipe
+  have no samples yet, or those at the tail have finished; then lanes are
+  computed one at a time, with the same arithmetic.
+
+**********************************************************************/
+#include "BiquadCascade.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Only 64 bit x86, where scalar arithmetic is sure not to use the wider
+// registers of the x87 unit
+#if defined(__x86_64__) || defined(_M_X64)
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#     include <intrin.h>
+#  endif
+#  define BIQUAD_CASCADE_SSE2
+#  if defined(_MSC_VER) || defined(__GNUC__)
+#     define BIQUAD_CASCADE_AVX
+#  endif
+#  if defined(__GNUC__)
+#     define TARGET_AVX __attribute__((target("avx")))
+#  else
+#     define TARGET_AVX
+#  endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#  define BIQUAD_CASCADE_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace {
+
+//! Lanes are padded to a multiple of the widest vector
+constexpr size_t LaneMultiple = 4;
+
+//! Steps computed between copies of samples into and out of the lanes
+constexpr size_t StepsPerRun = 256;
+
+//! Vectors of lanes that one run of a vector implementation keeps in
+//! registers
+constexpr size_t GroupsPerRun = 2;
+
+//! The arrays of a BiquadCascade, as rows of `count` lanes
+struct Lanes {
+   size_t count;
+   const double *b0, *b1, *b2, *na1, *na2;
+   const uint64_t *inputMask;
+   double *z1, *z2, *y;
+   //! Outputs of the lanes before the run of steps
+   const double *yBefore;
+};
+
+//! Rows of `count` lanes as laid out in a BiquadCascade
+Lanes MakeLanes(size_t count,
+   const double *coefficients, const uint64_t *inputMask, double *state)
+{
+   return { count,
+      coefficients, coefficients + count, coefficients + 2 * count,
+      coefficients + 3 * count, coefficients + 4 * count,
+      inputMask,
+      state, state + count, state + 2 * count, state + 3 * count };
+}
+
+// Multiply-add is fused on ARM64, where compilers may contract the scalar
+// code into it anyway, and not elsewhere, so that the compiler's choice makes
+// no difference
+inline double MulAdd(double a, double b, double c)
+{
+#if defined(BIQUAD_CASCADE_NEON)
+   return std::fma(a, b, c);
+#else
+   const double product = a * b;
+   return product + c;
+#endif
+}
+
+//! Take `x` into lane `l`, and return its output
+inline double StepLane(const Lanes &lanes, size_t l, double x)
+{
+   const double out = MulAdd(lanes.b0[l], x, lanes.z1[l]);
+   lanes.z1[l] =
+      MulAdd(lanes.na1[l], out, MulAdd(lanes.b1[l], x, lanes.z2[l]));
+   lanes.z2[l] = MulAdd(lanes.na2[l], out, lanes.b2[l] * x);
+   return lanes.y[l] = out;
+}
+
+//! Filter `len` samples in place through lane `l` alone, with the arithmetic
+//! of StepLane
+void RunSection(const Lanes &lanes, size_t l, double *samples, size_t len)
+{
+   const auto b0 = lanes.b0[l], b1 = lanes.b1[l], b2 = lanes.b2[l];
+   const auto na1 = lanes.na1[l], na2 = lanes.na2[l];
+   auto z1 = lanes.z1[l], z2 = lanes.z2[l], y = lanes.y[l];
+   for (size_t ii = 0; ii < len; ++ii) {
+      const auto x = samples[ii];
+      y = MulAdd(b0, x, z1);
+      z1 = MulAdd(na1, y, MulAdd(b1, x, z2));
+      z2 = MulAdd(na2, y, b2 * x);
+      samples[ii] = y;
+   }
+   lanes.z1[l] = z1, lanes.z2[l] = z2, lanes.y[l] = y;
+}
+
+void RunScalar(const Lanes &lanes,
+   const double *inputs, double *outputs, size_t nSteps)
+{
+   for (size_t n = 0; n < nSteps; ++n) {
+      const double *const in = inputs + n * lanes.count;
+      double *const out = outputs + n * lanes.count;
+      // Descending, so that each lane takes the output of the one before from
+      // the previous step
+      for (size_t l = lanes.count; l-- > 0;)
+         out[l] = StepLane(lanes, l,
+            lanes.inputMask[l] ? in[l] : lanes.y[l - 1]);
+   }
+}
+
+//! The output of the lane before `first` at each step is in `outputs`
+//! already, or in `yBefore` for the first step
+inline double Carry(const Lanes &lanes, size_t first, const double *outputs,
+   size_t n)
+{
+   if (first == 0)
+      // The first lane always takes input
+      return 0;
+   return n == 0
+      ? lanes.yBefore[first - 1]
+      : outputs[(n - 1) * lanes.count + first - 1];
+}
+
+//! Call `run(first, nGroups)` for runs of vectors of `width` lanes
+template<size_t width, typename Run>
+inline void ForEachRun(const Lanes &lanes, const Run &run)
+{
+   static_assert(LaneMultiple % width == 0);
+   constexpr auto runLanes = width * GroupsPerRun;
+   size_t first = 0;
+   for (; first + runLanes <= lanes.count; first += runLanes)
+      run(first, GroupsPerRun);
+   if (first < lanes.count)
+      run(first, (lanes.count - first) / width);
+}
+
+#if defined(BIQUAD_CASCADE_SSE2)
+struct SectionsSSE2 {
+   __m128d b0, b1, b2, na1, na2, mask, z1, z2, y;
+
+   void Load(const Lanes &lanes, size_t l)
+   {
+      b0 = _mm_loadu_pd(lanes.b0 + l);
+      b1 = _mm_loadu_pd(lanes.b1 + l);
+      b2 = _mm_loadu_pd(lanes.b2 + l);
+      na1 = _mm_loadu_pd(lanes.na1 + l);
+      na2 = _mm_loadu_pd(lanes.na2 + l);
+      mask = _mm_castsi128_pd(_mm_loadu_si128(
+         reinterpret_cast<const __m128i*>(lanes.inputMask + l)));
+      z1 = _mm_loadu_pd(lanes.z1 + l);
+      z2 = _mm_loadu_pd(lanes.z2 + l);
+      y = _mm_loadu_pd(lanes.y + l);
+   }
+
+   void Save(const Lanes &lanes, size_t l) const
+   {
+      _mm_storeu_pd(lanes.z1 + l, z1);
+      _mm_storeu_pd(lanes.z2 + l, z2);
+      _mm_storeu_pd(lanes.y + l, y);
+   }
+
+   //! Take input from `in`, or from the previous outputs, the last of
+   //! `before` and all but the last of `y`; return the previous outputs
+   __m128d Step(__m128d before, const double *in, double *out)
+   {
+      const auto shifted = _mm_shuffle_pd(before, y, 1);
+      const auto sample = _mm_loadu_pd(in);
+      const auto x = _mm_or_pd(
+         _mm_and_pd(mask, sample), _mm_andnot_pd(mask, shifted));
+      const auto result = y;
+      y = _mm_add_pd(_mm_mul_pd(b0, x), z1);
+      z1 = _mm_add_pd(_mm_mul_pd(na1, y),
+         _mm_add_pd(_mm_mul_pd(b1, x), z2));
+      z2 = _mm_add_pd(_mm_mul_pd(na2, y), _mm_mul_pd(b2, x));
+      _mm_storeu_pd(out, y);
+      return result;
+   }
+};
+
+template<size_t nGroups>
+void RunGroupsSSE2(const Lanes &lanes, size_t first,
+   const double *inputs, double *outputs, size_t nSteps)
+{
+   constexpr size_t width = 2;
+   SectionsSSE2 groups[nGroups];
+   for (size_t g = 0; g < nGroups; ++g)
+      groups[g].Load(lanes, first + g * width);
+   for (size_t n = 0; n < nSteps; ++n) {
+      const auto offset = n * lanes.count + first;
+      auto before = _mm_set1_pd(Carry(lanes, first, outputs, n));
+      for (size_t g = 0; g < nGroups; ++g)
+         before = groups[g].Step(before,
+            inputs + offset + g * width, outputs + offset + g * width);
+   }
+   for (size_t g = 0; g < nGroups; ++g)
+      groups[g].Save(lanes, first + g * width);
+}
+
+void RunSSE2(const Lanes &lanes,
+   const double *inputs, double *outputs, size_t nSteps)
+{
+   ForEachRun<2>(lanes, [&](size_t first, size_t nGroups){
+      (nGroups == GroupsPerRun ? RunGroupsSSE2<GroupsPerRun> : RunGroupsSSE2<1>)
+         (lanes, first, inputs, outputs, nSteps);
+   });
+}
+#endif
+
+#if defined(BIQUAD_CASCADE_AVX)
+struct SectionsAVX {
+   __m256d b0, b1, b2, na1, na2, mask, z1, z2, y;
+
+   TARGET_AVX void Load(const Lanes &lanes, size_t l)
+   {
+      b0 = _mm256_loadu_pd(lanes.b0 + l);
+      b1 = _mm256_loadu_pd(lanes.b1 + l);
+      b2 = _mm256_loadu_pd(lanes.b2 + l);
+      na1 = _mm256_loadu_pd(lanes.na1 + l);
+      na2 = _mm256_loadu_pd(lanes.na2 + l);
+      mask = _mm256_castsi256_pd(_mm256_loadu_si256(
+         reinterpret_cast<const __m256i*>(lanes.inputMask + l)));
+      z1 = _mm256_loadu_pd(lanes.z1 + l);
+      z2 = _mm256_loadu_pd(lanes.z2 + l);
+      y = _mm256_loadu_pd(lanes.y + l);
+   }
+
+   TARGET_AVX void Save(const Lanes &lanes, size_t l) const
+   {
+      _mm256_storeu_pd(lanes.z1 + l, z1);
+      _mm256_storeu_pd(lanes.z2 + l, z2);
+      _mm256_storeu_pd(lanes.y + l, y);
+   }
+
+   //! Take input from `in`, or from the previous outputs, the last of
+   //! `before` and all but the last of `y`; return the previous outputs
+   TARGET_AVX __m256d Step(__m256d before, const double *in, double *out)
+   {
+      // Lanes 2 and 3 of before, 0 and 1 of y; then shuffle in the others
+      const auto middle = _mm256_permute2f128_pd(before, y, 0x21);
+      const auto shifted = _mm256_shuffle_pd(middle, y, 5);
+      const auto sample = _mm256_loadu_pd(in);
+      // Bitwise selection; the compiler might turn a blend into branches
+      const auto x = _mm256_or_pd(
+         _mm256_and_pd(mask, sample), _mm256_andnot_pd(mask, shifted));
+      const auto result = y;
+      y = _mm256_add_pd(_mm256_mul_pd(b0, x), z1);
+      z1 = _mm256_add_pd(_mm256_mul_pd(na1, y),
+         _mm256_add_pd(_mm256_mul_pd(b1, x), z2));
+      z2 = _mm256_add_pd(_mm256_mul_pd(na2, y), _mm256_mul_pd(b2, x));
+      _mm256_storeu_pd(out, y);
+      return result;
+   }
+};
+
+// Lambdas would not inherit the target attribute, so the run is a function
+template<size_t nGroups>
+TARGET_AVX void RunGroupsAVX(const Lanes &lanes, size_t first,
+   const double *inputs, double *outputs, size_t nSteps)
+{
+   constexpr size_t width = 4;
+   SectionsAVX groups[nGroups];
+   for (size_t g = 0; g < nGroups; ++g)
+      groups[g].Load(lanes, first + g * width);
+   for (size_t n = 0; n < nSteps; ++n) {
+      const auto offset = n * lanes.count + first;
+      auto before = _mm256_set1_pd(Carry(lanes, first, outputs, n));
+      for (size_t g = 0; g < nGroups; ++g)
+         before = groups[g].Step(before,
+            inputs + offset + g * width, outputs + offset + g * width);
+   }
+   for (size_t g = 0; g < nGroups; ++g)
+      groups[g].Save(lanes, first + g * width);
+   _mm256_zeroupper();
+}
+
+void RunAVX(const Lanes &lanes,
+   const double *inputs, double *outputs, size_t nSteps)
+{
+   ForEachRun<4>(lanes, [&](size_t first, size_t nGroups){
+      (nGroups == GroupsPerRun ? RunGroupsAVX<GroupsPerRun> : RunGroupsAVX<1>)
+         (lanes, first, inputs, outputs, nSteps);
+   });
+}
+
+bool HaveAVX()
+{
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   const bool avx = (info[2] & (1 << 28)) != 0;
+   // The operating system must also save the upper halves of registers
+   return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+   return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+#if defined(BIQUAD_CASCADE_NEON)
+struct SectionsNEON {
+   float64x2_t b0, b1, b2, na1, na2, z1, z2, y;
+   uint64x2_t mask;
+
+   void Load(const Lanes &lanes, size_t l)
+   {
+      b0 = vld1q_f64(lanes.b0 + l);
+      b1 = vld1q_f64(lanes.b1 + l);
+      b2 = vld1q_f64(lanes.b2 + l);
+      na1 = vld1q_f64(lanes.na1 + l);
+      na2 = vld1q_f64(lanes.na2 + l);
+      mask = vld1q_u64(lanes.inputMask + l);
+      z1 = vld1q_f64(lanes.z1 + l);
+      z2 = vld1q_f64(lanes.z2 + l);
+      y = vld1q_f64(lanes.y + l);
+   }
+
+   void Save(const Lanes &lanes, size_t l) const
+   {
+      vst1q_f64(lanes.z1 + l, z1);
+      vst1q_f64(lanes.z2 + l, z2);
+      vst1q_f64(lanes.y + l, y);
+   }
+
+   //! Take input from `in`, or from the previous outputs, the last of
+   //! `before` and all but the last of `y`; return the previous outputs
+   float64x2_t Step(float64x2_t before, const double *in, double *out)
+   {
+      const auto shifted = vextq_f64(before, y, 1);
+      const auto x = vbslq_f64(mask, vld1q_f64(in), shifted);
+      const auto result = y;
+      y = vfmaq_f64(z1, b0, x);
+      z1 = vfmaq_f64(vfmaq_f64(z2, b1, x), na1, y);
+      z2 = vfmaq_f64(vmulq_f64(b2, x), na2, y);
+      vst1q_f64(out, y);
+      return result;
+   }
+};
+
+template<size_t nGroups>
+void RunGroupsNEON(const Lanes &lanes, size_t first,
+   const double *inputs, double *outputs, size_t nSteps)
+{
+   constexpr size_t width = 2;
+   SectionsNEON groups[nGroups];
+   for (size_t g = 0; g < nGroups; ++g)
+      groups[g].Load(lanes, first + g * width);
+   for (size_t n = 0; n < nSteps; ++n) {
+      const auto offset = n * lanes.count + first;
+      auto before = vdupq_n_f64(Carry(lanes, first, outputs, n));
+      for (size_t g = 0; g < nGroups; ++g)
+         before = groups[g].Step(before,
+            inputs + offset + g * width, outputs + offset + g * width);
+   }
+   for (size_t g = 0; g < nGroups; ++g)
+      groups[g].Save(lanes, first + g * width);
+}
+
+void RunNEON(const Lanes &lanes,
+   const double *inputs, double *outputs, size_t nSteps)
+{
+   ForEachRun<2>(lanes, [&](size_t first, size_t nGroups){
+      (nGroups == GroupsPerRun ? RunGroupsNEON<GroupsPerRun> : RunGroupsNEON<1>)
+         (lanes, first, inputs, outputs, nSteps);
+   });
+}
+#endif
+
+struct Kernel {
+   const char *name;
+   //! Null for filtering whole blocks one section at a time
+   void (*run)(const Lanes &lanes,
+      const double *inputs, double *outputs, size_t nSteps);
+};
+
+const std::vector<Kernel> &GetKernels()
+{
+   static const auto kernels = []{
+      std::vector<Kernel> result{
+         { "serial", nullptr }, { "scalar", RunScalar } };
+#if defined(BIQUAD_CASCADE_SSE2)
+      result.push_back({ "SSE2", RunSSE2 });
+#endif
+#if defined(BIQUAD_CASCADE_AVX)
+      if (HaveAVX())
+         result.push_back({ "AVX", RunAVX });
+#endif
+#if defined(BIQUAD_CASCADE_NEON)
+      result.push_back({ "NEON", RunNEON });
+#endif
+      return result;
+   }();
+   return kernels;
+}
+
+}
+
+BiquadCascade::BiquadCascade(
+   const std::vector<BiquadCoefficients> &sections, size_t nChannels)
+   : mChannels{ nChannels }
+   , mSections{ sections.size() }
+   , mLanes{ (nChannels * sections.size() + LaneMultiple - 1)
+      / LaneMultiple * LaneMultiple }
+   // Lanes in vectors gain nothing when most of them would be padding
+   , mImplementation{ 2 * nChannels * sections.size() < mLanes
+      ? 0 : GetKernels().size() - 1 }
+   , mCoefficients(5 * mLanes)
+   , mInputMask(mLanes)
+   , mState(4 * mLanes)
+   , mInputs(StepsPerRun * mLanes)
+   , mOutputs(StepsPerRun * mLanes)
+{
+   assert(nChannels > 0);
+   assert(!sections.empty());
+   // Unused lanes pass their input through, and feed no others
+   std::fill(mCoefficients.begin(), mCoefficients.begin() + mLanes, 1.0);
+   for (size_t c = 0; c < mChannels; ++c)
+      for (size_t s = 0; s < mSections; ++s) {
+         const auto l = c * mSections + s;
+         const auto &section = sections[s];
+         mCoefficients[l] = section.b0;
+         mCoefficients[mLanes + l] = section.b1;
+         mCoefficients[2 * mLanes + l] = section.b2;
+         mCoefficients[3 * mLanes + l] = -section.a1;
+         mCoefficients[4 * mLanes + l] = -section.a2;
+         if (s == 0)
+            mInputMask[l] = ~uint64_t{};
+      }
+}
+
+void BiquadCascade::Reset()
+{
+   std::fill(mState.begin(), mState.end(), 0.0);
+}
+
+const std::vector<const char *> &BiquadCascade::Implementations()
+{
+   static const auto names = []{
+      std::vector<const char *> result;
+      for (const auto &kernel : GetKernels())
+         result.push_back(kernel.name);
+      return result;
+   }();
+   return names;
+}
+
+void BiquadCascade::SetImplementation(size_t index)
+{
+   assert(index < GetKernels().size());
+   mImplementation = index;
+}
+
+void BiquadCascade::StepLanes(size_t step, size_t len,
+   const float *const *input, float *const *output)
+{
+   const auto lanes = MakeLanes(mLanes,
+      mCoefficients.data(), mInputMask.data(), mState.data());
+   for (size_t c = 0; c < mChannels; ++c) {
+      // Take the sample before writing output, which may overwrite it
+      const double sample = step < len ? input[c][step] : 0;
+      // Section s is active for samples step - s within [0, len)
+      for (size_t s = std::min(step + 1, mSections); s-- > 0;) {
+         if (step >= len + s)
+            break;
+         const auto l = c * mSections + s;
+         const auto out = StepLane(lanes, l, s == 0 ? sample : lanes.y[l - 1]);
+         if (s + 1 == mSections)
+            output[c][step - s] = out;
+      }
+   }
+}
+
+void BiquadCascade::Process(
+   const float *const *input, float *const *output, size_t len)
+{
+   if (len == 0)
+      return;
+
+   const auto &kernel = GetKernels()[mImplementation];
+   if (!kernel.run) {
+      ProcessSerial(input, output, len);
+      return;
+   }
+
+   // Step n gives sample n to the first sections, and the last sections give
+   // sample n + 1 - mSections; all sections are active from step
+   // mSections - 1 until step len
+   const auto nSteps = len + mSections - 1;
+   const auto firstFull = mSections - 1;
+   size_t n = 0;
+   for (; n < std::min(firstFull, nSteps); ++n)
+      StepLanes(n, len, input, output);
+
+   const auto lanes = MakeLanes(mLanes,
+      mCoefficients.data(), mInputMask.data(), mState.data());
+   const auto yBefore = &mState[3 * mLanes];
+   while (n < len) {
+      const auto count = std::min(StepsPerRun, len - n);
+      for (size_t c = 0; c < mChannels; ++c) {
+         const auto l = c * mSections;
+         const float *const in = input[c] + n;
+         for (size_t ii = 0; ii < count; ++ii)
+            mInputs[ii * mLanes + l] = in[ii];
+      }
+      std::copy(lanes.y, lanes.y + mLanes, yBefore);
+      kernel.run(lanes, mInputs.data(), mOutputs.data(), count);
+      for (size_t c = 0; c < mChannels; ++c) {
+         const auto l = c * mSections + mSections - 1;
+         float *const out = output[c] + n - firstFull;
+         for (size_t ii = 0; ii < count; ++ii)
+            out[ii] = mOutputs[ii * mLanes + l];
+      }
+      n += count;
+   }
+
+   for (; n < nSteps; ++n)
+      StepLanes(n, len, input, output);
+}
+
+void BiquadCascade::ProcessSerial(
+   const float *const *input, float *const *output, size_t len)
+{
+   const auto lanes = MakeLanes(mLanes,
+      mCoefficients.data(), mInputMask.data(), mState.data());
+   const auto buffer = mInputs.data();
+   for (size_t c = 0; c < mChannels; ++c)
+      for (size_t pos = 0; pos < len;) {
+         const auto count = std::min(mInputs.size(), len - pos);
+         std::copy(input[c] + pos, input[c] + pos + count, buffer);
+         for (size_t s = 0; s < mSections; ++s)
+            RunSection(lanes, c * mSections + s, buffer, count);
+         std::copy(buffer, buffer + count, output[c] + pos);
+         pos += count;
+      }
+}
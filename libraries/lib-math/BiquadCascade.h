@@ -0,0 +1,88 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file BiquadCascade.h
+  @brief Second order IIR sections in series, for several channels at once
+
+**********************************************************************/
+#ifndef __AUDACITY_BIQUAD_CASCADE__
+#define __AUDACITY_BIQUAD_CASCADE__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Coefficients of one second order section, normalized so that a0 is 1
+struct BiquadCoefficients {
+   double b0{ 1 }, b1{ 0 }, b2{ 0 };
+   double a1{ 0 }, a2{ 0 };
+};
+
+//! The same sections in series, applied to each of some channels
+/*!
+ Each section of each channel is a lane, computed in transposed direct form II
+ in double precision, and lanes are computed side by side in vector
+ registers.  To make sections of one channel independent, lanes are skewed in
+ time:  at each step, a section takes the output of the section before it
+ from the previous step, while the first section takes the next sample.
+
+ The implementation is chosen once, for the instruction set of the machine,
+ except that when most lanes would be padding, each section instead filters
+ whole blocks in turn.  Every implementation gives bit-identical results.
+ */
+class MATH_API BiquadCascade final
+{
+public:
+   //! @pre `nChannels > 0` and `!sections.empty()`
+   BiquadCascade(
+      const std::vector<BiquadCoefficients> &sections, size_t nChannels);
+
+   size_t Channels() const { return mChannels; }
+   size_t Sections() const { return mSections; }
+
+   //! Forget all past input
+   void Reset();
+
+   //! Filter `len` samples of each channel, without delay
+   /*! `input[c]` and `output[c]` may be the same.  Does not allocate. */
+   void Process(
+      const float *const *input, float *const *output, size_t len);
+
+   //! Names of implementations usable on this machine; the serial one comes
+   //! first, then the portable one, and the last is the default for cascades
+   //! that fill most of their lanes
+   static const std::vector<const char *> &Implementations();
+
+   //! Choose an implementation by its index in Implementations(), for testing
+   //! and benchmarking
+   void SetImplementation(size_t index);
+
+private:
+   //! Each section over whole blocks, one channel at a time
+   void ProcessSerial(
+      const float *const *input, float *const *output, size_t len);
+
+   //! One step of each active lane, one at a time
+   void StepLanes(size_t step, size_t len,
+      const float *const *input, float *const *output);
+
+   const size_t mChannels;
+   const size_t mSections;
+   //! Number of lanes, padded with unused lanes to a whole number of vectors
+   const size_t mLanes;
+   size_t mImplementation;
+
+   //! For each lane:  b0, b1, b2, then a1 and a2 negated, each in a row
+   std::vector<double> mCoefficients;
+   //! For each lane, all bits set if it takes input of its channel
+   std::vector<uint64_t> mInputMask;
+   //! For each lane:  the two state variables, the last output, and a copy
+   //! of the last output, each in a row
+   std::vector<double> mState;
+   //! Inputs and outputs of lanes for a run of steps, lane by lane
+   std::vector<double> mInputs, mOutputs;
+};
+
+#endif
@@ -0,0 +1,279 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file FrameSummary.cpp
+
+  The vector implementations summarize several frames at once, one frame in
+  each lane, so that each lane does the same operations in the same order as
+  the portable implementation does for one frame.  Blocks of samples are
+  transposed after loading, so that each vector holds the same sample of
+  each frame.
+
+**********************************************************************/
+#include "FrameSummary.h"
+
+#include <cmath>
+
+// Only 64 bit x86, where scalar arithmetic is sure not to use the wider
+// registers of the x87 unit
+#if defined(__x86_64__) || defined(_M_X64)
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#     include <intrin.h>
+#  endif
+#  define FRAME_SUMMARY_SSE2
+#  if defined(_MSC_VER) || defined(__GNUC__)
+#     define FRAME_SUMMARY_AVX
+#  endif
+#  if defined(__GNUC__)
+#     define TARGET_AVX __attribute__((target("avx")))
+#  else
+#     define TARGET_AVX
+#  endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#  define FRAME_SUMMARY_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace {
+
+// Sum of squares is accumulated with fused multiply-add on ARM64, where
+// compilers may contract the scalar loop into it anyway, and without it
+// elsewhere, so that the compiler's choice makes no difference
+inline float AddSquare(float sum, float x)
+{
+#if defined(FRAME_SUMMARY_NEON)
+   return std::fma(x, x, sum);
+#else
+   const float square = x * x;
+   return sum + square;
+#endif
+}
+
+void SummarizeScalar(const float *samples, size_t nFrames, float *summaries)
+{
+   for (size_t ii = 0; ii < nFrames; ++ii) {
+      const float *const frame = samples + ii * SummaryFrameLength;
+      float min = frame[0];
+      float max = frame[0];
+      float sumsq = min * min;
+      for (size_t jj = 1; jj < SummaryFrameLength; ++jj) {
+         const float f1 = frame[jj];
+         sumsq = AddSquare(sumsq, f1);
+         if (f1 < min)
+            min = f1;
+         else if (f1 > max)
+            max = f1;
+      }
+      summaries[3 * ii] = min;
+      summaries[3 * ii + 1] = max;
+      summaries[3 * ii + 2] = sumsq;
+   }
+}
+
+//! Store the lanes of the three vectors as consecutive summaries
+template<size_t width>
+void StoreLanes(const float (&min)[width], const float (&max)[width],
+   const float (&sumsq)[width], float *summaries)
+{
+   for (size_t ii = 0; ii < width; ++ii) {
+      summaries[3 * ii] = min[ii];
+      summaries[3 * ii + 1] = max[ii];
+      summaries[3 * ii + 2] = sumsq[ii];
+   }
+}
+
+#if defined(FRAME_SUMMARY_SSE2)
+void SummarizeSSE2(const float *samples, size_t nFrames, float *summaries)
+{
+   constexpr size_t width = 4;
+   const auto nGroups = nFrames / width;
+   for (size_t ii = 0; ii < nGroups; ++ii) {
+      const float *const frames = samples + ii * width * SummaryFrameLength;
+      __m128 min{}, max{}, sumsq{};
+      const auto accumulate = [&](__m128 f1) {
+         sumsq = _mm_add_ps(sumsq, _mm_mul_ps(f1, f1));
+         // Operand order matters when f1 is NaN:  keep the old value
+         min = _mm_min_ps(f1, min);
+         max = _mm_max_ps(f1, max);
+      };
+      for (size_t jj = 0; jj < SummaryFrameLength; jj += width) {
+         auto r0 = _mm_loadu_ps(frames + jj);
+         auto r1 = _mm_loadu_ps(frames + SummaryFrameLength + jj);
+         auto r2 = _mm_loadu_ps(frames + 2 * SummaryFrameLength + jj);
+         auto r3 = _mm_loadu_ps(frames + 3 * SummaryFrameLength + jj);
+         _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+         if (jj == 0) {
+            min = max = r0;
+            sumsq = _mm_mul_ps(r0, r0);
+         }
+         else
+            accumulate(r0);
+         accumulate(r1);
+         accumulate(r2);
+         accumulate(r3);
+      }
+      float mins[width], maxes[width], sums[width];
+      _mm_storeu_ps(mins, min);
+      _mm_storeu_ps(maxes, max);
+      _mm_storeu_ps(sums, sumsq);
+      StoreLanes(mins, maxes, sums, summaries + 3 * width * ii);
+   }
+   SummarizeScalar(samples + nGroups * width * SummaryFrameLength,
+      nFrames - nGroups * width, summaries + 3 * nGroups * width);
+}
+#endif
+
+#if defined(FRAME_SUMMARY_AVX)
+// Lambdas would not inherit the target attribute, so these are functions
+
+//! Load four samples at p, and the same four of the frame four frames later
+TARGET_AVX inline __m256 LoadHalvesAVX(const float *p)
+{
+   return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)),
+      _mm_loadu_ps(p + 4 * SummaryFrameLength), 1);
+}
+
+TARGET_AVX inline void AccumulateAVX(
+   __m256 f1, __m256 &min, __m256 &max, __m256 &sumsq)
+{
+   sumsq = _mm256_add_ps(sumsq, _mm256_mul_ps(f1, f1));
+   min = _mm256_min_ps(f1, min);
+   max = _mm256_max_ps(f1, max);
+}
+
+TARGET_AVX
+void SummarizeAVX(const float *samples, size_t nFrames, float *summaries)
+{
+   constexpr size_t width = 8;
+   const auto nGroups = nFrames / width;
+   for (size_t ii = 0; ii < nGroups; ++ii) {
+      const float *const frames = samples + ii * width * SummaryFrameLength;
+      __m256 min = _mm256_setzero_ps(), max = min, sumsq = min;
+      // Vector rk holds four samples of frame k in its lower half, and of
+      // frame k + 4 in its upper half; then the halves are transposed alike
+      for (size_t jj = 0; jj < SummaryFrameLength; jj += 4) {
+         const auto r0 = LoadHalvesAVX(frames + jj);
+         const auto r1 = LoadHalvesAVX(frames + SummaryFrameLength + jj);
+         const auto r2 = LoadHalvesAVX(frames + 2 * SummaryFrameLength + jj);
+         const auto r3 = LoadHalvesAVX(frames + 3 * SummaryFrameLength + jj);
+         const auto t0 = _mm256_unpacklo_ps(r0, r1);
+         const auto t1 = _mm256_unpacklo_ps(r2, r3);
+         const auto t2 = _mm256_unpackhi_ps(r0, r1);
+         const auto t3 = _mm256_unpackhi_ps(r2, r3);
+         const auto c0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+         const auto c1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+         const auto c2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+         const auto c3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+         if (jj == 0) {
+            min = max = c0;
+            sumsq = _mm256_mul_ps(c0, c0);
+         }
+         else
+            AccumulateAVX(c0, min, max, sumsq);
+         AccumulateAVX(c1, min, max, sumsq);
+         AccumulateAVX(c2, min, max, sumsq);
+         AccumulateAVX(c3, min, max, sumsq);
+      }
+      float mins[width], maxes[width], sums[width];
+      _mm256_storeu_ps(mins, min);
+      _mm256_storeu_ps(maxes, max);
+      _mm256_storeu_ps(sums, sumsq);
+      StoreLanes(mins, maxes, sums, summaries + 3 * width * ii);
+   }
+   _mm256_zeroupper();
+   SummarizeScalar(samples + nGroups * width * SummaryFrameLength,
+      nFrames - nGroups * width, summaries + 3 * nGroups * width);
+}
+
+bool HaveAVX()
+{
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   const bool avx = (info[2] & (1 << 28)) != 0;
+   // The operating system must also save the upper halves of registers
+   return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+   return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+#if defined(FRAME_SUMMARY_NEON)
+void SummarizeNEON(const float *samples, size_t nFrames, float *summaries)
+{
+   constexpr size_t width = 4;
+   const auto nGroups = nFrames / width;
+   for (size_t ii = 0; ii < nGroups; ++ii) {
+      const float *const frames = samples + ii * width * SummaryFrameLength;
+      float32x4_t min{}, max{}, sumsq{};
+      const auto accumulate = [&](float32x4_t f1) {
+         sumsq = vfmaq_f32(sumsq, f1, f1);
+         // vminq_f32 and vmaxq_f32 propagate NaN, unlike the scalar loop
+         min = vbslq_f32(vcltq_f32(f1, min), f1, min);
+         max = vbslq_f32(vcgtq_f32(f1, max), f1, max);
+      };
+      for (size_t jj = 0; jj < SummaryFrameLength; jj += width) {
+         const auto t0 = vtrnq_f32(vld1q_f32(frames + jj),
+            vld1q_f32(frames + SummaryFrameLength + jj));
+         const auto t1 = vtrnq_f32(vld1q_f32(frames + 2 * SummaryFrameLength + jj),
+            vld1q_f32(frames + 3 * SummaryFrameLength + jj));
+         const auto r0 =
+            vcombine_f32(vget_low_f32(t0.val[0]), vget_low_f32(t1.val[0]));
+         const auto r1 =
+            vcombine_f32(vget_low_f32(t0.val[1]), vget_low_f32(t1.val[1]));
+         const auto r2 =
+            vcombine_f32(vget_high_f32(t0.val[0]), vget_high_f32(t1.val[0]));
+         const auto r3 =
+            vcombine_f32(vget_high_f32(t0.val[1]), vget_high_f32(t1.val[1]));
+         if (jj == 0) {
+            min = max = r0;
+            sumsq = vmulq_f32(r0, r0);
+         }
+         else
+            accumulate(r0);
+         accumulate(r1);
+         accumulate(r2);
+         accumulate(r3);
+      }
+      float mins[width], maxes[width], sums[width];
+      vst1q_f32(mins, min);
+      vst1q_f32(maxes, max);
+      vst1q_f32(sums, sumsq);
+      StoreLanes(mins, maxes, sums, summaries + 3 * width * ii);
+   }
+   SummarizeScalar(samples + nGroups * width * SummaryFrameLength,
+      nFrames - nGroups * width, summaries + 3 * nGroups * width);
+}
+#endif
+
+}
+
+const std::vector<FrameSummarizer> &GetFrameSummarizers()
+{
+   static const auto summarizers = []{
+      std::vector<FrameSummarizer> result{ { "scalar", SummarizeScalar } };
+#if defined(FRAME_SUMMARY_SSE2)
+      result.push_back({ "SSE2", SummarizeSSE2 });
+#endif
+#if defined(FRAME_SUMMARY_AVX)
+      if (HaveAVX())
+         result.push_back({ "AVX", SummarizeAVX });
+#endif
+#if defined(FRAME_SUMMARY_NEON)
+      result.push_back({ "NEON", SummarizeNEON });
+#endif
+      return result;
+   }();
+   return summarizers;
+}
+
+void SummarizeFrames(const float *samples, size_t nFrames, float *summaries)
+{
+   static const auto summarize = GetFrameSummarizers().back().summarize;
+   summarize(samples, nFrames, summaries);
+}
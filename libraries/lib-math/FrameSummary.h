@@ -0,0 +1,42 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file FrameSummary.h
+  @brief Minimum, maximum and sum of squares of frames of samples
+
+**********************************************************************/
+#ifndef __AUDACITY_FRAME_SUMMARY__
+#define __AUDACITY_FRAME_SUMMARY__
+
+#include <cstddef>
+#include <vector>
+
+//! Number of samples in each frame summarized by SummarizeFrames
+constexpr size_t SummaryFrameLength = 256;
+
+//! Summarize `nFrames` consecutive frames of SummaryFrameLength samples
+/*!
+ For frame `i`, store at `summaries[3 * i]` the minimum, the maximum, and the
+ sum of squares, each accumulated in order of the samples in single
+ precision, exactly as a simple loop would.  Samples that are NaN are skipped
+ by the minimum and maximum, unless the first of the frame is NaN.
+
+ The implementation is chosen once, for the instruction set of the machine;
+ every implementation gives bit-identical results.
+ */
+MATH_API void SummarizeFrames(
+   const float *samples, size_t nFrames, float *summaries);
+
+//! One implementation of SummarizeFrames, for testing and benchmarking
+struct FrameSummarizer {
+   const char *name;
+   void (*summarize)(const float *samples, size_t nFrames, float *summaries);
+};
+
+//! Implementations usable on this machine; the portable one comes first, and
+//! SummarizeFrames uses the last
+MATH_API const std::vector<FrameSummarizer> &GetFrameSummarizers();
+
+#endif
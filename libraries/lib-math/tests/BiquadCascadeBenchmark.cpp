@@ -0,0 +1,110 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BiquadCascadeBenchmark.cpp
+
+**********************************************************************/
+#include "BiquadCascade.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace
+{
+// Ten seconds of audio at 44.1 kHz, in blocks of a typical size
+constexpr size_t nSamples = 441000;
+constexpr size_t blockSize = 4096;
+
+//! One section at a time, one sample at a time, in direct form I, as the
+//! effects did
+double SerialSeconds(
+   const std::vector<BiquadCoefficients>& sections,
+   std::vector<std::vector<float>>& channels)
+{
+   struct State
+   {
+      double x1 {}, x2 {}, y1 {}, y2 {};
+   };
+   std::vector<State> states(sections.size() * channels.size());
+
+   using namespace std::chrono;
+   const auto start = steady_clock::now();
+   for (size_t pos = 0; pos < nSamples; pos += blockSize)
+      for (size_t c = 0; c < channels.size(); ++c)
+         for (size_t s = 0; s < sections.size(); ++s)
+         {
+            const auto& section = sections[s];
+            auto& state = states[c * sections.size() + s];
+            for (size_t ii = pos; ii < pos + blockSize && ii < nSamples; ++ii)
+            {
+               const double x = channels[c][ii];
+               const auto y = section.b0 * x + section.b1 * state.x1 +
+                              section.b2 * state.x2 - section.a1 * state.y1 -
+                              section.a2 * state.y2;
+               state.x2 = state.x1, state.x1 = x;
+               state.y2 = state.y1, state.y1 = y;
+               channels[c][ii] = y;
+            }
+         }
+   return duration<double>(steady_clock::now() - start).count();
+}
+
+double CascadeSeconds(
+   BiquadCascade& cascade, std::vector<std::vector<float>>& channels)
+{
+   std::vector<float*> pointers;
+   for (auto& channel : channels)
+      pointers.push_back(channel.data());
+
+   using namespace std::chrono;
+   const auto start = steady_clock::now();
+   for (size_t pos = 0; pos < nSamples; pos += blockSize)
+   {
+      const auto len = std::min(blockSize, nSamples - pos);
+      cascade.Process(pointers.data(), pointers.data(), len);
+      for (auto& pointer : pointers)
+         pointer += len;
+   }
+   return duration<double>(steady_clock::now() - start).count();
+}
+} // namespace
+
+TEST_CASE("BiquadCascade benchmark", "[.][benchmark]")
+{
+   std::mt19937 engine { 1 };
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+   std::vector<float> samples(nSamples);
+   for (auto& sample : samples)
+      sample = distribution(engine);
+
+   // A stable section, repeated, as for a Butterworth filter of even order
+   const BiquadCoefficients section { 0.02, 0.04, 0.02, -1.56, 0.64 };
+
+   // Mono filters of the orders of Classic Filters, and K-weighting of
+   // stereo and of 5.1
+   for (const auto& [nSections, nChannels] :
+        std::vector<std::pair<size_t, size_t>> {
+           { 1, 1 }, { 2, 1 }, { 5, 1 }, { 2, 2 }, { 2, 6 } })
+   {
+      const std::vector<BiquadCoefficients> sections(nSections, section);
+      std::vector<std::vector<float>> channels(nChannels, samples);
+      std::cout << nSections << " sections, " << nChannels << " channels\n";
+      std::cout << "   direct form I: "
+                << SerialSeconds(sections, channels) * 1e3 << " ms\n";
+
+      const auto& implementations = BiquadCascade::Implementations();
+      for (size_t ii = 0; ii < implementations.size(); ++ii)
+      {
+         BiquadCascade cascade { sections, nChannels };
+         cascade.SetImplementation(ii);
+         const auto seconds = CascadeSeconds(cascade, channels);
+         std::cout << "   " << implementations[ii] << ": " << seconds * 1e3
+                   << " ms\n";
+         REQUIRE(seconds > 0);
+      }
+   }
+}
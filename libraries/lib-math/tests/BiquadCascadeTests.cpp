@@ -0,0 +1,135 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BiquadCascadeTests.cpp
+
+**********************************************************************/
+#include "BiquadCascade.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+std::vector<float> RandomSamples(size_t size, unsigned seed)
+{
+   std::mt19937 engine { seed };
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+   std::vector<float> result(size);
+   for (auto& sample : result)
+      sample = distribution(engine);
+   return result;
+}
+
+//! Stable sections, with poles and zeros at various radii and angles
+std::vector<BiquadCoefficients> Sections(size_t count)
+{
+   std::vector<BiquadCoefficients> result;
+   for (size_t ii = 0; ii < count; ++ii)
+   {
+      const auto radius = 0.5 + 0.45 * ii / count;
+      const auto angle = 0.3 + 2.5 * ii / count;
+      result.push_back({ 0.3, -0.2 * ii, 0.1 + 0.05 * ii,
+                         -2 * radius * std::cos(angle), radius * radius });
+   }
+   return result;
+}
+
+//! The sections in series, one sample at a time, in direct form I
+std::vector<float> Reference(
+   const std::vector<BiquadCoefficients>& sections,
+   const std::vector<float>& input)
+{
+   std::vector<double> signal(input.begin(), input.end());
+   for (const auto& section : sections)
+   {
+      double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+      for (auto& sample : signal)
+      {
+         const auto y = section.b0 * sample + section.b1 * x1 +
+                        section.b2 * x2 - section.a1 * y1 - section.a2 * y2;
+         x2 = x1, x1 = sample;
+         y2 = y1, y1 = y;
+         sample = y;
+      }
+   }
+   return { signal.begin(), signal.end() };
+}
+
+//! Process the channels in place, in pieces of irregular lengths
+void Process(BiquadCascade& cascade, std::vector<std::vector<float>>& channels)
+{
+   std::vector<float*> pointers;
+   for (auto& channel : channels)
+      pointers.push_back(channel.data());
+   const auto size = channels[0].size();
+   for (size_t pos = 0, len = 0; pos < size;
+        pos += len, len = (len * 7 + 3) % 700)
+   {
+      len = std::min(len, size - pos);
+      cascade.Process(pointers.data(), pointers.data(), len);
+      for (auto& pointer : pointers)
+         pointer += len;
+   }
+}
+} // namespace
+
+TEST_CASE("BiquadCascade")
+{
+   constexpr size_t nSamples = 3000;
+   const auto& implementations = BiquadCascade::Implementations();
+   REQUIRE(!implementations.empty());
+   REQUIRE(std::strcmp(implementations[0], "serial") == 0);
+
+   for (const size_t nSections : { 1, 2, 3, 4, 5, 9 })
+      for (const size_t nChannels : { 1, 2, 3, 6 })
+      {
+         const auto sections = Sections(nSections);
+         std::vector<std::vector<float>> inputs;
+         for (size_t c = 0; c < nChannels; ++c)
+            inputs.push_back(RandomSamples(nSamples, c + 1));
+
+         std::vector<std::vector<float>> serial;
+         for (size_t ii = 0; ii < implementations.size(); ++ii)
+         {
+            INFO(implementations[ii] << ", " << nSections << " sections, "
+                                     << nChannels << " channels");
+            BiquadCascade cascade { sections, nChannels };
+            REQUIRE(cascade.Channels() == nChannels);
+            REQUIRE(cascade.Sections() == nSections);
+            cascade.SetImplementation(ii);
+            auto outputs = inputs;
+            Process(cascade, outputs);
+
+            if (ii == 0)
+            {
+               // Close to filtering each section in turn
+               for (size_t c = 0; c < nChannels; ++c)
+               {
+                  const auto expected = Reference(sections, inputs[c]);
+                  for (size_t jj = 0; jj < nSamples; ++jj)
+                     REQUIRE(
+                        outputs[c][jj] ==
+                        Approx(expected[jj]).margin(1e-6).epsilon(1e-5));
+               }
+               serial = outputs;
+            }
+            else
+               // The same as the serial implementation, exactly
+               for (size_t c = 0; c < nChannels; ++c)
+                  REQUIRE(std::memcmp(
+                             outputs[c].data(), serial[c].data(),
+                             nSamples * sizeof(float)) == 0);
+
+            // Reset forgets past input
+            cascade.Reset();
+            auto again = inputs;
+            Process(cascade, again);
+            REQUIRE(again == outputs);
+         }
+      }
+}
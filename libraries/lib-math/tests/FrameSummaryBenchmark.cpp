@@ -0,0 +1,47 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FrameSummaryBenchmark.cpp
+
+**********************************************************************/
+#include "FrameSummary.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+TEST_CASE("SummarizeFrames benchmark", "[.][benchmark]")
+{
+   // As many frames as in a minute of recording at 44.1 kHz, in blocks of
+   // the default size
+   constexpr size_t blockSize = 262144;
+   constexpr size_t nFramesPerBlock = blockSize / SummaryFrameLength;
+   constexpr size_t nBlocks = 44100 * 60 / blockSize + 1;
+   std::vector<float> samples(blockSize);
+   std::mt19937 engine { 1 };
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+   for (auto& sample : samples)
+      sample = distribution(engine);
+   std::vector<float> summaries(3 * nFramesPerBlock);
+
+   constexpr int nTrials = 20;
+   for (const auto& summarizer : GetFrameSummarizers())
+   {
+      using namespace std::chrono;
+      const auto start = steady_clock::now();
+      for (int trial = 0; trial < nTrials; ++trial)
+         for (size_t block = 0; block < nBlocks; ++block)
+            summarizer.summarize(
+               samples.data(), nFramesPerBlock, summaries.data());
+      const auto elapsed =
+         duration<double>(steady_clock::now() - start).count() / nTrials;
+      const auto megasamples = double(nBlocks * blockSize) / 1e6;
+      std::cout << summarizer.name << ": " << elapsed * 1000 << " ms per "
+                << "minute of audio, " << megasamples / elapsed
+                << " megasamples per second\n";
+      REQUIRE(elapsed > 0);
+   }
+}
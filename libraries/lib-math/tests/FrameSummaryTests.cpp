@@ -0,0 +1,101 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FrameSummaryTests.cpp
+
+**********************************************************************/
+#include "FrameSummary.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace
+{
+// Exact minimum and maximum, and sum of squares in double precision
+void Summarize(const float* frame, float* summary)
+{
+   float min = frame[0];
+   float max = frame[0];
+   double sumsq = 0;
+   for (size_t jj = 0; jj < SummaryFrameLength; ++jj)
+   {
+      const float f1 = frame[jj];
+      sumsq += double(f1) * f1;
+      if (f1 < min)
+         min = f1;
+      else if (f1 > max)
+         max = f1;
+   }
+   summary[0] = min;
+   summary[1] = max;
+   summary[2] = sumsq;
+}
+} // namespace
+
+TEST_CASE("SummarizeFrames")
+{
+   // An odd number of frames leaves a remainder for every vector width
+   constexpr size_t nFrames = 45;
+   std::vector<float> samples(nFrames * SummaryFrameLength);
+   std::mt19937 engine { 42 };
+   std::uniform_real_distribution<float> distribution { -1.0f, 1.0f };
+   for (auto& sample : samples)
+      sample = distribution(engine);
+
+   // Special values
+   constexpr auto nan = std::numeric_limits<float>::quiet_NaN();
+   constexpr auto infinity = std::numeric_limits<float>::infinity();
+   samples[3] = nan;
+   samples[SummaryFrameLength] = nan;
+   samples[2 * SummaryFrameLength + 7] = infinity;
+   samples[3 * SummaryFrameLength + 9] = -infinity;
+   samples[4 * SummaryFrameLength + 255] = -0.0f;
+   std::fill_n(samples.begin() + 5 * SummaryFrameLength, SummaryFrameLength, 0.0f);
+   samples[6 * SummaryFrameLength] = 1e-40f; // denormal
+
+   // The portable implementation is close to a more precise calculation
+   const auto& summarizers = GetFrameSummarizers();
+   std::vector<float> expected(3 * nFrames);
+   summarizers.front().summarize(samples.data(), nFrames, expected.data());
+   for (size_t ii = 0; ii < nFrames; ++ii)
+   {
+      float precise[3];
+      Summarize(&samples[ii * SummaryFrameLength], precise);
+      if (std::isnan(precise[2]) || std::isinf(precise[2]))
+         continue;
+      REQUIRE(expected[3 * ii] == precise[0]);
+      REQUIRE(expected[3 * ii + 1] == precise[1]);
+      REQUIRE(expected[3 * ii + 2] == Approx(precise[2]).epsilon(1e-5));
+   }
+
+   // The others agree with it exactly
+   for (const auto& summarizer : summarizers)
+   {
+      SECTION(summarizer.name)
+      {
+         std::vector<float> summaries(3 * nFrames);
+         summarizer.summarize(samples.data(), nFrames, summaries.data());
+         // Bitwise comparison, which also compares NaN
+         REQUIRE(
+            std::memcmp(
+               summaries.data(), expected.data(),
+               summaries.size() * sizeof(float)) == 0);
+      }
+   }
+
+   SECTION("NaN is skipped unless first")
+   {
+      std::vector<float> summaries(3 * nFrames);
+      SummarizeFrames(samples.data(), nFrames, summaries.data());
+      REQUIRE(!std::isnan(summaries[0]));
+      REQUIRE(!std::isnan(summaries[1]));
+      REQUIRE(std::isnan(summaries[3]));
+      REQUIRE(summaries[7] == infinity);
+      REQUIRE(summaries[9] == -infinity);
+   }
+}
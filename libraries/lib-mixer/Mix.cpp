@@ -21,7 +21,9 @@
 #include "EffectStage.h"
 #include "Dither.h"
 #include "Resample.h"
+#include "SequencePrefetcher.h"
 #include "WideSampleSequence.h"
+#include "concurrency/ThreadPool.h"
 #include "float_cast.h"
 #include <numeric>
 
@@ -76,7 +78,7 @@ Mixer::Mixer(Inputs inputs,
    const size_t outBufferSize, const bool outInterleaved,
    double outRate, sampleFormat outFormat,
    const bool highQuality, MixerSpec *const mixerSpec,
-   ApplyGain applyGain
+   ApplyGain applyGain, const Threading &threading
 )  : mNumChannels{ numOutChannels }
    , mInputs{ move(inputs) }
    , mBufferSize{ FindBufferSize(mInputs, outBufferSize) }
@@ -97,6 +99,10 @@ Mixer::Mixer(Inputs inputs,
    // plug-in is yet larger
    , mFloatBuffers{ 3, mBufferSize, 1, 1 }
 
+   // Binary search in an Envelope caches a guess, so a shared time warp
+   // cannot be evaluated concurrently
+   , mMaxThreads{ warpOptions.envelope ? 1 : threading.maxThreads }
+
    // non-interleaved
    , mTemp{ initVector<float>(mNumChannels, mBufferSize) }
    , mBuffer{ initVector<SampleBuffer>(mInterleaved ? 1 : mNumChannels,
@@ -179,6 +185,16 @@ Mixer::Mixer(Inputs inputs,
       mDecoratedSources.emplace_back(Source{ source, *pDownstream });
    }
 
+   mResults.resize(mDecoratedSources.size());
+   if (mMaxThreads != 1 && mDecoratedSources.size() > 1 &&
+      audacity::concurrency::ThreadPool::Get().Size() > 0)
+   {
+      mInputBuffers.reserve(mDecoratedSources.size());
+      for (size_t ii = 0; ii < mDecoratedSources.size(); ++ii)
+         // Same shape as mFloatBuffers
+         mInputBuffers.emplace_back(3, mBufferSize, 1, 1);
+   }
+
    // Decide once at construction time
    std::tie(mNeedsDither, mEffectiveFormat) = NeedsDither(needsDither, outRate);
 }
@@ -313,8 +329,26 @@ size_t Mixer::Process(const size_t maxToProcess)
    // TODO: more-than-two-channels
    auto maxChannels = std::max(2u, mFloatBuffers.Channels());
 
-   for (auto &[ upstream, downstream ] : mDecoratedSources) {
-      auto oResult = downstream.Acquire(mFloatBuffers, maxToProcess);
+   const auto parallel = !mInputBuffers.empty();
+   const auto getBuffers = [&](size_t iSource) -> AudioGraph::Buffers & {
+      return parallel ? mInputBuffers[iSource] : mFloatBuffers;
+   };
+   const auto acquire = [&](size_t iSource){
+      mResults[iSource] = mDecoratedSources[iSource].downstream
+         .Acquire(getBuffers(iSource), maxToProcess);
+   };
+   // Inputs share nothing mutable until the summation into mTemp, which is
+   // done below in the order of inputs, whether acquired here or not
+   if (parallel)
+      audacity::concurrency::ThreadPool::Get()
+         .ParallelFor(mDecoratedSources.size(), acquire, mMaxThreads);
+
+   for (size_t iSource = 0; iSource < mDecoratedSources.size(); ++iSource) {
+      auto &[ upstream, downstream ] = mDecoratedSources[iSource];
+      auto &buffers = getBuffers(iSource);
+      if (!parallel)
+         acquire(iSource);
+      const auto &oResult = mResults[iSource];
       // One of MixVariableRates or MixSameRate assigns into mTemp[*][*] which
       // are the sources for the CopySamples calls, and they copy into
       // mBuffer[*][*]
@@ -327,7 +361,7 @@ size_t Mixer::Process(const size_t maxToProcess)
 
       const auto limit = std::min<size_t>(upstream.Channels(), maxChannels);
       for (size_t j = 0; j < limit; ++j) {
-         const auto pFloat = (const float *)mFloatBuffers.GetReadPosition(j);
+         const auto pFloat = (const float *)buffers.GetReadPosition(j);
          auto &sequence = upstream.GetSequence();
          if (mApplyGain != ApplyGain::Discard) {
             for (size_t c = 0; c < mNumChannels; ++c) {
@@ -346,15 +380,21 @@ size_t Mixer::Process(const size_t maxToProcess)
       }
 
       downstream.Release();
-      mFloatBuffers.Advance(result);
-      mFloatBuffers.Rotate();
+      buffers.Advance(result);
+      buffers.Rotate();
    }
 
+   for (auto &source : mSources)
+      if (const auto newT = source.TakeTime())
+         mTime = backwards ? std::min(mTime, *newT) : std::max(mTime, *newT);
    if (backwards)
       mTime = std::clamp(mTime, mT1, oldTime);
    else
       mTime = std::clamp(mTime, oldTime, mT1);
 
+   if (mpPrefetcher)
+      mpPrefetcher->Advance(mTime, mT1);
+
    const auto dstStride = (mInterleaved ? mNumChannels : 1);
    auto ditherType = mNeedsDither
       ? (mHighQuality ? gHighQualityDither : gLowQualityDither)
@@ -390,6 +430,14 @@ sampleFormat Mixer::EffectiveFormat() const
    return mEffectiveFormat;
 }
 
+void Mixer::SetPrefetcher(std::unique_ptr<SequencePrefetcher> pPrefetcher)
+{
+   mpPrefetcher = move(pPrefetcher);
+   if (mpPrefetcher)
+      // Begin reading ahead before the first call to Process()
+      mpPrefetcher->Advance(mTimesAndSpeed->mTime, mTimesAndSpeed->mT1);
+}
+
 double Mixer::MixGetCurrentTime()
 {
    return mTimesAndSpeed->mTime;
@@ -15,12 +15,14 @@
 #include "AudioGraphBuffers.h"
 #include "MixerOptions.h"
 #include "SampleFormat.h"
+#include <optional>
 
 class sampleCount;
 class BoundedEnvelope;
 class EffectStage;
 namespace AudioGraph{ class Source; }
 class MixerSource;
+class SequencePrefetcher;
 class TrackList;
 class WideSampleSequence;
 
@@ -31,6 +33,7 @@ class MIXER_API Mixer {
    using ResampleParameters = MixerOptions::ResampleParameters;
    using TimesAndSpeed = MixerOptions::TimesAndSpeed;
    using Stages = std::vector<MixerOptions::StageSpecification>;
+   using Threading = MixerOptions::Threading;
 
    struct Input {
       Input(
@@ -60,6 +63,8 @@ class MIXER_API Mixer {
     @pre any left channels in inputs are immediately followed by their
        partners
     @post `BufferSize() <= outBufferSize` (equality when no inputs have stages)
+    @param threading allows concurrent rendering of inputs; it is ignored when
+       there is a time warp envelope, which all inputs would share
     */
    Mixer(Inputs inputs, bool mayThrow,
          const WarpOptions &warpOptions,
@@ -69,7 +74,8 @@ class MIXER_API Mixer {
          bool highQuality = true,
          //! Null or else must have a lifetime enclosing this object's
          MixerSpec *mixerSpec = nullptr,
-         ApplyGain applyGain = ApplyGain::MapChannels);
+         ApplyGain applyGain = ApplyGain::MapChannels,
+         const Threading &threading = {});
 
    Mixer(const Mixer&) = delete;
    Mixer &operator=(const Mixer&) = delete;
@@ -118,6 +124,10 @@ class MIXER_API Mixer {
    //! Deduce the effective width of the output, which may be narrower than the stored format
    sampleFormat EffectiveFormat() const;
 
+   //! Let the prefetcher read ahead of each call to Process()
+   /*! @pre the prefetcher's sequences are those of the inputs, or outlive it */
+   void SetPrefetcher(std::unique_ptr<SequencePrefetcher> pPrefetcher);
+
  private:
 
    void Clear();
@@ -154,6 +164,17 @@ class MIXER_API Mixer {
    // Resample into these buffers, or produce directly when not resampling
    AudioGraph::Buffers mFloatBuffers;
 
+   // Given to ThreadPool::ParallelFor; 1 when rendering serially
+   const size_t     mMaxThreads;
+
+   // When rendering concurrently, one like mFloatBuffers for each of
+   // mDecoratedSources; else empty
+   std::vector<AudioGraph::Buffers> mInputBuffers;
+
+   // Results of Acquire() for each of mDecoratedSources, reused to avoid
+   // allocation in Process()
+   std::vector<std::optional<size_t>> mResults;
+
    // Each channel's data is transformed, including application of
    // gains and pans, and then (maybe many-to-one) mixer specifications
    // determine where in mTemp it is accumulated
@@ -169,5 +190,8 @@ class MIXER_API Mixer {
 
    struct Source { MixerSource &upstream; AudioGraph::Source &downstream; };
    std::vector<Source> mDecoratedSources;
+
+   // Declared last, to be destroyed first
+   std::unique_ptr<SequencePrefetcher> mpPrefetcher;
 };
 #endif
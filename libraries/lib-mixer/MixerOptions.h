@@ -101,6 +101,19 @@ struct TimesAndSpeed final {
    // consistency with AudioIO - mT represented warped time there)
 };
 
+//! How many threads may render the inputs of a Mixer
+/*!
+ Each input, with its resampling and effect stages, is independent of the
+ others until they are summed.  With more than one thread, inputs are
+ rendered concurrently into separate buffers, but still summed in the order
+ of inputs, so that the output is the same as with one thread.
+ */
+struct Threading final {
+   //! 1 renders all inputs on the thread calling Process(); 0 allows as many
+   //! as the shared thread pool has, plus the calling thread
+   size_t maxThreads{ 1 };
+};
+
 struct StageSpecification final {
    using Factory = std::function<std::shared_ptr<EffectInstance>()>;
 
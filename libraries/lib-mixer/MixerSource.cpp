@@ -342,8 +342,6 @@ std::optional<size_t> MixerSource::Acquire(Buffers &data, size_t bound)
    assert(bound <= data.BlockSize());
    assert(data.BlockSize() <= data.Remaining());
 
-   auto &[mT0, mT1, _, mTime] = *mTimesAndSpeed;
-   const bool backwards = (mT1 < mT0);
    // TODO: more-than-two-channels
    const auto maxChannels = mMaxChannels = data.Channels();
    const auto limit = std::min<size_t>(mnChannels, maxChannels);
@@ -357,11 +355,9 @@ std::optional<size_t> MixerSource::Acquire(Buffers &data, size_t bound)
       ? MixVariableRates(limit, bound, pFloats)
       : MixSameRate(limit, bound, pFloats);
    maxTrack = std::max(maxTrack, result);
-   auto newT = mSamplePos.as_double() / rate;
-   if (backwards)
-      mTime = std::min(mTime, newT);
-   else
-      mTime = std::max(mTime, newT);
+   // Positions only move one way between repositionings, so the last is the
+   // furthest
+   mNewTime = mSamplePos.as_double() / rate;
    for (size_t j = 0; j < limit; ++j) {
       mixed[j] = result;
    }
@@ -410,6 +406,7 @@ void MixerSource::Reposition(double time, bool skipping)
    mSamplePos = GetSequence().TimeToLongSamples(time);
    mQueueStart = 0;
    mQueueLen = 0;
+   mNewTime.reset();
 
    // Bug 2025:  libsoxr 0.1.3, first used in Audacity 2.3.0, crashes with
    // constant rate resampling if you try to reuse the resampler after it has
@@ -18,6 +18,8 @@
 #include "MixerOptions.h"
 #include "SampleCount.h"
 #include <memory>
+#include <optional>
+#include <utility>
 
 class Resample;
 class SampleTrack;
@@ -62,6 +64,14 @@ public:
    bool Terminates() const override;
    void Reposition(double time, bool skipping);
 
+   //! Time reached by calls to Acquire() since the previous call of this
+   //! function or of Reposition(), if any
+   /*!
+    The owner of the TimesAndSpeed updates its readout of time from this,
+    because sources may be acquired concurrently
+    */
+   std::optional<double> TakeTime() { return std::exchange(mNewTime, {}); }
+
    bool VariableRates() const { return mResampleParameters.mVariableRates; }
 
 private:
@@ -137,5 +147,6 @@ private:
    //! Remember how many channels were passed to Acquire()
    unsigned mMaxChannels{};
    size_t mLastProduced{};
+   std::optional<double> mNewTime;
 };
 #endif
@@ -0,0 +1,215 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SequencePrefetcher.cpp
+
+**********************************************************************/
+#include "SequencePrefetcher.h"
+#include "MemoryX.h"
+#include "WideSampleSequence.h"
+#include "concurrency/ThreadPool.h"
+
+#include <algorithm>
+#include <deque>
+#include <optional>
+
+namespace {
+//! Ranges are warmed in pieces of this many seconds, so that destruction
+//! need not wait long for a task in progress
+constexpr double ChunkDuration = 4.0;
+
+//! How many disjoint warmed ranges to remember
+constexpr size_t MaxWarmedRanges = 8;
+}
+
+struct SequencePrefetcher::State {
+   struct Range {
+      double t0, t1;
+      bool Contains(double t) const { return t0 <= t && t <= t1; }
+   };
+
+   explicit State(Sequences sequences)
+      : sequences{ move(sequences) }
+   {}
+
+   void Run();
+   void Warm(const Range &range);
+
+   Sequences sequences;
+
+   std::mutex mutex;
+   std::condition_variable condition;
+   std::deque<Range> pending;
+   std::vector<Range> warmed;
+   std::optional<Range> inFlight;
+   bool scheduled{ false };
+   std::atomic<bool> stopping{ false };
+
+   Statistics statistics;
+};
+
+SequencePrefetcher::SequencePrefetcher(Sequences sequences, double lookAhead)
+   : mLookAhead{ std::max(0.0, lookAhead) }
+   , mpState{ std::make_shared<State>(move(sequences)) }
+{
+   mpState->statistics.lookAhead = mLookAhead;
+}
+
+SequencePrefetcher::~SequencePrefetcher()
+{
+   auto &state = *mpState;
+   std::unique_lock<std::mutex> lock{ state.mutex };
+   state.stopping.store(true);
+   state.pending.clear();
+   // A task still queued in the pool will find nothing to do, but wait for
+   // one that is using the sequences
+   state.condition.wait(lock, [&]{ return !state.inFlight; });
+   state.sequences.clear();
+}
+
+void SequencePrefetcher::Advance(double time, double limit)
+{
+   const auto backwards = limit < time;
+   {
+      auto &state = *mpState;
+      std::lock_guard<std::mutex> lock{ state.mutex };
+      auto &statistics = state.statistics;
+      const auto &warmed = state.warmed;
+      const auto iter = std::find_if(warmed.begin(), warmed.end(),
+         [&](const State::Range &range){ return range.Contains(time); });
+      if (iter == warmed.end()) {
+         statistics.depth = 0;
+         if (statistics.requests > 0)
+            ++statistics.stalls;
+      }
+      else
+         statistics.depth = backwards ? time - iter->t0 : iter->t1 - time;
+   }
+   Request(time, backwards
+      ? std::max(limit, time - mLookAhead)
+      : std::min(limit, time + mLookAhead));
+}
+
+void SequencePrefetcher::Request(double t0, double t1)
+{
+   if (t1 < t0)
+      std::swap(t0, t1);
+   {
+      auto &state = *mpState;
+      std::lock_guard<std::mutex> lock{ state.mutex };
+      if (state.stopping)
+         return;
+
+      // Trim away what is already warmed or about to be
+      const auto trim = [&](const State::Range &range){
+         if (range.Contains(t0))
+            t0 = std::max(t0, range.t1);
+         if (range.Contains(t1))
+            t1 = std::min(t1, range.t0);
+      };
+      for (const auto &range : state.warmed)
+         trim(range);
+      for (const auto &range : state.pending)
+         trim(range);
+      if (state.inFlight)
+         trim(*state.inFlight);
+      if (!(t0 < t1))
+         return;
+
+      state.pending.push_back({ t0, t1 });
+      ++state.statistics.requests;
+   }
+   Schedule();
+}
+
+void SequencePrefetcher::Reset()
+{
+   auto &state = *mpState;
+   std::lock_guard<std::mutex> lock{ state.mutex };
+   state.pending.clear();
+   state.warmed.clear();
+}
+
+auto SequencePrefetcher::GetStatistics() const -> Statistics
+{
+   auto &state = *mpState;
+   std::lock_guard<std::mutex> lock{ state.mutex };
+   return state.statistics;
+}
+
+void SequencePrefetcher::Schedule()
+{
+   {
+      auto &state = *mpState;
+      std::lock_guard<std::mutex> lock{ state.mutex };
+      if (state.scheduled || state.pending.empty())
+         return;
+      state.scheduled = true;
+   }
+   audacity::concurrency::ThreadPool::Get().Enqueue(
+      [pState = mpState]{ pState->Run(); });
+}
+
+void SequencePrefetcher::State::Run()
+{
+   while (true) {
+      Range range;
+      {
+         std::lock_guard<std::mutex> lock{ mutex };
+         if (stopping || pending.empty()) {
+            scheduled = false;
+            return;
+         }
+         range = pending.front();
+         pending.pop_front();
+         inFlight = range;
+      }
+
+      // Clear inFlight and wake the destructor, even if Warm throws
+      auto cleanup = finally([&]{
+         {
+            std::lock_guard<std::mutex> lock{ mutex };
+            inFlight.reset();
+         }
+         condition.notify_all();
+      });
+      Warm(range);
+
+      std::lock_guard<std::mutex> lock{ mutex };
+      // Merge with a touching range, else remember it as a new one
+      const auto iter = std::find_if(warmed.begin(), warmed.end(),
+         [&](const Range &other){
+            return other.Contains(range.t0) || other.Contains(range.t1); });
+      if (iter != warmed.end()) {
+         iter->t0 = std::min(iter->t0, range.t0);
+         iter->t1 = std::max(iter->t1, range.t1);
+      }
+      else {
+         if (warmed.size() == MaxWarmedRanges)
+            warmed.erase(warmed.begin());
+         warmed.push_back(range);
+      }
+      // Stop trimming requests against the range in the same critical
+      // section, so that a Reset() that follows its merging forgets it
+      inFlight.reset();
+   }
+}
+
+void SequencePrefetcher::State::Warm(const Range &range)
+{
+   for (auto t0 = range.t0; t0 < range.t1; t0 += ChunkDuration) {
+      const auto t1 = std::min(range.t1, t0 + ChunkDuration);
+      for (const auto &pSequence : sequences) {
+         if (stopping)
+            return;
+         try {
+            pSequence->Prefetch(t0, t1);
+         }
+         catch (...) {
+            // A read error will be reported again when the consumer reaches
+            // the same samples
+         }
+      }
+   }
+}
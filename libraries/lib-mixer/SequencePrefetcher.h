@@ -0,0 +1,79 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SequencePrefetcher.h
+  @brief Reads ahead of a consumer of WideSampleSequences on worker threads
+
+**********************************************************************/
+#ifndef __AUDACITY_SEQUENCE_PREFETCHER__
+#define __AUDACITY_SEQUENCE_PREFETCHER__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class WideSampleSequence;
+
+//! Warms the storage of sequences ahead of the times that a consumer, such as
+//! a playback or export Mixer, is about to fetch
+/*!
+ The consumer reports its position and requests ranges with calls that never
+ block on storage; the warming happens in tasks of the shared thread pool,
+ one task at a time per prefetcher, by WideSampleSequence::Prefetch.
+
+ The destructor waits for a task in progress, so the sequences must outlive
+ this object.
+ */
+class MIXER_API SequencePrefetcher final
+{
+public:
+   using Sequences = std::vector<std::shared_ptr<const WideSampleSequence>>;
+
+   struct Statistics {
+      //! Configured look-ahead, in seconds
+      double lookAhead{ 0 };
+      //! How far ahead of the consumer the warmed range extended at the last
+      //! report of its position, in seconds
+      double depth{ 0 };
+      //! Number of ranges submitted to the worker
+      size_t requests{ 0 };
+      //! Number of times the consumer reached a time not yet warmed
+      size_t stalls{ 0 };
+   };
+
+   /*!
+    @param lookAhead how many seconds beyond the consumer to keep warm
+    */
+   SequencePrefetcher(Sequences sequences, double lookAhead);
+   ~SequencePrefetcher();
+
+   SequencePrefetcher(const SequencePrefetcher&) = delete;
+   SequencePrefetcher &operator=(const SequencePrefetcher&) = delete;
+
+   double LookAhead() const { return mLookAhead; }
+
+   //! Report the consumer's position, then request the look-ahead range in
+   //! the direction of `limit`, not passing it
+   void Advance(double time, double limit);
+
+   //! Request warming of the range between `t0` and `t1`, in either order
+   /*! Parts already warmed, or pending, are not requested again */
+   void Request(double t0, double t1);
+
+   //! Forget warmed ranges, as after a discontinuous jump of the consumer
+   void Reset();
+
+   Statistics GetStatistics() const;
+
+private:
+   struct State;
+   void Schedule();
+
+   const double mLookAhead;
+   const std::shared_ptr<State> mpState;
+};
+
+#endif
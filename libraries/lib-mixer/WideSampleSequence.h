@@ -77,6 +77,14 @@ public:
       // contiguous range.
       sampleCount* pNumWithinClips = nullptr) const = 0;
 
+   //! Hint that samples between times `t0` and `t1` will soon be fetched
+   /*!
+    May be called on a worker thread, concurrently with fetches by other
+    threads, so an override must not change state observable by them.
+    It may throw; the default does nothing.
+    */
+   virtual void Prefetch(double t0, double t1) const;
+
    virtual double GetStartTime() const = 0;
    virtual double GetEndTime() const = 0;
    virtual double GetRate() const = 0;
@@ -0,0 +1,71 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MixerTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "Mix.h"
+#include "MockSampleSequence.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+using Output = std::vector<std::vector<float>>;
+
+Output Render(const Mixer::Inputs &inputs,
+   double t0, double t1, double outRate, size_t maxThreads)
+{
+   constexpr unsigned nChannels = 2;
+   Mixer mixer{ inputs, true, Mixer::WarpOptions{ 1.0, 1.0 },
+      t0, t1, nChannels, 1000, false, outRate, floatSample,
+      false, nullptr, Mixer::ApplyGain::MapChannels, { maxThreads } };
+   Output output(nChannels);
+   while (const auto count = mixer.Process()) {
+      for (unsigned channel = 0; channel < nChannels; ++channel) {
+         const auto buffer =
+            reinterpret_cast<const float*>(mixer.GetBuffer(channel));
+         output[channel].insert(
+            output[channel].end(), buffer, buffer + count);
+      }
+   }
+   return output;
+}
+
+bool BitIdentical(const Output &a, const Output &b)
+{
+   return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+      [](const std::vector<float> &x, const std::vector<float> &y){
+         return x.size() == y.size() &&
+            0 == memcmp(x.data(), y.data(), x.size() * sizeof(float));
+      });
+}
+}
+
+TEST_CASE("Mixer renders the same with any number of threads", "[Mixer]")
+{
+   // Mono and stereo inputs, with fractional gains and differing rates
+   const Mixer::Inputs inputs{
+      { std::make_shared<MockSampleSequence>(44100, 1, 3.0, 1, 0.5f) },
+      { std::make_shared<MockSampleSequence>(44100, 2, 2.5, 2) },
+      { std::make_shared<MockSampleSequence>(22050, 1, 2.0, 3, 0.25f) },
+      { std::make_shared<MockSampleSequence>(48000, 2, 1.5, 4, 0.75f) },
+   };
+
+   const auto outRate = GENERATE(44100.0, 48000.0);
+   // Also render backwards, as when scrubbing
+   const auto [t0, t1] = GENERATE(
+      std::make_pair(0.25, 2.75), std::make_pair(2.75, 0.25));
+
+   const auto serial = Render(inputs, t0, t1, outRate, 1);
+   REQUIRE(serial[0].size() > 0);
+   REQUIRE(std::any_of(serial[0].begin(), serial[0].end(),
+      [](float sample){ return sample != 0; }));
+
+   for (const size_t maxThreads : { 0, 2, 3 })
+      REQUIRE(BitIdentical(serial, Render(inputs, t0, t1, outRate, maxThreads)));
+}
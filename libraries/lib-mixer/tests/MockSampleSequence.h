@@ -0,0 +1,137 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MockSampleSequence.h
+
+**********************************************************************/
+#pragma once
+
+#include "WideSampleSequence.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+//! A sequence of reproducible noise, starting at time zero, that records the
+//! ranges it is asked to prefetch
+class MockSampleSequence final : public WideSampleSequence
+{
+public:
+   using Range = std::pair<double, double>;
+
+   /*!
+    @param seed distinguishes the noise of sequences otherwise alike
+    */
+   MockSampleSequence(double rate, size_t nChannels, double duration,
+      unsigned seed = 0, float gain = 1.f
+   )  : mRate{ rate }, mNChannels{ nChannels }, mDuration{ duration }
+      , mSeed{ seed }, mGain{ gain }
+   {}
+
+   //! @return the sample of `channel` at `position`, zero outside the sequence
+   float GetSample(size_t channel, long long position) const
+   {
+      if (position < 0 || position >= mDuration * mRate)
+         return 0;
+      auto x = static_cast<uint32_t>(position) * 2654435761u
+         + static_cast<uint32_t>(channel + 1) * 40503u + mSeed * 2246822519u;
+      x ^= x >> 15;
+      x *= 2246822519u;
+      x ^= x >> 13;
+      // Uniform in [-1, 1)
+      return static_cast<float>(x >> 8) / (1 << 23) - 1.f;
+   }
+
+   std::vector<Range> GetPrefetched() const
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      return mPrefetched;
+   }
+
+   //! Wait until the prefetched ranges add up to at least `total` seconds
+   //! @return whether that happened before a generous timeout
+   bool WaitForPrefetched(double total) const
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      return mCondition.wait_for(lock, std::chrono::seconds{ 10 }, [&]{
+         double sum = 0;
+         for (const auto &[t0, t1] : mPrefetched)
+            sum += t1 - t0;
+         return sum >= total;
+      });
+   }
+
+   // WideSampleSequence
+   size_t NChannels() const override { return mNChannels; }
+   float GetChannelGain(int) const override { return mGain; }
+
+   //! Supports only floatSample, and ignores `fill`, always filling zeroes
+   bool DoGet(
+      size_t iChannel, size_t nBuffers, const samplePtr buffers[],
+      sampleFormat format, sampleCount start, size_t len, bool backwards,
+      fillFormat, bool, sampleCount* pNumWithinClips) const override
+   {
+      if (format != floatSample)
+         return false;
+      size_t numWithinClips = 0;
+      for (size_t ii = 0; ii < nBuffers; ++ii) {
+         const auto buffer = reinterpret_cast<float*>(buffers[ii]);
+         for (size_t jj = 0; jj < len; ++jj) {
+            const auto position = backwards
+               ? start.as_long_long() - 1 - jj
+               : start.as_long_long() + jj;
+            buffer[jj] = GetSample(iChannel + ii, position);
+            if (ii == 0 && position >= 0 && position < mDuration * mRate)
+               ++numWithinClips;
+         }
+      }
+      if (pNumWithinClips)
+         *pNumWithinClips = numWithinClips;
+      return true;
+   }
+
+   void Prefetch(double t0, double t1) const override
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mPrefetched.emplace_back(t0, t1);
+      }
+      mCondition.notify_all();
+   }
+
+   double GetStartTime() const override { return 0; }
+   double GetEndTime() const override { return mDuration; }
+   double GetRate() const override { return mRate; }
+   sampleFormat WidestEffectiveFormat() const override { return floatSample; }
+   bool HasTrivialEnvelope() const override { return true; }
+
+   void GetEnvelopeValues(
+      double* buffer, size_t bufferLen, double, bool) const override
+   {
+      std::fill(buffer, buffer + bufferLen, 1.0);
+   }
+
+   // AudioGraph::Channel
+   AudioGraph::ChannelType GetChannelType() const override
+   {
+      return mNChannels == 1
+         ? AudioGraph::MonoChannel : AudioGraph::LeftChannel;
+   }
+
+private:
+   const double mRate;
+   const size_t mNChannels;
+   const double mDuration;
+   const unsigned mSeed;
+   const float mGain;
+
+   mutable std::mutex mMutex;
+   mutable std::condition_variable mCondition;
+   mutable std::vector<Range> mPrefetched;
+};
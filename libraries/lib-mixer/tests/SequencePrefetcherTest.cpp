@@ -0,0 +1,127 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SequencePrefetcherTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "MockSampleSequence.h"
+#include "SequencePrefetcher.h"
+
+#include <thread>
+
+using Range = MockSampleSequence::Range;
+using Ranges = std::vector<Range>;
+
+namespace {
+//! Report the same position until the prefetcher finds it warmed, as a
+//! consumer waiting for the worker would; each failed try counts a stall
+bool AdvanceUntilWarm(
+   SequencePrefetcher &prefetcher, double time, double limit)
+{
+   const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+   while (std::chrono::steady_clock::now() < deadline) {
+      prefetcher.Advance(time, limit);
+      if (prefetcher.GetStatistics().depth > 0)
+         return true;
+      std::this_thread::yield();
+   }
+   return false;
+}
+}
+
+TEST_CASE("SequencePrefetcher::Advance", "[SequencePrefetcher]")
+{
+   const auto pSequence = std::make_shared<MockSampleSequence>(44100, 1, 60);
+
+   SECTION("Requests the look-ahead towards the limit")
+   {
+      {
+         SequencePrefetcher prefetcher{ { pSequence }, 2 };
+         prefetcher.Advance(1, 60);
+         REQUIRE(pSequence->WaitForPrefetched(2));
+      }
+      REQUIRE(pSequence->GetPrefetched() == Ranges{ { 1, 3 } });
+   }
+
+   SECTION("Does not pass the limit")
+   {
+      {
+         SequencePrefetcher prefetcher{ { pSequence }, 2 };
+         prefetcher.Advance(59, 60);
+         REQUIRE(pSequence->WaitForPrefetched(1));
+      }
+      REQUIRE(pSequence->GetPrefetched() == Ranges{ { 59, 60 } });
+   }
+
+   SECTION("Requests backwards when the limit is before the time")
+   {
+      {
+         SequencePrefetcher prefetcher{ { pSequence }, 2 };
+         prefetcher.Advance(10, 0);
+         REQUIRE(pSequence->WaitForPrefetched(2));
+      }
+      REQUIRE(pSequence->GetPrefetched() == Ranges{ { 8, 10 } });
+   }
+
+   SECTION("Warms long ranges of every sequence in pieces")
+   {
+      const auto pOther = std::make_shared<MockSampleSequence>(44100, 2, 60);
+      {
+         SequencePrefetcher prefetcher{ { pSequence, pOther }, 10 };
+         prefetcher.Advance(0, 60);
+         REQUIRE(pSequence->WaitForPrefetched(10));
+         REQUIRE(pOther->WaitForPrefetched(10));
+      }
+      const Ranges expected{ { 0, 4 }, { 4, 8 }, { 8, 10 } };
+      REQUIRE(pSequence->GetPrefetched() == expected);
+      REQUIRE(pOther->GetPrefetched() == expected);
+   }
+
+   SECTION("Does not request again what is pending or warmed")
+   {
+      SequencePrefetcher prefetcher{ { pSequence }, 2 };
+      prefetcher.Advance(0, 60);
+      // Nothing was warmed yet, but nothing was requested before either
+      REQUIRE(prefetcher.GetStatistics().stalls == 0);
+      prefetcher.Advance(0, 60);
+      REQUIRE(prefetcher.GetStatistics().requests == 1);
+
+      REQUIRE(AdvanceUntilWarm(prefetcher, 0, 60));
+      REQUIRE(prefetcher.GetStatistics().depth == 2);
+      REQUIRE(prefetcher.GetStatistics().requests == 1);
+
+      // Only the part beyond the warmed range is new
+      const auto stalls = prefetcher.GetStatistics().stalls;
+      prefetcher.Advance(1, 60);
+      const auto statistics = prefetcher.GetStatistics();
+      REQUIRE(statistics.depth == 1);
+      REQUIRE(statistics.requests == 2);
+      REQUIRE(statistics.stalls == stalls);
+      REQUIRE(pSequence->WaitForPrefetched(3));
+      REQUIRE(pSequence->GetPrefetched() == Ranges{ { 0, 2 }, { 2, 3 } });
+   }
+}
+
+TEST_CASE("SequencePrefetcher::Reset", "[SequencePrefetcher]")
+{
+   const auto pSequence = std::make_shared<MockSampleSequence>(44100, 1, 60);
+   SequencePrefetcher prefetcher{ { pSequence }, 2 };
+   prefetcher.Advance(0, 60);
+   REQUIRE(AdvanceUntilWarm(prefetcher, 0, 60));
+   const auto stalls = prefetcher.GetStatistics().stalls;
+
+   // After a jump, the same position is cold again, and requested again
+   prefetcher.Reset();
+   prefetcher.Advance(0, 60);
+   const auto statistics = prefetcher.GetStatistics();
+   REQUIRE(statistics.depth == 0);
+   REQUIRE(statistics.stalls == stalls + 1);
+   REQUIRE(statistics.requests == 2);
+   REQUIRE(pSequence->WaitForPrefetched(4));
+   REQUIRE(pSequence->GetPrefetched() == Ranges{ { 0, 2 }, { 0, 2 } });
+}
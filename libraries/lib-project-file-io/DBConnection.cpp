@@ -13,6 +13,11 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #include "sqlite3.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <thread>
+#include <vector>
 #include <wx/string.h>
 
 #include "AudacityLogger.h"
@@ -29,8 +34,11 @@ Paul Licameli -- split from ProjectFileIO.cpp
 #define xstr(a) str(a)
 #define str(a) #a
 
+// Incremental auto-vacuum also takes effect only with the VACUUM, and lets
+// StartCompaction() release free pages without copying the file
 static const char* PageSizeConfig =
    "PRAGMA <schema>.page_size = " xstr(AUDACITY_PROJECT_PAGE_SIZE) ";"
+   "PRAGMA <schema>.auto_vacuum = INCREMENTAL;"
    "VACUUM;";
 
 // Configuration to provide "safe" connections
@@ -48,6 +56,37 @@ static const char *FastConfig =
    "PRAGMA <schema>.synchronous = OFF;"
    "PRAGMA <schema>.journal_mode = OFF;";
 
+// Incremental compaction works in slices of about this duration, each its own
+// transaction, pausing between them so other writers are not starved
+static constexpr auto CompactionSliceDuration = std::chrono::milliseconds{ 50 };
+static constexpr auto CompactionPause = std::chrono::milliseconds{ 10 };
+static constexpr int64_t MinCompactionBatch = 1;
+static constexpr int64_t MaxCompactionBatch = 1024;
+
+// Deferred writes wait for the writer thread when this many bytes are queued;
+// this is several seconds of many channels of recording at high rates
+static constexpr size_t MaxDeferredBytes = 64 * 1024 * 1024;
+// At most this many deferred writes are committed in one transaction
+static constexpr size_t MaxDeferredBatch = 64;
+// The writer thread waits this long for another connection to release the
+// write lock, then gives back its batch and tries again after a pause
+static constexpr int DeferredBusyTimeout = 100;
+static constexpr auto DeferredRetryPause = std::chrono::milliseconds{ 10 };
+
+//! @return the value of an integer PRAGMA of the main database, or -1
+static int64_t GetPragmaValue(sqlite3 *db, const char *pragma)
+{
+   sqlite3_stmt *stmt = nullptr;
+   auto sql = wxString::Format("PRAGMA main.%s;", pragma);
+   int rc = sqlite3_prepare_v2(db, sql.ToUTF8(), -1, &stmt, nullptr);
+   if (rc != SQLITE_OK)
+      return -1;
+   auto finalizer = finally([&stmt] { sqlite3_finalize(stmt); });
+   if (sqlite3_step(stmt) != SQLITE_ROW)
+      return -1;
+   return sqlite3_column_int64(stmt, 0);
+}
+
 DBConnection::DBConnection(
    const std::weak_ptr<AudacityProject> &pProject,
    const std::shared_ptr<DBConnectionErrors> &pErrors,
@@ -58,6 +97,7 @@ DBConnection::DBConnection(
 {
    mDB = nullptr;
    mCheckpointDB = nullptr;
+   mWriterDB = nullptr;
    mBypass = false;
 }
 
@@ -148,9 +188,20 @@ int DBConnection::Open(const FilePath fileName)
    mCheckpointStop = false;
    mCheckpointPending = false;
    mCheckpointActive = false;
+   mCompactionPending = false;
+   mWriterStop = false;
+   mDeferredFailed = false;
+   mDeferredStatistics = {};
+   mNextBlockID = 0;
    rc = OpenStepByStep( fileName );
    if ( rc != SQLITE_OK)
    {
+      if (mWriterDB)
+      {
+         sqlite3_close(mWriterDB);
+         mWriterDB = nullptr;
+      }
+
       if (mCheckpointDB)
       {
          sqlite3_close(mCheckpointDB);
@@ -221,12 +272,37 @@ int DBConnection::OpenStepByStep(const FilePath fileName)
       return rc;
    }
 
+   rc = sqlite3_open(name, &mWriterDB);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::OpenStepByStep::open_writer");
+
+      wxLogMessage("Failed to open writer connection to %s: %d, %s\n",
+         fileName,
+         rc,
+         sqlite3_errstr(rc));
+      return rc;
+   }
+
+   rc = ModeConfig(mWriterDB, "main", SafeConfig);
+   if (rc != SQLITE_OK) {
+      SetDBError(XO("Failed to set safe mode on writer connection to %s").Format(fileName));
+      return rc;
+   }
+   sqlite3_busy_timeout(mWriterDB, DeferredBusyTimeout);
+
    auto db = mCheckpointDB;
    mCheckpointThread = std::thread(
       [this, db, fileName]{ CheckpointThread(db, fileName); });
 
-   // Install our checkpoint hook
+   auto writerDB = mWriterDB;
+   mWriterThread = std::thread(
+      [this, writerDB, fileName]{ WriterThread(writerDB, fileName); });
+
+   // Install our checkpoint hook, also for commits of deferred writes
    sqlite3_wal_hook(mDB, CheckpointHook, this);
+   sqlite3_wal_hook(mWriterDB, CheckpointHook, this);
    return rc;
 }
 
@@ -241,9 +317,17 @@ bool DBConnection::Close()
       return true;
    }
 
+   // Finish deferred writes before the last checkpoints
+   StopWriter();
+
    // Uninstall our checkpoint hook so that no additional checkpoints
    // are sent our way.  (Though this shouldn't really happen.)
    sqlite3_wal_hook(mDB, nullptr, nullptr);
+   sqlite3_wal_hook(mWriterDB, nullptr, nullptr);
+
+   // Don't wait for compaction to finish; what remains can be done the next
+   // time the file is opened
+   StopCompaction();
 
    // Display a progress dialog if there's active or pending checkpoints
    if (mCheckpointPending || mCheckpointActive)
@@ -307,6 +391,20 @@ bool DBConnection::Close()
 
    // Not much we can do if the closes fail, so just report the error
 
+   // Close the writer connection
+   rc = sqlite3_close(mWriterDB);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::Close::close_writer");
+
+      wxLogMessage("Failed to close writer connection for %s\n"
+                   "\tError: %s\n",
+                   sqlite3_db_filename(mWriterDB, nullptr),
+                   sqlite3_errmsg(mWriterDB));
+   }
+   mWriterDB = nullptr;
+
    // Close the checkpoint connection
    rc = sqlite3_close(mCheckpointDB);
    if (rc != SQLITE_OK)
@@ -500,11 +598,20 @@ void DBConnection::CheckpointThread(sqlite3 *db, const FilePath &fileName)
       {
          // Wait for work or the stop signal
          std::unique_lock<std::mutex> lock(mCheckpointMutex);
-         mCheckpointCondition.wait(lock,
+         if (mCompactionPending)
+            // Pause between slices of compaction, unless a checkpoint is
+            // requested sooner
+            mCheckpointCondition.wait_for(lock, CompactionPause,
                                    [&]
                                    {
                                       return mCheckpointPending || mCheckpointStop;
                                    });
+         else
+            mCheckpointCondition.wait(lock,
+                                   [&]
+                                   {
+                                      return mCheckpointPending || mCompactionPending || mCheckpointStop;
+                                   });
 
          // Requested to stop, so bail
          if (mCheckpointStop)
@@ -517,6 +624,11 @@ void DBConnection::CheckpointThread(sqlite3 *db, const FilePath &fileName)
          mCheckpointPending = false;
       }
 
+      // Release some free pages; the checkpoint that follows then truncates
+      // the database file
+      if (mCompactionPending && !giveUp)
+         CompactionSlice(db, fileName);
+
       // And kick off the checkpoint. This may not checkpoint ALL frames
       // in the WAL.  They'll be gotten the next time around.
       using namespace std::chrono;
@@ -584,6 +696,373 @@ void DBConnection::CheckpointThread(sqlite3 *db, const FilePath &fileName)
    return;
 }
 
+bool DBConnection::CanCompactIncrementally()
+{
+   // 2 means INCREMENTAL
+   return mDB && GetPragmaValue(mDB, "auto_vacuum") == 2;
+}
+
+bool DBConnection::StartCompaction(CompactionCallback callback)
+{
+   if (!CanCompactIncrementally())
+      return false;
+
+   const auto pageSize = GetPragmaValue(mDB, "page_size");
+   const auto freePages = GetPragmaValue(mDB, "freelist_count");
+   if (pageSize < 0 || freePages < 0)
+      return false;
+
+   CompactionProgress progress{ pageSize, 0, freePages, freePages == 0 };
+   {
+      std::lock_guard<std::mutex> guard(mCheckpointMutex);
+      mCompactionProgress = progress;
+      mCompactionCallback = callback;
+      mCompactionBatch = 16;
+      if (!progress.done)
+      {
+         mCompactionPending = true;
+         mCheckpointCondition.notify_one();
+         return true;
+      }
+   }
+
+   // Nothing to do, but report that
+   if (callback)
+      BasicUI::CallAfter([callback, progress]{ callback(progress); });
+   return true;
+}
+
+void DBConnection::StopCompaction()
+{
+   std::lock_guard<std::mutex> guard(mCheckpointMutex);
+   mCompactionPending = false;
+}
+
+bool DBConnection::IsCompacting() const
+{
+   // Include the slice in progress, and the checkpoint after it that
+   // truncates the file
+   return mCompactionPending || mCheckpointActive;
+}
+
+auto DBConnection::GetCompactionProgress() -> CompactionProgress
+{
+   std::lock_guard<std::mutex> guard(mCheckpointMutex);
+   return mCompactionProgress;
+}
+
+void DBConnection::CompactionSlice(sqlite3 *db, const FilePath &fileName)
+{
+   int64_t batch;
+   {
+      std::lock_guard<std::mutex> guard(mCheckpointMutex);
+      batch = mCompactionBatch;
+   }
+
+   // Each PRAGMA is its own transaction, moving pages from the end of the
+   // file into free pages, then truncating the file (in the WAL)
+   using namespace std::chrono;
+   const auto before = GetPragmaValue(db, "freelist_count");
+   const auto start = steady_clock::now();
+   auto sql = wxString::Format("PRAGMA main.incremental_vacuum(%lld);",
+      static_cast<long long>(batch));
+   int rc = sqlite3_exec(db, sql.ToUTF8(), nullptr, nullptr, nullptr);
+   const auto elapsed = steady_clock::now() - start;
+   const auto after = GetPragmaValue(db, "freelist_count");
+
+   // Contention with the main connection just means try again later
+   const bool failed = (rc != SQLITE_OK && rc != SQLITE_BUSY) || after < 0;
+   if (failed)
+   {
+      // The file is still consistent, so just report it and give up
+      wxLogMessage("Failed incremental compaction of %s\n"
+                   "\tErrCode: %d\n"
+                   "\tErrMsg: %s",
+                   fileName,
+                   sqlite3_errcode(db),
+                   sqlite3_errmsg(db));
+   }
+
+   CompactionProgress progress;
+   CompactionCallback callback;
+   {
+      std::lock_guard<std::mutex> guard(mCheckpointMutex);
+      if (rc == SQLITE_OK)
+      {
+         // Aim for slices of the target duration
+         if (elapsed < CompactionSliceDuration / 2)
+            batch = std::min(batch * 2, MaxCompactionBatch);
+         else if (elapsed > CompactionSliceDuration)
+            batch = std::max(batch / 2, MinCompactionBatch);
+         mCompactionBatch = batch;
+      }
+
+      auto &stats = mCompactionProgress;
+      if (before >= 0 && after >= 0)
+         stats.reclaimedPages += std::max<int64_t>(0, before - after);
+      if (after >= 0)
+         stats.remainingPages = after;
+      stats.done = (after == 0);
+      if (stats.done || failed)
+         mCompactionPending = false;
+
+      progress = stats;
+      callback = mCompactionCallback;
+   }
+
+   if (callback)
+      BasicUI::CallAfter([callback, progress]{ callback(progress); });
+}
+
+DBConnection::DeferredWrite::~DeferredWrite() = default;
+
+bool DBConnection::Defer(std::shared_ptr<DeferredWrite> pWrite)
+{
+   const auto size = pWrite->Size();
+   {
+      std::unique_lock<std::mutex> lock(mWriterMutex);
+      if (mDeferredFailed || mWriterStop)
+         return false;
+
+      // Backpressure:  wait while the queue is full, but accept any one write
+      auto &stats = mDeferredStatistics;
+      if (stats.queuedBytes > 0 && stats.queuedBytes + size > MaxDeferredBytes)
+      {
+         const auto start = std::chrono::steady_clock::now();
+         mDeferredCondition.wait(lock, [&]{
+            return mDeferredFailed || mWriterStop || stats.queuedBytes == 0 ||
+               stats.queuedBytes + size <= MaxDeferredBytes;
+         });
+         ++stats.stalls;
+         stats.stalledTime += std::chrono::steady_clock::now() - start;
+         if (mDeferredFailed || mWriterStop)
+            return false;
+      }
+
+      mDeferred.push_back(std::move(pWrite));
+      stats.queuedBytes += size;
+      stats.maxQueuedBytes = std::max(stats.maxQueuedBytes, stats.queuedBytes);
+   }
+   mWriterCondition.notify_one();
+   return true;
+}
+
+bool DBConnection::FlushDeferred()
+{
+   // The writer thread can't commit while this thread's connection holds a
+   // write transaction, so then do the writes here, within that transaction
+   if (sqlite3_txn_state(mDB, "main") == SQLITE_TXN_WRITE)
+      return WriteDeferred(mDB);
+
+   std::unique_lock<std::mutex> lock(mWriterMutex);
+   mDeferredCondition.wait(lock, [this]{
+      return mDeferred.empty() && mDeferredInProgress == 0;
+   });
+   return !mDeferredFailed;
+}
+
+bool DBConnection::WriteDeferred(sqlite3 *db)
+{
+   std::deque<std::shared_ptr<DeferredWrite>> writes;
+   {
+      // The writer thread gives back its batch when it finds the database
+      // busy, so this wait is short
+      std::unique_lock<std::mutex> lock(mWriterMutex);
+      mDeferredCondition.wait(lock, [this]{
+         return mDeferredInProgress == 0;
+      });
+      if (mDeferredFailed)
+         return false;
+      writes.swap(mDeferred);
+      mDeferredInProgress += writes.size();
+   }
+
+   size_t bytes = 0;
+   size_t written = 0;
+   for (auto &pWrite : writes)
+   {
+      if (!pWrite->Write(db))
+      {
+         wxLogMessage("Failed deferred write to %s\n"
+                      "\tErrCode: %d\n"
+                      "\tErrMsg: %s",
+                      sqlite3_db_filename(db, nullptr),
+                      sqlite3_errcode(db),
+                      sqlite3_errmsg(db));
+         break;
+      }
+      bytes += pWrite->Size();
+      pWrite->Committed();
+      ++written;
+   }
+
+   {
+      std::lock_guard<std::mutex> guard(mWriterMutex);
+      auto &stats = mDeferredStatistics;
+      stats.queuedBytes -= bytes;
+      stats.writes += written;
+      // The writer thread may try again what failed here, after this
+      // transaction ends
+      mDeferred.insert(mDeferred.begin(),
+         std::make_move_iterator(writes.begin() + written),
+         std::make_move_iterator(writes.end()));
+      mDeferredInProgress -= writes.size();
+   }
+   mDeferredCondition.notify_all();
+   mWriterCondition.notify_one();
+   return written == writes.size();
+}
+
+auto DBConnection::GetDeferredStatistics() -> DeferredStatistics
+{
+   std::lock_guard<std::mutex> guard(mWriterMutex);
+   return mDeferredStatistics;
+}
+
+int64_t DBConnection::NewBlockID()
+{
+   std::lock_guard<std::mutex> guard(mBlockIDMutex);
+   if (mNextBlockID == 0)
+   {
+      // Continue after the greatest id ever used, as AUTOINCREMENT would
+      sqlite3_stmt *stmt = nullptr;
+      auto finalizer = finally([&stmt] { sqlite3_finalize(stmt); });
+      int rc = sqlite3_prepare_v2(mDB,
+         "SELECT max("
+         "  ifnull((SELECT seq FROM sqlite_sequence"
+         "     WHERE name = 'sampleblocks'), 0),"
+         "  ifnull((SELECT max(blockid) FROM sampleblocks), 0));",
+         -1, &stmt, nullptr);
+      if (rc != SQLITE_OK || sqlite3_step(stmt) != SQLITE_ROW)
+      {
+         wxLogMessage("Failed to find the next block id of %s\n"
+                      "\tError: %s\n",
+                      sqlite3_db_filename(mDB, nullptr),
+                      sqlite3_errmsg(mDB));
+         return 0;
+      }
+      mNextBlockID = sqlite3_column_int64(stmt, 0) + 1;
+   }
+   return mNextBlockID++;
+}
+
+void DBConnection::WriterThread(sqlite3 *db, const FilePath &fileName)
+{
+   std::vector<std::shared_ptr<DeferredWrite>> batch;
+   while (true)
+   {
+      size_t bytes = 0;
+      {
+         // Wait for work or the stop signal; stop only after the queue drains
+         std::unique_lock<std::mutex> lock(mWriterMutex);
+         mWriterCondition.wait(lock, [this]{
+            return !mDeferred.empty() || mWriterStop;
+         });
+         if (mDeferred.empty())
+            break;
+
+         while (!mDeferred.empty() && batch.size() < MaxDeferredBatch)
+         {
+            bytes += mDeferred.front()->Size();
+            batch.push_back(std::move(mDeferred.front()));
+            mDeferred.pop_front();
+         }
+         mDeferredInProgress += batch.size();
+      }
+
+      // Take the write lock at once, so that a busy database is found before
+      // any of the batch is written
+      int rc = mDeferredFailed ? SQLITE_ABORT :
+         sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+      if (rc == SQLITE_OK)
+      {
+         for (auto &pWrite : batch)
+            if (!pWrite->Write(db))
+            {
+               rc = sqlite3_errcode(db);
+               break;
+            }
+         if (rc == SQLITE_OK)
+            rc = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+         if (rc != SQLITE_OK)
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+      }
+
+      // Another connection, usually the main one, holds the write lock; this
+      // is no failure
+      const auto primary = rc & 0xff;
+      const bool busy = primary == SQLITE_BUSY || primary == SQLITE_LOCKED;
+      if (rc != SQLITE_OK && !busy && !mDeferredFailed)
+         wxLogMessage("Failed deferred write to %s\n"
+                      "\tErrCode: %d\n"
+                      "\tErrMsg: %s",
+                      fileName,
+                      rc,
+                      sqlite3_errmsg(db));
+
+      if (rc == SQLITE_OK)
+         for (auto &pWrite : batch)
+            pWrite->Committed();
+
+      {
+         std::lock_guard<std::mutex> guard(mWriterMutex);
+         auto &stats = mDeferredStatistics;
+         if (rc == SQLITE_OK)
+         {
+            stats.queuedBytes -= bytes;
+            stats.writes += batch.size();
+            ++stats.batches;
+         }
+         else if (busy)
+         {
+            // Give the batch back, in order, to be tried again, or to be
+            // written by the thread holding the lock, in WriteDeferred()
+            mDeferred.insert(mDeferred.begin(),
+               std::make_move_iterator(batch.begin()),
+               std::make_move_iterator(batch.end()));
+            ++stats.retries;
+         }
+         else
+         {
+            stats.queuedBytes -= bytes;
+            // Later Defer() and FlushDeferred() report the failure to their
+            // threads
+            mDeferredFailed = true;
+         }
+         mDeferredInProgress -= batch.size();
+      }
+      mDeferredCondition.notify_all();
+      batch.clear();
+
+      if (busy)
+         std::this_thread::sleep_for(DeferredRetryPause);
+   }
+}
+
+void DBConnection::StopWriter()
+{
+   {
+      std::lock_guard<std::mutex> guard(mWriterMutex);
+      mWriterStop = true;
+      mWriterCondition.notify_one();
+   }
+
+   if (mWriterThread.joinable())
+   {
+      mWriterThread.join();
+   }
+
+   const auto stats = GetDeferredStatistics();
+   if (stats.writes > 0)
+      wxLogMessage("Deferred %zu writes in %zu transactions, "
+         "%zu retries, at most %zu bytes queued, %zu stalls for %lld ms",
+         stats.writes, stats.batches, stats.retries, stats.maxQueuedBytes,
+         stats.stalls,
+         static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+               stats.stalledTime).count()));
+}
+
 int DBConnection::CheckpointHook(void *data, sqlite3 *db, const char *schema, int pages)
 {
    // Get access to our object
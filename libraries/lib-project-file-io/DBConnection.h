@@ -13,7 +13,10 @@ Paul Licameli -- split from ProjectFileIO.h
 #define __AUDACITY_DB_CONNECTION__
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
@@ -41,6 +44,21 @@ class PROJECT_FILE_IO_API DBConnection final
 public:
    using CheckpointFailureCallback = std::function<void()>;
 
+   //! Progress of incremental compaction of the main database, in pages
+   struct CompactionProgress
+   {
+      int64_t pageSize{ 0 };
+      //! Pages released to the file system since compaction started
+      int64_t reclaimedPages{ 0 };
+      //! Free pages still in the file
+      int64_t remainingPages{ 0 };
+      //! True when no free pages remain
+      bool done{ false };
+
+      int64_t ReclaimedBytes() const { return reclaimedPages * pageSize; }
+   };
+   using CompactionCallback = std::function<void(const CompactionProgress &)>;
+
    DBConnection(
       const std::weak_ptr<AudacityProject> &pProject,
       const std::shared_ptr<DBConnectionErrors> &pErrors,
@@ -63,6 +81,76 @@ public:
    int FastMode(const char* schema = "main");
    int SetPageSize(const char* schema = "main");
 
+   //! Whether the main database was created with incremental auto-vacuum,
+   //! so that its free pages can be released without copying the file
+   bool CanCompactIncrementally();
+
+   //! Begin releasing free pages of the main database to the file system
+   /*!
+    The checkpoint thread does the work in slices of bounded duration,
+    relocating live pages into free pages nearer the start of the file, so
+    that other use of the database may proceed between slices.
+    @param callback invoked in the main thread in idle time after each slice
+    @return false if the database does not permit incremental compaction
+    */
+   bool StartCompaction(CompactionCallback callback = {});
+   //! Stop after the current slice; free pages that remain may be released
+   //! by a later StartCompaction(), even by another connection
+   void StopCompaction();
+   bool IsCompacting() const;
+   CompactionProgress GetCompactionProgress();
+
+   //! A write to be done by the writer thread, with its own connection
+   class DeferredWrite
+   {
+   public:
+      virtual ~DeferredWrite();
+      //! @return false on failure
+      virtual bool Write(sqlite3 *db) = 0;
+      //! Called after the transaction including Write() is committed, or
+      //! after Write() joined a transaction of the main connection
+      virtual void Committed() = 0;
+      //! Approximate number of bytes held, for the bound on the queue
+      virtual size_t Size() const = 0;
+   };
+
+   //! Measures of the queue of deferred writes
+   struct DeferredStatistics
+   {
+      size_t queuedBytes{ 0 }; //!< Not yet committed
+      size_t maxQueuedBytes{ 0 }; //!< High-water mark
+      size_t writes{ 0 }; //!< Committed
+      size_t batches{ 0 }; //!< Transactions
+      size_t retries{ 0 }; //!< Batches given back while the database was busy
+      size_t stalls{ 0 }; //!< Times Defer() waited for the queue to drain
+      std::chrono::steady_clock::duration stalledTime{};
+   };
+
+   //! Queue a write for the writer thread
+   /*!
+    Writes are done in the order queued, several in each transaction.  The
+    caller waits while the queue already holds too many bytes.
+    @return false if an earlier deferred write failed
+    */
+   bool Defer(std::shared_ptr<DeferredWrite> pWrite);
+
+   //! Wait until all deferred writes are committed
+   /*!
+    Call it before a transaction that refers to the rows, such as one writing
+    a project document.  If the main connection already holds a write
+    transaction, the queued rows are instead written in that transaction.
+    @return false if any failed
+    */
+   bool FlushDeferred();
+
+   DeferredStatistics GetDeferredStatistics();
+
+   //! @return a new id for a row of sampleblocks, greater than any used
+   //! before in the database, or 0 on failure
+   /*! Ids are assigned before insertion, so that deferred writes and
+    immediate ones do not collide */
+   int64_t NewBlockID();
+
    bool Assign(sqlite3 *handle);
    sqlite3 *Detach();
 
@@ -74,13 +162,19 @@ public:
    enum StatementID
    {
       GetSamples,
+      GetSamplesBatch,
       GetSummary256,
       GetSummary64k,
       LoadSampleBlock,
+      LoadAllSampleBlocks,
       InsertSampleBlock,
       DeleteSampleBlock,
       GetSampleBlockSize,
-      GetAllSampleBlocksSize
+      GetAllSampleBlocksSize,
+      GetCachedData,
+      PutCachedData,
+      TouchCachedData,
+      DeleteCachedData
    };
    sqlite3_stmt *Prepare(enum StatementID id, const char *sql);
 
@@ -104,6 +198,12 @@ private:
    int ModeConfig(sqlite3 *db, const char *schema, const char *config);
 
    void CheckpointThread(sqlite3 *db, const FilePath &fileName);
+   void WriterThread(sqlite3 *db, const FilePath &fileName);
+   //! Do queued writes on `db` in the calling thread, and put back any that
+   //! fail
+   bool WriteDeferred(sqlite3 *db);
+   void StopWriter();
+   void CompactionSlice(sqlite3 *db, const FilePath &fileName);
    static int CheckpointHook(void *data, sqlite3 *db, const char *schema, int pages);
 
 private:
@@ -117,6 +217,31 @@ private:
    std::atomic_bool mCheckpointStop{ false };
    std::atomic_bool mCheckpointPending{ false };
    std::atomic_bool mCheckpointActive{ false };
+   std::atomic_bool mCompactionPending{ false };
+
+   // Guarded by mCheckpointMutex
+   CompactionProgress mCompactionProgress;
+   CompactionCallback mCompactionCallback;
+   //! Pages per slice, adjusted to keep slices near the target duration
+   int64_t mCompactionBatch{ 0 };
+
+   sqlite3 *mWriterDB;
+   std::thread mWriterThread;
+   //! Guards the members that follow it
+   std::mutex mWriterMutex;
+   //! Signals work or the stop request to the writer thread
+   std::condition_variable mWriterCondition;
+   //! Signals commits to threads waiting in Defer() or FlushDeferred()
+   std::condition_variable mDeferredCondition;
+   std::deque<std::shared_ptr<DeferredWrite>> mDeferred;
+   //! Writes taken from mDeferred and not yet committed
+   size_t mDeferredInProgress{ 0 };
+   bool mWriterStop{ false };
+   bool mDeferredFailed{ false };
+   DeferredStatistics mDeferredStatistics;
+
+   std::mutex mBlockIDMutex;
+   int64_t mNextBlockID{ 0 };
 
    std::mutex mStatementMutex;
    using StatementIndex = std::pair<enum StatementID, std::thread::id>;
@@ -0,0 +1,313 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ProjectCache.cpp
+
+**********************************************************************/
+#include "ProjectCache.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "BasicUI.h"
+#include "DBConnection.h"
+#include "Project.h"
+
+#include <wx/log.h>
+
+// CREATE SQL cachedata
+// Not in ProjectFileSchema, because older versions need not know of it.
+// accessed is the time of last reading or writing, in seconds; items
+// least recently accessed are discarded first.
+static const char *CacheSchema =
+   "CREATE TABLE IF NOT EXISTS main.cachedata"
+   "("
+   "  groupid              INTEGER,"
+   "  itemid               INTEGER,"
+   "  accessed             INTEGER,"
+   "  data                 BLOB,"
+   "  PRIMARY KEY (groupid, itemid)"
+   ");"
+   "CREATE INDEX IF NOT EXISTS main.cachedata_accessed"
+   "  ON cachedata (accessed);";
+
+static const AudacityProject::AttachedObjects::RegisteredFactory
+sProjectCacheKey{
+   []( AudacityProject &project ){
+      return std::make_shared< ProjectCache >( project );
+   }
+};
+
+ProjectCache &ProjectCache::Get(AudacityProject &project)
+{
+   return project.AttachedObjects::Get< ProjectCache >( sProjectCacheKey );
+}
+
+ProjectCache::ProjectCache(AudacityProject &project)
+   : mProject{ project }
+{
+}
+
+ProjectCache::~ProjectCache() = default;
+
+//! @return total bytes of items in the table, or 0 on failure
+static size_t CountBytes(sqlite3 *db)
+{
+   size_t result = 0;
+   sqlite3_stmt *stmt = nullptr;
+   if (sqlite3_prepare_v2(db,
+      "SELECT COALESCE(SUM(length(data)), 0) FROM cachedata;",
+      -1, &stmt, nullptr) != SQLITE_OK)
+      return result;
+   if (sqlite3_step(stmt) == SQLITE_ROW)
+      result = sqlite3_column_int64(stmt, 0);
+   sqlite3_finalize(stmt);
+   return result;
+}
+
+sqlite3 *ProjectCache::DB()
+{
+   auto &pConnection = ConnectionPtr::Get(mProject).mpConnection;
+   if (!pConnection)
+      return nullptr;
+   const auto db = pConnection->DB();
+   if (!db || db == mDB)
+      return db;
+
+   mDB = nullptr;
+   char *errmsg = nullptr;
+   if (sqlite3_exec(db, CacheSchema, nullptr, nullptr, &errmsg) != SQLITE_OK)
+   {
+      wxLogDebug(wxT("ProjectCache - SQLITE error %s"), errmsg);
+      sqlite3_free(errmsg);
+      return nullptr;
+   }
+
+   mBytes = CountBytes(db);
+   mDB = db;
+   return db;
+}
+
+auto ProjectCache::Read(int64_t group, int64_t item) -> Data
+{
+   if (const auto iter = mPending.find({ group, item });
+       iter != mPending.end())
+      return iter->second;
+   // Rows of the group may remain until the next flush
+   if (mInvalidated.count(group))
+      return {};
+
+   Data result;
+   try {
+      const auto db = DB();
+      if (!db)
+         return result;
+      auto &conn = *ConnectionPtr::Get(mProject).mpConnection;
+
+      // Prepare and cache statements...automatically finalized at DB close
+      sqlite3_stmt *stmt = conn.Prepare(DBConnection::GetCachedData,
+         "SELECT data FROM cachedata WHERE groupid = ?1 AND itemid = ?2;");
+      sqlite3_bind_int64(stmt, 1, group);
+      sqlite3_bind_int64(stmt, 2, item);
+      if (sqlite3_step(stmt) == SQLITE_ROW) {
+         const auto data =
+            static_cast<const char *>(sqlite3_column_blob(stmt, 0));
+         result.assign(data, data + sqlite3_column_bytes(stmt, 0));
+      }
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+   }
+   catch (...) {
+      // Such as failure to prepare; try again from the start next time
+      mDB = nullptr;
+      result.clear();
+   }
+
+   if (!result.empty()) {
+      // Update the time of access later, not making a write now
+      mTouched.emplace(group, item);
+      ScheduleFlush();
+   }
+   return result;
+}
+
+void ProjectCache::Write(int64_t group, int64_t item,
+   const void *data, size_t size, size_t budget)
+{
+   if (mPendingBytes + size <= budget) {
+      const auto bytes = static_cast<const char *>(data);
+      auto &pending = mPending[{ group, item }];
+      mPendingBytes = mPendingBytes - pending.size() + size;
+      pending.assign(bytes, bytes + size);
+      mBudget = budget;
+   }
+
+   // Schedule also when the queue is full, because a flush may have failed
+   if (!mPending.empty())
+      ScheduleFlush();
+}
+
+void ProjectCache::ScheduleFlush()
+{
+   if (mFlushScheduled)
+      return;
+   mFlushScheduled = true;
+   BasicUI::CallAfter([wThis = weak_from_this()]{
+      if (auto pThis = wThis.lock())
+         pThis->Flush();
+   });
+}
+
+void ProjectCache::Flush()
+{
+   mFlushScheduled = false;
+   if (mPending.empty() && mInvalidated.empty() && mTouched.empty())
+      return;
+   try {
+      const auto db = DB();
+      if (!db) {
+         // No file to store into
+         mPending.clear();
+         mPendingBytes = 0;
+         mInvalidated.clear();
+         mTouched.clear();
+         return;
+      }
+      // On failure, as when another connection is writing, keep everything
+      // for the next flush
+      if (!Store(db))
+         return;
+      mPending.clear();
+      mPendingBytes = 0;
+      mInvalidated.clear();
+      mTouched.clear();
+      if (mBytes > mBudget)
+         Trim(mBudget);
+   }
+   catch (...) {
+      mDB = nullptr;
+   }
+}
+
+bool ProjectCache::Store(sqlite3 *db)
+{
+   auto &conn = *ConnectionPtr::Get(mProject).mpConnection;
+   // Prepare and cache statements...automatically finalized at DB close
+   sqlite3_stmt *const deleteStmt = conn.Prepare(DBConnection::DeleteCachedData,
+      "DELETE FROM cachedata WHERE groupid = ?1;");
+   sqlite3_stmt *const touchStmt = conn.Prepare(DBConnection::TouchCachedData,
+      "UPDATE cachedata SET accessed = strftime('%s', 'now')"
+      " WHERE groupid = ?1 AND itemid = ?2;");
+   sqlite3_stmt *const stmt = conn.Prepare(DBConnection::PutCachedData,
+      "INSERT OR REPLACE INTO cachedata (groupid, itemid, accessed, data)"
+      " VALUES(?1, ?2, strftime('%s', 'now'), ?3);");
+
+   const auto step = [db](sqlite3_stmt *statement) {
+      const auto rc = sqlite3_step(statement);
+      sqlite3_clear_bindings(statement);
+      sqlite3_reset(statement);
+      if (rc == SQLITE_DONE)
+         return true;
+      wxLogDebug(wxT("ProjectCache::Store - SQLITE error %s"),
+         sqlite3_errmsg(db));
+      return false;
+   };
+
+   // One transaction for all, nested in any that the project has begun
+   if (sqlite3_exec(db, "SAVEPOINT ProjectCache;",
+      nullptr, nullptr, nullptr) != SQLITE_OK)
+      return false;
+   size_t bytes = 0;
+   const auto storeAll = [&]{
+      // Invalidations first, because items may be written again after them
+      for (const auto group : mInvalidated) {
+         sqlite3_bind_int64(deleteStmt, 1, group);
+         if (!step(deleteStmt))
+            return false;
+      }
+      for (const auto &[group, item] : mTouched) {
+         sqlite3_bind_int64(touchStmt, 1, group);
+         sqlite3_bind_int64(touchStmt, 2, item);
+         if (!step(touchStmt))
+            return false;
+      }
+      for (const auto &[keys, data] : mPending) {
+         sqlite3_bind_int64(stmt, 1, keys.first);
+         sqlite3_bind_int64(stmt, 2, keys.second);
+         sqlite3_bind_blob(stmt, 3, data.data(), data.size(), SQLITE_STATIC);
+         if (!step(stmt))
+            return false;
+         bytes += data.size();
+      }
+      return true;
+   };
+
+   if (storeAll() && sqlite3_exec(db, "RELEASE ProjectCache;",
+      nullptr, nullptr, nullptr) == SQLITE_OK) {
+      if (!mInvalidated.empty())
+         mBytes = CountBytes(db);
+      else
+         // A replaced item is counted twice until the next recount
+         mBytes += bytes;
+      return true;
+   }
+   sqlite3_exec(db, "ROLLBACK TO ProjectCache; RELEASE ProjectCache;",
+      nullptr, nullptr, nullptr);
+   return false;
+}
+
+void ProjectCache::Invalidate(int64_t group)
+{
+   const auto first = mPending.lower_bound(
+      { group, std::numeric_limits<int64_t>::min() });
+   auto last = first;
+   for (; last != mPending.end() && last->first.first == group; ++last)
+      mPendingBytes -= last->second.size();
+   mPending.erase(first, last);
+   mTouched.erase(
+      mTouched.lower_bound({ group, std::numeric_limits<int64_t>::min() }),
+      mTouched.upper_bound({ group, std::numeric_limits<int64_t>::max() }));
+
+   // Delete the rows at the next flush, not making a write now
+   mInvalidated.insert(group);
+   ScheduleFlush();
+}
+
+void ProjectCache::Trim(size_t budget)
+{
+   // Discard the oldest items until three quarters of the budget remain, so
+   // that trimming is not needed again at every write
+   const int64_t target = budget - budget / 4;
+   int64_t bytes = CountBytes(mDB);
+   std::vector<std::pair<int64_t, int64_t>> victims;
+
+   sqlite3_stmt *stmt = nullptr;
+   if (sqlite3_prepare_v2(mDB,
+      "SELECT groupid, itemid, length(data) FROM cachedata"
+      " ORDER BY accessed;",
+      -1, &stmt, nullptr) != SQLITE_OK)
+      return;
+   while (bytes > target && sqlite3_step(stmt) == SQLITE_ROW) {
+      victims.emplace_back(
+         sqlite3_column_int64(stmt, 0), sqlite3_column_int64(stmt, 1));
+      bytes -= sqlite3_column_int64(stmt, 2);
+   }
+   sqlite3_finalize(stmt);
+
+   if (sqlite3_prepare_v2(mDB,
+      "DELETE FROM cachedata WHERE groupid = ?1 AND itemid = ?2;",
+      -1, &stmt, nullptr) != SQLITE_OK)
+      return;
+   for (const auto &[group, item] : victims) {
+      sqlite3_bind_int64(stmt, 1, group);
+      sqlite3_bind_int64(stmt, 2, item);
+      sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+   }
+   sqlite3_finalize(stmt);
+   mBytes = std::max<int64_t>(0, bytes);
+}
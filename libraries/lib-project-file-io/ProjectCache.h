@@ -0,0 +1,98 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ProjectCache.h
+  @brief Keeps data derived from a project in a side table of its file
+
+**********************************************************************/
+#ifndef __AUDACITY_PROJECT_CACHE__
+#define __AUDACITY_PROJECT_CACHE__
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "ClientData.h"
+
+class AudacityProject;
+struct sqlite3;
+
+//! Stores blobs that are expensive to compute from the project's samples,
+//! such as spectrogram columns, so that they survive closing the project
+/*!
+ Items are identified by a group and an item key, both chosen by the client.
+ A group should be derived from the contents that the items depend on, so
+ that it can be invalidated all at once when those contents change.
+
+ The table is created on first use and is not part of the project format;
+ it is not copied when the project is compacted or saved to a new file.
+ Errors are never reported, because everything stored can be computed again.
+
+ Reading only reads the file.  Writes, invalidations, and the times of
+ reading are queued in memory, and stored at idle time in one transaction, so
+ that a client drawing the screen does not wait for the file.
+ */
+class PROJECT_FILE_IO_API ProjectCache final
+   : public ClientData::Base
+   , public std::enable_shared_from_this<ProjectCache>
+{
+public:
+   using Data = std::vector<char>;
+
+   static ProjectCache &Get(AudacityProject &project);
+
+   explicit ProjectCache(AudacityProject &project);
+   ~ProjectCache() override;
+
+   ProjectCache(const ProjectCache&) = delete;
+   ProjectCache &operator=(const ProjectCache&) = delete;
+
+   //! @return the stored item, or empty if there is none
+   Data Read(int64_t group, int64_t item);
+
+   //! Queue an item to be stored, replacing any with the same keys; when it
+   //! is stored, discard the least recently read or written items as needed
+   //! to stay within `budget`
+   /*! Nothing is queued while the items queued already use `budget` */
+   void Write(int64_t group, int64_t item,
+      const void *data, size_t size, size_t budget);
+
+   //! Queue the discarding of all items of the group, which are not read
+   //! again meanwhile
+   void Invalidate(int64_t group);
+
+   //! Store the queued items, invalidations, and times of reading now
+   void Flush();
+
+private:
+   //! @return the project's database, with the table created, or null
+   sqlite3 *DB();
+   void ScheduleFlush();
+   bool Store(sqlite3 *db);
+   void Trim(size_t budget);
+
+   AudacityProject &mProject;
+
+   //! Items written but not yet stored
+   std::map<std::pair<int64_t, int64_t>, Data> mPending;
+   size_t mPendingBytes{ 0 };
+   //! Groups invalidated but not yet deleted
+   std::set<int64_t> mInvalidated;
+   //! Items read whose time of access is not yet updated
+   std::set<std::pair<int64_t, int64_t>> mTouched;
+   //! The budget given to the latest Write()
+   size_t mBudget{ 0 };
+   bool mFlushScheduled{ false };
+
+   //! The database in which the table was last found or created
+   sqlite3 *mDB{};
+   //! Total bytes of items in mDB, as last known
+   size_t mBytes{ 0 };
+};
+
+#endif
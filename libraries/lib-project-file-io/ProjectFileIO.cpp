@@ -11,9 +11,11 @@ Paul Licameli split from AudacityProject.cpp
 #include "ProjectFileIO.h"
 
 #include <atomic>
+#include <chrono>
 #include <sqlite3.h>
 #include <optional>
 #include <cstring>
+#include <thread>
 
 #include <wx/crt.h>
 #include <wx/log.h>
@@ -21,6 +23,7 @@ Paul Licameli split from AudacityProject.cpp
 #include <wx/utils.h>
 
 #include "ActiveProjects.h"
+#include "BinaryDelta.h"
 #include "CodeConversions.h"
 #include "DBConnection.h"
 #include "FileNames.h"
@@ -86,6 +89,15 @@ static const int ProjectFileID = PACK('A', 'U', 'D', 'Y');
 // DV: ProjectFileVersion is now evaluated at runtime
 // static const int ProjectFileVersion = PACK(3, 0, 0, 0);
 
+// Autosave documents written as deltas can't be read by older versions, which
+// would find only the base
+static const ProjectFormatVersion AutoSaveDeltaFormatVersion = { 3, 6, 0, 0 };
+
+// Limits on the chain of autosave deltas, before the next document is written
+// in full: number of deltas, and their total size as a fraction of the base
+static constexpr int64_t MaxAutoSaveDeltas = 100;
+static constexpr size_t AutoSaveDeltaRatio = 2;
+
 // Navigation:
 //
 // Bindings are marked out in the code by, e.g. 
@@ -99,6 +111,9 @@ static const char *ProjectFileSchema =
    //
    // See the CMakeList.txt for the SQLite lib for more
    // settings.
+   //
+   // auto_vacuum must precede creation of the tables
+   "PRAGMA <schema>.auto_vacuum = INCREMENTAL;"
    "PRAGMA <schema>.application_id = %d;"
    "PRAGMA <schema>.user_version = %u;"
    ""
@@ -539,6 +554,15 @@ bool ProjectFileIO::OpenConnection(FilePath fileName /* = {}  */)
 
    SetFileName(fileName);
 
+   // Release any space left unused when the file was last closed
+   const auto name = fileName;
+   curConn->StartCompaction(
+      [name](const DBConnection::CompactionProgress &progress){
+         if (progress.done && progress.reclaimedPages > 0)
+            wxLogInfo("Compaction of %s released %lld bytes", name,
+               static_cast<long long>(progress.ReclaimedBytes()));
+      });
+
    return true;
 }
 
@@ -925,6 +949,10 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
    if (!pConn)
       return false;
 
+   // Copy the rows of deferred writes too
+   if (!pConn->FlushDeferred())
+      return false;
+
    // Get access to the active tracklist
    auto pProject = &mProject;
 
@@ -1209,6 +1237,17 @@ bool ProjectFileIO::ShouldCompact(const std::vector<const TrackList *> &tracks)
    // Remember if we had unused blocks in the project file
    mHadUnused = (blockcount > active.size());
 
+   // Incremental compaction takes time only in proportion to the space
+   // released, so it is worth doing whenever there is any
+   if (auto pConn = CurrConn().get(); pConn && pConn->CanCompactIncrementally())
+   {
+      int64_t freePages = 0;
+      GetValue("PRAGMA freelist_count;", freePages);
+      wxLogDebug(wxT("unused blocks %d free pages %lld"),
+         mHadUnused, static_cast<long long>(freePages));
+      return mHadUnused || freePages > 0;
+   }
+
    // Let's make a percentage...should be plenty of head room
    current *= 100;
 
@@ -1439,6 +1478,13 @@ void ProjectFileIO::Compact(
       }
    }
 
+   if (CompactIncrementally(tracks))
+   {
+      // Remember that we compacted
+      mWasCompacted = true;
+      return;
+   }
+
    wxString origName = mFileName;
    wxString backName = origName + "_compact_back";
    wxString tempName = origName + "_compact_temp";
@@ -1538,6 +1584,81 @@ void ProjectFileIO::Compact(
    return;
 }
 
+bool ProjectFileIO::CompactIncrementally(
+   const std::vector<const TrackList *> &tracks)
+{
+   auto pConn = CurrConn().get();
+   // Files made by older versions require the copy
+   if (!pConn || !pConn->CanCompactIncrementally())
+      return false;
+
+   // Make the same contents that CopyTo() would in a new file, but in place
+   if (!tracks.empty())
+   {
+      BlockIDs blockids;
+      for (auto pTracks : tracks)
+         if (pTracks)
+            WaveTrackUtilities::InspectBlocks(*pTracks, {}, &blockids);
+
+      ProjectSerializer doc;
+      WriteXMLHeader(doc);
+      WriteXML(doc, false, tracks[0]);
+
+      TransactionScope transaction(mProject, "Compact");
+
+      // Don't set mRecovered if any were deleted
+      const bool recovered = mRecovered;
+      const bool deleted = DeleteBlocks(blockids, true);
+      mRecovered = recovered;
+      if (!deleted)
+         return false;
+
+      // See CopyTo() about temporary projects
+      if (!WriteDoc(IsTemporary() ? "autosave" : "project", doc))
+         return false;
+      if (!IsTemporary() && !AutoSaveDelete())
+         return false;
+
+      if (!transaction.Commit())
+         return false;
+   }
+
+   // Now release the space of the deleted blocks to the file system, without
+   // blocking
+   const auto name = mFileName;
+   return pConn->StartCompaction(
+      [name](const DBConnection::CompactionProgress &progress){
+         if (progress.done)
+            wxLogInfo("Compaction of %s released %lld bytes", name,
+               static_cast<long long>(progress.ReclaimedBytes()));
+      });
+}
+
+void ProjectFileIO::WaitForCompaction()
+{
+   auto pConn = CurrConn().get();
+   if (!pConn || !pConn->IsCompacting())
+      return;
+
+   using namespace BasicUI;
+   auto progress = MakeProgress(
+      XO("Progress"), XO("Compacting project"), ProgressShowCancel);
+   while (pConn->IsCompacting())
+   {
+      using namespace std::chrono;
+      std::this_thread::sleep_for(50ms);
+      const auto stats = pConn->GetCompactionProgress();
+      if (progress->Poll(stats.reclaimedPages,
+         stats.reclaimedPages + stats.remainingPages) !=
+            ProgressResult::Success)
+      {
+         // The rest is done when the file is next opened
+         pConn->StopCompaction();
+         break;
+      }
+   }
+}
+
 bool ProjectFileIO::WasCompacted()
 {
    return mWasCompacted;
@@ -1601,6 +1722,9 @@ void ProjectFileIO::SetFileName(const FilePath &fileName)
 {
    auto &project = mProject;
 
+   // Another file may have another autosave document
+   mAutoSaveChain = {};
+
    if (!fileName.empty() && fileName != mFileName)
    {
       BasicUI::CallAfter(
@@ -1791,7 +1915,7 @@ bool ProjectFileIO::AutoSave(bool recording)
    WriteXMLHeader(autosave);
    WriteXML(autosave, recording);
 
-   if (WriteDoc("autosave", autosave))
+   if (WriteAutoSave(autosave))
    {
       mModified = true;
       return true;
@@ -1809,6 +1933,7 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
       db = DB();
    }
 
+   // Deltas also go
    rc = sqlite3_exec(db, "DELETE FROM autosave;", nullptr, nullptr, nullptr);
    if (rc != SQLITE_OK)
    {
@@ -1821,6 +1946,12 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
       return false;
    }
 
+   // If there were deltas, let older versions open the file again, unless
+   // something else requires the newer version
+   if (sqlite3_changes(db) > 1 && db == DB())
+      (void) UpdateFormatVersion();
+   mAutoSaveChain = {};
+
    mModified = false;
 
    return true;
@@ -1832,10 +1963,40 @@ bool ProjectFileIO::WriteDoc(const char *table,
 {
    auto db = DB();
 
+   // The document may refer to rows of deferred writes, which must not be
+   // committed after it
+   if (!GetConnection().FlushDeferred())
+   {
+      SetError(XO("Failed to write sample blocks"));
+      return false;
+   }
+
    TransactionScope transaction(mProject, "UpdateProject");
 
    int rc;
 
+   // A new autosave base makes any deltas obsolete
+   if (strcmp(table, "autosave") == 0)
+   {
+      mAutoSaveChain = {};
+
+      char sql[256];
+      sqlite3_snprintf(sizeof(sql), sql,
+         "DELETE FROM %s.autosave WHERE id > 1;", schema);
+      rc = sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
+      if (rc != SQLITE_OK)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.query", sql);
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "ProjectGileIO::WriteDoc::deltas");
+
+         SetDBError(
+            XO("Failed to update the project file.\nThe following command failed:\n\n%s")
+               .Format(sql));
+         return false;
+      }
+   }
+
    // For now, we always use an ID of 1. This will replace the previously
    // written row every time.
    char sql[256];
@@ -1973,9 +2134,24 @@ bool ProjectFileIO::WriteDoc(const char *table,
    if (!writeStream("doc", data))
       return false;
 
-   const auto requiredVersion =
+   if (!UpdateFormatVersion())
+      return false;
+
+   return transaction.Commit();
+}
+
+bool ProjectFileIO::UpdateFormatVersion()
+{
+   auto requiredVersion =
       ProjectFormatExtensionsRegistry::Get().GetRequiredVersion(mProject);
 
+   int64_t hasDeltas = 0;
+   if (requiredVersion < AutoSaveDeltaFormatVersion &&
+       GetValue("SELECT EXISTS(SELECT 1 FROM main.autosave WHERE id > 1);",
+          hasDeltas, true) &&
+       hasDeltas)
+      requiredVersion = AutoSaveDeltaFormatVersion;
+
    const wxString setVersionSql =
       wxString::Format("PRAGMA user_version = %u", requiredVersion.GetPacked());
 
@@ -1984,13 +2160,198 @@ bool ProjectFileIO::WriteDoc(const char *table,
       // DV: Very unlikely case.
       // Since we need to improve the error messages in the future, let's use
       // the generic message for now, so no new strings are needed
-      reportError(setVersionSql);
+      SetDBError(
+         XO("Failed to update the project file.\nThe following command failed:\n\n%s")
+            .Format(setVersionSql));
       return false;
    }
 
+   return true;
+}
+
+bool ProjectFileIO::WriteAutoSave(const ProjectSerializer &autosave)
+{
+   const MemoryStream &dict = autosave.GetDict();
+   const MemoryStream &data = autosave.GetData();
+   const auto pData = static_cast<const uint8_t *>(data.GetData());
+   const auto size = data.GetSize();
+   auto &chain = mAutoSaveChain;
+
+   // Usually an edit changes a small part of the document, so write only
+   // the difference, until the deltas would make recovery too slow
+   if (chain.nextId > 0 && chain.nextId < 2 + MaxAutoSaveDeltas)
+   {
+      const auto delta = BinaryDelta::Encode(
+         chain.doc.data(), chain.doc.size(), pData, size);
+      if (chain.deltaBytes + delta.size() <=
+          chain.baseSize / AutoSaveDeltaRatio)
+      {
+         // The static dictionary only grows
+         const bool dictChanged = dict.GetSize() != chain.dictSize;
+         if (!WriteAutoSaveDelta(
+            chain.nextId, dictChanged ? &dict : nullptr, delta))
+            return false;
+
+         chain.doc.assign(pData, pData + size);
+         chain.dictSize = dict.GetSize();
+         chain.deltaBytes += delta.size();
+         ++chain.nextId;
+         return true;
+      }
+   }
+
+   // Write a new base
+   if (!WriteDoc("autosave", autosave))
+      return false;
+
+   chain.doc.assign(pData, pData + size);
+   chain.dictSize = dict.GetSize();
+   chain.baseSize = size;
+   chain.deltaBytes = 0;
+   chain.nextId = 2;
+   return true;
+}
+
+bool ProjectFileIO::WriteAutoSaveDelta(int64_t id,
+   const MemoryStream *pDict, const std::vector<uint8_t> &delta)
+{
+   auto db = DB();
+
+   // As in WriteDoc()
+   if (!GetConnection().FlushDeferred())
+   {
+      SetError(XO("Failed to write sample blocks"));
+      return false;
+   }
+
+   TransactionScope transaction(mProject, "UpdateProject");
+
+   const char *sql =
+      "INSERT INTO main.autosave(id, dict, doc) VALUES(?1, ?2, ?3);";
+
+   sqlite3_stmt *stmt = nullptr;
+   auto cleanup = finally([&]
+   {
+      if (stmt)
+      {
+         sqlite3_finalize(stmt);
+      }
+   });
+
+   int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.query", sql);
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "ProjectGileIO::WriteAutoSaveDelta::prepare");
+
+      SetDBError(
+         XO("Unable to prepare project file command:\n\n%s").Format(sql)
+      );
+      return false;
+   }
+
+   // A null dictionary means, unchanged from the previous row
+   if (sqlite3_bind_int64(stmt, 1, id) ||
+       (pDict
+          ? sqlite3_bind_blob64(stmt, 2,
+               pDict->GetData(), pDict->GetSize(), SQLITE_STATIC)
+          : sqlite3_bind_null(stmt, 2)) ||
+       sqlite3_bind_blob64(stmt, 3,
+          delta.data(), delta.size(), SQLITE_STATIC))
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.query", sql);
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "ProjectGileIO::WriteAutoSaveDelta::bind");
+
+      SetDBError(XO("Unable to bind to blob"));
+      return false;
+   }
+
+   rc = sqlite3_step(stmt);
+   if (rc != SQLITE_DONE)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.query", sql);
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "ProjectGileIO::WriteAutoSaveDelta::step");
+
+      SetDBError(
+         XO("Failed to update the project file.\nThe following command failed:\n\n%s")
+            .Format(sql));
+      return false;
+   }
+
+   // Finalize the statement before committing the transaction
+   sqlite3_finalize(stmt);
+   stmt = nullptr;
+
+   // The first delta changes the version required to open the file
+   if (id == 2 && !UpdateFormatVersion())
+      return false;
+
    return transaction.Commit();
 }
 
+bool ProjectFileIO::DecodeAutoSave()
+{
+   const char *sql = "SELECT dict, doc FROM main.autosave ORDER BY id;";
+
+   sqlite3_stmt *stmt = nullptr;
+   auto cleanup = finally([&]
+   {
+      if (stmt)
+      {
+         sqlite3_finalize(stmt);
+      }
+   });
+
+   int rc = sqlite3_prepare_v2(DB(), sql, -1, &stmt, nullptr);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.query", sql);
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "ProjectGileIO::DecodeAutoSave::prepare");
+
+      SetDBError(
+         XO("Unable to prepare project file command:\n\n%s").Format(sql)
+      );
+      return false;
+   }
+
+   const auto column = [&stmt](int index) {
+      const auto data =
+         static_cast<const uint8_t *>(sqlite3_column_blob(stmt, index));
+      return std::make_pair(data, data + sqlite3_column_bytes(stmt, index));
+   };
+
+   std::vector<uint8_t> dict, doc, next;
+   bool first = true;
+   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+   {
+      // The last dictionary stored contains all of the earlier ones
+      if (sqlite3_column_type(stmt, 0) != SQLITE_NULL)
+      {
+         const auto [begin, end] = column(0);
+         dict.assign(begin, end);
+      }
+
+      const auto [begin, end] = column(1);
+      if (first)
+         doc.assign(begin, end);
+      else if (BinaryDelta::Apply(
+         doc.data(), doc.size(), begin, end - begin, next))
+         doc.swap(next);
+      else
+         return false;
+      first = false;
+   }
+
+   if (rc != SQLITE_DONE || first)
+      return false;
+
+   dict.insert(dict.end(), doc.begin(), doc.end());
+   return ProjectSerializer::Decode(std::move(dict), this);
+}
+
 ProjectFileIO::
 TentativeConnection::TentativeConnection(ProjectFileIO &projectFileIO)
    : mProjectFileIO{ projectFileIO }
@@ -2065,11 +2426,30 @@ auto ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
       return {};
    else
    {
-      // Load 'er up
-      BufferedProjectBlobStream stream(
-         DB(), "main", useAutosave ? "autosave" : "project", rowId);
+      int64_t deltas = 0;
+      if (useAutosave)
+         GetValue(
+            "SELECT COUNT(1) FROM main.autosave WHERE id > 1;", deltas, true);
 
-      success = ProjectSerializer::Decode(stream, this);
+      // Let the factory read the metadata of all blocks at once, rather than
+      // with one query for each waveblock tag
+      {
+         const auto pFactory =
+            WaveTrackFactory::Get( mProject ).GetSampleBlockFactory();
+         pFactory->BeginBulkLoad();
+         auto cleanup = finally([&]{ pFactory->EndBulkLoad(); });
+
+         if (deltas > 0)
+            success = DecodeAutoSave();
+         else
+         {
+            // Load 'er up
+            BufferedProjectBlobStream stream(
+               DB(), "main", useAutosave ? "autosave" : "project", rowId);
+
+            success = ProjectSerializer::Decode(stream, this);
+         }
+      }
 
       if (!success)
       {
@@ -2578,6 +2958,9 @@ int64_t ProjectFileIO::GetTotalUsage()
 //
 int64_t ProjectFileIO::GetDiskUsage(DBConnection &conn, SampleBlockID blockid /* = 0 */)
 {
+   // Count rows of deferred writes too; failures are reported elsewhere
+   conn.FlushDeferred();
+
    sqlite3_stmt* stmt = nullptr;
 
    if (blockid == 0)
@@ -14,6 +14,7 @@ Paul Licameli split from AudacityProject.h
 #include <memory>
 #include <optional>
 #include <unordered_set>
+#include <vector>
 
 #include <wx/event.h>
 
@@ -29,6 +30,7 @@ struct sqlite3_value;
 
 class AudacityProject;
 class DBConnection;
+class MemoryStream;
 struct DBConnectionErrors;
 class ProjectSerializer;
 class SqliteSampleBlock;
@@ -202,9 +204,17 @@ public:
    };
 
    // Remove all unused space within a project file
+   /*
+    If the file permits, unused blocks are deleted at once, and the space is
+    released to the file system in the background, else the file is copied
+    */
    void Compact(
       const std::vector<const TrackList *> &tracks, bool force = false);
 
+   // Show progress until any background compaction finishes.  The user may
+   // cancel, leaving the rest to be done when the file is next opened.
+   void WaitForCompaction();
+
    // The last compact check did actually compact the project file if true
    bool WasCompacted();
 
@@ -275,6 +285,16 @@ private:
    // Write project or autosave XML (binary) documents
    bool WriteDoc(const char *table, const ProjectSerializer &autosave, const char *schema = "main");
 
+   // Write the autosave document in full, or as a delta from the previous
+   bool WriteAutoSave(const ProjectSerializer &autosave);
+   bool WriteAutoSaveDelta(int64_t id,
+      const MemoryStream *pDict, const std::vector<uint8_t> &delta);
+   // Reconstruct the autosave document from its base and deltas, and load it
+   bool DecodeAutoSave();
+
+   // Store the minimum version of Audacity that can open the file
+   bool UpdateFormatVersion();
+
    // Application defined function to verify blockid exists is in set of blockids
    static void InSet(sqlite3_context *context, int argc, sqlite3_value **argv);
 
@@ -301,6 +321,9 @@ private:
 
    bool ShouldCompact(const std::vector<const TrackList *> &tracks);
 
+   // Compact without copying the file; return false if not possible
+   bool CompactIncrementally(const std::vector<const TrackList *> &tracks);
+
 private:
    Connection &CurrConn();
 
@@ -329,6 +352,18 @@ private:
    // Project had unused blocks during last Compact()
    bool mHadUnused;
 
+   // The autosave document is stored as a base in the row with id 1, and
+   // deltas in following rows, each from the document before
+   struct AutoSaveChain {
+      // Most recent document, from which the next delta is made
+      std::vector<uint8_t> doc;
+      size_t dictSize{ 0 };
+      size_t baseSize{ 0 };
+      size_t deltaBytes{ 0 };
+      // 0 when the next document must be written in full
+      int64_t nextId{ 0 };
+   } mAutoSaveChain;
+
    Connection mPrevConn;
    FilePath mPrevFileName;
    bool mPrevTemporary;
@@ -17,6 +17,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <mutex>
 #include <wx/ustring.h>
 #include <codecvt>
@@ -221,14 +222,14 @@ public:
       mHandlers.pop_back();
    }
 
-   void WriteAttr(const std::string_view& name, std::string value)
+   void WriteAttr(const std::string_view& name, std::string_view value)
    {
       assert(mInTag);
 
       if (!mInTag)
          return;
 
-      mAttributes.emplace_back(name, CacheString(std::move(value)));
+      mAttributes.emplace_back(name, CacheString(value));
    }
 
    template <typename T> void WriteAttr(const std::string_view& name, T value)
@@ -241,16 +242,16 @@ public:
       mAttributes.emplace_back(name, XMLAttributeValueView(value));
    }
 
-   void WriteData(std::string value)
+   void WriteData(std::string_view value)
    {
       if (mInTag)
          EmitStartTag();
 
       if (XMLTagHandler* const handler = mHandlers.back())
-         handler->HandleXMLContent(CacheString(std::move(value)));
+         handler->HandleXMLContent(value);
    }
 
-   void WriteRaw(std::string)
+   void WriteRaw(std::string_view)
    {
       // This method is intentionally left empty.
       // The only data that is serialized by FT_Raw
@@ -295,15 +296,20 @@ private:
          }
       }
 
-      mStringsCache.clear();
+      // Keep the strings, and their capacities, for reuse by the next tag
+      mStringsUsed = 0;
       mAttributes.clear();
       mInTag = false;
    }
 
-   std::string_view CacheString(std::string string)
+   std::string_view CacheString(std::string_view string)
    {
-      mStringsCache.emplace_back(std::move(string));
-      return mStringsCache.back();
+      // Deque, so that earlier views remain valid as the cache grows
+      if (mStringsUsed == mStringsCache.size())
+         mStringsCache.emplace_back();
+      auto& cached = mStringsCache[mStringsUsed++];
+      cached.assign(string.data(), string.size());
+      return cached;
    }
 
    XMLTagHandler* mBaseHandler;
@@ -313,6 +319,7 @@ private:
    std::string_view mCurrentTagName;
 
    std::deque<std::string> mStringsCache;
+   size_t mStringsUsed { 0 };
    AttributesList mAttributes;
 
    bool mInTag { false };
@@ -325,7 +332,7 @@ private:
 // }
 
 template<typename BaseCharType>
-std::string FastStringConvert(const void* bytes, int bytesCount)
+void FastStringConvert(const void* bytes, int bytesCount, std::string& result)
 {
    constexpr int charSize = sizeof(BaseCharType);
 
@@ -340,9 +347,15 @@ std::string FastStringConvert(const void* bytes, int bytesCount)
       { return static_cast<std::make_unsigned_t<BaseCharType>>(c) < 0x7f; });
 
    if (isAscii)
-      return std::string(begin, end);
-   
-   return std::wstring_convert<std::codecvt_utf8<BaseCharType>, BaseCharType>()
+   {
+      // Reuses the capacity of result
+      result.resize(end - begin);
+      std::transform(begin, end, result.begin(),
+         [](BaseCharType c) { return static_cast<char>(c); });
+      return;
+   }
+
+   result = std::wstring_convert<std::codecvt_utf8<BaseCharType>, BaseCharType>()
       .to_bytes(begin, end);
 }
 } // namespace
@@ -519,6 +532,44 @@ bool ProjectSerializer::DictChanged() const
    return mDictChanged;
 }
 
+namespace {
+//! Reads dictionary and document reconstructed in memory, in one buffer
+class BufferedProjectMemoryStream : public BufferedStreamReader
+{
+public:
+   explicit BufferedProjectMemoryStream(std::vector<uint8_t> bytes)
+       : BufferedStreamReader(32 * 1024)
+       , mBytes(std::move(bytes))
+   {
+   }
+
+protected:
+   bool HasMoreData() const override
+   {
+      return mOffset < mBytes.size();
+   }
+
+   size_t ReadData(void* buffer, size_t maxBytes) override
+   {
+      maxBytes = std::min(maxBytes, mBytes.size() - mOffset);
+      memcpy(buffer, mBytes.data() + mOffset, maxBytes);
+      mOffset += maxBytes;
+      return maxBytes;
+   }
+
+private:
+   const std::vector<uint8_t> mBytes;
+   size_t mOffset { 0 };
+};
+}
+
+bool ProjectSerializer::Decode(
+   std::vector<uint8_t> bytes, XMLTagHandler* handler)
+{
+   BufferedProjectMemoryStream stream{ std::move(bytes) };
+   return Decode(stream, handler);
+}
+
 // See ProjectFileIO::LoadProject() for explanation of the blockids arg
 bool ProjectSerializer::Decode(BufferedStreamReader& in, XMLTagHandler* handler)
 {
@@ -527,33 +578,42 @@ bool ProjectSerializer::Decode(BufferedStreamReader& in, XMLTagHandler* handler)
 
    XMLTagHandlerAdapter adapter(handler);
 
+   // Buffers reused for all strings, growing to the longest
    std::vector<char> bytes;
+   std::string string;
+
+   // Storage for the names, which must outlive any scope that refers to them,
+   // because the adapter may hold a view of a tag name across FT_Pop
+   std::deque<std::string> names;
    IdMap mIds;
    std::vector<IdMap> mIdStack;
    char mCharSize = 0;
 
-   mIds.clear();
-
    struct Error{}; // exception type for short-range try/catch
    auto Lookup = [&mIds]( UShort id ) -> std::string_view
    {
-      auto iter = mIds.find( id );
-      if (iter == mIds.end())
+      // A default constructed view, unlike any name, has null data
+      if (id >= mIds.size() || mIds[id].data() == nullptr)
       {
          throw Error{};
       }
 
-      return iter->second;
+      return mIds[id];
    };
 
    int64_t stringsCount = 0;
    int64_t stringsLength = 0;
 
-   auto ReadString = [&mCharSize, &in, &bytes, &stringsCount, &stringsLength](int len) -> std::string
+   auto ReadBytes = [&in, &bytes](int len)
+   {
+      bytes.resize( len );
+      in.Read( bytes.data(), len );
+   };
+
+   // Result is valid until the next call
+   auto ReadString = [&mCharSize, &string, &bytes, &ReadBytes, &stringsCount, &stringsLength](int len) -> std::string_view
    {
-      bytes.reserve( len );
-      auto data = bytes.data();
-      in.Read( data, len );
+      ReadBytes( len );
 
       stringsCount++;
       stringsLength += len;
@@ -561,20 +621,24 @@ bool ProjectSerializer::Decode(BufferedStreamReader& in, XMLTagHandler* handler)
       switch (mCharSize)
       {
          case 1:
-            return std::string(bytes.data(), len);
+            string.assign(bytes.data(), len);
+            break;
 
          case 2:
-            return FastStringConvert<char16_t>(bytes.data(), len);
+            FastStringConvert<char16_t>(bytes.data(), len, string);
+            break;
 
          case 4:
-            return FastStringConvert<char32_t>(bytes.data(), len);
+            FastStringConvert<char32_t>(bytes.data(), len, string);
+            break;
 
          default:
             wxASSERT_MSG(false, wxT("Characters size not 1, 2, or 4"));
+            string.clear();
          break;
       }
 
-      return {};
+      return string;
    };
 
    try
@@ -587,14 +651,16 @@ bool ProjectSerializer::Decode(BufferedStreamReader& in, XMLTagHandler* handler)
          {
             case FT_Push:
             {
-               mIdStack.push_back(mIds);
+               mIdStack.push_back(std::move(mIds));
                mIds.clear();
             }
             break;
 
             case FT_Pop:
             {
-               mIds = mIdStack.back();
+               if (mIdStack.empty())
+                  throw Error{};
+               mIds = std::move(mIdStack.back());
                mIdStack.pop_back();
             }
             break;
@@ -603,7 +669,9 @@ bool ProjectSerializer::Decode(BufferedStreamReader& in, XMLTagHandler* handler)
             {
                id = ReadUShort( in );
                auto len = ReadUShort( in );
-               mIds[id] = ReadString(len);
+               if (id >= mIds.size())
+                  mIds.resize(id + 1);
+               mIds[id] = names.emplace_back(ReadString(len));
             }
             break;
 
@@ -712,7 +780,9 @@ bool ProjectSerializer::Decode(BufferedStreamReader& in, XMLTagHandler* handler)
             case FT_Raw:
             {
                int len = ReadLength( in );
-               adapter.WriteRaw(ReadString(len));
+               // Not converted, because the adapter ignores it
+               ReadBytes(len);
+               adapter.WriteRaw({ bytes.data(), bytes.size() });
             }
             break;
 
@@ -16,8 +16,11 @@
 #include "MemoryStream.h" // member variables
 #include <wx/mstream.h>
 
+#include <cstdint>
 #include <unordered_set>
 #include <unordered_map>
+#include <string_view>
+#include <vector>
 
 #include "Identifier.h"
 
@@ -30,7 +33,8 @@ class BufferedStreamReader;
 ///
 
 using NameMap = std::unordered_map<wxString, unsigned short>;
-using IdMap = std::unordered_map<unsigned short, std::string>;
+//! Names of the dictionary in one scope, indexed by id
+using IdMap = std::vector<std::string_view>;
 
 // This class's overrides do NOT throw AudacityException.
 class PROJECT_FILE_IO_API ProjectSerializer final : public XMLWriter
@@ -67,6 +71,8 @@ public:
 
    // Returns empty string if decoding fails
    static bool Decode(BufferedStreamReader& in, XMLTagHandler* handler);
+   //! Decode a dictionary followed by a document, in one buffer
+   static bool Decode(std::vector<uint8_t> bytes, XMLTagHandler* handler);
 
 private:
    void WriteName(const wxString& name);
@@ -13,21 +13,29 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 
 #include "BasicUI.h"
 #include "DBConnection.h"
+#include "Prefs.h"
 #include "ProjectFileIO.h"
 #include "SampleFormat.h"
 #include "AudioSegmentSampleView.h"
+#include "FrameSummary.h"
 #include "XMLTagHandler.h"
 
 #include "SampleBlock.h" // to inherit
+#include "SampleBlockCache.h"
 #include "UndoManager.h"
 #include "UndoTracks.h"
 #include "WaveTrack.h"
 #include "WaveTrackUtilities.h"
+#include "crypto/SHA256.h"
 
 #include "SentryHelper.h"
 #include <wx/log.h>
+#include <wx/thread.h>
 
+#include <algorithm>
+#include <chrono>
 #include <mutex>
+#include <unordered_map>
 
 class SqliteSampleBlockFactory;
 
@@ -83,7 +91,50 @@ public:
 
 private:
    bool IsSilent() const { return mBlockID <= 0; }
+   //! @return the view retained by this block or by the factory's cache,
+   //! or null
+   /*! @param count whether a lookup in the factory's cache counts in its
+    statistics */
+   BlockSampleView FindCachedView(bool count = true);
+   //! Retain the view in this block and the factory's cache
+   void SetCachedView(const BlockSampleView &view);
+   //! Read from the database, not consulting cached views
+   size_t ReadSamples(samplePtr dest,
+                      sampleFormat destformat,
+                      size_t sampleoffset,
+                      size_t numsamples);
    void Load(SampleBlockID sbid);
+
+   //! Fields of a row of the sampleblocks table, other than the blobs
+   struct Metadata {
+      sampleFormat format;
+      double sumMin;
+      double sumMax;
+      double sumRms;
+      size_t sampleBytes;
+   };
+   //! Read metadata from columns of stmt beginning at column
+   static Metadata GetMetadata(sqlite3_stmt *stmt, int column);
+   //! Initialize the fields as Load does, without a query
+   void SetMetadata(SampleBlockID sbid, const Metadata &metadata);
+
+   //! Contents of the row, kept in memory until the writer thread of the
+   //! connection commits it
+   class PendingRow;
+   //! @return whether the row is not yet committed by the writer thread
+   bool IsPending() const;
+   //! If the row is pending, copy from memory as GetBlob would from the row
+   /*!
+    @param column one of GetSamples, GetSummary256, GetSummary64k
+    @return whether the row was pending
+    */
+   bool ReadPending(void *dest,
+                    sampleFormat destformat,
+                    DBConnection::StatementID column,
+                    sampleFormat srcformat,
+                    size_t srcoffset,
+                    size_t srcbytes) const;
+
    bool GetSummary(float *dest,
                    size_t frameoffset,
                    size_t numframes,
@@ -115,6 +166,9 @@ private:
    friend SqliteSampleBlockFactory;
 
    const std::shared_ptr<SqliteSampleBlockFactory> mpFactory;
+   //! Not null if the row was given to the writer thread; assigned only
+   //! before the block is shared
+   std::shared_ptr<PendingRow> mpPending;
    bool mValid{ false };
    bool mLocked = false;
 
@@ -131,11 +185,154 @@ private:
    double mSumMax;
    double mSumRms;
 
+   //! Hash of format and samples, if the factory deduplicates this block
+   std::string mHash;
+
 #if defined(WORDS_BIGENDIAN)
 #error All sample block data is little endian...big endian not yet supported
 #endif
 };
 
+//! A row of sampleblocks, which SqliteSampleBlock::Commit() inserts
+//! immediately, or queues for the writer thread when not in the main thread
+class SqliteSampleBlock::PendingRow final : public DBConnection::DeferredWrite
+{
+public:
+   PendingRow(SqliteSampleBlock &block, Sizes sizes)
+      : mBlockID{ block.mBlockID }
+      , mSampleFormat{ block.mSampleFormat }
+      , mSumMin{ block.mSumMin }
+      , mSumMax{ block.mSumMax }
+      , mSumRms{ block.mSumRms }
+      , mSamples{ std::move(block.mSamples) }
+      , mSummary256{ std::move(block.mSummary256) }
+      , mSummary64k{ std::move(block.mSummary64k) }
+      , mSampleBytes{ block.mSampleBytes }
+      , mSummary256Bytes{ sizes.first }
+      , mSummary64kBytes{ sizes.second }
+   {}
+
+   //! Bind statement parameters, execute, clear bindings and rewind
+   /*! @return result of sqlite3_step */
+   int Insert(sqlite3_stmt *stmt)
+   {
+      // Might return SQLITE_MISUSE which means it's our mistake that we
+      // violated preconditions; should return SQL_OK which is 0
+      if (sqlite3_bind_int64(stmt, 1, mBlockID) ||
+          sqlite3_bind_int(stmt, 2, static_cast<int>(mSampleFormat)) ||
+          sqlite3_bind_double(stmt, 3, mSumMin) ||
+          sqlite3_bind_double(stmt, 4, mSumMax) ||
+          sqlite3_bind_double(stmt, 5, mSumRms) ||
+          sqlite3_bind_blob(stmt, 6, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
+          sqlite3_bind_blob(stmt, 7, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
+          sqlite3_bind_blob(stmt, 8, mSamples.get(), mSampleBytes, SQLITE_STATIC))
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc",
+            std::to_string(sqlite3_errcode(sqlite3_db_handle(stmt))));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::bind");
+
+         wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+      }
+
+      const auto rc = sqlite3_step(stmt);
+
+      // Clear statement bindings and rewind statement
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+      return rc;
+   }
+
+   static const char *InsertSQL()
+   {
+      return
+         "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax,"
+         "                          sumrms, summary256, summary64k, samples)"
+         "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8);";
+   }
+
+   bool Write(sqlite3 *db) override
+   {
+      // The contents are not changed until Committed(), so need no lock
+      sqlite3_stmt *stmt = nullptr;
+      auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+      return
+         sqlite3_prepare_v2(db, InsertSQL(), -1, &stmt, nullptr) == SQLITE_OK
+         && Insert(stmt) == SQLITE_DONE;
+   }
+
+   void Committed() override
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mCommitted = true;
+      mSamples.reset();
+      mSummary256.reset();
+      mSummary64k.reset();
+   }
+
+   size_t Size() const override
+   {
+      return mSampleBytes + mSummary256Bytes + mSummary64kBytes;
+   }
+
+   bool IsCommitted() const
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      return mCommitted;
+   }
+
+   //! @copydoc SqliteSampleBlock::ReadPending
+   bool Read(void *dest,
+             sampleFormat destformat,
+             DBConnection::StatementID column,
+             sampleFormat srcformat,
+             size_t srcoffset,
+             size_t srcbytes) const
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (mCommitted)
+         return false;
+
+      const auto [src, blobbytes] =
+         column == DBConnection::GetSummary256
+            ? std::pair{ mSummary256.get(), mSummary256Bytes }
+         : column == DBConnection::GetSummary64k
+            ? std::pair{ mSummary64k.get(), mSummary64kBytes }
+         : std::pair{ mSamples.get(), mSampleBytes };
+
+      srcoffset = std::min(srcoffset, blobbytes);
+      const auto copied =
+         std::min(srcbytes, blobbytes - srcoffset) / SAMPLE_SIZE(srcformat);
+      CopySamples(src + srcoffset, srcformat,
+         static_cast<samplePtr>(dest), destformat, copied);
+
+      const auto wanted = srcbytes / SAMPLE_SIZE(srcformat);
+      memset(static_cast<samplePtr>(dest) + copied * SAMPLE_SIZE(destformat),
+         0, (wanted - copied) * SAMPLE_SIZE(destformat));
+      return true;
+   }
+
+private:
+   mutable std::mutex mMutex;
+   bool mCommitted{ false };
+
+   const SampleBlockID mBlockID;
+   const sampleFormat mSampleFormat;
+   const double mSumMin;
+   const double mSumMax;
+   const double mSumRms;
+   ArrayOf<char> mSamples;
+   ArrayOf<char> mSummary256;
+   ArrayOf<char> mSummary64k;
+   const size_t mSampleBytes;
+   const size_t mSummary256Bytes;
+   const size_t mSummary64kBytes;
+};
+
+// New blocks with the same contents as a live block share it and its row;
+// off by default, because it costs a hash of each block made on the main thread
+static BoolSetting DeduplicateSampleBlocks{
+   L"/Directories/DeduplicateSampleBlocks", false };
+
 // Silent blocks use nonpositive id values to encode a length
 // and don't occupy any rows in the database; share blocks for repeatedly
 // used length values
@@ -154,6 +351,16 @@ public:
 
    SampleBlockIDs GetActiveBlockIDs() override;
 
+   std::vector<BlockSampleView> GetFloatSampleViews(
+      const SampleBlockPtrs &blocks, bool mayThrow) override;
+
+   SampleBlockCache *GetCache() override;
+
+   DeduplicationStatistics GetDeduplicationStatistics() const override;
+
+   void BeginBulkLoad() override;
+   void EndBulkLoad() override;
+
    SampleBlockPtr DoCreate(constSamplePtr src,
       size_t numsamples,
       sampleFormat srcformat) override;
@@ -178,6 +385,11 @@ private:
    void OnBeginPurge(size_t begin, size_t end);
    void OnEndPurge();
 
+   //! Read metadata of all stored blocks, if not done yet in this bulk load
+   void ReadBulkMetadata();
+   //! @return null if the block was not found by ReadBulkMetadata
+   const SqliteSampleBlock::Metadata *FindBulkMetadata(SampleBlockID id) const;
+
    friend SqliteSampleBlock;
 
    AudacityProject &mProject;
@@ -192,11 +404,38 @@ private:
    using AllBlocksMap =
       std::map< SampleBlockID, std::weak_ptr< SqliteSampleBlock > >;
    AllBlocksMap mAllBlocks;
+
+   // Decoded contents of recently read blocks, which outlive the views
+   SampleBlockCache mCache;
+
+   // Metadata of all stored blocks, sorted by id, during a bulk load
+   std::vector<std::pair<SampleBlockID, SqliteSampleBlock::Metadata>>
+      mBulkMetadata;
+   bool mBulkLoading{ false };
+   bool mBulkMetadataRead{ false };
+   // Statistics for the log
+   std::chrono::steady_clock::duration mBulkReadTime{};
+   size_t mBulkFound{ 0 };
+   size_t mBulkMissed{ 0 };
+
+   //! Remove the entry for the hash if its block is gone
+   void ForgetHash(const std::string &hash);
+
+   // Whether new blocks of the main thread are looked up by hash of their
+   // contents, so that duplicates share one block and one row
+   const bool mDeduplicate;
+   mutable std::mutex mDedupMutex;
+   std::unordered_map<std::string, std::weak_ptr<SqliteSampleBlock>>
+      mBlocksByHash;
+   DeduplicationStatistics mDedupStatistics;
 };
 
 SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
    : mProject{ project }
    , mppConnection{ ConnectionPtr::Get(project).shared_from_this() }
+   , mCache{
+      static_cast<size_t>(std::max(0, SampleBlockCacheSize.Read())) << 20 }
+   , mDeduplicate{ DeduplicateSampleBlocks.Read() }
 {
    mUndoSubscription = UndoManager::Get(project)
       .Subscribe([this](UndoRedoMessage message){
@@ -213,16 +452,282 @@ SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
 
 SqliteSampleBlockFactory::~SqliteSampleBlockFactory() = default;
 
+auto SqliteSampleBlockFactory::GetDeduplicationStatistics() const
+   -> DeduplicationStatistics
+{
+   std::lock_guard<std::mutex> lock(mDedupMutex);
+   return mDedupStatistics;
+}
+
+//! @return digest of the format and the samples
+static std::string HashContents(
+   constSamplePtr src, size_t numsamples, sampleFormat srcformat)
+{
+   crypto::SHA256 hasher;
+   const auto format = static_cast<uint32_t>(srcformat);
+   hasher.Update(&format, sizeof(format));
+   hasher.Update(src, numsamples * SAMPLE_SIZE(srcformat));
+   return hasher.Finalize();
+}
+
 SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
    constSamplePtr src, size_t numsamples, sampleFormat srcformat )
 {
+   // The audio thread, while recording, makes blocks that are rarely
+   // duplicates, and should not spend the time
+   std::string hash;
+   if (mDeduplicate && wxThread::IsMain()) {
+      hash = HashContents(src, numsamples, srcformat);
+      std::lock_guard<std::mutex> lock(mDedupMutex);
+      ++mDedupStatistics.hashed;
+      if (const auto found = mBlocksByHash.find(hash);
+          found != mBlocksByHash.end())
+         // Blocks are immutable, so share the existing one, which counts
+         // its references and deletes its row only after the last
+         if (auto pBlock = found->second.lock()) {
+            ++mDedupStatistics.found;
+            mDedupStatistics.bytes += numsamples * SAMPLE_SIZE(srcformat);
+            return pBlock;
+         }
+   }
+
    auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
    sb->SetSamples(src, numsamples, srcformat);
    // block id has now been assigned
    mAllBlocks[ sb->GetBlockID() ] = sb;
+
+   if (!hash.empty()) {
+      std::lock_guard<std::mutex> lock(mDedupMutex);
+      mBlocksByHash[hash] = sb;
+      sb->mHash = std::move(hash);
+   }
    return sb;
 }
 
+void SqliteSampleBlockFactory::ForgetHash(const std::string &hash)
+{
+   std::lock_guard<std::mutex> lock(mDedupMutex);
+   // A newer block with the same contents may have replaced the entry
+   if (const auto found = mBlocksByHash.find(hash);
+       found != mBlocksByHash.end() && found->second.expired())
+      mBlocksByHash.erase(found);
+}
+
+//! How many block ids are bound in one query of GetFloatSampleViews
+static constexpr size_t SamplesBatchSize = 16;
+
+static const char *SamplesBatchSQL()
+{
+   static const auto sql = []{
+      std::string result = "SELECT blockid, samples FROM sampleblocks"
+         " WHERE blockid IN (";
+      for (size_t ii = 1; ii <= SamplesBatchSize; ++ii)
+         result += (ii > 1 ? ",?" : "?") + std::to_string(ii);
+      return result + ");";
+   }();
+   return sql.c_str();
+}
+
+std::vector<BlockSampleView> SqliteSampleBlockFactory::GetFloatSampleViews(
+   const SampleBlockPtrs &blocks, bool mayThrow)
+{
+   std::vector<BlockSampleView> result(blocks.size());
+
+   // Find which blocks must be read from the database, grouped by id
+   std::map<SampleBlockID, std::vector<size_t>> missing;
+   for (size_t ii = 0; ii < blocks.size(); ++ii) {
+      const auto pBlock = dynamic_cast<SqliteSampleBlock*>(blocks[ii].get());
+      if (!pBlock || pBlock->IsSilent() || pBlock->mpFactory.get() != this ||
+          // Not yet in the database
+          pBlock->IsPending())
+         result[ii] = blocks[ii]->GetFloatSampleView(mayThrow);
+      else if (auto view = pBlock->FindCachedView())
+         result[ii] = std::move(view);
+      else
+         missing[pBlock->GetBlockID()].push_back(ii);
+   }
+
+   // After a failed batch, read the blocks not yet found one at a time, so
+   // that only those that really fail are zero-filled
+   const auto readSingly = [&]{
+      for (auto &[id, indices] : missing)
+         for (auto ii : indices)
+            if (!result[ii])
+               result[ii] = blocks[ii]->GetFloatSampleView(false);
+   };
+
+   try {
+      for (auto iter = missing.begin(); iter != missing.end();) {
+         // Gather one batch, loading metadata of blocks first if needed
+         std::vector<SampleBlockID> ids;
+         DBConnection *conn = nullptr;
+         while (iter != missing.end() && ids.size() < SamplesBatchSize) {
+            auto &block = static_cast<SqliteSampleBlock&>(
+               *blocks[iter->second.front()]);
+            if (!block.mValid)
+               block.Load(block.mBlockID);
+            conn = block.Conn();
+            ids.push_back(iter->first);
+            ++iter;
+         }
+
+         // Prepare and cache statement...automatically finalized at DB close
+         sqlite3_stmt *stmt =
+            conn->Prepare(DBConnection::GetSamplesBatch, SamplesBatchSQL());
+
+         // Bind statement parameters; unused ones match no row
+         for (size_t ii = 0; ii < SamplesBatchSize; ++ii) {
+            const SampleBlockID id = ii < ids.size() ? ids[ii] : 0;
+            if (sqlite3_bind_int64(stmt, ii + 1, id))
+            {
+               ADD_EXCEPTION_CONTEXT(
+                  "sqlite3.rc", std::to_string(sqlite3_errcode(conn->DB())));
+               ADD_EXCEPTION_CONTEXT("sqlite3.context",
+                  "SqliteSampleBlockFactory::GetFloatSampleViews::bind");
+
+               wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+            }
+         }
+
+         // Execute the statement, decoding each returned row
+         size_t nFound = 0;
+         int rc;
+         while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            const auto found = missing.find(sqlite3_column_int64(stmt, 0));
+            if (found == missing.end())
+               continue;
+            ++nFound;
+            auto &indices = found->second;
+            auto &block = static_cast<SqliteSampleBlock&>(
+               *blocks[indices.front()]);
+
+            const auto src = (constSamplePtr) sqlite3_column_blob(stmt, 1);
+            const auto blobbytes = (size_t) sqlite3_column_bytes(stmt, 1);
+            const auto view =
+               std::make_shared<std::vector<float>>(block.mSampleCount);
+            CopySamples(src, block.mSampleFormat,
+               reinterpret_cast<samplePtr>(view->data()), floatSample,
+               std::min(block.mSampleCount,
+                  blobbytes / SAMPLE_SIZE(block.mSampleFormat)));
+            block.SetCachedView(view);
+            for (auto ii : indices)
+               result[ii] = view;
+         }
+
+         // Clear statement bindings and rewind statement
+         sqlite3_clear_bindings(stmt);
+         sqlite3_reset(stmt);
+
+         if (rc != SQLITE_DONE || nFound != ids.size())
+         {
+            ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+            ADD_EXCEPTION_CONTEXT("sqlite3.context",
+               "SqliteSampleBlockFactory::GetFloatSampleViews::step");
+
+            wxLogDebug(
+               wxT("SqliteSampleBlockFactory::GetFloatSampleViews - SQLITE error %s"),
+               sqlite3_errmsg(conn->DB()));
+
+            // Just showing the user a simple message, not the library error too
+            // which isn't internationalized
+            conn->ThrowException( false );
+         }
+      }
+   }
+   catch (...)
+   {
+      if (mayThrow)
+         std::rethrow_exception(std::current_exception());
+      readSingly();
+   }
+
+   return result;
+}
+
+SampleBlockCache *SqliteSampleBlockFactory::GetCache()
+{
+   return &mCache;
+}
+
+void SqliteSampleBlockFactory::BeginBulkLoad()
+{
+   mBulkLoading = true;
+   mBulkMetadataRead = false;
+   mBulkReadTime = {};
+   mBulkFound = mBulkMissed = 0;
+}
+
+void SqliteSampleBlockFactory::EndBulkLoad()
+{
+   if (mBulkMetadataRead)
+      wxLogInfo(
+         "Read metadata of %zu sample blocks in %lld ms; %zu used, %zu queried singly",
+         mBulkMetadata.size(),
+         static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+               mBulkReadTime).count()),
+         mBulkFound, mBulkMissed);
+
+   mBulkLoading = false;
+   mBulkMetadataRead = false;
+   // Free the memory
+   decltype(mBulkMetadata){}.swap(mBulkMetadata);
+}
+
+void SqliteSampleBlockFactory::ReadBulkMetadata()
+{
+   if (mBulkMetadataRead)
+      return;
+   mBulkMetadataRead = true;
+
+   const auto start = std::chrono::steady_clock::now();
+   auto &conn = *mppConnection->mpConnection;
+
+   // Prepare and cache statement...automatically finalized at DB close
+   // length() of a blob needs only the header of the row, not the overflow
+   // pages of the samples
+   sqlite3_stmt *stmt = conn.Prepare(DBConnection::LoadAllSampleBlocks,
+      "SELECT blockid, sampleformat, summin, summax, sumrms,"
+      "       length(samples)"
+      "  FROM sampleblocks;");
+
+   int rc;
+   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+      mBulkMetadata.emplace_back(sqlite3_column_int64(stmt, 0),
+         SqliteSampleBlock::GetMetadata(stmt, 1));
+
+   // Rewind statement
+   sqlite3_reset(stmt);
+
+   if (rc != SQLITE_DONE)
+   {
+      wxLogDebug(
+         wxT("SqliteSampleBlockFactory::ReadBulkMetadata - SQLITE error %s"),
+         sqlite3_errmsg(conn.DB()));
+      // Not an error yet; Load() of each block will query and report it
+      mBulkMetadata.clear();
+   }
+
+   // Rows of a rowid table come in order, but don't depend on that
+   if (!std::is_sorted(mBulkMetadata.begin(), mBulkMetadata.end(),
+      [](const auto &a, const auto &b){ return a.first < b.first; }))
+      std::sort(mBulkMetadata.begin(), mBulkMetadata.end(),
+         [](const auto &a, const auto &b){ return a.first < b.first; });
+
+   mBulkReadTime = std::chrono::steady_clock::now() - start;
+}
+
+auto SqliteSampleBlockFactory::FindBulkMetadata(SampleBlockID id) const
+   -> const SqliteSampleBlock::Metadata *
+{
+   const auto found = std::lower_bound(
+      mBulkMetadata.begin(), mBulkMetadata.end(), id,
+      [](const auto &pair, SampleBlockID id){ return pair.first < id; });
+   if (found == mBulkMetadata.end() || found->first != id)
+      return nullptr;
+   return &found->second;
+}
+
 auto SqliteSampleBlockFactory::GetActiveBlockIDs() -> SampleBlockIDs
 {
    SampleBlockIDs result;
@@ -290,6 +795,17 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromId(
    auto ssb           = std::make_shared<SqliteSampleBlock>(shared_from_this());
    wb                 = ssb;
    ssb->mSampleFormat = srcformat;
+
+   if (mBulkLoading && mppConnection->mpConnection) {
+      ReadBulkMetadata();
+      if (const auto pMetadata = FindBulkMetadata(id)) {
+         ++mBulkFound;
+         ssb->SetMetadata(id, *pMetadata);
+         return ssb;
+      }
+      ++mBulkMissed;
+   }
+
    // This may throw database errors
    // It initializes the rest of the fields
    ssb->Load(static_cast<SampleBlockID>(id));
@@ -312,13 +828,23 @@ BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
    if (cache)
       return cache;
 
+   // Some other block object may have decoded the same contents recently
+   const auto pSharedCache = IsSilent() ? nullptr : &mpFactory->mCache;
+   if (pSharedCache)
+      if (auto found = pSharedCache->Find(mBlockID)) {
+         mCache = found;
+         return found;
+      }
+
    const auto newCache =
       std::make_shared<std::vector<float>>(mSampleCount);
    try {
-      const auto cachedSize = DoGetSamples(
+      const auto cachedSize = ReadSamples(
          reinterpret_cast<samplePtr>(newCache->data()), floatSample, 0,
          mSampleCount);
       assert(cachedSize == mSampleCount);
+      if (pSharedCache)
+         pSharedCache->Insert(mBlockID, newCache);
    }
    catch (...)
    {
@@ -330,6 +856,31 @@ BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
    return newCache;
 }
 
+BlockSampleView SqliteSampleBlock::FindCachedView(bool count)
+{
+   if (auto cache = mCache.lock())
+      return cache;
+   if (IsSilent())
+      return {};
+   auto &cache = mpFactory->mCache;
+   auto found = count ? cache.Find(mBlockID) : cache.Peek(mBlockID);
+   if (found) {
+      std::lock_guard<std::mutex> lock(mCacheMutex);
+      mCache = found;
+   }
+   return found;
+}
+
+void SqliteSampleBlock::SetCachedView(const BlockSampleView &view)
+{
+   {
+      std::lock_guard<std::mutex> lock(mCacheMutex);
+      mCache = view;
+   }
+   if (!IsSilent())
+      mpFactory->mCache.Insert(mBlockID, view);
+}
+
 SqliteSampleBlock::SqliteSampleBlock(
    const std::shared_ptr<SqliteSampleBlockFactory> &pFactory)
 :  mpFactory(pFactory)
@@ -352,6 +903,9 @@ SqliteSampleBlock::~SqliteSampleBlock()
       cb(*this);
    }
 
+   if (!mHash.empty())
+      mpFactory->ForgetHash(mHash);
+
    if (IsSilent()) {
       // The block object was constructed but failed to Load() or Commit().
       // Or it's a silent block with no row in the database.
@@ -418,6 +972,26 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
                                      sampleFormat destformat,
                                      size_t sampleoffset,
                                      size_t numsamples)
+{
+   if (destformat == floatSample && !IsSilent())
+      // Prefer contents already decoded, perhaps by read-ahead; but a plain
+      // read is not a use of the cache, whether or not it finds them
+      if (const auto view = FindCachedView(false)) {
+         const auto offset = std::min(sampleoffset, view->size());
+         const auto available = std::min(numsamples, view->size() - offset);
+         const auto floats = reinterpret_cast<float*>(dest);
+         std::copy_n(view->data() + offset, available, floats);
+         std::fill(floats + available, floats + numsamples, 0.0f);
+         return numsamples;
+      }
+
+   return ReadSamples(dest, destformat, sampleoffset, numsamples);
+}
+
+size_t SqliteSampleBlock::ReadSamples(samplePtr dest,
+                                      sampleFormat destformat,
+                                      size_t sampleoffset,
+                                      size_t numsamples)
 {
    if (IsSilent()) {
       auto size = SAMPLE_SIZE(destformat);
@@ -425,6 +999,14 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
       return numsamples;
    }
 
+   if (ReadPending(dest,
+                   destformat,
+                   DBConnection::GetSamples,
+                   mSampleFormat,
+                   sampleoffset * SAMPLE_SIZE(mSampleFormat),
+                   numsamples * SAMPLE_SIZE(mSampleFormat)))
+      return numsamples;
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::GetSamples,
       "SELECT samples FROM sampleblocks WHERE blockid = ?1;");
@@ -476,6 +1058,13 @@ bool SqliteSampleBlock::GetSummary(float *dest,
    bool silent = IsSilent();
    if (!silent) {
       // Not a silent block
+      if (ReadPending(dest,
+                      floatSample,
+                      id,
+                      floatSample,
+                      frameoffset * fields * SAMPLE_SIZE(floatSample),
+                      numframes * fields * SAMPLE_SIZE(floatSample)))
+         return true;
       try {
          // Prepare and cache statement...automatically finalized at DB close
          auto stmt = Conn()->Prepare(id, sql);
@@ -754,92 +1343,115 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    }
 
    // Retrieve returned data
-   mBlockID = sbid;
-   mSampleFormat = (sampleFormat) sqlite3_column_int(stmt, 0);
-   mSumMin = sqlite3_column_double(stmt, 1);
-   mSumMax = sqlite3_column_double(stmt, 2);
-   mSumRms = sqlite3_column_double(stmt, 3);
-   mSampleBytes = sqlite3_column_int(stmt, 4);
-   mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+   SetMetadata(sbid, GetMetadata(stmt, 0));
 
    // Clear statement bindings and rewind statement
    sqlite3_clear_bindings(stmt);
    sqlite3_reset(stmt);
+}
 
-   mValid = true;
+auto SqliteSampleBlock::GetMetadata(sqlite3_stmt *stmt, int column)
+   -> Metadata
+{
+   return {
+      (sampleFormat) sqlite3_column_int(stmt, column),
+      sqlite3_column_double(stmt, column + 1),
+      sqlite3_column_double(stmt, column + 2),
+      sqlite3_column_double(stmt, column + 3),
+      (size_t) sqlite3_column_int(stmt, column + 4),
+   };
 }
 
-void SqliteSampleBlock::Commit(Sizes sizes)
+void SqliteSampleBlock::SetMetadata(
+   SampleBlockID sbid, const Metadata &metadata)
 {
-   const auto mSummary256Bytes = sizes.first;
-   const auto mSummary64kBytes = sizes.second;
+   mBlockID = sbid;
+   mSampleFormat = metadata.format;
+   mSumMin = metadata.sumMin;
+   mSumMax = metadata.sumMax;
+   mSumRms = metadata.sumRms;
+   mSampleBytes = metadata.sampleBytes;
+   mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
 
-   auto db = DB();
-   int rc;
+   mValid = true;
+}
 
-   // Prepare and cache statement...automatically finalized at DB close
-   sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::InsertSampleBlock,
-      "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
-      "                          summary256, summary64k, samples)"
-      "                         VALUES(?1,?2,?3,?4,?5,?6,?7);");
+void SqliteSampleBlock::Commit(Sizes sizes)
+{
+   auto &conn = *Conn();
 
-   // Bind statement parameters
-   // Might return SQLITE_MISUSE which means it's our mistake that we violated
-   // preconditions; should return SQL_OK which is 0
-   if (sqlite3_bind_int(stmt, 1, static_cast<int>(mSampleFormat)) ||
-       sqlite3_bind_double(stmt, 2, mSumMin) ||
-       sqlite3_bind_double(stmt, 3, mSumMax) ||
-       sqlite3_bind_double(stmt, 4, mSumRms) ||
-       sqlite3_bind_blob(stmt, 5, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 6, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 7, mSamples.get(), mSampleBytes, SQLITE_STATIC))
+   // The id is assigned first, so that the row may be inserted later
+   mBlockID = conn.NewBlockID();
+   if (mBlockID <= 0)
    {
-
-      ADD_EXCEPTION_CONTEXT(
-         "sqlite3.rc", std::to_string(sqlite3_errcode(Conn()->DB())));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::bind");
-
-
-      wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+      mBlockID = 0;
+      conn.ThrowException( true );
    }
+   // The row id may be a reused one, if the connection changed, so forget
+   // any stale decoded contents
+   mpFactory->mCache.Invalidate(mBlockID);
 
-   // Execute the statement
-   rc = sqlite3_step(stmt);
-   if (rc != SQLITE_DONE)
+   auto pRow = std::make_shared<PendingRow>(*this, sizes);
+   if (!wxThread::IsMain())
    {
-      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::step");
+      // Such as the audio thread while recording:  don't make it wait for
+      // the database, unless the writer thread falls too far behind
+      mpPending = pRow;
+      if (!conn.Defer(pRow))
+      {
+         mBlockID = 0;
+         mpPending.reset();
+         conn.ThrowException( true );
+      }
+   }
+   else
+   {
+      // Prepare and cache statement...automatically finalized at DB close
+      sqlite3_stmt *stmt =
+         conn.Prepare(DBConnection::InsertSampleBlock, PendingRow::InsertSQL());
 
-      wxLogDebug(wxT("SqliteSampleBlock::Commit - SQLITE error %s"), sqlite3_errmsg(db));
+      // Execute the statement
+      const auto rc = pRow->Insert(stmt);
+      if (rc != SQLITE_DONE)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::step");
 
-      // Clear statement bindings and rewind statement
-      sqlite3_clear_bindings(stmt);
-      sqlite3_reset(stmt);
+         wxLogDebug(wxT("SqliteSampleBlock::Commit - SQLITE error %s"),
+            sqlite3_errmsg(conn.DB()));
 
-      // Just showing the user a simple message, not the library error too
-      // which isn't internationalized
-      Conn()->ThrowException( true );
-   }
+         mBlockID = 0;
 
-   // Retrieve returned data
-   mBlockID = sqlite3_last_insert_rowid(db);
+         // Just showing the user a simple message, not the library error too
+         // which isn't internationalized
+         conn.ThrowException( true );
+      }
+   }
 
-   // Reset local arrays
-   mSamples.reset();
-   mSummary256.reset();
-   mSummary64k.reset();
    {
       std::lock_guard<std::mutex> lock(mCacheMutex);
       mCache.reset();
    }
 
-   // Clear statement bindings and rewind statement
-   sqlite3_clear_bindings(stmt);
-   sqlite3_reset(stmt);
-
    mValid = true;
 }
 
+bool SqliteSampleBlock::IsPending() const
+{
+   return mpPending && !mpPending->IsCommitted();
+}
+
+bool SqliteSampleBlock::ReadPending(void *dest,
+                                    sampleFormat destformat,
+                                    DBConnection::StatementID column,
+                                    sampleFormat srcformat,
+                                    size_t srcoffset,
+                                    size_t srcbytes) const
+{
+   return mpPending && mpPending->Read(
+      dest, destformat, column, srcformat, srcoffset, srcbytes);
+}
+
 void SqliteSampleBlock::Delete()
 {
    auto db = DB();
@@ -847,6 +1459,12 @@ void SqliteSampleBlock::Delete()
 
    wxASSERT(!IsSilent());
 
+   // Don't let the insertion follow the deletion
+   if (IsPending())
+      Conn()->FlushDeferred();
+
+   mpFactory->mCache.Invalidate(mBlockID);
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::DeleteSampleBlock,
       "DELETE FROM sampleblocks WHERE blockid = ?1;");
@@ -944,7 +1562,19 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
    int sumLen = (mSampleCount + 255) / 256;
    int summaries = 256;
 
-   for (int i = 0; i < sumLen; ++i)
+   // Complete frames are summarized with vector instructions, storing
+   // sums of squares in place of rms
+   static_assert(SummaryFrameLength == 256);
+   const int fullLen = mSampleCount / 256;
+   SummarizeFrames(samples, fullLen, summary256);
+   for (int i = 0; i < fullLen; ++i)
+   {
+      sumsq = summary256[i * fields + 2];
+      totalSquares += sumsq;
+      summary256[i * fields + 2] = (float) sqrt(sumsq / 256);
+   }
+
+   for (int i = fullLen; i < sumLen; ++i)
    {
       min = samples[i * 256];
       max = samples[i * 256];
@@ -1073,8 +1703,7 @@ static size_t EstimateRemovedBlocks(
    using namespace WaveTrackUtilities;
    SampleBlockIDSet wontDelete;
    auto f = [&](const UndoStackElem &elem) {
-      if (auto pTracks = UndoTracks::Find(elem))
-         InspectBlocks(*pTracks, {}, &wontDelete);
+      InspectBlocks(elem, {}, &wontDelete);
    };
    manager.VisitStates(f, 0, begin);
    manager.VisitStates(f, end, manager.GetNumStates());
@@ -1085,16 +1714,14 @@ static size_t EstimateRemovedBlocks(
    // Collect ids that won't survive (and are not negative pseudo ids)
    SampleBlockIDSet seen, mayDelete;
    manager.VisitStates([&](const UndoStackElem &elem) {
-      if (auto pTracks = UndoTracks::Find(elem)) {
-         InspectBlocks(*pTracks,
-            [&](SampleBlockConstPtr pBlock){
-               auto id = pBlock->GetBlockID();
-               if (id > 0 && !wontDelete.count(id))
-                  mayDelete.insert(id);
-            },
-            &seen
-         );
-      }
+      InspectBlocks(elem,
+         [&](SampleBlockConstPtr pBlock){
+            auto id = pBlock->GetBlockID();
+            if (id > 0 && !wontDelete.count(id))
+               mayDelete.insert(id);
+         },
+         &seen
+      );
    }, begin, end);
    return mayDelete.size();
 }
@@ -0,0 +1,319 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file UndoStateSpiller.cpp
+
+**********************************************************************/
+#include "UndoStateSpiller.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "AudacityException.h"
+#include "MemoryX.h"
+#include "Project.h"
+#include "ProjectSerializer.h"
+#include "Track.h"
+#include "UndoTracks.h"
+#include "WaveTrack.h"
+#include "WaveTrackUtilities.h"
+
+#include <wx/log.h>
+
+IntSetting UndoHistoryMemoryBudget{ L"/History/MemoryBudget", 512 };
+
+// CREATE SQL undostates
+// The cache is small, so that spilled documents go to the file and not to
+// memory
+static const char *SpillSchema =
+   "PRAGMA cache_size = -1024;"
+   "CREATE TABLE undostates"
+   "("
+   "  id                   INTEGER PRIMARY KEY,"
+   "  doc                  BLOB"
+   ");";
+
+// Tag of the root of each spilled document
+static constexpr auto RootTag = "undostate";
+
+//! A private temporary database, deleted by SQLite when it is closed
+class UndoStateSpiller::Database final
+{
+public:
+   //! @return null on failure
+   static std::shared_ptr<Database> Open()
+   {
+      sqlite3 *db = nullptr;
+      // An empty file name makes a private temporary database
+      int rc = sqlite3_open_v2("", &db,
+         SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+      if (rc == SQLITE_OK)
+         rc = sqlite3_exec(db, SpillSchema, nullptr, nullptr, nullptr);
+      if (rc != SQLITE_OK) {
+         wxLogMessage("Failed to open undo state database: %s",
+            db ? sqlite3_errmsg(db) : "");
+         sqlite3_close(db);
+         return nullptr;
+      }
+      return std::make_shared<Database>(db);
+   }
+
+   explicit Database(sqlite3 *db) : mDB{ db } {}
+   ~Database() { sqlite3_close(mDB); }
+
+   //! @return id of the row, or 0 on failure
+   sqlite3_int64 Insert(const std::vector<uint8_t> &bytes)
+   {
+      sqlite3_stmt *stmt = nullptr;
+      auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+      if (sqlite3_prepare_v2(mDB,
+            "INSERT INTO undostates (doc) VALUES (?1);", -1, &stmt, nullptr)
+               != SQLITE_OK ||
+          sqlite3_bind_blob(stmt, 1, bytes.data(), bytes.size(),
+            SQLITE_STATIC) != SQLITE_OK ||
+          sqlite3_step(stmt) != SQLITE_DONE)
+         return 0;
+      return sqlite3_last_insert_rowid(mDB);
+   }
+
+   bool Read(sqlite3_int64 id, std::vector<uint8_t> &bytes)
+   {
+      sqlite3_stmt *stmt = nullptr;
+      auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+      if (sqlite3_prepare_v2(mDB,
+            "SELECT doc FROM undostates WHERE id = ?1;", -1, &stmt, nullptr)
+               != SQLITE_OK ||
+          sqlite3_bind_int64(stmt, 1, id) != SQLITE_OK ||
+          sqlite3_step(stmt) != SQLITE_ROW)
+         return false;
+      const auto data =
+         static_cast<const uint8_t *>(sqlite3_column_blob(stmt, 0));
+      bytes.assign(data, data + sqlite3_column_bytes(stmt, 0));
+      return true;
+   }
+
+   void Delete(sqlite3_int64 id)
+   {
+      sqlite3_stmt *stmt = nullptr;
+      auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+      if (sqlite3_prepare_v2(mDB,
+            "DELETE FROM undostates WHERE id = ?1;", -1, &stmt, nullptr)
+               == SQLITE_OK &&
+          sqlite3_bind_int64(stmt, 1, id) == SQLITE_OK)
+         sqlite3_step(stmt);
+   }
+
+private:
+   sqlite3 *const mDB;
+};
+
+namespace {
+//! Receives the tracks of a spilled document, adding them to a list that
+//! the project does not own
+struct SpilledDocumentHandler final : XMLTagHandler {
+   SpilledDocumentHandler(AudacityProject &project, TrackList &tracks)
+      : mProject{ project }, mTracks{ tracks } {}
+
+   bool HandleXMLTag(
+      const std::string_view &tag, const AttributesList &) override
+   {
+      return tag == RootTag;
+   }
+
+   XMLTagHandler *HandleXMLChild(const std::string_view &tag) override
+   {
+      // Not the registered reader, which adds to the project's tracks
+      if (tag != WaveTrack::WaveTrack_tag)
+         return nullptr;
+      return mTracks.Add(WaveTrackFactory::Get(mProject).Create());
+   }
+
+   AudacityProject &mProject;
+   TrackList &mTracks;
+};
+
+class SpilledDocument final : public WaveTrackUtilities::SpilledWaveTracks {
+public:
+   SpilledDocument(const TrackList &tracks,
+      std::shared_ptr<UndoStateSpiller::Database> pDatabase,
+      sqlite3_int64 id)
+      : SpilledWaveTracks{ tracks }
+      , mpDatabase{ std::move(pDatabase) }
+      , mId{ id }
+   {}
+
+   ~SpilledDocument() override
+   {
+      mpDatabase->Delete(mId);
+   }
+
+   std::shared_ptr<TrackList> Restore(AudacityProject &project) override
+   {
+      std::vector<uint8_t> bytes;
+      if (!mpDatabase->Read(mId, bytes))
+         ThrowRestoreFailure();
+
+      // The project's tracks do not change until the undo manager applies
+      // the state
+      const auto result = TrackList::Temporary(nullptr);
+      SpilledDocumentHandler handler{ project, *result };
+      if (!ProjectSerializer::Decode(std::move(bytes), &handler))
+         ThrowRestoreFailure();
+
+      // As when opening a project, make wide tracks from the channels that
+      // were written separately.  Beware iterator invalidation, because
+      // stereo channels get zipped, replacing WaveTracks
+      for (auto iter = result->begin(); iter != result->end();) {
+         const auto pTrack = (*iter++)->SharedPointer();
+         pTrack->LinkConsistencyFix();
+      }
+      return result;
+   }
+
+private:
+   [[noreturn]] static void ThrowRestoreFailure()
+   {
+      throw SimpleMessageBoxException{
+         ExceptionType::Internal,
+         XO("Could not restore a state of the undo history."),
+         XO("Warning"),
+         "Error:_Disk_full_or_not_writable"
+      };
+   }
+
+   const std::shared_ptr<UndoStateSpiller::Database> mpDatabase;
+   const sqlite3_int64 mId;
+};
+}
+
+static const AudacityProject::AttachedObjects::RegisteredFactory
+sUndoStateSpillerKey{
+   []( AudacityProject &project ){
+      return std::make_shared< UndoStateSpiller >( project );
+   }
+};
+
+UndoStateSpiller &UndoStateSpiller::Get(AudacityProject &project)
+{
+   return project.AttachedObjects::Get< UndoStateSpiller >(
+      sUndoStateSpillerKey );
+}
+
+UndoStateSpiller::UndoStateSpiller(AudacityProject &project)
+   : mProject{ project }
+{
+   mUndoSubscription = UndoManager::Get(project)
+      .Subscribe([this](UndoRedoMessage message){
+         CountState(message.type);
+         switch (message.type) {
+         case UndoRedoMessage::Pushed:
+         case UndoRedoMessage::Modified:
+            return EnforceBudget();
+         default:
+            return;
+         }
+      });
+}
+
+UndoStateSpiller::~UndoStateSpiller() = default;
+
+std::unique_ptr<UndoTracks::SpilledTracks>
+UndoStateSpiller::Spill(const TrackList &tracks)
+{
+   // Only wave tracks can be decoded again without the project's list, and
+   // they are what uses the memory; keep other states in memory
+   if (tracks.Any().size() != tracks.Any<const WaveTrack>().size())
+      return nullptr;
+   if (!mpDatabase && !(mpDatabase = Database::Open()))
+      return nullptr;
+
+   ProjectSerializer serializer;
+   serializer.StartTag(RootTag);
+   for (auto pTrack : tracks)
+      pTrack->WriteXML(serializer);
+   serializer.EndTag(RootTag);
+
+   // Dictionary and document in one blob, as ProjectSerializer::Decode
+   // expects
+   const auto &dict = serializer.GetDict();
+   const auto &data = serializer.GetData();
+   std::vector<uint8_t> bytes(dict.GetSize() + data.GetSize());
+   memcpy(bytes.data(), dict.GetData(), dict.GetSize());
+   memcpy(bytes.data() + dict.GetSize(), data.GetData(), data.GetSize());
+
+   const auto id = mpDatabase->Insert(bytes);
+   if (!id)
+      return nullptr;
+   return std::make_unique<SpilledDocument>(tracks, mpDatabase, id);
+}
+
+void UndoStateSpiller::CountState(UndoRedoMessage::Type type)
+{
+   auto &manager = UndoManager::Get(mProject);
+   const size_t nStates = manager.GetNumStates();
+   switch (type) {
+   case UndoRedoMessage::Pushed:
+      // A push after undo discards the redo states, and messages may be
+      // handled after several pushes
+      if (mCounted > 0 && nStates == mCounted + 1) {
+         mUsage += manager.GetMemoryUsage(mCounted, mSeen);
+         mCounted = nStates;
+         return;
+      }
+      break;
+   case UndoRedoMessage::Modified:
+      // Storage no longer used by the modified state stays counted until the
+      // next recomputation
+      if (mCounted > 0 && nStates == mCounted) {
+         mUsage += manager.GetMemoryUsage(manager.GetCurrentState(), mSeen);
+         return;
+      }
+      break;
+   case UndoRedoMessage::Renamed:
+      return;
+   default:
+      // Purges free memory, and undo or redo may restore a spilled state
+      break;
+   }
+   mCounted = 0;
+}
+
+void UndoStateSpiller::EnforceBudget()
+{
+   const auto budget =
+      static_cast<size_t>(std::max(0, UndoHistoryMemoryBudget.Read())) << 20;
+   if (budget == 0 || (mCounted > 0 && mUsage <= budget))
+      return;
+
+   auto &manager = UndoManager::Get(mProject);
+   mSeen.clear();
+   const auto usage = manager.GetMemoryUsage(mSeen);
+   mUsage = std::accumulate(usage.begin(), usage.end(), size_t{ 0 });
+   mCounted = usage.size();
+   if (mUsage <= budget)
+      return;
+
+   // Spill below the budget, so that the next pushes do not measure the
+   // whole history again at once
+   const auto target = budget - budget / 4;
+   const size_t current = manager.GetCurrentState();
+   const auto saved = manager.GetSavedState();
+   for (size_t ii = 0; mUsage > target && ii < usage.size(); ++ii) {
+      if (ii == current || static_cast<int>(ii) == saved)
+         continue;
+      // Already spilled states return false
+      if (manager.SpillState(ii))
+         mUsage -= std::min(mUsage, usage[ii]);
+   }
+}
+
+//! Install the spiller of undo states
+static UndoTracks::Spiller::Scope scope{
+[](AudacityProject &project, const TrackList &tracks) {
+   return UndoStateSpiller::Get(project).Spill(tracks);
+} };
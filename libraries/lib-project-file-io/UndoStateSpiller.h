@@ -0,0 +1,82 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file UndoStateSpiller.h
+  @brief Moves older undo states out of memory when history grows too large
+
+**********************************************************************/
+#ifndef __AUDACITY_UNDO_STATE_SPILLER__
+#define __AUDACITY_UNDO_STATE_SPILLER__
+
+#include <memory>
+
+#include "ClientData.h"
+#include "Observer.h"
+#include "Prefs.h"
+#include "UndoManager.h"
+
+class AudacityProject;
+class TrackList;
+namespace UndoTracks { class SpilledTracks; }
+
+//! Megabytes of memory that undo history may use before older states are
+//! spilled; default 512, 0 for no limit
+extern PROJECT_FILE_IO_API IntSetting UndoHistoryMemoryBudget;
+
+//! Keeps the undo history of a project within UndoHistoryMemoryBudget
+/*!
+ When the budget is exceeded after a push or modification of a state, the
+ tracks of the oldest states are encoded like a project document, into a
+ private temporary database that SQLite deletes when it is closed.  They are
+ decoded again only when undo or redo reaches them.
+
+ A running total of the usage is updated with each new state.  The whole
+ history is measured again only after other changes of it, or when the total
+ exceeds the budget; then states are spilled until it is a quarter below.
+
+ The current and the saved states are never spilled, so that saving and
+ compaction of the project always find their tracks in memory.  Spilled
+ states still hold their sample blocks, so that those remain in the project
+ file until the states are purged.
+ */
+class PROJECT_FILE_IO_API UndoStateSpiller final : public ClientData::Base
+{
+public:
+   class Database;
+
+   static UndoStateSpiller &Get(AudacityProject &project);
+
+   explicit UndoStateSpiller(AudacityProject &project);
+   ~UndoStateSpiller() override;
+
+   UndoStateSpiller(const UndoStateSpiller&) = delete;
+   UndoStateSpiller &operator=(const UndoStateSpiller&) = delete;
+
+   //! @return null if the tracks are not all wave tracks, or could not be
+   //! stored
+   std::unique_ptr<UndoTracks::SpilledTracks> Spill(const TrackList &tracks);
+
+   //! Spill states, oldest first, until the history is within budget
+   void EnforceBudget();
+
+private:
+   //! Add the usage of the state that the message concerns to the total, or
+   //! mark the total for recomputation
+   void CountState(UndoRedoMessage::Type type);
+
+   AudacityProject &mProject;
+   //! Storage counted in mUsage
+   UndoStateExtension::SharedStorage mSeen;
+   //! Estimated bytes of the first mCounted states
+   size_t mUsage{ 0 };
+   //! How many states mUsage covers; 0 when it must be recomputed
+   size_t mCounted{ 0 };
+   //! Opened at the first spill; shared with spilled states, which may
+   //! outlive this
+   std::shared_ptr<Database> mpDatabase;
+   Observer::Subscription mUndoSubscription;
+};
+
+#endif
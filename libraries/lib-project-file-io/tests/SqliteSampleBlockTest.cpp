@@ -0,0 +1,79 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SqliteSampleBlockTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "FileNames.h"
+#include "MockedPrefs.h"
+#include "Project.h"
+#include "ProjectFileIO.h"
+#include "SampleBlock.h"
+
+#include <wx/filename.h>
+
+#include <numeric>
+
+TEST_CASE("SqliteSampleBlockFactory deduplication", "[SqliteSampleBlock]")
+{
+   MockedPrefs prefs;
+   FileNames::UpdateDefaultPath(
+      FileNames::Operation::Temp, wxFileName::GetTempDir());
+   REQUIRE(ProjectFileIO::InitializeSQL());
+
+   auto project = AudacityProject::Create();
+   auto &projectFileIO = ProjectFileIO::Get(*project);
+   REQUIRE(projectFileIO.OpenProject());
+
+   std::vector<float> samples(1000);
+   std::iota(samples.begin(), samples.end(), 0.0f);
+   const auto create = [&](SampleBlockFactory &factory) {
+      return factory.Create(
+         reinterpret_cast<constSamplePtr>(samples.data()),
+         samples.size(), floatSample);
+   };
+
+   SECTION("Identical blocks share one row")
+   {
+      gPrefs->Write(wxT("/Directories/DeduplicateSampleBlocks"), true);
+      const auto pFactory = SampleBlockFactory::New(*project);
+
+      const auto first = create(*pFactory);
+      const auto usage = projectFileIO.GetTotalUsage();
+      const auto second = create(*pFactory);
+      REQUIRE(second == first);
+      REQUIRE(pFactory->GetActiveBlockIDs().size() == 1);
+      REQUIRE(projectFileIO.GetTotalUsage() == usage);
+
+      samples[0] = -1.0f;
+      const auto third = create(*pFactory);
+      REQUIRE(third->GetBlockID() != first->GetBlockID());
+      REQUIRE(pFactory->GetActiveBlockIDs().size() == 2);
+      REQUIRE(projectFileIO.GetTotalUsage() > usage);
+
+      const auto statistics = pFactory->GetDeduplicationStatistics();
+      REQUIRE(statistics.hashed == 3);
+      REQUIRE(statistics.found == 1);
+      REQUIRE(statistics.bytes == samples.size() * sizeof(float));
+   }
+
+   SECTION("Identical blocks have their own rows by default")
+   {
+      const auto pFactory = SampleBlockFactory::New(*project);
+
+      const auto first = create(*pFactory);
+      const auto second = create(*pFactory);
+      REQUIRE(second->GetBlockID() != first->GetBlockID());
+      REQUIRE(pFactory->GetActiveBlockIDs().size() == 2);
+
+      const auto statistics = pFactory->GetDeduplicationStatistics();
+      REQUIRE(statistics.hashed == 0);
+      REQUIRE(statistics.found == 0);
+   }
+
+   projectFileIO.CloseProject();
+}
@@ -0,0 +1,342 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  UndoStateSpillerTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "BasicUI.h"
+#include "Internat.h"
+#include "MockedPrefs.h"
+#include "Project.h"
+#include "ProjectHistory.h"
+#include "SampleBlock.h"
+#include "UndoManager.h"
+#include "UndoStateSpiller.h"
+#include "UndoTracks.h"
+#include "WaveTrack.h"
+#include "XMLWriter.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+//! Holds its samples in memory, and writes only its id
+class MemorySampleBlock final : public SampleBlock
+{
+public:
+   MemorySampleBlock(SampleBlockID id, std::vector<float> samples)
+       : mId { id }
+       , mSamples { std::move(samples) }
+   {
+   }
+
+   void CloseLock() noexcept override
+   {
+   }
+
+   SampleBlockID GetBlockID() const override
+   {
+      return mId;
+   }
+
+   BlockSampleView GetFloatSampleView(bool) override
+   {
+      return std::make_shared<std::vector<float>>(mSamples);
+   }
+
+   sampleFormat GetSampleFormat() const override
+   {
+      return floatSample;
+   }
+
+   size_t GetSampleCount() const override
+   {
+      return mSamples.size();
+   }
+
+   bool GetSummary256(float*, size_t, size_t) override
+   {
+      return false;
+   }
+
+   bool GetSummary64k(float*, size_t, size_t) override
+   {
+      return false;
+   }
+
+   size_t GetSpaceUsage() const override
+   {
+      return mSamples.size() * sizeof(float);
+   }
+
+   void SaveXML(XMLWriter& xmlFile) override
+   {
+      xmlFile.WriteAttr(wxT("blockid"), mId);
+   }
+
+   size_t DoGetSamples(
+      samplePtr dest, sampleFormat destformat, size_t sampleoffset,
+      size_t numsamples) override
+   {
+      CopySamples(
+         reinterpret_cast<constSamplePtr>(mSamples.data() + sampleoffset),
+         floatSample, dest, destformat, numsamples);
+      return numsamples;
+   }
+
+   MinMaxRMS DoGetMinMaxRMS(size_t, size_t) override
+   {
+      return {};
+   }
+
+   MinMaxRMS DoGetMinMaxRMS() const override
+   {
+      return {};
+   }
+
+private:
+   const SampleBlockID mId;
+   const std::vector<float> mSamples;
+};
+
+//! Finds again the blocks that spilled tracks keep alive, as the factory of
+//! the project file does
+class MemorySampleBlockFactory final : public SampleBlockFactory
+{
+public:
+   SampleBlockIDs GetActiveBlockIDs() override
+   {
+      SampleBlockIDs result;
+      for (const auto& [id, wBlock] : mBlocks)
+         if (!wBlock.expired())
+            result.insert(id);
+      return result;
+   }
+
+private:
+   SampleBlockPtr DoCreate(
+      constSamplePtr src, size_t numsamples, sampleFormat srcformat) override
+   {
+      std::vector<float> samples(numsamples);
+      CopySamples(
+         src, srcformat, reinterpret_cast<samplePtr>(samples.data()),
+         floatSample, numsamples);
+      const auto result =
+         std::make_shared<MemorySampleBlock>(++mLastId, std::move(samples));
+      mBlocks[mLastId] = result;
+      return result;
+   }
+
+   SampleBlockPtr
+   DoCreateSilent(size_t numsamples, sampleFormat srcformat) override
+   {
+      const std::vector<float> silence(numsamples);
+      return DoCreate(
+         reinterpret_cast<constSamplePtr>(silence.data()), numsamples,
+         floatSample);
+   }
+
+   SampleBlockPtr
+   DoCreateFromXML(sampleFormat srcformat, const AttributesList& attrs) override
+   {
+      for (auto [attr, value] : attrs) {
+         long long id;
+         if (attr == "blockid" && value.TryGet(id))
+            return DoCreateFromId(srcformat, id);
+      }
+      return nullptr;
+   }
+
+   SampleBlockPtr DoCreateFromId(sampleFormat, SampleBlockID id) override
+   {
+      if (const auto iter = mBlocks.find(id); iter != mBlocks.end())
+         return iter->second.lock();
+      return nullptr;
+   }
+
+   std::unordered_map<SampleBlockID, std::weak_ptr<SampleBlock>> mBlocks;
+   SampleBlockID mLastId = 0;
+};
+
+constexpr auto numSamples = 1000;
+
+float Sample(int nTracks, int iTrack, int iSample)
+{
+   return (nTracks * 100 + iTrack) / 1000.f + iSample / 1e6f;
+}
+
+//! Replace the tracks of the project with nTracks distinct mono tracks
+void MakeTracks(AudacityProject& project, int nTracks)
+{
+   auto& tracks = TrackList::Get(project);
+   tracks.Clear();
+   for (int iTrack = 0; iTrack < nTracks; ++iTrack) {
+      const auto pTrack =
+         WaveTrackFactory::Get(project).Create(floatSample, 44100);
+      pTrack->SetName(wxString::Format("%d %d", nTracks, iTrack));
+      std::vector<float> samples(numSamples);
+      for (int iSample = 0; iSample < numSamples; ++iSample)
+         samples[iSample] = Sample(nTracks, iTrack, iSample);
+      pTrack->Append(
+         0, reinterpret_cast<constSamplePtr>(samples.data()), floatSample,
+         numSamples);
+      pTrack->Flush();
+      tracks.Add(pTrack);
+   }
+}
+
+//! Check that the project has the tracks that MakeTracks made
+void CheckTracks(AudacityProject& project, int nTracks)
+{
+   const auto& tracks = TrackList::Get(project);
+   REQUIRE(tracks.Size() == nTracks);
+   int iTrack = 0;
+   for (const auto pTrack : tracks.Any<const WaveTrack>()) {
+      REQUIRE(pTrack->GetName() == wxString::Format("%d %d", nTracks, iTrack));
+      std::vector<float> samples(numSamples);
+      float* const buffers[]{ samples.data() };
+      REQUIRE(pTrack->GetFloats(0, 1, buffers, 0, numSamples));
+      for (int iSample = 0; iSample < numSamples; ++iSample)
+         REQUIRE(samples[iSample] == Sample(nTracks, iTrack, iSample));
+      ++iTrack;
+   }
+   REQUIRE(iTrack == nTracks);
+}
+
+struct StateInfo
+{
+   bool inMemory;
+   bool spilled;
+};
+
+StateInfo GetStateInfo(UndoManager& manager, size_t n)
+{
+   StateInfo result {};
+   manager.VisitStates(
+      [&](const UndoStackElem& elem) {
+         result = { UndoTracks::Find(elem) != nullptr,
+                    UndoTracks::FindSpilled(elem) != nullptr };
+      },
+      n, n + 1);
+   return result;
+}
+
+//! Fails as a damaged temporary file would
+struct FailingSpilledTracks final : UndoTracks::SpilledTracks
+{
+   std::shared_ptr<TrackList> Restore(AudacityProject&) override
+   {
+      throw std::runtime_error { "Could not restore" };
+   }
+
+   size_t GetMemoryUsage(std::unordered_set<const void*>&) const override
+   {
+      return 0;
+   }
+};
+} // namespace
+
+TEST_CASE("UndoStateSpiller")
+{
+   MockedPrefs prefs;
+   // Spill only as the test directs
+   UndoHistoryMemoryBudget.Write(0);
+
+   SampleBlockFactory::Factory::Scope factoryScope {
+      [](AudacityProject&) {
+         return std::make_shared<MemorySampleBlockFactory>();
+      }
+   };
+   const auto project = AudacityProject::Create();
+   auto& manager = UndoManager::Get(*project);
+   auto& history = ProjectHistory::Get(*project);
+
+   // States 0, 1, 2 with one, two and three tracks
+   for (int nTracks = 1; nTracks <= 3; ++nTracks) {
+      MakeTracks(*project, nTracks);
+      manager.PushState(XO("Make tracks"), XO("Make tracks"));
+   }
+   REQUIRE(manager.GetCurrentState() == 2);
+
+   SECTION("Spilled states are restored by undo and redo")
+   {
+      REQUIRE(manager.SpillState(0));
+      REQUIRE(manager.SpillState(1));
+      REQUIRE_FALSE(manager.SpillState(1));
+      for (size_t n : { 0, 1 }) {
+         const auto info = GetStateInfo(manager, n);
+         REQUIRE_FALSE(info.inMemory);
+         REQUIRE(info.spilled);
+      }
+
+      history.SetStateTo(1, false);
+      CheckTracks(*project, 2);
+      // The restored state is kept in memory again
+      const auto info = GetStateInfo(manager, 1);
+      REQUIRE(info.inMemory);
+      REQUIRE_FALSE(info.spilled);
+
+      history.SetStateTo(0, false);
+      CheckTracks(*project, 1);
+      history.SetStateTo(2, false);
+      CheckTracks(*project, 3);
+      history.SetStateTo(1, false);
+      CheckTracks(*project, 2);
+   }
+
+   SECTION("Restoring a spilled state leaves the project's list alone")
+   {
+      auto& tracks = TrackList::Get(*project);
+      const auto pSpilled = UndoStateSpiller::Get(*project).Spill(tracks);
+      REQUIRE(pSpilled);
+      std::vector<TrackId> ids;
+      for (const auto pTrack : tracks)
+         ids.push_back(pTrack->GetId());
+
+      // Deliver the events of making the tracks before counting
+      BasicUI::Yield();
+      size_t nEvents = 0;
+      const auto subscription =
+         tracks.Subscribe([&](const TrackListEvent&) { ++nEvents; });
+
+      const auto pRestored = pSpilled->Restore(*project);
+      REQUIRE(pRestored->Size() == 3);
+      for (const auto pTrack : *pRestored)
+         REQUIRE(pTrack->GetOwner() == pRestored);
+      BasicUI::Yield();
+      REQUIRE(nEvents == 0);
+
+      CheckTracks(*project, 3);
+      std::vector<TrackId> newIds;
+      for (const auto pTrack : tracks)
+         newIds.push_back(pTrack->GetId());
+      REQUIRE(newIds == ids);
+   }
+
+   SECTION("Failure to restore leaves the tracks of the project unchanged")
+   {
+      UndoTracks::Spiller::Scope spillerScope {
+         [](AudacityProject&, const TrackList&) {
+            return std::make_unique<FailingSpilledTracks>();
+         }
+      };
+      REQUIRE(manager.SpillState(0));
+      REQUIRE_THROWS(history.SetStateTo(0, false));
+      CheckTracks(*project, 3);
+   }
+
+   SECTION("Usage of each state adds up to the usage of the history")
+   {
+      const auto usage = manager.GetMemoryUsage();
+      UndoStateExtension::SharedStorage seen;
+      for (auto n = usage.size(); n--;)
+         REQUIRE(manager.GetMemoryUsage(n, seen) == usage[n]);
+   }
+
+   manager.ClearStates();
+}
@@ -38,6 +38,16 @@ bool UndoStateExtension::CanUndoOrRedo(const AudacityProject &)
    return true;
 }
 
+size_t UndoStateExtension::GetMemoryUsage(SharedStorage &) const
+{
+   return 0;
+}
+
+bool UndoStateExtension::Spill(AudacityProject &)
+{
+   return false;
+}
+
 namespace {
    using Savers = std::vector<UndoRedoExtensionRegistry::Saver>;
    static Savers &GetSavers()
@@ -179,6 +189,45 @@ bool UndoManager::RedoAvailable()
    return CheckAvailable(current + 1);
 }
 
+std::vector<size_t> UndoManager::GetMemoryUsage() const
+{
+   UndoStateExtension::SharedStorage seen;
+   return GetMemoryUsage(seen);
+}
+
+std::vector<size_t> UndoManager::GetMemoryUsage(
+   UndoStateExtension::SharedStorage &seen) const
+{
+   std::vector<size_t> result(stack.size());
+   for (auto ii = stack.size(); ii--;)
+      result[ii] = GetMemoryUsage(ii, seen);
+   return result;
+}
+
+size_t UndoManager::GetMemoryUsage(
+   size_t n, UndoStateExtension::SharedStorage &seen) const
+{
+   wxASSERT(n < stack.size());
+
+   size_t usage = sizeof(UndoStackElem);
+   for (auto &pExtension : stack[n]->state.extensions)
+      if (pExtension)
+         usage += pExtension->GetMemoryUsage(seen);
+   return usage;
+}
+
+bool UndoManager::SpillState(size_t n)
+{
+   wxASSERT(n < stack.size());
+   wxASSERT(static_cast<int>(n) != current);
+
+   bool result = false;
+   for (auto &pExtension : stack[n]->state.extensions)
+      if (pExtension && pExtension->Spill(mProject))
+         result = true;
+   return result;
+}
+
 bool UndoManager::CheckAvailable(int index)
 {
    if (index < 0 || index >= (int)stack.size())
@@ -46,6 +46,7 @@
 
 #include <functional>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 #include "ClientData.h"
 #include "Observer.h"
@@ -89,6 +90,18 @@ public:
 
    //! Whether undo or redo is now permitted; default returns true
    virtual bool CanUndoOrRedo(const AudacityProject &project);
+
+   //! Storage, identified by address, that may be shared among states
+   using SharedStorage = std::unordered_set<const void*>;
+   //! Estimated bytes of memory held by this, not counting storage in seen,
+   //! to which any shareable storage that is counted is added
+   /*! Default returns 0, for no estimate */
+   virtual size_t GetMemoryUsage(SharedStorage &seen) const;
+
+   //! Move the contents out of memory, until RestoreUndoRedoState needs them
+   /*! Default does nothing and returns false
+    @return whether anything was moved */
+   virtual bool Spill(AudacityProject &project);
 };
 
 class PROJECT_HISTORY_API UndoRedoExtensionRegistry {
@@ -203,6 +216,26 @@ class PROJECT_HISTORY_API UndoManager final
    bool UndoAvailable();
    bool RedoAvailable();
 
+   //! Estimated bytes of memory held by each state, oldest first
+   /*!
+    Storage shared by several states is counted once, in the newest of them,
+    as the History window counts sample blocks, because discarding the older
+    states does not free it.
+    */
+   std::vector<size_t> GetMemoryUsage() const;
+   //! Like the other overload, also adding to seen the storage that is counted
+   std::vector<size_t> GetMemoryUsage(
+      UndoStateExtension::SharedStorage &seen) const;
+   //! Estimated bytes of memory held by state n, not counting storage in
+   //! seen, to which any shareable storage that is counted is added
+   size_t GetMemoryUsage(
+      size_t n, UndoStateExtension::SharedStorage &seen) const;
+
+   //! Move contents of state n out of memory, until it is restored
+   /*! @pre `n != GetCurrentState()`
+    @return whether anything was moved */
+   bool SpillState(size_t n);
+
    void MarkUnsaved();
    bool UnsavedChanges() const;
    int GetSavedState() const;
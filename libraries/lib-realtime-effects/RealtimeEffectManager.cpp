@@ -10,6 +10,7 @@
 #include "RealtimeEffectManager.h"
 #include "RealtimeEffectState.h"
 #include "Channel.h"
+#include "RealtimeSafety.h"
 
 #include <memory>
 #include "Project.h"
@@ -107,6 +108,8 @@ void RealtimeEffectManager::Finalize() noexcept
 //
 void RealtimeEffectManager::ProcessStart(bool suspended)
 {
+   RealtimeSafety::Scope realtimeSafety;
+
    // Can be suspended because of the audio stream being paused or because
    // effects have been suspended.
    VisitAll([suspended](RealtimeEffectState &state, bool listIsActive){
@@ -128,6 +131,8 @@ size_t RealtimeEffectManager::Process(bool suspended,
    if (suspended)
       return 0;
 
+   RealtimeSafety::Scope realtimeSafety;
+
    // Remember when we started so we can calculate the amount of latency we
    // are introducing
    auto start = std::chrono::steady_clock::now();
@@ -184,6 +189,8 @@ size_t RealtimeEffectManager::Process(bool suspended,
 //
 void RealtimeEffectManager::ProcessEnd(bool suspended) noexcept
 {
+   RealtimeSafety::Scope realtimeSafety;
+
    // Can be suspended because of the audio stream being paused or because
    // effects have been suspended.
    VisitAll([suspended](RealtimeEffectState &state, bool){
@@ -300,6 +300,8 @@ public:
 
 private:
    RealtimeEffectManager::AllListsLock mLocks;
+   //! Not owning, so that the scope does not keep the project alive in the
+   //! audio thread
    std::weak_ptr<AudacityProject> mwProject;
    bool mSuspended{};
 };
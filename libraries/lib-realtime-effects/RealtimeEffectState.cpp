@@ -14,6 +14,7 @@
 #include "EffectInterface.h"
 #include "MessageBuffer.h"
 #include "PluginManager.h"
+#include "RealtimeSafety.h"
 #include "SampleCount.h"
 
 #include <chrono>
@@ -76,6 +77,8 @@ public:
    void WorkerWrite() {
 
       {
+         // The main thread holds this lock only while it reads the channel
+         RealtimeSafety::Exemption realtimeSafetyExemption;
          std::unique_lock lk(mLockForCV);
 
          // Worker thread avoids memory allocation.
@@ -400,6 +403,7 @@ RealtimeEffectState::EnsureInstance(double sampleRate)
       if (!pInstance->RealtimeInitialize(mMainSettings.settings, sampleRate))
          return {};
       mInitialized = true;
+      mpProcessingInstance.store(pInstance.get(), std::memory_order_release);
       return pInstance;
    }
    return pInstance;
@@ -497,7 +501,8 @@ bool RealtimeEffectState::ProcessStart(bool running)
       pAccessState->WorkerRead();
 
    // Detect transitions of activity state
-   auto pInstance = mwInstance.lock();
+   const auto pInstance =
+      mpProcessingInstance.load(std::memory_order_acquire);
    bool active = IsActive() && running;
    if (active != mLastActive) {
       if (pInstance) {
@@ -530,6 +535,9 @@ bool RealtimeEffectState::ProcessStart(bool running)
 
 #define stackAllocate(T, count) static_cast<T*>(alloca(count * sizeof(T)))
 
+//! First processor and rate, for a group not given to AddGroup()
+static const std::pair<size_t, double> NoGroup{};
+
 //! Visit the effect processors that were added in AddGroup
 /*! The iteration over channels in AddGroup and Process must be the same */
 size_t RealtimeEffectState::Process(
@@ -538,8 +546,11 @@ size_t RealtimeEffectState::Process(
    size_t numSamples)
 {
 
-   const auto pInstance = mwInstance.lock();
-   const auto& pair = mGroups[&group];
+   const auto pInstance =
+      mpProcessingInstance.load(std::memory_order_acquire);
+   // Don't insert into the map in the worker thread
+   const auto iter = mGroups.find(&group);
+   const auto& pair = iter == mGroups.end() ? NoGroup : iter->second;
    const float** const clientIn =
       pInstance ? stackAllocate(const float*, pInstance->GetAudioInCount()) :
                   nullptr;
@@ -648,7 +659,8 @@ size_t RealtimeEffectState::Process(
 
 bool RealtimeEffectState::ProcessEnd()
 {
-   auto pInstance = mwInstance.lock();
+   const auto pInstance =
+      mpProcessingInstance.load(std::memory_order_acquire);
    bool result = pInstance &&
       // Assuming we are in a processing scope, use the worker settings
       pInstance->RealtimeProcessEnd(mWorkerSettings.settings) &&
@@ -693,6 +705,7 @@ bool RealtimeEffectState::Finalize() noexcept
 {
    mGroups.clear();
    mCurrentProcessor = 0;
+   mpProcessingInstance.store(nullptr, std::memory_order_release);
 
    auto pInstance = mwInstance.lock();
    if (!pInstance)
@@ -188,6 +188,11 @@ private:
    std::unordered_map<const ChannelGroup *, std::pair<size_t, double>>
       mGroups;
 
+   //! The initialized instance, which a RealtimeEffects::InitializationScope
+   //! owns until Finalize(); so the worker thread need not lock mwInstance
+   /*! Set and reset in the main thread, read in the worker thread */
+   std::atomic<EffectInstance *> mpProcessingInstance{ nullptr };
+
    // This must not be reset to nullptr while a worker thread is running.
    // In fact it is never yet reset to nullptr, before destruction.
    // Destroy before mWorkerSettings:
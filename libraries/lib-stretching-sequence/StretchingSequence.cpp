@@ -143,6 +143,13 @@ bool StretchingSequence::HasTrivialEnvelope() const
    return mSequence.HasTrivialEnvelope();
 }
 
+void StretchingSequence::Prefetch(double t0, double t1) const
+{
+   // The time-stretching state is not shared with other threads, but the
+   // underlying sequence is stateless
+   mSequence.Prefetch(t0, t1);
+}
+
 void StretchingSequence::GetEnvelopeValues(
    double* buffer, size_t bufferLen, double t0, bool backwards) const
 {
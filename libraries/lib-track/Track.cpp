@@ -231,6 +231,11 @@ std::optional<TranslatableString> Track::GetErrorOpening() const
    return {};
 }
 
+size_t Track::GetMemoryUsage(SharedStorage &) const
+{
+   return 0;
+}
+
 void Track::Notify(bool allChannels, int code)
 {
    auto pList = mList.lock();
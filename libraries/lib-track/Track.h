@@ -17,6 +17,7 @@
 #include <list>
 #include <optional>
 #include <functional>
+#include <unordered_set>
 #include <wx/longlong.h>
 
 #include "Channel.h"
@@ -409,6 +410,15 @@ public:
     */
    virtual std::optional<TranslatableString> GetErrorOpening() const;
 
+   //! Storage, identified by address, that may be shared among tracks
+   using SharedStorage = std::unordered_set<const void*>;
+   //! Estimated bytes of memory used by this track, not counting storage in
+   //! seen, to which any shareable storage that is counted is added
+   /*!
+    Default implementation returns 0, for no estimate
+    */
+   virtual size_t GetMemoryUsage(SharedStorage &seen) const;
+
    // Send a notification to subscribers when state of the track changes
    // To do: define values for the argument to distinguish different parts
    // of the state
@@ -12,6 +12,8 @@
 #include "Track.h"
 #include "UndoManager.h"
 
+UndoTracks::SpilledTracks::~SpilledTracks() = default;
+
 // Undo/redo handling of selection changes
 namespace {
 struct TrackListRestorer final : UndoStateExtension {
@@ -27,6 +29,19 @@ struct TrackListRestorer final : UndoStateExtension {
    }
    void RestoreUndoRedoState(AudacityProject &project) override {
       auto &dstTracks = TrackList::Get(project);
+      if (mpSpilled) {
+         // Decode before clearing, so that a failure loses nothing
+         const auto pTracks = mpSpilled->Restore(project);
+         // Keep this state in memory again, now that it is in use
+         auto pCopies = TrackList::Create(nullptr);
+         for (auto pTrack : *pTracks)
+            pCopies->Add(pTrack->Duplicate());
+         dstTracks.Clear();
+         dstTracks.Append(std::move(*pTracks));
+         mpTracks = std::move(pCopies);
+         mpSpilled.reset();
+         return;
+      }
       dstTracks.Clear();
       for (auto pTrack : *mpTracks)
          dstTracks.Add(pTrack->Duplicate());
@@ -34,7 +49,26 @@ struct TrackListRestorer final : UndoStateExtension {
    bool CanUndoOrRedo(const AudacityProject &project) override {
       return !PendingTracks::Get(project).HasPendingTracks();
    }
-   const std::shared_ptr<TrackList> mpTracks;
+   size_t GetMemoryUsage(SharedStorage &seen) const override {
+      if (mpSpilled)
+         return mpSpilled->GetMemoryUsage(seen);
+      size_t result = 0;
+      for (auto pTrack : *mpTracks)
+         result += pTrack->GetMemoryUsage(seen);
+      return result;
+   }
+   bool Spill(AudacityProject &project) override {
+      if (mpSpilled)
+         return false;
+      mpSpilled = UndoTracks::Spiller::Call(project, *mpTracks);
+      if (!mpSpilled)
+         return false;
+      mpTracks.reset();
+      return true;
+   }
+   std::shared_ptr<TrackList> mpTracks;
+   //! Non-null exactly when mpTracks is null
+   std::unique_ptr<UndoTracks::SpilledTracks> mpSpilled;
 };
 
 UndoRedoExtensionRegistry::Entry sEntry {
@@ -42,9 +76,8 @@ UndoRedoExtensionRegistry::Entry sEntry {
       return std::make_shared<TrackListRestorer>(project);
    }
 };
-}
 
-TrackList *UndoTracks::Find(const UndoStackElem &state)
+TrackListRestorer *FindRestorer(const UndoStackElem &state)
 {
    auto &exts = state.state.extensions;
    auto end = exts.end(),
@@ -52,6 +85,22 @@ TrackList *UndoTracks::Find(const UndoStackElem &state)
          return dynamic_cast<TrackListRestorer*>(pExt.get());
       });
    if (iter != end)
-      return static_cast<TrackListRestorer*>(iter->get())->mpTracks.get();
+      return static_cast<TrackListRestorer*>(iter->get());
+   return nullptr;
+}
+}
+
+TrackList *UndoTracks::Find(const UndoStackElem &state)
+{
+   if (auto pRestorer = FindRestorer(state))
+      return pRestorer->mpTracks.get();
+   return nullptr;
+}
+
+auto UndoTracks::FindSpilled(const UndoStackElem &state)
+   -> const SpilledTracks *
+{
+   if (auto pRestorer = FindRestorer(state))
+      return pRestorer->mpSpilled.get();
    return nullptr;
 }
@@ -10,11 +10,43 @@
 #ifndef __AUDACITY_UNDO_TRACKS__
 #define __AUDACITY_UNDO_TRACKS__
 
+#include "GlobalVariable.h"
+#include <memory>
+#include <unordered_set>
+
+class AudacityProject;
 class TrackList;
 struct UndoStackElem;
 
 namespace UndoTracks {
+//! @return the copies of tracks in the state, or null if there are none or
+//! they are spilled
 TRACK_API TrackList *Find(const UndoStackElem &state);
+
+//! Copies of the tracks of an undo state, moved out of memory
+class TRACK_API SpilledTracks {
+public:
+   virtual ~SpilledTracks();
+
+   //! Recreate the tracks in a new list, not owned by the project
+   /*! May throw, leaving the tracks of the project unchanged */
+   virtual std::shared_ptr<TrackList> Restore(AudacityProject &project) = 0;
+
+   //! Estimated bytes still held in memory, not counting storage in seen,
+   //! to which any shareable storage that is counted is added
+   virtual size_t GetMemoryUsage(
+      std::unordered_set<const void*> &seen) const = 0;
+};
+
+//! @return the spilled copies of tracks in the state, or null if there are
+//! none or they are in memory
+TRACK_API const SpilledTracks *FindSpilled(const UndoStackElem &state);
+
+//! Hook that moves copies of tracks out of memory
+/*! When none is installed, or it returns null, the tracks remain in memory */
+struct TRACK_API Spiller : GlobalHook<Spiller,
+   std::unique_ptr<SpilledTracks>(AudacityProject &, const TrackList &)
+>{};
 }
 
 #endif
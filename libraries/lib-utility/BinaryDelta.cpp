@@ -0,0 +1,186 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BinaryDelta.cpp
+
+  The delta begins with the size of the target, then has instructions, each
+  beginning with a variable length integer, twice the length plus one for
+  insertion of the literal bytes that follow, or plus zero for a copy from the
+  base at the offset that follows.
+
+  Blocks of the base at multiples of BlockSize are indexed by hash; a rolling
+  hash of the target finds them at any offset, and matches then extend in
+  both directions.
+
+**********************************************************************/
+#include "BinaryDelta.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+constexpr size_t BlockSize = 32;
+constexpr uint32_t Multiplier = 0x01000193;
+
+enum : uint64_t { Copy = 0, Insert = 1 };
+
+void PutVarint(BinaryDelta::Bytes &out, uint64_t value)
+{
+   while (value >= 0x80) {
+      out.push_back(static_cast<uint8_t>(value) | 0x80);
+      value >>= 7;
+   }
+   out.push_back(static_cast<uint8_t>(value));
+}
+
+bool GetVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+{
+   value = 0;
+   for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (p == end)
+         return false;
+      const auto byte = *p++;
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return true;
+   }
+   return false;
+}
+
+uint32_t Hash(const uint8_t *p)
+{
+   uint32_t result = 0;
+   for (size_t ii = 0; ii < BlockSize; ++ii)
+      result = result * Multiplier + p[ii];
+   return result;
+}
+
+//! Factor of the first byte in the hash of a block, to remove it when rolling
+constexpr uint32_t LeadFactor()
+{
+   uint32_t result = 1;
+   for (size_t ii = 1; ii < BlockSize; ++ii)
+      result *= Multiplier;
+   return result;
+}
+
+void PutInsert(BinaryDelta::Bytes &out, const uint8_t *p, size_t length)
+{
+   if (length == 0)
+      return;
+   PutVarint(out, (static_cast<uint64_t>(length) << 1) | Insert);
+   out.insert(out.end(), p, p + length);
+}
+
+void PutCopy(BinaryDelta::Bytes &out, size_t offset, size_t length)
+{
+   PutVarint(out, (static_cast<uint64_t>(length) << 1) | Copy);
+   PutVarint(out, offset);
+}
+}
+
+namespace BinaryDelta {
+
+Bytes Encode(
+   const void *base, size_t baseSize, const void *target, size_t targetSize)
+{
+   const auto pBase = static_cast<const uint8_t *>(base);
+   const auto pTarget = static_cast<const uint8_t *>(target);
+
+   Bytes result;
+   PutVarint(result, targetSize);
+
+   if (baseSize < BlockSize || targetSize < BlockSize) {
+      PutInsert(result, pTarget, targetSize);
+      return result;
+   }
+
+   // Index the first occurrence of each block of the base
+   std::unordered_map<uint32_t, size_t> index;
+   index.reserve(baseSize / BlockSize);
+   for (size_t offset = 0; offset + BlockSize <= baseSize; offset += BlockSize)
+      index.emplace(Hash(pBase + offset), offset);
+
+   constexpr auto lead = LeadFactor();
+   // Start of the target bytes not yet encoded
+   size_t literal = 0;
+   // Start of the window of the rolling hash; pos + BlockSize <= targetSize
+   size_t pos = 0;
+   auto hash = Hash(pTarget);
+   while (true) {
+      const auto found = index.find(hash);
+      if (found != index.end() &&
+          memcmp(pBase + found->second, pTarget + pos, BlockSize) == 0) {
+         auto start = pos, offset = found->second;
+         while (start > literal && offset > 0 &&
+                pBase[offset - 1] == pTarget[start - 1])
+            --start, --offset;
+         auto end = pos + BlockSize, baseEnd = found->second + BlockSize;
+         while (end < targetSize && baseEnd < baseSize &&
+                pBase[baseEnd] == pTarget[end])
+            ++end, ++baseEnd;
+
+         PutInsert(result, pTarget + literal, start - literal);
+         PutCopy(result, offset, end - start);
+         literal = pos = end;
+         if (pos + BlockSize > targetSize)
+            break;
+         hash = Hash(pTarget + pos);
+         continue;
+      }
+
+      if (pos + BlockSize >= targetSize)
+         break;
+      hash = (hash - pTarget[pos] * lead) * Multiplier +
+         pTarget[pos + BlockSize];
+      ++pos;
+   }
+   PutInsert(result, pTarget + literal, targetSize - literal);
+
+   return result;
+}
+
+bool Apply(const void *base, size_t baseSize,
+   const void *delta, size_t deltaSize, Bytes &target)
+{
+   const auto pBase = static_cast<const uint8_t *>(base);
+   auto p = static_cast<const uint8_t *>(delta);
+   const auto end = p + deltaSize;
+
+   uint64_t size;
+   if (!GetVarint(p, end, size))
+      return false;
+
+   target.clear();
+   // Don't trust a corrupt size for the reservation
+   target.reserve(std::min<uint64_t>(size, baseSize + deltaSize));
+
+   while (p != end) {
+      uint64_t instruction;
+      if (!GetVarint(p, end, instruction))
+         return false;
+      const auto length = instruction >> 1;
+      if (length > size - target.size())
+         return false;
+      if ((instruction & 1) == Insert) {
+         if (length > static_cast<uint64_t>(end - p))
+            return false;
+         target.insert(target.end(), p, p + length);
+         p += length;
+      }
+      else {
+         uint64_t offset;
+         if (!GetVarint(p, end, offset) ||
+             offset > baseSize || length > baseSize - offset)
+            return false;
+         target.insert(target.end(),
+            pBase + offset, pBase + offset + length);
+      }
+   }
+
+   return target.size() == size;
+}
+
+}
@@ -0,0 +1,41 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BinaryDelta.h
+
+**********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Compact encoding of one byte sequence as changes to another
+/*!
+ A delta is a sequence of instructions, each either to copy a range of the
+ base, or to insert literal bytes.  Ranges of the base are found wherever they
+ occur in the target, so that edits in several places, and insertions or
+ deletions that shift the rest of the sequence, cost little more than the
+ changed bytes.
+
+ Encoding takes time linear in the sizes of base and target.
+ */
+namespace BinaryDelta {
+
+using Bytes = std::vector<uint8_t>;
+
+//! @return instructions to make target from base
+UTILITY_API Bytes Encode(
+   const void *base, size_t baseSize, const void *target, size_t targetSize);
+
+//! Reconstruct a target from base and delta
+/*!
+ @return false if the delta is malformed or does not fit the base; then the
+ contents of target are unspecified
+ */
+UTILITY_API bool Apply(const void *base, size_t baseSize,
+   const void *delta, size_t deltaSize, Bytes &target);
+
+}
@@ -0,0 +1,187 @@
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file RealtimeSafety.cpp
+
+**********************************************************************/
+#include "RealtimeSafety.h"
+
+#ifndef NDEBUG
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define HAS_EXECINFO
+#endif
+
+namespace {
+constexpr size_t MaxFrames = 32;
+//! How many distinct violations to remember
+constexpr size_t MaxRecords = 64;
+
+thread_local unsigned sDepth = 0;
+thread_local unsigned sExempt = 0;
+//! Prevents recursion, if capture of the stack should allocate or lock
+thread_local bool sChecking = false;
+
+struct Record {
+   //! Set with release when the other fields are complete
+   std::atomic<bool> ready{ false };
+   std::atomic<size_t> count{ 0 };
+   const char *what{};
+   size_t hash{};
+   int nFrames{};
+   void *frames[MaxFrames]{};
+};
+
+Record sRecords[MaxRecords];
+//! May exceed MaxRecords
+std::atomic<size_t> sClaimed{ 0 };
+std::atomic<size_t> sDropped{ 0 };
+
+std::mutex sReportMutex;
+//! Guarded by sReportMutex
+size_t sReported = 0;
+
+#ifdef HAS_EXECINFO
+//! The first call of backtrace() may load a library and allocate, so make it
+//! at startup and not in a real-time thread
+[[maybe_unused]] const bool sPrimed = []{
+   void *frame;
+   backtrace(&frame, 1);
+   return true;
+}();
+#endif
+
+int CaptureStack(void **frames)
+{
+#if defined(_WIN32)
+   return RtlCaptureStackBackTrace(0, MaxFrames, frames, nullptr);
+#elif defined(HAS_EXECINFO)
+   return backtrace(frames, MaxFrames);
+#else
+   return 0;
+#endif
+}
+
+void PrintStack(void *const *frames, int nFrames)
+{
+#if defined(HAS_EXECINFO)
+   fflush(stderr);
+   // Writes without allocating
+   backtrace_symbols_fd(frames, nFrames, fileno(stderr));
+#else
+   for (int ii = 0; ii < nFrames; ++ii)
+      fprintf(stderr, "   %p\n", frames[ii]);
+#endif
+}
+
+//! FNV-1a of the description and return addresses
+size_t Hash(const char *what, void *const *frames, int nFrames)
+{
+   uint64_t result = 14695981039346656037ull;
+   const auto combine = [&](const void *p){
+      result ^= reinterpret_cast<uintptr_t>(p);
+      result *= 1099511628211ull;
+   };
+   combine(what);
+   for (int ii = 0; ii < nFrames; ++ii)
+      combine(frames[ii]);
+   return static_cast<size_t>(result);
+}
+}
+
+namespace RealtimeSafety {
+
+Scope::Scope() noexcept
+{
+   ++sDepth;
+}
+
+Scope::~Scope()
+{
+   --sDepth;
+}
+
+Exemption::Exemption() noexcept
+{
+   ++sExempt;
+}
+
+Exemption::~Exemption()
+{
+   --sExempt;
+}
+
+void Check(const char *what) noexcept
+{
+   if (sDepth == 0 || sExempt > 0 || sChecking)
+      return;
+   sChecking = true;
+
+   void *frames[MaxFrames];
+   const auto nFrames = CaptureStack(frames);
+   const auto hash = Hash(what, frames, nFrames);
+
+   // Count a repetition of a known violation
+   // (Two threads might record the same one twice, which is harmless)
+   const auto nClaimed = std::min(sClaimed.load(), MaxRecords);
+   for (size_t ii = 0; ii < nClaimed; ++ii) {
+      auto &record = sRecords[ii];
+      if (record.ready.load(std::memory_order_acquire) &&
+          record.hash == hash) {
+         record.count.fetch_add(1, std::memory_order_relaxed);
+         sChecking = false;
+         return;
+      }
+   }
+
+   const auto index = sClaimed.fetch_add(1);
+   if (index < MaxRecords) {
+      auto &record = sRecords[index];
+      record.what = what;
+      record.hash = hash;
+      record.nFrames = nFrames;
+      std::copy(frames, frames + nFrames, record.frames);
+      record.count.store(1, std::memory_order_relaxed);
+      record.ready.store(true, std::memory_order_release);
+   }
+   else
+      sDropped.fetch_add(1, std::memory_order_relaxed);
+   sChecking = false;
+}
+
+size_t Report()
+{
+   std::lock_guard<std::mutex> lock{ sReportMutex };
+   size_t result = 0;
+   const auto nClaimed = std::min(sClaimed.load(), MaxRecords);
+   for (; sReported < nClaimed; ++sReported) {
+      const auto &record = sRecords[sReported];
+      if (!record.ready.load(std::memory_order_acquire))
+         // Still being written; report it next time
+         break;
+      fprintf(stderr,
+         "Real-time safety violation: %s (%zu times so far) at:\n",
+         record.what, record.count.load(std::memory_order_relaxed));
+      PrintStack(record.frames, record.nFrames);
+      ++result;
+   }
+   if (const auto dropped = sDropped.exchange(0))
+      fprintf(stderr,
+         "Real-time safety: %zu more violations were not recorded\n",
+         dropped);
+   return result;
+}
+
+}
+
+#endif
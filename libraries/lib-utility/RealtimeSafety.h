@@ -0,0 +1,74 @@
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file RealtimeSafety.h
+  @brief Debug-build detection of allocations and locks on real-time paths
+
+**********************************************************************/
+#ifndef __AUDACITY_REALTIME_SAFETY__
+#define __AUDACITY_REALTIME_SAFETY__
+
+#include <cstddef>
+
+//! Detection, in debug builds only, of operations that may block a thread
+//! that must meet real-time deadlines
+/*!
+ Code that must not allocate or lock, like the audio callback, is bracketed
+ with Scope objects.  Interceptors of allocation and locking, installed by the
+ executable, call Check(), which remembers the call stack of each distinct
+ violation in a fixed table, without allocating or locking.  Report() then
+ writes them, outside of the real-time path.
+
+ In builds with NDEBUG defined, all of this compiles to nothing.
+ */
+namespace RealtimeSafety {
+
+#ifdef NDEBUG
+
+struct Scope { Scope() {} };
+struct Exemption { Exemption() {} };
+inline void Check(const char *) noexcept {}
+inline size_t Report() { return 0; }
+
+#else
+
+//! While an object of this class exists, the thread that made it must not
+//! allocate or lock
+/*! Scopes may nest */
+class UTILITY_API Scope final {
+public:
+   Scope() noexcept;
+   ~Scope();
+   Scope(const Scope&) = delete;
+   Scope &operator=(const Scope&) = delete;
+};
+
+//! While an object of this class exists, Check() ignores its thread
+/*! For a known violation that is bounded, and better than the alternatives */
+class UTILITY_API Exemption final {
+public:
+   Exemption() noexcept;
+   ~Exemption();
+   Exemption(const Exemption&) = delete;
+   Exemption &operator=(const Exemption&) = delete;
+};
+
+//! Remember the call stack, if this thread is in a Scope and not exempt
+/*!
+ @param what a string with static duration, describing the operation
+ */
+UTILITY_API void Check(const char *what) noexcept;
+
+//! Write to standard error the violations not reported before, with their
+//! call stacks
+/*! Not for use on a real-time path
+ @return how many were written
+ */
+UTILITY_API size_t Report();
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BinaryDeltaTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "BinaryDelta.h"
+
+#include <random>
+
+namespace {
+BinaryDelta::Bytes RandomBytes(size_t size, unsigned seed)
+{
+   std::mt19937 engine{ seed };
+   std::uniform_int_distribution<int> distribution{ 0, 255 };
+   BinaryDelta::Bytes result(size);
+   for (auto &byte : result)
+      byte = distribution(engine);
+   return result;
+}
+
+BinaryDelta::Bytes RoundTrip(
+   const BinaryDelta::Bytes &base, const BinaryDelta::Bytes &target,
+   size_t maxDeltaSize)
+{
+   const auto delta = BinaryDelta::Encode(
+      base.data(), base.size(), target.data(), target.size());
+   REQUIRE(delta.size() <= maxDeltaSize);
+   BinaryDelta::Bytes result;
+   REQUIRE(BinaryDelta::Apply(
+      base.data(), base.size(), delta.data(), delta.size(), result));
+   return result;
+}
+}
+
+TEST_CASE("BinaryDelta")
+{
+   const auto base = RandomBytes(100000, 1);
+
+   SECTION("Identical sequences need only one copy")
+   {
+      REQUIRE(RoundTrip(base, base, 16) == base);
+   }
+
+   SECTION("Edits in several places cost little more than the edits")
+   {
+      auto target = base;
+      // Replace
+      target[10] ^= 0xff;
+      // Insert, shifting the rest
+      const auto inserted = RandomBytes(100, 2);
+      target.insert(target.begin() + 30000, inserted.begin(), inserted.end());
+      // Delete
+      target.erase(target.begin() + 60000, target.begin() + 61000);
+      // Append
+      target.push_back(42);
+      REQUIRE(RoundTrip(base, target, 400) == target);
+   }
+
+   SECTION("Unrelated sequences become one insertion")
+   {
+      const auto target = RandomBytes(1000, 3);
+      REQUIRE(RoundTrip(base, target, 1010) == target);
+   }
+
+   SECTION("Short and empty sequences")
+   {
+      const BinaryDelta::Bytes empty, shortBytes{ 1, 2, 3 };
+      REQUIRE(RoundTrip(empty, shortBytes, 8) == shortBytes);
+      REQUIRE(RoundTrip(shortBytes, empty, 8) == empty);
+      REQUIRE(RoundTrip(base, empty, 8) == empty);
+   }
+
+   SECTION("Malformed deltas are rejected")
+   {
+      auto target = base;
+      target[500] ^= 1;
+      auto delta = BinaryDelta::Encode(
+         base.data(), base.size(), target.data(), target.size());
+      BinaryDelta::Bytes result;
+
+      // Truncated
+      REQUIRE(!BinaryDelta::Apply(
+         base.data(), base.size(), delta.data(), delta.size() - 1, result));
+
+      // Applied to a shorter base
+      REQUIRE(!BinaryDelta::Apply(
+         base.data(), base.size() / 2, delta.data(), delta.size(), result));
+   }
+}
@@ -0,0 +1,59 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeSafetyTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "RealtimeSafety.h"
+
+#ifndef NDEBUG
+
+TEST_CASE("RealtimeSafety")
+{
+   using namespace RealtimeSafety;
+   // Forget anything from before
+   Report();
+
+   SECTION("Checks outside of a scope are not violations")
+   {
+      Check("test");
+      REQUIRE(Report() == 0);
+   }
+
+   SECTION("Repetitions of one violation are reported once")
+   {
+      {
+         Scope scope;
+         for (int ii = 0; ii < 3; ++ii)
+            Check("test");
+      }
+      REQUIRE(Report() == 1);
+      REQUIRE(Report() == 0);
+   }
+
+   SECTION("Scopes nest")
+   {
+      {
+         Scope outer;
+         {
+            Scope inner;
+         }
+         Check("test nested");
+      }
+      REQUIRE(Report() == 1);
+   }
+
+   SECTION("Exemptions suppress violations")
+   {
+      Scope scope;
+      Exemption exemption;
+      Check("test exempt");
+      REQUIRE(Report() == 0);
+   }
+}
+
+#endif
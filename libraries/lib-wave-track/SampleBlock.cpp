@@ -23,6 +23,35 @@ SampleBlockFactoryPtr SampleBlockFactory::New( AudacityProject &project )
 
 SampleBlockFactory::~SampleBlockFactory() = default;
 
+std::vector<BlockSampleView> SampleBlockFactory::GetFloatSampleViews(
+   const SampleBlockPtrs &blocks, bool mayThrow)
+{
+   std::vector<BlockSampleView> result;
+   result.reserve(blocks.size());
+   for (const auto &pBlock : blocks)
+      result.push_back(pBlock->GetFloatSampleView(mayThrow));
+   return result;
+}
+
+SampleBlockCache *SampleBlockFactory::GetCache()
+{
+   return nullptr;
+}
+
+auto SampleBlockFactory::GetDeduplicationStatistics() const
+   -> DeduplicationStatistics
+{
+   return {};
+}
+
+void SampleBlockFactory::BeginBulkLoad()
+{
+}
+
+void SampleBlockFactory::EndBulkLoad()
+{
+}
+
 SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src,
    size_t numsamples,
    sampleFormat srcformat)
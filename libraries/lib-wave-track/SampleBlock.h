@@ -16,6 +16,7 @@ SampleBlock.h
 #include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "Observer.h"
 #include "XMLTagHandler.h"
@@ -25,6 +26,7 @@ class ProjectFileIO;
 class XMLWriter;
 
 class SampleBlock;
+class SampleBlockCache;
 using SampleBlockPtr = std::shared_ptr<SampleBlock>;
 using SampleBlockConstPtr = std::shared_ptr<const SampleBlock>;
 class SampleBlockFactory;
@@ -148,6 +150,39 @@ public:
    /*! @return ids of all sample blocks created by this factory and still extant */
    virtual SampleBlockIDs GetActiveBlockIDs() = 0;
 
+   using SampleBlockPtrs = std::vector<SampleBlockPtr>;
+   //! Get float views of the entire contents of several blocks
+   /*!
+    The default implementation asks each block in turn.  Overrides may fetch
+    the contents of many blocks with fewer accesses to storage.
+    If !mayThrow and there is an error, the failing views are filled with zeroes.
+    @return one view for each of `blocks`, in the same order
+    */
+   virtual std::vector<BlockSampleView> GetFloatSampleViews(
+      const SampleBlockPtrs &blocks, bool mayThrow);
+
+   //! @return the cache of decoded blocks shared by blocks of this factory,
+   //! or null if there is none
+   virtual SampleBlockCache *GetCache();
+
+   //! Counts of new blocks that were found to duplicate live blocks
+   struct DeduplicationStatistics {
+      size_t hashed{ 0 }; //!< new blocks compared by contents
+      size_t found{ 0 }; //!< of those, how many shared an existing block
+      size_t bytes{ 0 }; //!< sample bytes not stored again
+   };
+   //! The default returns zeroes, for factories that do not deduplicate
+   virtual DeduplicationStatistics GetDeduplicationStatistics() const;
+
+   //! Hint that many blocks will be created from XML or ids, as when opening
+   //! a project, until the matching EndBulkLoad
+   /*!
+    Overrides may read what they need of all stored blocks at once.
+    The default does nothing.
+    */
+   virtual void BeginBulkLoad();
+   virtual void EndBulkLoad();
+
 protected:
    // The override should throw more informative exceptions on error than the
    // default InconsistencyException thrown by Create
@@ -0,0 +1,120 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleBlockCache.cpp
+
+**********************************************************************/
+#include "SampleBlockCache.h"
+#include "Prefs.h"
+
+SampleBlockCache::SampleBlockCache(size_t budgetBytes)
+{
+   mStatistics.budget = budgetBytes;
+}
+
+SampleBlockCache::~SampleBlockCache() = default;
+
+size_t SampleBlockCache::Bytes(const Data &data)
+{
+   return data ? data->size() * sizeof(float) : 0;
+}
+
+auto SampleBlockCache::Find(SampleBlockID id) -> Data
+{
+   return Lookup(id, true);
+}
+
+auto SampleBlockCache::Peek(SampleBlockID id) -> Data
+{
+   return Lookup(id, false);
+}
+
+auto SampleBlockCache::Lookup(SampleBlockID id, bool count) -> Data
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   const auto iter = mMap.find(id);
+   if (iter == mMap.end()) {
+      if (count)
+         ++mStatistics.misses;
+      return {};
+   }
+   if (count)
+      ++mStatistics.hits;
+   // Move to the front
+   mList.splice(mList.begin(), mList, iter->second);
+   return iter->second->second;
+}
+
+void SampleBlockCache::Insert(SampleBlockID id, Data data)
+{
+   if (!data)
+      return;
+   std::lock_guard<std::mutex> lock{ mMutex };
+   if (Bytes(data) > mStatistics.budget)
+      // Would only flush everything else and then be evicted itself
+      return;
+   if (const auto iter = mMap.find(id); iter != mMap.end())
+      Evict(iter->second);
+   mStatistics.bytes += Bytes(data);
+   mList.emplace_front(id, std::move(data));
+   mMap.emplace(id, mList.begin());
+   Trim();
+   mStatistics.entries = mList.size();
+}
+
+void SampleBlockCache::Invalidate(SampleBlockID id)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   if (const auto iter = mMap.find(id); iter != mMap.end()) {
+      Evict(iter->second);
+      mStatistics.entries = mList.size();
+   }
+}
+
+void SampleBlockCache::Clear()
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   mMap.clear();
+   mList.clear();
+   mStatistics.bytes = 0;
+   mStatistics.entries = 0;
+}
+
+void SampleBlockCache::SetBudget(size_t budgetBytes)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   mStatistics.budget = budgetBytes;
+   Trim();
+   mStatistics.entries = mList.size();
+}
+
+auto SampleBlockCache::GetStatistics() const -> Statistics
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   return mStatistics;
+}
+
+void SampleBlockCache::ResetStatistics()
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   mStatistics.hits = mStatistics.misses = mStatistics.evictions = 0;
+}
+
+void SampleBlockCache::Evict(List::iterator iter)
+{
+   mStatistics.bytes -= Bytes(iter->second);
+   mMap.erase(iter->first);
+   mList.erase(iter);
+}
+
+void SampleBlockCache::Trim()
+{
+   while (mStatistics.bytes > mStatistics.budget && !mList.empty()) {
+      Evict(std::prev(mList.end()));
+      ++mStatistics.evictions;
+   }
+}
+
+IntSetting SampleBlockCacheSize{ L"/Directories/SampleBlockCacheSize", 64 };
@@ -0,0 +1,94 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleBlockCache.h
+
+  @brief A memory-bounded, least-recently-used cache of decoded sample blocks
+
+**********************************************************************/
+#ifndef __AUDACITY_SAMPLE_BLOCK_CACHE__
+#define __AUDACITY_SAMPLE_BLOCK_CACHE__
+
+#include "SampleBlock.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class IntSetting;
+
+//! Holds the float contents of recently read sample blocks, so that repeated
+//! reads of the same regions need not decode them again from storage
+/*!
+ Entries are shared pointers, so an eviction never invalidates a view that is
+ still in use; it only makes the cache forget it.
+
+ All member functions are thread-safe.
+ */
+class WAVE_TRACK_API SampleBlockCache final
+{
+public:
+   using Data = std::shared_ptr<std::vector<float>>;
+
+   struct Statistics
+   {
+      size_t hits{ 0 };
+      size_t misses{ 0 };
+      size_t evictions{ 0 };
+      size_t entries{ 0 };
+      size_t bytes{ 0 };
+      size_t budget{ 0 };
+   };
+
+   explicit SampleBlockCache(size_t budgetBytes);
+   ~SampleBlockCache();
+
+   SampleBlockCache(const SampleBlockCache&) = delete;
+   SampleBlockCache& operator=(const SampleBlockCache&) = delete;
+
+   //! @return the cached contents for the block, or null; counts a hit or miss
+   Data Find(SampleBlockID id);
+
+   //! Like Find, but counts neither a hit nor a miss, for lookups that read
+   //! storage directly when they miss, and so are not uses of the cache
+   Data Peek(SampleBlockID id);
+
+   //! Store contents for the block, making it most recently used, and evict
+   //! least recently used entries until the total fits the budget
+   void Insert(SampleBlockID id, Data data);
+
+   //! Forget the block, because its id was reassigned or its row was deleted
+   void Invalidate(SampleBlockID id);
+
+   void Clear();
+
+   //! Change the budget, evicting entries if it shrank
+   void SetBudget(size_t budgetBytes);
+
+   Statistics GetStatistics() const;
+   void ResetStatistics();
+
+private:
+   using Entry = std::pair<SampleBlockID, Data>;
+   using List = std::list<Entry>;
+
+   static size_t Bytes(const Data &data);
+   Data Lookup(SampleBlockID id, bool count);
+   void Evict(List::iterator iter);
+   void Trim();
+
+   mutable std::mutex mMutex;
+   //! Most recently used first
+   List mList;
+   std::unordered_map<SampleBlockID, List::iterator> mMap;
+   Statistics mStatistics;
+};
+
+//! Size of the cache of decoded sample blocks, in megabytes; zero disables it
+extern WAVE_TRACK_API IntSetting SampleBlockCacheSize;
+
+#endif
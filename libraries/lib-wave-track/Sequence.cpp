@@ -17,7 +17,7 @@
    A WaveClip contains a Sequence. A Sequence is primarily an
    interface to an array of SeqBlock instances, corresponding to
    the audio sample blocks in the database.
-   Contrast with RingBuffer.
+   Contrast with MultiChannelRingBuffer.
 
 *//****************************************************************//**
 
@@ -33,6 +33,7 @@
 
 #include <algorithm>
 #include <optional>
+#include <utility>
 #include <float.h>
 #include <math.h>
 
@@ -70,7 +71,14 @@ Sequence::Sequence(
    mMinSamples(orig.mMinSamples),
    mMaxSamples(orig.mMaxSamples)
 {
-   Paste(0, &orig);
+   if (orig.mpFactory == pFactory) {
+      // Same blocks, at the same positions; share the array of them too,
+      // until one of the sequences changes
+      mBlock = orig.mBlock;
+      mNumSamples = orig.mNumSamples;
+   }
+   else
+      Paste(0, &orig);
 }
 
 Sequence::~Sequence()
@@ -89,8 +97,8 @@ size_t Sequence::GetIdealBlockSize() const
 
 bool Sequence::CloseLock() noexcept
 {
-   for (unsigned int i = 0; i < mBlock.size(); i++)
-      mBlock[i].sb->CloseLock();
+   for (const auto &block : std::as_const(mBlock))
+      block.sb->CloseLock();
 
    return true;
 }
@@ -620,7 +628,8 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    // then resplit it all
    BlockArray newBlock;
    newBlock.reserve(numBlocks + srcNumBlocks + 2);
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b);
+   newBlock.insert(newBlock.end(),
+      std::as_const(mBlock).begin(), std::as_const(mBlock).begin() + b);
 
    SeqBlock &splitBlock = mBlock[b];
    auto splitLen = splitBlock.sb->GetSampleCount();
@@ -1132,14 +1141,19 @@ AudioSegmentSampleView Sequence::GetFloatSampleView(
    // `sequenceOffset` cannot be larger than `GetMaxBlockSize()`, a `size_t` =>
    // no narrowing possible.
    const auto sequenceOffset = (start - GetBlockStart(start)).as_size_t();
+   SampleBlockFactory::SampleBlockPtrs blocks;
    auto cursor = start;
-   while (cursor < start + length)
+   for (auto b = FindBlock(cursor); cursor < start + length; ++b)
    {
-      const auto b = FindBlock(cursor);
       const SeqBlock& block = mBlock[b];
-      blockViews.push_back(block.sb->GetFloatSampleView(mayThrow));
+      blocks.push_back(block.sb);
       cursor = block.start + block.sb->GetSampleCount();
    }
+   if (blocks.size() == 1)
+      blockViews.push_back(blocks.front()->GetFloatSampleView(mayThrow));
+   else
+      // Let the factory fetch all blocks of the span together
+      blockViews = mpFactory->GetFloatSampleViews(blocks, mayThrow);
    return { std::move(blockViews), sequenceOffset, length };
 }
 
@@ -1185,6 +1199,20 @@ bool Sequence::Get(samplePtr buffer, sampleFormat format,
 bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
+   if (format == floatSample &&
+      start + len > mBlock[b].start + mBlock[b].sb->GetSampleCount())
+      // The span crosses block boundaries; fetch all of the blocks together
+      try {
+         GetFloats(b, reinterpret_cast<float*>(buffer), start, len);
+         return true;
+      }
+      catch (...) {
+         if (mayThrow)
+            throw;
+         // Read each block alone, so that the readable ones are not lost
+         // and the failure is reported
+      }
+
    bool result = true;
    while (len) {
       const SeqBlock &block = mBlock[b];
@@ -1204,6 +1232,31 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    return result;
 }
 
+void Sequence::GetFloats(int b, float *buffer,
+   sampleCount start, size_t len) const
+{
+   SampleBlockFactory::SampleBlockPtrs blocks;
+   for (auto end = start + len, cursor = start; cursor < end; ++b) {
+      const SeqBlock &block = mBlock[b];
+      blocks.push_back(block.sb);
+      cursor = block.start + block.sb->GetSampleCount();
+   }
+   b -= blocks.size();
+
+   const auto views = mpFactory->GetFloatSampleViews(blocks, true);
+   for (const auto &view : views) {
+      const SeqBlock &block = mBlock[b++];
+      // start is in block
+      const auto bstart = (start - block.start).as_size_t();
+      // bstart is not more than block length
+      const auto blen = std::min(len, block.sb->GetSampleCount() - bstart);
+      std::copy_n(view->data() + bstart, blen, buffer);
+      len -= blen;
+      buffer += blen;
+      start += blen;
+   }
+}
+
 // Pass nullptr to set silence
 /*! @excsafety{Strong} */
 void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
@@ -1229,7 +1282,8 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
 
    int b = FindBlock(start);
    BlockArray newBlock;
-   std::copy( mBlock.begin(), mBlock.begin() + b, std::back_inserter(newBlock) );
+   const auto &blocks = std::as_const(mBlock);
+   std::copy( blocks.begin(), blocks.begin() + b, std::back_inserter(newBlock) );
 
    while (len > 0
       // Redundant termination condition,
@@ -1238,7 +1292,7 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
       // that cause the loop to make no progress because blen == 0
       && b < (int)size
    ) {
-      newBlock.push_back( mBlock[b] );
+      newBlock.push_back( blocks[b] );
       SeqBlock &block = newBlock.back();
       // start is within block
       const auto bstart = ( start - block.start ).as_size_t();
@@ -1315,7 +1369,7 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
       b++;
    }
 
-   std::copy( mBlock.begin() + b, mBlock.end(), std::back_inserter(newBlock) );
+   std::copy( blocks.begin() + b, blocks.end(), std::back_inserter(newBlock) );
 
    CommitChangesIfConsistent( newBlock, mNumSamples, wxT("SetSamples") );
 
@@ -1652,7 +1706,8 @@ void Sequence::Delete(sampleCount start, sampleCount len)
 
    // Copy the blocks before the deletion point over to
    // the NEW array
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b0);
+   newBlock.insert(newBlock.end(),
+      std::as_const(mBlock).begin(), std::as_const(mBlock).begin() + b0);
    unsigned int i;
 
    // First grab the samples in block b0 before the deletion point
@@ -1751,6 +1806,15 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       (newBlock, mNumSamples - len, wxT("Delete - branch two"));
 }
 
+size_t Sequence::GetMemoryUsage(SharedStorage &seen) const
+{
+   size_t result = sizeof(Sequence);
+   if (const auto storage = mBlock.GetStorage();
+       storage && seen.insert(storage).second)
+      result += mBlock.GetStorageBytes();
+   return result;
+}
+
 void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
 {
    ConsistencyCheck(mBlock, mMaxSamples, 0, mNumSamples, whereStr, mayThrow);
@@ -14,6 +14,8 @@
 
 #include <vector>
 #include <functional>
+#include <memory>
+#include <unordered_set>
 
 #include "SampleFormat.h"
 #include "XMLTagHandler.h"
@@ -47,7 +49,92 @@ class SeqBlock {
       return SeqBlock(sb, start + delta);
    }
 };
-class BlockArray : public std::vector<SeqBlock> {};
+
+//! Vector of blocks, sharing storage with its copies until one of them changes
+/*!
+ Copies of a sequence, such as those in undo history, then share the storage
+ of block pointers, instead of duplicating it in each state.
+
+ Non-const access first makes the storage unique, so code that only reads
+ should go through a const reference, to avoid needless copying.
+ */
+class BlockArray {
+public:
+   using Vector = std::vector<SeqBlock>;
+   using value_type = Vector::value_type;
+   using size_type = Vector::size_type;
+   using reference = Vector::reference;
+   using const_reference = Vector::const_reference;
+   using iterator = Vector::iterator;
+   using const_iterator = Vector::const_iterator;
+
+   size_type size() const { return Get().size(); }
+   bool empty() const { return Get().empty(); }
+   const_reference operator [](size_type ii) const { return Get()[ii]; }
+   const_reference front() const { return Get().front(); }
+   const_reference back() const { return Get().back(); }
+   const_iterator begin() const { return Get().begin(); }
+   const_iterator end() const { return Get().end(); }
+   const_iterator cbegin() const { return Get().cbegin(); }
+   const_iterator cend() const { return Get().cend(); }
+
+   reference operator [](size_type ii) { return Mutate()[ii]; }
+   reference front() { return Mutate().front(); }
+   reference back() { return Mutate().back(); }
+   iterator begin() { return Mutate().begin(); }
+   iterator end() { return Mutate().end(); }
+
+   void reserve(size_type size) { Mutate().reserve(size); }
+   void resize(size_type size) { Mutate().resize(size); }
+   void push_back(const SeqBlock &block) { Mutate().push_back(block); }
+   template<typename... Args> reference emplace_back(Args&&... args)
+   { return Mutate().emplace_back(std::forward<Args>(args)...); }
+   void pop_back() { Mutate().pop_back(); }
+   void clear() { mpBlocks.reset(); }
+   void swap(BlockArray &other) noexcept { mpBlocks.swap(other.mpBlocks); }
+
+   //! pos may have come from this array before it was made unique
+   template<typename Iterator>
+   iterator insert(const_iterator pos, Iterator first, Iterator last)
+   {
+      const auto offset = pos - Get().begin();
+      auto &blocks = Mutate();
+      return blocks.insert(blocks.begin() + offset, first, last);
+   }
+
+   //! first and last may have come from this array before it was made unique
+   iterator erase(const_iterator first, const_iterator last)
+   {
+      const auto offset = first - Get().begin();
+      const auto count = last - first;
+      auto &blocks = Mutate();
+      const auto start = blocks.begin() + offset;
+      return blocks.erase(start, start + count);
+   }
+
+   //! Identifies storage that may be shared with copies; null if empty
+   const void *GetStorage() const { return mpBlocks.get(); }
+   //! Bytes of storage that may be shared with copies
+   size_t GetStorageBytes() const
+   { return mpBlocks ? mpBlocks->capacity() * sizeof(SeqBlock) : 0; }
+
+private:
+   const Vector &Get() const
+   {
+      static const Vector empty;
+      return mpBlocks ? *mpBlocks : empty;
+   }
+   Vector &Mutate()
+   {
+      if (!mpBlocks)
+         mpBlocks = std::make_shared<Vector>();
+      else if (mpBlocks.use_count() > 1)
+         mpBlocks = std::make_shared<Vector>(*mpBlocks);
+      return *mpBlocks;
+   }
+
+   std::shared_ptr<Vector> mpBlocks;
+};
 using BlockPtrArray = std::vector<SeqBlock*>; // non-owning pointers
 
 class WAVE_TRACK_API Sequence final : public XMLTagHandler{
@@ -188,6 +275,12 @@ class WAVE_TRACK_API Sequence final : public XMLTagHandler{
 
    bool GetErrorOpening() const { return mErrorOpening; }
 
+   //! Storage, identified by address, that may be shared among objects
+   using SharedStorage = std::unordered_set<const void*>;
+   //! Estimated bytes of memory used by this, not counting storage in seen,
+   //! to which any shareable storage that is counted is added
+   size_t GetMemoryUsage(SharedStorage &seen) const;
+
    //
    // Lock all of this sequence's sample blocks, keeping them
    // from being destroyed when closing.
@@ -299,6 +392,14 @@ class WAVE_TRACK_API Sequence final : public XMLTagHandler{
             size_t len,
             bool mayThrow) const;
 
+   //! Read float samples spanning blocks `b` and following ones, fetching
+   //! all of those blocks together from the factory
+   /*! Throws if any of the blocks can't be read */
+   void GetFloats(int b,
+            float *buffer,
+            sampleCount start,
+            size_t len) const;
+
 public:
 
    //
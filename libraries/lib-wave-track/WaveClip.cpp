@@ -697,6 +697,17 @@ size_t WaveClip::CountBlocks() const
       return acc + pSequence->GetBlockArray().size(); });
 }
 
+size_t WaveClip::GetMemoryUsage(std::unordered_set<const void*> &seen) const
+{
+   size_t result = sizeof(WaveClip) + sizeof(Envelope) +
+      mEnvelope->GetNumberOfPoints() * sizeof(EnvPoint);
+   for (const auto &pSequence : mSequences)
+      result += pSequence->GetMemoryUsage(seen);
+   for (const auto &pCutLine : mCutLines)
+      result += pCutLine->GetMemoryUsage(seen);
+   return result;
+}
+
 //! A hint for sizing of well aligned fetches
 size_t WaveClip::GetBestBlockSize(sampleCount t) const
 {
@@ -25,6 +25,7 @@
 #include <cassert>
 #include <functional>
 #include <optional>
+#include <unordered_set>
 #include <vector>
 
 class BlockArray;
@@ -806,6 +807,10 @@ public:
 
    size_t CountBlocks() const;
 
+   //! Estimated bytes of memory used by this and its cutlines, not counting
+   //! storage in seen, to which any shareable storage that is counted is added
+   size_t GetMemoryUsage(std::unordered_set<const void*> &seen) const;
+
    //! Reduce width
    /*!
     @post `NChannels() == 1`
@@ -2530,6 +2530,14 @@ std::optional<TranslatableString> WaveTrack::GetErrorOpening() const
    return {};
 }
 
+size_t WaveTrack::GetMemoryUsage(SharedStorage &seen) const
+{
+   size_t result = sizeof(WaveTrack);
+   for (const auto &pClip : NarrowClips())
+      result += pClip->GetMemoryUsage(seen);
+   return result;
+}
+
 auto WaveTrack::GetLeftmostClip() -> IntervalHolder {
    auto clips = Intervals();
    if (clips.empty())
@@ -2721,6 +2729,12 @@ WaveTrack::GetSampleView(double t0, double t1, bool mayThrow) const
    return result;
 }
 
+void WaveTrack::Prefetch(double t0, double t1) const
+{
+   // Discard the views; the blocks remain in the factory's cache
+   GetSampleView(t0, t1, false);
+}
+
 ChannelSampleView
 WaveChannel::GetSampleView(double t0, double t1, bool mayThrow) const
 {
@@ -499,6 +499,9 @@ public:
    ChannelGroupSampleView
    GetSampleView(double t0, double t1, bool mayThrow = true) const;
 
+   //! Decode the blocks under [t0, t1) into the sample block cache
+   void Prefetch(double t0, double t1) const override;
+
    sampleFormat WidestEffectiveFormat() const override;
 
    bool HasTrivialEnvelope() const override;
@@ -529,6 +532,8 @@ public:
    // Returns true if an error occurred while reading from XML
    std::optional<TranslatableString> GetErrorOpening() const override;
 
+   size_t GetMemoryUsage(SharedStorage &seen) const override;
+
    //
    // Lock and unlock the track: you must lock the track before
    // doing a copy and paste between projects.
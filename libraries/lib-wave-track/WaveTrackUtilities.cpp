@@ -400,6 +400,46 @@ void WaveTrackUtilities::InspectBlocks(const TrackList &tracks,
    VisitBlocks(const_cast<TrackList &>(tracks), move(inspector), pIDs);
 }
 
+WaveTrackUtilities::SpilledWaveTracks::SpilledWaveTracks(
+   const TrackList &tracks)
+{
+   SampleBlockIDSet ids;
+   WaveTrackUtilities::InspectBlocks(tracks,
+      [this](std::shared_ptr<const SampleBlock> pBlock){
+         mBlocks.push_back(move(pBlock)); },
+      &ids);
+   mBlocks.shrink_to_fit();
+}
+
+WaveTrackUtilities::SpilledWaveTracks::~SpilledWaveTracks() = default;
+
+void WaveTrackUtilities::SpilledWaveTracks::InspectBlocks(
+   BlockInspector inspector, SampleBlockIDSet *pIDs) const
+{
+   for (const auto &pBlock : mBlocks) {
+      if (pIDs && !pIDs->insert(pBlock->GetBlockID()).second)
+         continue;
+      if (inspector)
+         inspector(pBlock);
+   }
+}
+
+size_t WaveTrackUtilities::SpilledWaveTracks::GetMemoryUsage(
+   std::unordered_set<const void*> &) const
+{
+   return sizeof(*this) + mBlocks.capacity() * sizeof(mBlocks[0]);
+}
+
+void WaveTrackUtilities::InspectBlocks(const UndoStackElem &state,
+   BlockInspector inspector, SampleBlockIDSet *pIDs)
+{
+   if (auto pTracks = UndoTracks::Find(state))
+      InspectBlocks(*pTracks, move(inspector), pIDs);
+   else if (auto pSpilled = dynamic_cast<const SpilledWaveTracks*>(
+      UndoTracks::FindSpilled(state)))
+      pSpilled->InspectBlocks(move(inspector), pIDs);
+}
+
 WaveTrack::IntervalConstHolders
 WaveTrackUtilities::GetClipsIntersecting(const WaveTrack &track,
    double t0, double t1)
@@ -14,6 +14,7 @@
 #define __AUDACITY_WAVE_TRACK_UTILITIES__
 
 #include "IteratorX.h"
+#include "UndoTracks.h"
 #include "WaveTrack.h"
 #include <unordered_set>
 
@@ -21,6 +22,7 @@ class SampleBlock;
 class sampleCount;
 class TrackList;
 class WaveTrack;
+struct UndoStackElem;
 
 #include <functional>
 using ProgressReporter = std::function<void(double)>;
@@ -181,6 +183,29 @@ WAVE_TRACK_API void VisitBlocks(TrackList &tracks, BlockVisitor visitor,
 WAVE_TRACK_API void InspectBlocks(const TrackList &tracks,
    BlockInspector inspector, SampleBlockIDSet *pIDs = nullptr);
 
+//! Base class for spilled copies of tracks, which keeps their sample blocks
+//! alive, so that they remain in storage until the tracks are restored
+class WAVE_TRACK_API SpilledWaveTracks /* not final */
+   : public UndoTracks::SpilledTracks
+{
+public:
+   explicit SpilledWaveTracks(const TrackList &tracks);
+   ~SpilledWaveTracks() override;
+
+   //! Like the other InspectBlocks, but for the blocks of the spilled tracks
+   void InspectBlocks(BlockInspector inspector, SampleBlockIDSet *pIDs) const;
+
+   size_t GetMemoryUsage(std::unordered_set<const void*> &seen) const override;
+
+private:
+   std::vector<std::shared_ptr<const SampleBlock>> mBlocks;
+};
+
+//! Like the other InspectBlocks, for the tracks of an undo state, whether in
+//! memory or spilled
+WAVE_TRACK_API void InspectBlocks(const UndoStackElem &state,
+   BlockInspector inspector, SampleBlockIDSet *pIDs = nullptr);
+
 /*!
  @pre t0 <= t1
  */
@@ -0,0 +1,135 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockArrayTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "Sequence.h"
+
+#include <utility>
+#include <vector>
+
+namespace {
+// Blocks are told apart by their starts; no sample blocks are needed
+BlockArray MakeArray(std::initializer_list<long long> starts)
+{
+   BlockArray result;
+   for (const auto start : starts)
+      result.emplace_back(nullptr, start);
+   return result;
+}
+
+std::vector<long long> Starts(const BlockArray &blocks)
+{
+   std::vector<long long> result;
+   for (const auto &block : blocks)
+      result.push_back(block.start.as_long_long());
+   return result;
+}
+
+using Starts_t = std::vector<long long>;
+}
+
+TEST_CASE("BlockArray copy on write", "[BlockArray]")
+{
+   auto original = MakeArray({ 0, 10, 20 });
+   REQUIRE(original.GetStorage() != nullptr);
+   REQUIRE(original.GetStorageBytes() >= 3 * sizeof(SeqBlock));
+
+   SECTION("An empty array has no storage")
+   {
+      const BlockArray empty;
+      REQUIRE(empty.GetStorage() == nullptr);
+      REQUIRE(empty.GetStorageBytes() == 0);
+      REQUIRE(empty.begin() == empty.end());
+   }
+
+   SECTION("Copies share storage")
+   {
+      const auto copy = original;
+      REQUIRE(copy.GetStorage() == original.GetStorage());
+      REQUIRE(Starts(copy) == Starts_t{ 0, 10, 20 });
+   }
+
+   SECTION("Const access does not unshare")
+   {
+      const auto copy = original;
+      const auto &constOriginal = original;
+      (void) constOriginal[1];
+      (void) constOriginal.begin();
+      (void) constOriginal.back();
+      REQUIRE(copy.GetStorage() == original.GetStorage());
+   }
+
+   SECTION("Mutation unshares, leaving the copy unchanged")
+   {
+      auto copy = original;
+      copy[1].start = 15;
+      REQUIRE(copy.GetStorage() != original.GetStorage());
+      REQUIRE(Starts(copy) == Starts_t{ 0, 15, 20 });
+      REQUIRE(Starts(original) == Starts_t{ 0, 10, 20 });
+
+      // Now unique, so mutating again does not reallocate
+      const auto storage = copy.GetStorage();
+      copy.push_back({ nullptr, 30 });
+      copy.pop_back();
+      REQUIRE(copy.GetStorage() == storage);
+   }
+
+   SECTION("Clearing forgets only this array's share")
+   {
+      auto copy = original;
+      copy.clear();
+      REQUIRE(copy.empty());
+      REQUIRE(copy.GetStorage() == nullptr);
+      REQUIRE(Starts(original) == Starts_t{ 0, 10, 20 });
+   }
+
+   SECTION("Swap exchanges storage without copying")
+   {
+      auto other = MakeArray({ 5 });
+      const auto storage = original.GetStorage();
+      const auto otherStorage = other.GetStorage();
+      original.swap(other);
+      REQUIRE(original.GetStorage() == otherStorage);
+      REQUIRE(other.GetStorage() == storage);
+   }
+
+   SECTION("Insert accepts a position taken before unsharing")
+   {
+      auto copy = original;
+      const auto &constCopy = copy;
+      // Still pointing into the shared storage
+      const auto pos = constCopy.begin() + 1;
+      const auto more = MakeArray({ 1, 2 });
+      const auto result = copy.insert(pos, more.begin(), more.end());
+      REQUIRE(copy.GetStorage() != original.GetStorage());
+      REQUIRE(result == copy.begin() + 1);
+      REQUIRE(Starts(copy) == Starts_t{ 0, 1, 2, 10, 20 });
+      REQUIRE(Starts(original) == Starts_t{ 0, 10, 20 });
+   }
+
+   SECTION("Insert into an array without storage")
+   {
+      BlockArray empty;
+      const auto more = MakeArray({ 1, 2 });
+      empty.insert(std::as_const(empty).end(), more.begin(), more.end());
+      REQUIRE(Starts(empty) == Starts_t{ 1, 2 });
+   }
+
+   SECTION("Erase accepts a range taken before unsharing")
+   {
+      auto copy = original;
+      const auto &constCopy = copy;
+      const auto first = constCopy.begin() + 1, last = constCopy.end();
+      const auto result = copy.erase(first, last);
+      REQUIRE(copy.GetStorage() != original.GetStorage());
+      REQUIRE(result == copy.end());
+      REQUIRE(Starts(copy) == Starts_t{ 0 });
+      REQUIRE(Starts(original) == Starts_t{ 0, 10, 20 });
+   }
+}
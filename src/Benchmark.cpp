@@ -18,6 +18,11 @@ of sample block storage.
 
 #include "Benchmark.h"
 
+#include <cmath>
+#include <limits>
+#include <random>
+#include <utility>
+
 #include <wx/app.h>
 #include <wx/log.h>
 #include <wx/textctrl.h>
@@ -28,16 +33,22 @@ of sample block storage.
 #include <wx/valgen.h>
 #include <wx/valtext.h>
 
+#include "FFT.h"
 #include "Project.h"
 #include "ProjectTimeSignature.h"
 #include "SampleBlock.h"
 #include "ShuttleGui.h"
+#include "SpectrumAnalyst.h"
 #include "TempoChange.h"
 #include "WaveClip.h"
 #include "WaveTrack.h"
 #include "Sequence.h"
+#include "effects/NoiseReduction.h"
 #include "Prefs.h"
 #include "ProjectRate.h"
+#include "prefs/SpectrogramSettings.h"
+#include "tracks/playabletrack/wavetrack/ui/SpectrumCache.h"
+#include "tracks/playabletrack/wavetrack/ui/WaveClipUIUtilities.h"
 
 #include "FileNames.h"
 #include "SelectFile.h"
@@ -573,6 +584,177 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    Printf( XO("At 44100 Hz, %d bytes per sample, the estimated number of\n simultaneous tracks that could be played at once: %.1f\n" )
       .Format( SAMPLE_SIZE(SampleFormat), (nChunks*chunkSize/44100.0)/(elapsed/1000.0) ) );
 
+   Printf( XO("Computing spectrograms...\n") );
+   wxTheApp->Yield();
+   FlushPrint();
+
+   {
+      // Compare serial and parallel computation of the same columns, which
+      // must give identical results
+      auto &clip = *t->GetClip(0);
+      const WaveClipChannel channel{ clip, 0 };
+      const size_t numPixels = 4000;
+      const auto sampleRate = clip.GetRate();
+      const auto stretchRatio = clip.GetStretchRatio();
+      const auto samplesPerPixel = std::max(1.0,
+         clip.GetVisibleSampleCount().as_double() / numPixels);
+      const auto pixelsPerSecond = sampleRate / samplesPerPixel / stretchRatio;
+
+      SpectrogramSettings settings{ SpectrogramSettings::defaults() };
+      const auto populate = [&](SpecCache &cache, size_t maxThreads) {
+         cache.Grow(numPixels, settings, samplesPerPixel, 0);
+         // Reassignment accumulates, so it needs a zeroed buffer
+         std::fill(cache.freq.begin(), cache.freq.end(), 0.0f);
+         constexpr auto addBias = true;
+         WaveClipUIUtilities::fillWhere(cache.where, numPixels, addBias,
+            0.0, 0.0, sampleRate, stretchRatio, samplesPerPixel);
+         timer.Start();
+         cache.Populate(
+            settings, channel, 0, 0, numPixels, pixelsPerSecond, maxThreads);
+         return timer.Time();
+      };
+
+      for (const auto algorithm : {
+         SpectrogramSettings::algSTFT, SpectrogramSettings::algReassignment
+      }) {
+         settings.algorithm = algorithm;
+         SpecCache serial, parallel;
+         const auto serialElapsed = populate(serial, 1);
+         const auto parallelElapsed = populate(parallel, 0);
+         Printf( XO("Time to compute %lld %s columns: %ld ms serially, %ld ms in parallel\n")
+            .Format( (long long)numPixels,
+               algorithm == SpectrogramSettings::algSTFT
+                  ? wxT("STFT") : wxT("reassignment"),
+               serialElapsed, parallelElapsed ) );
+         if (0 != memcmp(serial.freq.data(), parallel.freq.data(),
+            serial.freq.size() * sizeof(float))) {
+            Printf( XO("Parallel spectrogram differs from serial.\n") );
+            goto fail;
+         }
+      }
+   }
+
+   Printf( XO("Plotting spectra...\n") );
+   wxTheApp->Yield();
+   FlushPrint();
+
+   {
+      // Compare serial and parallel analysis of all the data, streamed from
+      // the track as Plot Spectrum does, which must give identical results
+      const auto dataLen = limitSampleBufferSize(
+         std::numeric_limits<size_t>::max(), nChunks * chunkSize);
+      const auto source = [&](size_t start, size_t len, float *buffer){
+         return t->GetFloats(0, 1, &buffer, start, len,
+            false, FillFormat::fillZero, false);
+      };
+      const auto analyze = [&](SpectrumAnalyst &analyst,
+         SpectrumAnalyst::Algorithm algorithm, size_t maxThreads
+      ){
+         timer.Start();
+         if (!analyst.Calculate(algorithm, eWinFuncHann, 4096, mRate.GetRate(),
+            source, dataLen, nullptr, nullptr, nullptr, {}, maxThreads))
+            return -1L;
+         return timer.Time();
+      };
+
+      for (const auto algorithm : {
+         SpectrumAnalyst::Spectrum, SpectrumAnalyst::EnhancedAutocorrelation
+      }) {
+         SpectrumAnalyst serial, parallel;
+         const auto serialElapsed = analyze(serial, algorithm, 1);
+         const auto parallelElapsed = analyze(parallel, algorithm, 0);
+         Printf( XO("Time to plot %s of %lld samples: %ld ms serially, %ld ms in parallel\n")
+            .Format(
+               algorithm == SpectrumAnalyst::Spectrum
+                  ? wxT("spectrum") : wxT("enhanced autocorrelation"),
+               (long long)dataLen, serialElapsed, parallelElapsed ) );
+         if (serialElapsed < 0 || parallelElapsed < 0 ||
+            serial.GetProcessedSize() != parallel.GetProcessedSize() ||
+            0 != memcmp(serial.GetProcessed(), parallel.GetProcessed(),
+               serial.GetProcessedSize() * sizeof(float))) {
+            Printf( XO("Parallel spectrum plot differs from serial.\n") );
+            goto fail;
+         }
+      }
+   }
+
+   Printf( XO("Reducing noise...\n") );
+   wxTheApp->Yield();
+   FlushPrint();
+
+   {
+      // Compare serial and parallel noise reduction of stereo tracks, which
+      // must give identical results.  The long selection spans several
+      // segments of the parallel pass and the seams between them; the short
+      // one starts between steps and is shorter than one segment.
+      const double rate = 44100;
+      const auto len = static_cast<size_t>(30 * rate);
+      const auto makeTracks = [&](size_t length, bool tones) {
+         const auto track = WaveTrackFactory{ mRate,
+            SampleBlockFactory::New( mProject ) }
+               .Create(2, floatSample, rate);
+         std::minstd_rand engine{ static_cast<unsigned>(randSeed) };
+         std::uniform_real_distribution<float> distribution{ -0.05f, 0.05f };
+         std::vector<float> buffer(length);
+         for (size_t iChannel = 0; iChannel < 2; ++iChannel) {
+            for (size_t ii = 0; ii < length; ++ii) {
+               buffer[ii] = distribution(engine);
+               // Tones that start and stop, so that gains attack and release
+               if (tones && (ii / (length / 23)) % 3 == 1)
+                  buffer[ii] += 0.5f * std::sin(
+                     2 * M_PI * 440 * (iChannel + 1) * ii / rate);
+            }
+            track->Append(iChannel,
+               reinterpret_cast<constSamplePtr>(buffer.data()),
+               floatSample, length);
+         }
+         track->Flush();
+         track->SetSelected(true);
+         return TrackList::Temporary(nullptr, track);
+      };
+      const auto noise = makeTracks(static_cast<size_t>(rate), false);
+      const auto reduce = [&](TrackList &tracks,
+         double t0, double t1, size_t maxThreads
+      ){
+         timer.Start();
+         if (!EffectNoiseReduction::ReduceNoise(
+            *noise, tracks, t0, t1, maxThreads))
+            return -1L;
+         return timer.Time();
+      };
+
+      for (const auto &[t0, t1] : {
+         std::pair{ 0.0, len / rate }, std::pair{ 1.2345, 3.0 }
+      }) {
+         const auto serial = makeTracks(len, true);
+         const auto parallel = makeTracks(len, true);
+         const auto serialElapsed = reduce(*serial, t0, t1, 1);
+         const auto parallelElapsed = reduce(*parallel, t0, t1, 0);
+         Printf( XO("Time to reduce noise in %.1f s of stereo: %ld ms serially, %ld ms in parallel\n")
+            .Format( t1 - t0, serialElapsed, parallelElapsed ) );
+
+         const auto &serialTrack = **serial->Any<const WaveTrack>().begin();
+         const auto &parallelTrack =
+            **parallel->Any<const WaveTrack>().begin();
+         std::vector<float> serialLeft(len), serialRight(len),
+            parallelLeft(len), parallelRight(len);
+         float *const serialBuffers[]{ serialLeft.data(), serialRight.data() };
+         float *const parallelBuffers[]{
+            parallelLeft.data(), parallelRight.data() };
+         if (serialElapsed < 0 || parallelElapsed < 0 ||
+            serialTrack.GetEndTime() != parallelTrack.GetEndTime() ||
+            !serialTrack.GetFloats(0, 2, serialBuffers, 0, len, false) ||
+            !parallelTrack.GetFloats(0, 2, parallelBuffers, 0, len, false) ||
+            0 != memcmp(serialLeft.data(), parallelLeft.data(),
+               len * sizeof(float)) ||
+            0 != memcmp(serialRight.data(), parallelRight.data(),
+               len * sizeof(float))) {
+            Printf( XO("Parallel noise reduction differs from serial.\n") );
+            goto fail;
+         }
+      }
+   }
+
    goto success;
 
  fail:
@@ -34,6 +34,7 @@ the mouse around.
 #include "FreqWindow.h"
 
 #include <algorithm>
+#include <limits>
 
 #include <wx/setup.h> // for wxUSE_* macros
 
@@ -57,6 +58,7 @@ the mouse around.
 
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
+#include <wx/utils.h>
 
 #include <math.h>
 
@@ -583,82 +585,76 @@ bool FrequencyPlotDialog::Show(bool show)
 
 bool FrequencyPlotDialog::GetAudio()
 {
-   mData.reset();
+   mTracks.clear();
    mDataLen = 0;
 
-   int selcount = 0;
-   bool warning = false;
+   auto &selectedRegion = ViewInfo::Get(*mProject).selectedRegion;
+   const auto t0 = selectedRegion.t0(), t1 = selectedRegion.t1();
    for (auto track :
       TrackList::Get(*mProject).Selected<const WaveTrack>()
    ) {
-      auto &selectedRegion = ViewInfo::Get(*mProject).selectedRegion;
-      auto start = track->TimeToLongSamples(selectedRegion.t0());
-      if (selcount == 0) {
+      if (mTracks.empty()) {
          mRate = track->GetRate();
-         auto end = track->TimeToLongSamples(selectedRegion.t1());
-         auto dataLen = end - start;
-         // Permit approximately 46.60 minutes of selected samples at
-         // a sampling frequency of 48 kHz (11.65 minutes at 192 kHz).
-         auto maxDataLen = size_t(2) << 26;
-         if (dataLen > maxDataLen) {
-            warning = true;
-            mDataLen = maxDataLen;
-         }
-         else
-            mDataLen = dataLen.as_size_t();
-         mData = Floats{ mDataLen };
+         mStart = track->TimeToLongSamples(t0);
+         auto end = track->TimeToLongSamples(t1);
+         // Samples are read in chunks, so there is no limit but the size
+         // type
+         mDataLen = limitSampleBufferSize(
+            std::numeric_limits<size_t>::max(), end - mStart);
       }
-      const auto nChannels = track->NChannels();
       if (track->GetRate() != mRate) {
          using namespace BasicUI;
          ShowMessageBox(
             XO("To plot the spectrum, all selected tracks must have the same sample rate."),
             MessageBoxOptions {}.Caption(XO("Error")).IconStyle(Icon::Error));
-         mData.reset();
+         mTracks.clear();
          mDataLen = 0;
          return false;
       }
-      Floats buffer1{ mDataLen };
-      Floats buffer2{ mDataLen };
-      float *const buffers[]{ buffer1.get(), buffer2.get() };
-      // Don't allow throw for bad reads
-      if (!track->GetFloats(
-             0, nChannels, buffers, start, mDataLen, false,
-             FillFormat::fillZero, false))
-      {
-         using namespace BasicUI;
-         ShowMessageBox(
-            XO("Audio could not be analyzed. This may be due to a stretched or pitch-shifted clip.\nTry resetting any stretched clips, or mixing and rendering the tracks before analyzing"),
-            MessageBoxOptions {}.Caption(XO("Error")).IconStyle(Icon::Error));
-         mData.reset();
-         mDataLen = 0;
-         return false;
-      }
-      size_t iChannel = 0;
-      if (selcount == 0) {
-         // First channel -- assign into mData
-         for (size_t i = 0; i < mDataLen; i++)
-            mData[i] = buffers[0][i];
-         ++iChannel;
-      }
-      // Later channels -- accumulate
-      for (; iChannel < nChannels; ++iChannel) {
-         const auto buffer = buffers[iChannel];
-         for (size_t i = 0; i < mDataLen; i++)
-            mData[i] += buffer[i];
-      }
-      ++selcount;
+      // Reading would fail later
+      for (const auto &interval : track->Intervals())
+         if (interval->IntersectsPlayRegion(t0, t1) &&
+             interval->HasPitchOrSpeed()) {
+            ShowReadError();
+            mTracks.clear();
+            mDataLen = 0;
+            return false;
+         }
+      // A snapshot, so that later edits don't change the plot until Replot;
+      // cheap, because sample blocks are shared
+      mTracks.push_back(
+         track->Duplicate()->SharedPointer<const WaveTrack>());
    }
 
-   if (selcount == 0)
-      return false;
+   return !mTracks.empty();
+}
 
-   if (warning) {
-      auto msg = XO(
-"Too much audio was selected. Only the first %.1f seconds of audio will be analyzed.")
-         .Format(mDataLen / mRate);
-      AudacityMessageBox( msg );
-   }
+void FrequencyPlotDialog::ShowReadError()
+{
+   using namespace BasicUI;
+   ShowMessageBox(
+      XO("Audio could not be analyzed. This may be due to a stretched or pitch-shifted clip.\nTry resetting any stretched clips, or mixing and rendering the tracks before analyzing"),
+      MessageBoxOptions {}.Caption(XO("Error")).IconStyle(Icon::Error));
+}
+
+bool FrequencyPlotDialog::ReadSamples(
+   size_t start, size_t len, float *buffer) const
+{
+   // Sum all channels of all tracks
+   std::fill(buffer, buffer + len, 0.0f);
+   Floats channelBuffer{ len };
+   float *const buffers[]{ channelBuffer.get() };
+   for (const auto &pTrack : mTracks)
+      for (size_t iChannel = 0, nChannels = pTrack->NChannels();
+         iChannel < nChannels; ++iChannel
+      ) {
+         // Don't allow throw for bad reads
+         if (!pTrack->GetFloats(iChannel, 1, buffers, mStart + start, len,
+               false, FillFormat::fillZero, false))
+            return false;
+         for (size_t i = 0; i < len; i++)
+            buffer[i] += channelBuffer[i];
+      }
    return true;
 }
 
@@ -695,7 +691,7 @@ void FrequencyPlotDialog::DrawBackground(wxMemoryDC & dc)
 
 void FrequencyPlotDialog::DrawPlot()
 {
-   if (!mData || mDataLen < mWindowSize || mAnalyst->GetProcessedSize() == 0) {
+   if (mTracks.empty() || mDataLen < mWindowSize || mAnalyst->GetProcessedSize() == 0) {
       wxMemoryDC memDC;
 
       vRuler->ruler.SetUpdater(&LinearUpdater::Instance());
@@ -913,7 +909,7 @@ void FrequencyPlotDialog::PlotPaint(wxPaintEvent & event)
 
    dc.DrawBitmap( *mBitmap, 0, 0, true );
    // Fix for Bug 1226 "Plot Spectrum freezes... if insufficient samples selected"
-   if (!mData || mDataLen < mWindowSize)
+   if (mTracks.empty() || mDataLen < mWindowSize)
       return;
 
    dc.SetFont(mFreqFont);
@@ -1023,7 +1019,7 @@ void FrequencyPlotDialog::OnCloseButton(wxCommandEvent & WXUNUSED(event))
    gPrefs->Write(wxT("/FrequencyPlotDialog/FuncChoice"), mFuncChoice->GetSelection());
    gPrefs->Write(wxT("/FrequencyPlotDialog/AxisChoice"), mAxisChoice->GetSelection());
    gPrefs->Flush();
-   mData.reset();
+   mTracks.clear();
    Show(false);
 }
 
@@ -1035,7 +1031,7 @@ void FrequencyPlotDialog::SendRecalcEvent()
 
 void FrequencyPlotDialog::Recalc()
 {
-   if (!mData || mDataLen < mWindowSize) {
+   if (mTracks.empty() || mDataLen < mWindowSize) {
       DrawPlot();
       return;
    }
@@ -1049,20 +1045,34 @@ void FrequencyPlotDialog::Recalc()
    // just the mProgress window with the idea of preventing user interaction with the
    // controls while the plot was being recalculated.  This doesn't appear to be necessary
    // so just use the top level window instead.
+   bool cancelled = false;
+   bool ok;
    {
       std::optional<wxWindowDisabler> blocker;
       if (IsShown())
          blocker.emplace(this);
       wxYieldIfNeeded();
 
-      mAnalyst->Calculate(alg, windowFunc, mWindowSize, mRate,
-         mData.get(), mDataLen,
-         &mYMin, &mYMax, mProgress);
+      // The dialog is disabled, so poll the Escape key to cancel long
+      // selections
+      ok = mAnalyst->Calculate(alg, windowFunc, mWindowSize, mRate,
+         [this](size_t start, size_t len, float *buffer){
+            return ReadSamples(start, len, buffer);
+         }, mDataLen,
+         &mYMin, &mYMax, mProgress,
+         [&cancelled]{ return cancelled = wxGetKeyState(WXK_ESCAPE); });
    }
    if (hadFocus) {
       hadFocus->SetFocus();
    }
 
+   if (!ok) {
+      if (!cancelled)
+         ShowReadError();
+      DrawPlot();
+      return;
+   }
+
    if (alg == SpectrumAnalyst::Spectrum) {
       if(mYMin < -dBRange)
          mYMin = -dBRange;
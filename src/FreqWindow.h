@@ -11,10 +11,12 @@
 #ifndef __AUDACITY_FREQ_WINDOW__
 #define __AUDACITY_FREQ_WINDOW__
 
+#include <memory>
 #include <vector>
 #include <wx/font.h> // member variable
 #include <wx/statusbr.h> // to inherit
 #include "Prefs.h"
+#include "SampleCount.h"
 #include "SampleFormat.h"
 #include "SpectrumAnalyst.h"
 #include "wxPanelWrapper.h" // to inherit
@@ -31,6 +33,7 @@ class AudacityProject;
 class FrequencyPlotDialog;
 class FreqGauge;
 class RulerPanel;
+class WaveTrack;
 
 DECLARE_EXPORTED_EVENT_TYPE(AUDACITY_DLL_API, EVT_FREQWINDOW_RECALC, -1);
 
@@ -68,6 +71,9 @@ private:
    void Populate();
 
    bool GetAudio();
+   void ShowReadError();
+   //! A SpectrumAnalyst::SampleSource summing the channels of mTracks
+   bool ReadSamples(size_t start, size_t len, float *buffer) const;
 
    void PlotMouseEvent(wxMouseEvent & event);
    void PlotPaint(wxPaintEvent & event);
@@ -138,7 +144,10 @@ private:
 
    double mRate;
    size_t mDataLen;
-   Floats mData;
+   //! Copies of the selected tracks, sharing their sample blocks, which are
+   //! read again in chunks for each recalculation
+   std::vector<std::shared_ptr<const WaveTrack>> mTracks;
+   sampleCount mStart;
    size_t mWindowSize;
 
    bool mLogAxis;
@@ -56,7 +56,8 @@ struct SpaceUsageCalculator {
    using Type = unsigned long long;
    using SpaceArray = std::vector<Type> ;
 
-   Type CalculateUsage(const TrackList &tracks, SampleBlockIDSet &seen)
+   template<typename Tracks>
+   Type CalculateUsage(const Tracks &tracks, SampleBlockIDSet &seen)
    {
       Type result = 0;
       //TIMER_START( "CalculateSpaceUsage", space_calc );
@@ -92,9 +93,8 @@ struct SpaceUsageCalculator {
 
       manager.VisitStates(
          [this, &seen](const UndoStackElem &elem) {
-            // Scan all tracks at current level
-            if (auto pTracks = UndoTracks::Find(elem))
-               space.push_back(CalculateUsage(*pTracks, seen));
+            // Scan all tracks at current level, even if spilled
+            space.push_back(CalculateUsage(elem, seen));
          },
          true // newest state first
       );
@@ -176,7 +176,8 @@ void HistoryDialog::Populate(ShuttleGui & S)
             .ConnectRoot(wxEVT_KEY_DOWN, &HistoryDialog::OnListKeyDown)
             .AddListControlReportMode(
                { { XO("Action"), wxLIST_FORMAT_LEFT, 260 },
-                 { XO("Used Space"), wxLIST_FORMAT_LEFT, 125 } },
+                 { XO("Used Space"), wxLIST_FORMAT_LEFT, 125 },
+                 { XO("Memory"), wxLIST_FORMAT_LEFT, 100 } },
                wxLC_SINGLE_SEL
             );
 
@@ -232,7 +233,8 @@ void HistoryDialog::Populate(ShuttleGui & S)
    Layout();
    Fit();
    SetMinSize(GetSize());
-   mList->SetColumnWidth(0, mList->GetClientSize().x - mList->GetColumnWidth(1));
+   mList->SetColumnWidth(0, mList->GetClientSize().x
+      - mList->GetColumnWidth(1) - mList->GetColumnWidth(2));
    mList->SetTextColour(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT));
 }
 
@@ -290,6 +292,7 @@ void HistoryDialog::DoUpdate()
 
    // point to size for oldest state
    auto iter = calculator.space.rbegin();
+   const auto memory = mManager->GetMemoryUsage();
 
    mList->DeleteAllItems();
 
@@ -303,6 +306,7 @@ void HistoryDialog::DoUpdate()
          const auto &desc = elem.description;
          mList->InsertItem(i, desc.Translation(), i == mSelected ? 1 : 0);
          mList->SetItem(i, 1, size.Translation());
+         mList->SetItem(i, 2, Internat::FormatSize(memory[i]).Translation());
          ++i;
       },
       false // oldest state first
@@ -384,6 +388,7 @@ void HistoryDialog::OnCompact(wxCommandEvent & WXUNUSED(event))
    auto before = baseFile.GetSize() + walFile.GetSize();
 
    projectFileIO.Compact({}, true);
+   projectFileIO.WaitForCompaction();
 
    auto after = baseFile.GetSize() + walFile.GetSize();
 
@@ -462,7 +467,8 @@ void HistoryDialog::OnShow(wxShowEvent & event)
 void HistoryDialog::OnSize(wxSizeEvent & WXUNUSED(event))
 {
    Layout();
-   mList->SetColumnWidth(0, mList->GetClientSize().x - mList->GetColumnWidth(1));
+   mList->SetColumnWidth(0, mList->GetClientSize().x
+      - mList->GetColumnWidth(1) - mList->GetColumnWidth(2));
    if (mList->GetItemCount() > 0)
       mList->EnsureVisible(mSelected);
 }
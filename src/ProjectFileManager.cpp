@@ -1713,6 +1713,7 @@ void ProjectFileManager::Compact()
       auto before = wxFileName::GetSize(projectFileIO.GetFileName());
 
       projectFileIO.Compact(trackLists, true);
+      projectFileIO.WaitForCompaction();
 
       auto after = wxFileName::GetSize(projectFileIO.GetFileName());
 
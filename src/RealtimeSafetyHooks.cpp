@@ -0,0 +1,86 @@
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file RealtimeSafetyHooks.cpp
+  @brief Interceptors of allocation and locking, for RealtimeSafety
+
+  Replacements of the global operator new and operator delete must be
+  defined once in the program, so they are here and not in lib-utility.
+
+  On Windows, the replacements see only allocations by code in the
+  executable, because each module links its own.  Locks are intercepted only
+  on Linux, and only when configured with audacity_realtime_safety_locks,
+  because every lock in the program then goes through the interceptor.
+
+**********************************************************************/
+#include "RealtimeSafety.h"
+
+#ifndef NDEBUG
+
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__) && defined(REALTIME_SAFETY_LOCKS)
+#include <atomic>
+#include <cerrno>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// The default array and nothrow forms call these
+
+void *operator new(std::size_t size)
+{
+   RealtimeSafety::Check("allocation");
+   if (const auto result = std::malloc(size ? size : 1))
+      return result;
+   throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept
+{
+   if (ptr)
+      RealtimeSafety::Check("deallocation");
+   std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+   ::operator delete(ptr);
+}
+
+#if defined(__linux__) && defined(REALTIME_SAFETY_LOCKS)
+namespace {
+using LockFunction = int(*)(pthread_mutex_t *);
+
+//! Null until static initialization resolves it
+std::atomic<LockFunction> sNextLock{ nullptr };
+
+//! Resolve the next definition once, at startup and not in a real-time
+//! thread.  dlsym may itself lock, which the interceptor handles.
+[[maybe_unused]] const bool sResolved = []{
+   sNextLock.store(reinterpret_cast<LockFunction>(
+      dlsym(RTLD_NEXT, "pthread_mutex_lock")));
+   return true;
+}();
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+   const auto next = sNextLock.load();
+   if (!next) {
+      // Before resolution, or during it; pthread_mutex_trylock is not
+      // intercepted
+      int rc;
+      while ((rc = pthread_mutex_trylock(mutex)) == EBUSY)
+         sched_yield();
+      return rc;
+   }
+   RealtimeSafety::Check("mutex lock");
+   return next(mutex);
+}
+#endif
+
+#endif
@@ -26,6 +26,9 @@ and in the spectrogram spectral selection.
 #include "FFT.h"
 
 #include "SampleFormat.h"
+#include "concurrency/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
 #include <wx/dcclient.h>
 
 FreqGauge::FreqGauge(wxWindow * parent, wxWindowID winid)
@@ -88,11 +91,110 @@ SpectrumAnalyst::~SpectrumAnalyst()
 {
 }
 
+namespace {
+//! Samples spanned by the windows of one task.  Tasks don't depend on the
+//! number of threads, and their sums are added in order, so that results
+//! don't either.
+constexpr size_t SamplesPerTask = 1 << 18;
+
+//! Add the analysis of one windowed block `in` into `sums`
+/*! `in`, `out`, and `out2` are `windowSize` scratch; `in` is overwritten */
+void AnalyzeWindow(SpectrumAnalyst::Algorithm alg, size_t windowSize,
+   float *in, float *out, float *out2, double *sums)
+{
+   const auto half = windowSize / 2;
+   switch (alg) {
+      case SpectrumAnalyst::Spectrum:
+         PowerSpectrum(windowSize, in, out);
+
+         for (size_t i = 0; i < half; i++)
+            sums[i] += out[i];
+         break;
+
+      case SpectrumAnalyst::Autocorrelation:
+      case SpectrumAnalyst::CubeRootAutocorrelation:
+      case SpectrumAnalyst::EnhancedAutocorrelation:
+
+         // Take FFT
+         RealFFT(windowSize, in, out, out2);
+         // Compute power
+         for (size_t i = 0; i < windowSize; i++)
+            in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+
+         if (alg == SpectrumAnalyst::Autocorrelation) {
+            for (size_t i = 0; i < windowSize; i++)
+               in[i] = sqrt(in[i]);
+         }
+         if (alg == SpectrumAnalyst::CubeRootAutocorrelation ||
+             alg == SpectrumAnalyst::EnhancedAutocorrelation) {
+            // Tolonen and Karjalainen recommend taking the cube root
+            // of the power, instead of the square root
+
+            for (size_t i = 0; i < windowSize; i++)
+               in[i] = pow(in[i], 1.0f / 3.0f);
+         }
+         // Take FFT
+         RealFFT(windowSize, in, out, out2);
+
+         // Take real part of result
+         for (size_t i = 0; i < half; i++)
+            sums[i] += out[i];
+         break;
+
+      case SpectrumAnalyst::Cepstrum:
+         RealFFT(windowSize, in, out, out2);
+
+         // Compute log power
+         // Set a sane lower limit assuming maximum time amplitude of 1.0
+         {
+            float power;
+            float minpower = 1e-20*windowSize*windowSize;
+            for (size_t i = 0; i < windowSize; i++)
+            {
+               power = (out[i] * out[i]) + (out2[i] * out2[i]);
+               if(power < minpower)
+                  in[i] = log(minpower);
+               else
+                  in[i] = log(power);
+            }
+            // Take IFFT
+            InverseRealFFT(windowSize, in, NULL, out);
+
+            // Take real part of result
+            for (size_t i = 0; i < half; i++)
+               sums[i] += out[i];
+         }
+
+         break;
+
+      default:
+         wxASSERT(false);
+         break;
+   }                         //switch
+}
+}
+
 bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
                                 size_t windowSize, double rate,
                                 const float *data, size_t dataLen,
                                 float *pYMin, float *pYMax,
                                 FreqGauge *progress)
+{
+   return Calculate(alg, windowFunc, windowSize, rate,
+      [data](size_t start, size_t len, float *buffer){
+         std::copy(data + start, data + start + len, buffer);
+         return true;
+      },
+      dataLen, pYMin, pYMax, progress);
+}
+
+bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
+                                size_t windowSize, double rate,
+                                const SampleSource &source, size_t dataLen,
+                                float *pYMin, float *pYMax,
+                                FreqGauge *progress,
+                                const std::function<bool()> &isCancelled,
+                                size_t maxThreads)
 {
    // Wipe old data
    mProcessed.resize(0);
@@ -113,122 +215,103 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       return false;
    }
 
-   // Now repopulate
-   mRate = rate;
-   mWindowSize = windowSize;
-   mAlg = alg;
+   const auto half = windowSize / 2;
 
-   auto half = mWindowSize / 2;
-   mProcessed.resize(mWindowSize);
+   Floats win{ windowSize };
 
-   Floats in{ mWindowSize };
-   Floats out{ mWindowSize };
-   Floats out2{ mWindowSize };
-   Floats win{ mWindowSize };
-
-   for (size_t i = 0; i < mWindowSize; i++) {
-      mProcessed[i] = 0.0f;
+   for (size_t i = 0; i < windowSize; i++)
       win[i] = 1.0f;
-   }
 
-   WindowFunc(windowFunc, mWindowSize, win.get());
+   WindowFunc(windowFunc, windowSize, win.get());
 
    // Scale window such that an amplitude of 1.0 in the time domain
    // shows an amplitude of 0dB in the frequency domain
    double wss = 0;
-   for (size_t i = 0; i<mWindowSize; i++)
+   for (size_t i = 0; i<windowSize; i++)
       wss += win[i];
    if(wss > 0)
       wss = 4.0 / (wss*wss);
    else
       wss = 1.0;
 
+   // Windows overlap by half; each task takes a run of them
+   const size_t windows = (dataLen - windowSize) / half + 1;
+   const size_t windowsPerTask = std::max<size_t>(1, SamplesPerTask / half);
+   const size_t nTasks = (windows + windowsPerTask - 1) / windowsPerTask;
+
+   // Mutable data for each thread
+   struct Worker {
+      Floats samples, in, out, out2;
+   };
+   auto &pool = audacity::concurrency::ThreadPool::Get();
+   const size_t nWorkers = std::min(nTasks, maxThreads > 0
+      ? std::min(maxThreads, pool.Size() + 1)
+      : pool.Size() + 1);
+   std::vector<Worker> workers(nWorkers);
+
+   // Tasks of one round run in parallel, each with its own sums; then the
+   // sums are added in order of tasks, and the next round begins
+   const size_t tasksPerRound = 2 * nWorkers;
+   std::vector<std::vector<double>> partials(
+      std::min(tasksPerRound, nTasks), std::vector<double>(half));
+   std::vector<double> sums(half);
+
    if (progress) {
       progress->SetRange(dataLen);
    }
 
-   size_t start = 0;
-   int windows = 0;
-   while (start + mWindowSize <= dataLen) {
-      for (size_t i = 0; i < mWindowSize; i++)
-         in[i] = win[i] * data[start + i];
-
-      switch (alg) {
-         case Spectrum:
-            PowerSpectrum(mWindowSize, in.get(), out.get());
-
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Autocorrelation:
-         case CubeRootAutocorrelation:
-         case EnhancedAutocorrelation:
-
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-            // Compute power
-            for (size_t i = 0; i < mWindowSize; i++)
-               in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
-
-            if (alg == Autocorrelation) {
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = sqrt(in[i]);
-            }
-            if (alg == CubeRootAutocorrelation ||
-                alg == EnhancedAutocorrelation) {
-               // Tolonen and Karjalainen recommend taking the cube root
-               // of the power, instead of the square root
-
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = pow(in[i], 1.0f / 3.0f);
+   bool ok = true;
+   for (size_t firstTask = 0; ok && firstTask < nTasks;
+      firstTask += tasksPerRound
+   ) {
+      const auto nRoundTasks = std::min(tasksPerRound, nTasks - firstTask);
+      std::atomic<size_t> next{ 0 };
+      std::atomic<bool> failed{ false };
+      pool.ParallelFor(std::min(nWorkers, nRoundTasks), [&](size_t iWorker){
+         auto &worker = workers[iWorker];
+         if (!worker.in) {
+            worker.samples.reinit(
+               (windowsPerTask - 1) * half + windowSize);
+            worker.in.reinit(windowSize);
+            worker.out.reinit(windowSize);
+            worker.out2.reinit(windowSize);
+         }
+         for (size_t task; !failed && (task = next++) < nRoundTasks;) {
+            auto &partial = partials[task];
+            std::fill(partial.begin(), partial.end(), 0.0);
+            const auto firstWindow = (firstTask + task) * windowsPerTask;
+            const auto nTaskWindows =
+               std::min(windowsPerTask, windows - firstWindow);
+            const auto start = firstWindow * half;
+            const auto len = (nTaskWindows - 1) * half + windowSize;
+            const auto samples = worker.samples.get();
+            if (!source(start, len, samples)) {
+               failed = true;
+               break;
             }
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Take real part of result
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Cepstrum:
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Compute log power
-            // Set a sane lower limit assuming maximum time amplitude of 1.0
-            {
-               float power;
-               float minpower = 1e-20*mWindowSize*mWindowSize;
-               for (size_t i = 0; i < mWindowSize; i++)
-               {
-                  power = (out[i] * out[i]) + (out2[i] * out2[i]);
-                  if(power < minpower)
-                     in[i] = log(minpower);
-                  else
-                     in[i] = log(power);
-               }
-               // Take IFFT
-               InverseRealFFT(mWindowSize, in.get(), NULL, out.get());
-
-               // Take real part of result
-               for (size_t i = 0; i < half; i++)
-                  mProcessed[i] += out[i];
+            for (size_t ww = 0; ww < nTaskWindows; ++ww) {
+               const auto windowed = samples + ww * half;
+               for (size_t i = 0; i < windowSize; i++)
+                  worker.in[i] = win[i] * windowed[i];
+               AnalyzeWindow(alg, windowSize, worker.in.get(),
+                  worker.out.get(), worker.out2.get(), partial.data());
             }
+         }
+      }, nWorkers);
+      ok = !failed;
 
-            break;
-
-         default:
-            wxASSERT(false);
-            break;
-      }                         //switch
+      for (size_t task = 0; task < nRoundTasks; ++task)
+         for (size_t i = 0; i < half; i++)
+            sums[i] += partials[task][i];
 
       // Update the progress bar
       if (progress) {
-         progress->SetValue(start);
+         progress->SetValue(std::min(dataLen,
+            (firstTask + nRoundTasks) * windowsPerTask * half));
       }
 
-      start += half;
-      windows++;
+      if (isCancelled && isCancelled())
+         ok = false;
    }
 
    if (progress) {
@@ -236,6 +319,19 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       progress->Reset();
    }
 
+   if (!ok)
+      return false;
+
+   // Now repopulate
+   mRate = rate;
+   mWindowSize = windowSize;
+   mAlg = alg;
+
+   mProcessed.resize(mWindowSize);
+   std::copy(sums.begin(), sums.end(), mProcessed.begin());
+
+   Floats out{ mWindowSize };
+
    float mYMin = 1000000, mYMax = -1000000;
    double scale;
    switch (alg) {
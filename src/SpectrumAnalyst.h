@@ -12,6 +12,7 @@
 #ifndef __AUDACITY_SPECTRUM_ANALYST__
 #define __AUDACITY_SPECTRUM_ANALYST__
 
+#include <functional>
 #include <vector>
 #include <wx/statusbr.h>
 
@@ -31,6 +32,12 @@ public:
       NumAlgorithms
    };
 
+   //! Fills `buffer` with `len` samples at offset `start` of the analyzed
+   //! data, and returns false if they can't be read
+   /*! May be called from several threads at once */
+   using SampleSource =
+      std::function<bool(size_t start, size_t len, float *buffer)>;
+
    SpectrumAnalyst();
    ~SpectrumAnalyst();
 
@@ -42,6 +49,24 @@ public:
       float *pYMin = NULL, float *pYMax = NULL, // outputs
       FreqGauge *progress = NULL);
 
+   //! Like the overload above, but reads the data in chunks as it goes,
+   //! analyzing the chunks on the thread pool
+   /*!
+    Results are the same for any number of threads.
+
+    @param isCancelled polled on the calling thread between groups of chunks;
+    if it returns true, nothing is processed and the result is false
+    @param maxThreads if zero, all threads of the pool and the calling thread
+    */
+   bool Calculate(Algorithm alg,
+      int windowFunc, // see FFT.h for values
+      size_t windowSize, double rate,
+      const SampleSource &source, size_t dataLen,
+      float *pYMin = NULL, float *pYMax = NULL, // outputs
+      FreqGauge *progress = NULL,
+      const std::function<bool()> &isCancelled = {},
+      size_t maxThreads = 0);
+
    const float *GetProcessed() const;
    int GetProcessedSize() const;
 
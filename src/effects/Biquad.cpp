@@ -41,6 +41,20 @@ void Biquad::Process(const float* pfIn, float* pfOut, int iNumSamples)
       *pfOut++ = ProcessOne(*pfIn++);
 }
 
+std::vector<BiquadCoefficients>
+Biquad::Coefficients(const Biquad *biquads, size_t count)
+{
+   std::vector<BiquadCoefficients> result;
+   for (size_t ii = 0; ii < count; ++ii) {
+      const auto &biquad = biquads[ii];
+      result.push_back({
+         biquad.fNumerCoeffs[B0], biquad.fNumerCoeffs[B1],
+         biquad.fNumerCoeffs[B2],
+         biquad.fDenomCoeffs[A1], biquad.fDenomCoeffs[A2] });
+   }
+   return result;
+}
+
 const double Biquad::s_fChebyCoeffs[MAX_Order][MAX_Order + 1] =
 {
    // For Chebyshev polynomials of the first kind (see http://en.wikipedia.org/wiki/Chebyshev_polynomial)
@@ -12,6 +12,7 @@ Max Maisel
 #ifndef __BIQUAD_H__
 #define __BIQUAD_H__
 
+#include "BiquadCascade.h"
 #include "MemoryX.h"
 
 /// \brief Represents a biquad digital filter.
@@ -63,6 +64,10 @@ struct Biquad
       nSubTypes
    };
 
+   //! Coefficients of the first `count` of `biquads`, for a BiquadCascade
+   static std::vector<BiquadCoefficients>
+   Coefficients(const Biquad *biquads, size_t count);
+
    static ArrayOf<Biquad> CalcButterworthFilter(int order, double fn, double fc, int type);
    static ArrayOf<Biquad> CalcChebyshevType1Filter(int order, double fn, double fc, double ripple, int type);
    static ArrayOf<Biquad> CalcChebyshevType2Filter(int order, double fn, double fc, double ripple, int type);
@@ -9,6 +9,7 @@ Max Maisel
 ***********************************************************************/
 
 #include "EBUR128.h"
+#include <algorithm>
 #include <cstring>
 
 EBUR128::EBUR128(double rate, size_t channels)
@@ -16,19 +17,16 @@ EBUR128::EBUR128(double rate, size_t channels)
    , mRate{ rate }
    , mBlockSize( ceil(0.4 * mRate) ) // 400 ms blocks
    , mBlockOverlap( ceil(0.1 * mRate) ) // 100 ms overlap
+   , mWeightingFilter{
+      Biquad::Coefficients(CalcWeightingFilter(mRate).get(), 2), channels }
+   , mWeighted(channels * FilterBlockSize)
 {
    mLoudnessHist.reinit(HIST_BIN_COUNT, false);
    mBlockRingBuffer.reinit(mBlockSize);
-   mWeightingFilter.reinit(mChannelCount, false);
    for(size_t channel = 0; channel < mChannelCount; ++channel)
-      mWeightingFilter[channel] = CalcWeightingFilter(mRate);
+      mWeightedChannels.push_back(&mWeighted[channel * FilterBlockSize]);
 
    memset(mLoudnessHist.get(), 0, HIST_BIN_COUNT*sizeof(long int));
-   for(size_t channel = 0; channel < mChannelCount; ++channel)
-   {
-      mWeightingFilter[channel][0].Reset();
-      mWeightingFilter[channel][1].Reset();
-   }
 }
 
 // fs: sample rate
@@ -80,18 +78,33 @@ ArrayOf<Biquad> EBUR128::CalcWeightingFilter(double fs)
    return pBiquad;
 }
 
-void EBUR128::ProcessSampleFromChannel(float x_in, size_t channel) const
+void EBUR128::ProcessSamples(const float *const *channels, size_t len)
 {
-   double value;
-   value = mWeightingFilter[channel][0].ProcessOne(x_in);
-   value = mWeightingFilter[channel][1].ProcessOne(value);
-   if(channel == 0)
-      mBlockRingBuffer[mBlockRingPos] = value * value;
-   else
+   std::vector<const float*> positions(channels, channels + mChannelCount);
+   while(len > 0)
    {
-      // Add the power of additional channels to the power of first channel.
-      // As a result, stereo tracks appear about 3 LUFS louder, as specified.
-      mBlockRingBuffer[mBlockRingPos] += value * value;
+      const auto count = std::min(len, FilterBlockSize);
+      // All channels through both filters at once; unlike Biquad, the
+      // cascade does not round to float between the filters
+      mWeightingFilter.Process(
+         positions.data(), mWeightedChannels.data(), count);
+      for(size_t i = 0; i < count; ++i)
+      {
+         // Add the power of additional channels to the power of first
+         // channel.  As a result, stereo tracks appear about 3 LUFS louder,
+         // as specified.
+         double power = 0;
+         for(size_t channel = 0; channel < mChannelCount; ++channel)
+         {
+            const double value = mWeightedChannels[channel][i];
+            power += value * value;
+         }
+         mBlockRingBuffer[mBlockRingPos] = power;
+         NextSample();
+      }
+      for(auto &position : positions)
+         position += count;
+      len -= count;
    }
 }
 
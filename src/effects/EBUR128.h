@@ -13,6 +13,7 @@ Max Maisel
 
 #include "Biquad.h"
 #include <memory>
+#include <vector>
 #include "SampleFormat.h"
 
 #include <cmath>
@@ -27,13 +28,14 @@ public:
    ~EBUR128() = default;
 
    static ArrayOf<Biquad> CalcWeightingFilter(double fs);
-   void ProcessSampleFromChannel(float x_in, size_t channel) const;
-   void NextSample();
+   //! Weight and accumulate `len` samples of each channel
+   void ProcessSamples(const float *const *channels, size_t len);
    double IntegrativeLoudness();
    inline double IntegrativeLoudnessToLUFS(double loudness)
       { return 10 * log10(loudness); }
 
 private:
+   void NextSample();
    void HistogramSums(size_t start_idx, double& sum_v, long int& sum_c) const;
    void AddBlockToHistogram(size_t validLen);
 
@@ -50,11 +52,12 @@ private:
    const size_t mBlockSize;
    const size_t mBlockOverlap;
 
-   /// This is be an array of arrays of the type
-   /// mWeightingFilter[CHANNEL][FILTER] with
-   /// CHANNEL = LEFT/RIGHT (0/1) and
-   /// FILTER  = HSF/HPF    (0/1)
-   ArrayOf<ArrayOf<Biquad>> mWeightingFilter;
+   /// The HSF and then the HPF, for each channel
+   BiquadCascade mWeightingFilter;
+   /// Weighted samples of each channel, for up to FilterBlockSize samples
+   static constexpr size_t FilterBlockSize = 4096;
+   std::vector<float> mWeighted;
+   std::vector<float*> mWeightedChannels;
 };
 
 #endif
@@ -27,7 +27,7 @@
    Also allows the curve to be specified with a series of 'graphic EQ'
    sliders.
 
-   The filter is applied using overlap/add of Hann windows.
+   The filter is applied by uniformly partitioned convolution.
 
    Clone of the FFT Filter effect, no longer part of Audacity.
 
@@ -37,6 +37,7 @@
 #include "EffectEditor.h"
 #include "EffectOutputTracks.h"
 #include "LoadEffects.h"
+#include "PartitionedConvolver.h"
 #include "ShuttleGui.h"
 
 #include "WaveClip.h"
@@ -364,13 +365,14 @@ bool EffectEqualization::Init()
 }
 
 struct EffectEqualization::Task {
-   Task(size_t M, size_t idealBlockLen, WaveChannel &channel)
-      : buffer{ idealBlockLen }
+   Task(const std::vector<float> &impulse, size_t blockSize,
+      size_t idealBlockLen, WaveChannel &channel)
+      : convolver{ impulse.data(), impulse.size(), blockSize }
+      , buffer{ idealBlockLen }
       , idealBlockLen{ idealBlockLen }
       , output{ channel }
-      , leftTailRemaining{ (M - 1) / 2 }
+      , leftTailRemaining{ (impulse.size() - 1) / 2 }
    {
-      memset(lastWindow, 0, windowSize * sizeof(float));
    }
 
    void AccumulateSamples(constSamplePtr buffer, size_t len)
@@ -382,17 +384,12 @@ struct EffectEqualization::Task {
       output.Append(buffer, floatSample, len);
    }
 
-   static constexpr auto windowSize = EqualizationFilter::windowSize;
-   Floats window1{ windowSize };
-   Floats window2{ windowSize };
+   PartitionedConvolver convolver;
 
    Floats buffer;
+   //! A multiple of the convolver's block size
    const size_t idealBlockLen;
 
-   // These pointers are swapped after each FFT window
-   float *thisWindow{ window1.get() };
-   float *lastWindow{ window2.get() };
-
    // a new WaveChannel to hold all of the output,
    // including 'tails' each end
    WaveChannel &output;
@@ -423,17 +420,14 @@ bool EffectEqualization::Process(EffectInstance &, EffectSettings &)
          auto iter0 = pTempTrack->Channels().begin();
 
          for (const auto pChannel : track->Channels()) {
-            constexpr auto windowSize = EqualizationFilter::windowSize;
-            const auto &M = mParameters.mM;
-
-            wxASSERT(M - 1 < windowSize);
-            size_t L = windowSize - (M - 1);   //Process L samples at a go
-            auto s = start;
+            const auto &impulse = mParameters.mImpulse;
+            const auto blockSize =
+               PartitionedConvolver::FastBlockSize(impulse.size());
             auto idealBlockLen = pChannel->GetMaxBlockSize() * 4;
-            if (idealBlockLen % L != 0)
-               idealBlockLen += (L - (idealBlockLen % L));
+            if (idealBlockLen % blockSize != 0)
+               idealBlockLen += (blockSize - (idealBlockLen % blockSize));
             auto pNewChannel = *iter0++;
-            Task task{ M, idealBlockLen, *pNewChannel };
+            Task task{ impulse, blockSize, idealBlockLen, *pNewChannel };
             bGoodResult = ProcessOne(task, count, *pChannel, start, len);
             if (!bGoodResult)
                goto done;
@@ -475,82 +469,40 @@ bool EffectEqualization::TransferDataToWindow(const EffectSettings &settings)
 bool EffectEqualization::ProcessOne(Task &task,
    int count, const WaveChannel &t, sampleCount start, sampleCount len)
 {
-   constexpr auto windowSize = EqualizationFilter::windowSize;
-
-   const auto &M = mParameters.mM;
-
-   wxASSERT(M - 1 < windowSize);
-   size_t L = windowSize - (M - 1);   //Process L samples at a go
-   auto s = start;
-
+   auto &convolver = task.convolver;
+   const auto blockSize = convolver.BlockSize();
    auto &buffer = task.buffer;
-   auto &window1 = task.window1;
-   auto &window2 = task.window2;
-   auto &thisWindow = task.thisWindow;
-   auto &lastWindow = task.lastWindow;
-
-   auto originalLen = len;
 
-   auto &output = task.output;
+   // The filter delays by half its length; continue past the end of the
+   // input until that much of the 'tail' is output too
+   const auto M = convolver.ImpulseLength();
+   sampleCount remaining = len + (M - 1) / 2;
+   auto s = start;
 
    TrackProgress(count, 0.);
-   bool bLoopSuccess = true;
-   size_t wcopy = 0;
 
-   while (len != 0)
+   while (remaining > 0)
    {
-      auto block = limitSampleBufferSize( task.idealBlockLen, len );
-
-      t.GetFloats(buffer.get(), s, block);
+      const auto block = limitSampleBufferSize( task.idealBlockLen, remaining );
+      const auto inputLen = limitSampleBufferSize( block, start + len - s );
 
-      for(size_t i = 0; i < block; i += L)   //go through block in lumps of length L
-      {
-         wcopy = std::min <size_t> (L, block - i);
-         for(size_t j = 0; j < wcopy; j++)
-            thisWindow[j] = buffer[i+j];   //copy the L (or remaining) samples
-         for(auto j = wcopy; j < windowSize; j++)
-            thisWindow[j] = 0;   //this includes the padding
-
-         mParameters.Filter(windowSize, thisWindow);
-
-         // Overlap - Add
-         for(size_t j = 0; (j < M - 1) && (j < wcopy); j++)
-            buffer[i+j] = thisWindow[j] + lastWindow[L + j];
-         for(size_t j = M - 1; j < wcopy; j++)
-            buffer[i+j] = thisWindow[j];
+      if (inputLen > 0)
+         t.GetFloats(buffer.get(), s, inputLen);
+      // Zeros after the input, and to complete the last block
+      const auto padded = ((block + blockSize - 1) / blockSize) * blockSize;
+      std::fill(buffer.get() + inputLen, buffer.get() + padded, 0.0f);
 
-         std::swap( thisWindow, lastWindow );
-      }  //next i, lump of this block
+      for (size_t i = 0; i < padded; i += blockSize)
+         convolver.ProcessBlock(&buffer[i], &buffer[i]);
 
       task.AccumulateSamples((samplePtr)buffer.get(), block);
-      len -= block;
-      s += block;
+      remaining -= block;
+      s += inputLen;
 
       if (TrackProgress(count, ( s - start ).as_double() /
-                        originalLen.as_double()))
-      {
-         bLoopSuccess = false;
-         break;
-      }
+                        len.as_double()))
+         return false;
    }
 
-   if (bLoopSuccess) {
-      // M-1 samples of 'tail' left in lastWindow, get them now
-      if(wcopy < (M - 1)) {
-         // Still have some overlap left to process
-         // (note that lastWindow and thisWindow have been exchanged at this point
-         //  so that 'thisWindow' is really the window prior to 'lastWindow')
-         size_t j = 0;
-         for(; j < M - 1 - wcopy; j++)
-            buffer[j] = lastWindow[wcopy + j] + thisWindow[L + wcopy + j];
-         // And fill in the remainder after the overlap
-         for( ; j < M - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      } else {
-         for(size_t j = 0; j < M - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      }
-      task.AccumulateSamples((samplePtr)buffer.get(), M - 1);
-   }
-   return bLoopSuccess;
+   return true;
 }
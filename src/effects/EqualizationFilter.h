@@ -16,7 +16,8 @@
 
 #include "EqualizationParameters.h" // base class
 #include "Envelope.h" // member
-#include "RealFFTf.h" // member
+#include "MemoryX.h"
+#include <vector>
 using Floats = ArrayOf<float>;
 
 //! Extend EqualizationParameters with frequency domain coefficients computed
@@ -26,21 +27,15 @@ struct EqualizationFilter : EqualizationParameters {
    // low range of human hearing
    static constexpr int loFreqI = 20;
 
-   // Number of samples in an FFT window
-   // MJS - work out the optimum for this at run time?
-   // Have a dialog box for it?
+   // Number of samples in the FFT window that defines the response
    static constexpr size_t windowSize = 16384u;
 
    explicit EqualizationFilter(const EffectSettingsManager &manager);
 
    //! Adjust given coefficients so there is a finite impulse response in time
-   //! domain
+   //! domain, and compute that response
    bool CalcFilter();
 
-   //! Transform a given buffer of time domain signal, which should be zero
-   //! padded left and right for the tails
-   void Filter(size_t len, float *buffer) const;
-
    const Envelope &ChooseEnvelope() const
    { return mLin ? mLinEnvelope : mLogEnvelope; }
    Envelope &ChooseEnvelope()
@@ -51,9 +46,9 @@ struct EqualizationFilter : EqualizationParameters {
    { return IsLinear() ? mLinEnvelope : mLogEnvelope; }
 
    Envelope mLinEnvelope, mLogEnvelope;
-   HFFT hFFT{ GetFFT(windowSize) };
-   Floats mFFTBuffer{ windowSize };
    Floats mFilterFuncR{ windowSize }, mFilterFuncI{ windowSize };
+   //! The finite impulse response of length mM, delaying by (mM - 1) / 2
+   std::vector<float> mImpulse;
    double mLoFreq{ loFreqI };
    double mHiFreq{ mLoFreq };
    size_t mWindowSize{ windowSize };
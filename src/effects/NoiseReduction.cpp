@@ -55,6 +55,7 @@
 #include "WaveTrack.h"
 #include "AudacityMessageBox.h"
 #include "../widgets/valnum.h"
+#include "concurrency/ThreadPool.h"
 
 #include <algorithm>
 #include <vector>
@@ -115,6 +116,9 @@ const struct DiscriminationMethodInfo {
 // and the old discrimination
 const float minSignalTime = 0.05f;
 
+// Least number of samples output by each segment of a parallel reduction
+constexpr size_t MinSegmentLength = 1 << 18;
+
 enum WindowTypes : unsigned {
    WT_RECTANGULAR_HANN = 0, // 2.0.6 behavior, requires 1/2 step
    WT_HANN_RECTANGULAR, // requires 1/2 step
@@ -252,16 +256,32 @@ EffectNoiseReduction::Settings::Settings()
 }
 
 struct MyTransformer : TrackSpectrumTransformer {
+   //! Output of one of the overlapping segments of a parallel reduction
+   struct Segment {
+      //! Position in the selection of the next step of output
+      sampleCount outputPos;
+      //! Position in the selection of the first sample kept
+      sampleCount begin;
+      //! Samples kept, which the transformer fills
+      FloatVector output;
+   };
+
+   /*!
+    @param pSegment if not null, output goes there instead of to the track
+    */
    MyTransformer(EffectNoiseReduction::Worker &worker,
       WaveChannel *pOutputTrack,
       bool needsOutput, eWindowFunctions inWindowType,
       eWindowFunctions outWindowType, size_t windowSize,
-      unsigned stepsPerWindow, bool leadingPadding, bool trailingPadding
+      unsigned stepsPerWindow, bool leadingPadding, bool trailingPadding,
+      Segment *pSegment = nullptr
    )  : TrackSpectrumTransformer{ pOutputTrack,
          needsOutput, inWindowType, outWindowType,
          windowSize, stepsPerWindow, leadingPadding, trailingPadding
       }
       , mWorker{ worker }
+      , mFreqSmoothingScratch(windowSize / 2 + 1)
+      , mpSegment{ pSegment }
    {
    }
    struct MyWindow : public Window
@@ -280,9 +300,13 @@ struct MyTransformer : TrackSpectrumTransformer {
    MyWindow &NthWindow(int nn) { return static_cast<MyWindow&>(Nth(nn)); }
    std::unique_ptr<Window> NewWindow(size_t windowSize) override;
    bool DoStart() override;
+   void DoOutput(const float *outBuffer, size_t mStepSize) override;
    bool DoFinish() override;
 
    EffectNoiseReduction::Worker &mWorker;
+   //! Each transformer has its own, so that segments can run concurrently
+   FloatVector mFreqSmoothingScratch;
+   Segment *const mpSegment;
 };
 
 //----------------------------------------------------------------------------
@@ -304,12 +328,26 @@ public:
       );
    ~Worker();
 
+   /*!
+    @param maxThreads 1 for the serial pass; otherwise, reduction uses the
+    thread pool, limited as for ThreadPool::ParallelFor
+    */
    bool Process(eWindowFunctions inWindowType, eWindowFunctions outWindowType,
-      TrackList &tracks, double mT0, double mT1);
+      TrackList &tracks, double mT0, double mT1, size_t maxThreads = 0);
+
+   //! Reduce the channels of a track in overlapping segments on the thread
+   //! pool, with the same result as the serial pass
+   bool ProcessParallel(
+      eWindowFunctions inWindowType, eWindowFunctions outWindowType,
+      WaveTrack &track, WaveTrack &outputTrack,
+      sampleCount start, sampleCount len, size_t maxThreads);
 
    static bool Processor(SpectrumTransformer &transformer);
+   //! Like Processor, but without reporting progress, for worker threads
+   static bool SegmentProcessor(SpectrumTransformer &transformer);
 
-   void ApplyFreqSmoothing(FloatVector &gains);
+   void ComputePowerSpectrum(MyTransformer &transformer);
+   void ApplyFreqSmoothing(FloatVector &gains, FloatVector &scratch);
    void GatherStatistics(MyTransformer &transformer);
    inline bool Classify(
       MyTransformer &transformer, unsigned nWindows, int band);
@@ -322,7 +360,6 @@ public:
    const Settings &mSettings;
    Statistics &mStatistics;
 
-   FloatVector mFreqSmoothingScratch;
    const size_t mFreqSmoothingBins;
    // When spectral selection limits the affected band:
    size_t mBinLow;  // inclusive lower bound
@@ -340,6 +377,8 @@ public:
    unsigned  mNWindowsToExamine;
    unsigned  mCenter;
    unsigned  mHistoryLen;
+   //! Windows that a segment processes before its first complete output
+   unsigned  mSeamWindows;
 
    // Following are for progress indicator only:
    unsigned  mProgressTrackCount = 0;
@@ -633,6 +672,41 @@ MyTransformer::MyWindow::~MyWindow()
 {
 }
 
+//! Find the analysis and synthesis window functions for a choice of
+//! window types
+static void GetWindowFunctions(int windowTypes,
+   eWindowFunctions &inWindowType, eWindowFunctions &outWindowType)
+{
+   switch (windowTypes) {
+   case WT_RECTANGULAR_HANN:
+      inWindowType = eWinFuncRectangular;
+      outWindowType = eWinFuncHann;
+      break;
+   case WT_HANN_RECTANGULAR:
+      inWindowType = eWinFuncHann;
+      outWindowType = eWinFuncRectangular;
+      break;
+   case WT_BLACKMAN_HANN:
+      inWindowType = eWinFuncBlackman;
+      outWindowType = eWinFuncHann;
+      break;
+   case WT_HAMMING_RECTANGULAR:
+      inWindowType = eWinFuncHamming;
+      outWindowType = eWinFuncRectangular;
+      break;
+   case WT_HAMMING_HANN:
+      inWindowType = eWinFuncHamming;
+      outWindowType = eWinFuncHann;
+      break;
+   default:
+      wxASSERT(false);
+      [[fallthrough]] ;
+   case WT_HANN_HANN:
+      inWindowType = outWindowType = eWinFuncHann;
+      break;
+   }
+}
+
 bool EffectNoiseReduction::Process(EffectInstance &, EffectSettings &)
 {
    // This same code will either reduce noise or profile it
@@ -666,34 +740,7 @@ bool EffectNoiseReduction::Process(EffectInstance &, EffectSettings &)
    }
 
    eWindowFunctions inWindowType, outWindowType;
-   switch (mSettings->mWindowTypes) {
-   case WT_RECTANGULAR_HANN:
-      inWindowType = eWinFuncRectangular;
-      outWindowType = eWinFuncHann;
-      break;
-   case WT_HANN_RECTANGULAR:
-      inWindowType = eWinFuncHann;
-      outWindowType = eWinFuncRectangular;
-      break;
-   case WT_BLACKMAN_HANN:
-      inWindowType = eWinFuncBlackman;
-      outWindowType = eWinFuncHann;
-      break;
-   case WT_HAMMING_RECTANGULAR:
-      inWindowType = eWinFuncHamming;
-      outWindowType = eWinFuncRectangular;
-      break;
-   case WT_HAMMING_HANN:
-      inWindowType = eWinFuncHamming;
-      outWindowType = eWinFuncHann;
-      break;
-   default:
-      wxASSERT(false);
-      [[fallthrough]] ;
-   case WT_HANN_HANN:
-      inWindowType = outWindowType = eWinFuncHann;
-      break;
-   }
+   GetWindowFunctions(mSettings->mWindowTypes, inWindowType, outWindowType);
    Worker worker{ *this, *mSettings, *mStatistics
 #ifdef SPECTRAL_EDIT_NOISE_REDUCTION
       , mF0, mF1
@@ -714,13 +761,49 @@ bool EffectNoiseReduction::Process(EffectInstance &, EffectSettings &)
    return bGoodResult;
 }
 
+bool EffectNoiseReduction::ReduceNoise(TrackList &noise, TrackList &tracks,
+   double t0, double t1, size_t maxThreads)
+{
+   EffectNoiseReduction effect;
+   auto &settings = *effect.mSettings;
+   const auto track = *noise.Selected<const WaveTrack>().begin();
+   if (!track || !settings.Validate(&effect))
+      return false;
+
+   eWindowFunctions inWindowType, outWindowType;
+   GetWindowFunctions(settings.mWindowTypes, inWindowType, outWindowType);
+   Statistics statistics{
+      settings.SpectrumSize(), track->GetRate(), settings.mWindowTypes };
+
+   settings.mDoProfile = true;
+   {
+      Worker worker{ effect, settings, statistics
+#ifdef SPECTRAL_EDIT_NOISE_REDUCTION
+         , effect.mF0, effect.mF1
+#endif
+      };
+      if (!worker.Process(inWindowType, outWindowType,
+         noise, noise.GetStartTime(), noise.GetEndTime()))
+         return false;
+   }
+
+   settings.mDoProfile = false;
+   Worker worker{ effect, settings, statistics
+#ifdef SPECTRAL_EDIT_NOISE_REDUCTION
+      , effect.mF0, effect.mF1
+#endif
+   };
+   return worker.Process(inWindowType, outWindowType,
+      tracks, t0, t1, maxThreads);
+}
+
 EffectNoiseReduction::Worker::~Worker()
 {
 }
 
 bool EffectNoiseReduction::Worker::Process(
    eWindowFunctions inWindowType, eWindowFunctions outWindowType,
-   TrackList &tracks, double inT0, double inT1)
+   TrackList &tracks, double inT0, double inT1, size_t maxThreads)
 {
    mProgressTrackCount = 0;
    for (auto track : tracks.Selected<WaveTrack>()) {
@@ -766,7 +849,15 @@ bool EffectNoiseReduction::Worker::Process(
             pFirstTrack = ppTempTrack->get();
             pIter.emplace(pFirstTrack->Channels().begin());
          }
-         for (const auto pChannel : track->Channels()) {
+         // Profiling stays serial, because its sums accumulate in the order
+         // of windows
+         if (pFirstTrack && maxThreads != 1 &&
+            audacity::concurrency::ThreadPool::Get().Size() > 0) {
+            if (!ProcessParallel(inWindowType, outWindowType,
+               *track, *pFirstTrack, start, len, maxThreads))
+               return false;
+         }
+         else for (const auto pChannel : track->Channels()) {
             auto pOutputTrack = pIter ? *(*pIter)++ : nullptr;
             MyTransformer transformer{ *this, pOutputTrack.get(),
                !mSettings.mDoProfile, inWindowType, outWindowType,
@@ -799,7 +890,90 @@ bool EffectNoiseReduction::Worker::Process(
    return true;
 }
 
-void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
+bool EffectNoiseReduction::Worker::ProcessParallel(
+   eWindowFunctions inWindowType, eWindowFunctions outWindowType,
+   WaveTrack &track, WaveTrack &outputTrack,
+   sampleCount start, sampleCount len, size_t maxThreads)
+{
+   auto &pool = audacity::concurrency::ThreadPool::Get();
+   const auto windowSize = mSettings.WindowSize();
+   const auto stepSize = mSettings.StepSize();
+
+   // Segments begin at multiples of the step, so that their windows are those
+   // of the serial pass.  Each reads enough input before its first sample, so
+   // that the queue fills and the gains settle as they would in the serial
+   // pass, and enough after its last, for the lookahead.  The overlap-add of
+   // each kept sample then has the same terms, added in the same order.
+   const sampleCount lead = windowSize + mSeamWindows * stepSize;
+   const sampleCount lag = windowSize + mHistoryLen * stepSize;
+   // Long enough that the overlaps cost little; a multiple of the step
+   const sampleCount segmentLength = stepSize *
+      ((std::max<size_t>(MinSegmentLength, 8 * lead.as_size_t()) +
+         stepSize - 1) / stepSize);
+   // The serial pass outputs whole steps, which PostProcess trims
+   const auto outputLen = ((len + stepSize - 1) / stepSize) * stepSize;
+
+   std::vector<std::shared_ptr<WaveChannel>> inputs, outputs;
+   for (const auto pChannel : track.Channels())
+      inputs.push_back(pChannel);
+   for (const auto pChannel : outputTrack.Channels())
+      outputs.push_back(pChannel);
+   const auto nChannels = inputs.size();
+
+   const auto nSegments =
+      ((outputLen + segmentLength - 1) / segmentLength).as_size_t();
+   // Bound the memory of output awaiting append, but give every thread work
+   const auto nThreads = maxThreads > 0
+      ? std::min(maxThreads, pool.Size() + 1) : pool.Size() + 1;
+   const auto segmentsPerRound =
+      std::max<size_t>(1, 2 * nThreads / nChannels);
+   std::vector<MyTransformer::Segment> segments(nChannels * segmentsPerRound);
+
+   for (size_t first = 0; first < nSegments; first += segmentsPerRound) {
+      const auto count = std::min(segmentsPerRound, nSegments - first);
+      pool.ParallelFor(nChannels * count, [&](size_t task){
+         const auto iChannel = task % nChannels;
+         auto &segment = segments[task];
+         const auto begin = segmentLength * (first + task / nChannels);
+         const auto end = std::min(outputLen, begin + segmentLength);
+         const auto inBegin = std::max<sampleCount>(0, begin - lead);
+         const auto inEnd = std::min(len, end + lag);
+         segment.outputPos = inBegin;
+         segment.begin = begin;
+         segment.output.resize((end - begin).as_size_t());
+         // The first segment is padded like the serial pass; the others
+         // begin with input that the serial pass also sees
+         MyTransformer transformer{ *this, outputs[iChannel].get(),
+            true, inWindowType, outWindowType,
+            windowSize, mSettings.StepsPerWindow(),
+            inBegin == 0, inEnd == len, &segment
+         };
+         transformer.Process(SegmentProcessor,
+            *inputs[iChannel], mHistoryLen, start + inBegin, inEnd - inBegin);
+      }, maxThreads);
+
+      // Append in the same steps as the serial pass, in case of dithering
+      for (size_t iChannel = 0; iChannel < nChannels; ++iChannel)
+         for (size_t ii = 0; ii < count; ++ii) {
+            const auto &output = segments[ii * nChannels + iChannel].output;
+            for (size_t pos = 0; pos < output.size(); pos += stepSize)
+               outputs[iChannel]->Append(
+                  reinterpret_cast<constSamplePtr>(output.data() + pos),
+                  floatSample, stepSize);
+         }
+
+      if (mEffect.TrackProgress(mProgressTrackCount,
+         std::min(1.0, (segmentLength * (first + count)).as_double() /
+            outputLen.as_double())))
+         return false;
+   }
+
+   mProgressTrackCount += nChannels;
+   return true;
+}
+
+void EffectNoiseReduction::Worker::ApplyFreqSmoothing(
+   FloatVector &gains, FloatVector &scratch)
 {
    // Given an array of gain mutipliers, average them
    // GEOMETRICALLY.  Don't multiply and take nth root --
@@ -811,7 +985,7 @@ void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
    const auto spectrumSize = mSettings.SpectrumSize();
 
    {
-      auto pScratch = mFreqSmoothingScratch.data();
+      auto pScratch = scratch.data();
       std::fill(pScratch, pScratch + spectrumSize, 0.0f);
    }
 
@@ -823,13 +997,13 @@ void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
       const int j0 = std::max(0, ii - (int)mFreqSmoothingBins);
       const int j1 = std::min(spectrumSize - 1, ii + mFreqSmoothingBins);
       for(int jj = j0; jj <= j1; ++jj) {
-         mFreqSmoothingScratch[ii] += gains[jj];
+         scratch[ii] += gains[jj];
       }
-      mFreqSmoothingScratch[ii] /= (j1 - j0 + 1);
+      scratch[ii] /= (j1 - j0 + 1);
    }
 
    for (size_t ii = 0; ii < spectrumSize; ++ii)
-      gains[ii] = exp(mFreqSmoothingScratch[ii]);
+      gains[ii] = exp(scratch[ii]);
 }
 
 EffectNoiseReduction::Worker::Worker(EffectNoiseReduction &effect,
@@ -844,7 +1018,6 @@ EffectNoiseReduction::Worker::Worker(EffectNoiseReduction &effect,
 , mSettings{ settings }
 , mStatistics{ statistics }
 
-, mFreqSmoothingScratch(mSettings.SpectrumSize())
 , mFreqSmoothingBins{ size_t(std::max(0.0, settings.mFreqSmoothingBands)) }
 , mBinLow{ 0 }
 , mBinHigh{ mSettings.SpectrumSize() }
@@ -902,6 +1075,12 @@ EffectNoiseReduction::Worker::Worker(EffectNoiseReduction &effect,
       // See ReduceNoise()
       mHistoryLen = std::max(mNWindowsToExamine, mCenter + nAttackBlocks);
    }
+
+   // The gains that a window receives from the release of earlier windows
+   // fall to exactly mNoiseAttenFactor within nReleaseBlocks + 1 windows; allow
+   // as many again for rounding.  After that many windows, and a full queue
+   // more, a segment's windows have the gains of a serial pass.
+   mSeamWindows = mHistoryLen + 2 * (nReleaseBlocks + 1);
 }
 
 bool MyTransformer::DoStart()
@@ -915,24 +1094,56 @@ bool MyTransformer::DoStart()
    return TrackSpectrumTransformer::DoStart();
 }
 
+void MyTransformer::DoOutput(const float *outBuffer, size_t mStepSize)
+{
+   if (!mpSegment)
+      return TrackSpectrumTransformer::DoOutput(outBuffer, mStepSize);
+
+   // Keep only the part of the step that lies in the segment
+   auto &segment = *mpSegment;
+   const auto pos = segment.outputPos;
+   segment.outputPos += mStepSize;
+   const auto end = segment.begin + segment.output.size();
+   const auto first = std::max(pos, segment.begin);
+   const auto last = std::min(pos + mStepSize, end);
+   if (first < last)
+      std::copy(outBuffer + (first - pos).as_size_t(),
+         outBuffer + (last - pos).as_size_t(),
+         segment.output.data() + (first - segment.begin).as_size_t());
+}
+
+void EffectNoiseReduction::Worker::ComputePowerSpectrum(
+   MyTransformer &transformer)
+{
+   // Compute power spectrum in the newest window
+   auto &record = transformer.NthWindow(0);
+   float *pSpectrum = &record.mSpectrums[0];
+   const double dc = record.mRealFFTs[0];
+   *pSpectrum++ = dc * dc;
+   float *pReal = &record.mRealFFTs[1], *pImag = &record.mImagFFTs[1];
+   for (size_t nn = mSettings.SpectrumSize() - 2; nn--;) {
+      const double re = *pReal++, im = *pImag++;
+      *pSpectrum++ = re * re + im * im;
+   }
+   const double nyquist = record.mImagFFTs[0];
+   *pSpectrum = nyquist * nyquist;
+}
+
+bool EffectNoiseReduction::Worker::SegmentProcessor(SpectrumTransformer &trans)
+{
+   auto &transformer = static_cast<MyTransformer &>(trans);
+   auto &worker = transformer.mWorker;
+   worker.ComputePowerSpectrum(transformer);
+   worker.ReduceNoise(transformer);
+   // Progress is reported between rounds of segments, on the main thread
+   return true;
+}
+
 bool EffectNoiseReduction::Worker::Processor(SpectrumTransformer &trans)
 {
    auto &transformer = static_cast<MyTransformer &>(trans);
    auto &worker = transformer.mWorker;
-   // Compute power spectrum in the newest window
-   {
-      auto &record = transformer.NthWindow(0);
-      float *pSpectrum = &record.mSpectrums[0];
-      const double dc = record.mRealFFTs[0];
-      *pSpectrum++ = dc * dc;
-      float *pReal = &record.mRealFFTs[1], *pImag = &record.mImagFFTs[1];
-      for (size_t nn = worker.mSettings.SpectrumSize() - 2; nn--;) {
-         const double re = *pReal++, im = *pImag++;
-         *pSpectrum++ = re * re + im * im;
-      }
-      const double nyquist = record.mImagFFTs[0];
-      *pSpectrum = nyquist * nyquist;
-   }
+   worker.ComputePowerSpectrum(transformer);
 
    if (worker.mDoProfile)
       worker.GatherStatistics(transformer);
@@ -1169,7 +1380,8 @@ void EffectNoiseReduction::Worker::ReduceNoise(MyTransformer &transformer)
       if (mNoiseReductionChoice != NRC_ISOLATE_NOISE)
          // Apply frequency smoothing to output gain
          // Gains are not less than mNoiseAttenFactor
-         ApplyFreqSmoothing(record.mGains);
+         ApplyFreqSmoothing(
+            record.mGains, transformer.mFreqSmoothingScratch);
 
       // Apply gain to FFT
       {
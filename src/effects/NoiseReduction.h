@@ -15,6 +15,8 @@
 
 #include "StatefulEffect.h"
 
+class TrackList;
+
 class EffectNoiseReduction final : public StatefulEffect {
 public:
    static const ComponentInterfaceSymbol Symbol;
@@ -44,6 +46,17 @@ public:
 
    bool Process(EffectInstance &instance, EffectSettings &settings) override;
 
+   //! Profile the noise in the selected wave tracks of `noise`, then reduce
+   //! it in the selected wave tracks of `tracks` between t0 and t1
+   /*!
+    Uses the settings stored in preferences.  This lets the benchmark compare
+    the serial and parallel passes.
+    @param maxThreads 1 for the serial pass, or 0 for all threads of the pool
+    @return false if profiling or reduction failed
+    */
+   static bool ReduceNoise(TrackList &noise, TrackList &tracks,
+      double t0, double t1, size_t maxThreads);
+
    class Settings;
    class Statistics;
    class Dialog;
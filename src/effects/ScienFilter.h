@@ -21,6 +21,7 @@ Vaughan Johnson (Preview)
 #include "ShuttleAutomation.h"
 #include "wxPanelWrapper.h"
 #include <float.h> // for FLT_MAX
+#include <optional>
 
 class wxBitmap;
 class wxChoice;
@@ -100,6 +101,8 @@ private:
    int mOrder;
    int mOrderIndex;
    ArrayOf<Biquad> mpBiquad;
+   //! Made from mpBiquad for each track processed
+   std::optional<BiquadCascade> mCascade;
 
    double mdBMax;
    double mdBMin;
@@ -11,16 +11,49 @@
 #include "SpectrumCache.h"
 
 #include "../../../../prefs/SpectrogramSettings.h"
+#include "ProjectCache.h"
 #include "RealFFTf.h"
+#include "SampleBlock.h"
 #include "Sequence.h"
 #include "Spectrum.h"
 #include "WaveClipUIUtilities.h"
 #include "WaveTrack.h"
 #include "WideSampleSequence.h"
+#include "concurrency/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
+#include <type_traits>
 
 namespace {
 
+//! Workers claim columns in groups of this many
+constexpr int ColumnsPerTask = 16;
+
+//! Reassignment contributions are gathered for at most this many columns
+//! before they are accumulated
+constexpr int ColumnsPerBatch = 256;
+
+//! Columns are saved in the project file in groups of this many
+constexpr int TileColumns = 128;
+
+//! 64 bit FNV-1a hash of the bytes of values
+class Hasher {
+public:
+   template<typename T> Hasher &operator ()(const T &value)
+   {
+      static_assert(std::is_arithmetic_v<T>);
+      auto bytes = reinterpret_cast<const unsigned char *>(&value);
+      for (size_t ii = 0; ii < sizeof(T); ++ii)
+         mValue = (mValue ^ bytes[ii]) * 1099511628211ull;
+      return *this;
+   }
+   int64_t Get() const { return static_cast<int64_t>(mValue); }
+private:
+   uint64_t mValue{ 14695981039346656037ull };
+};
+
 static void ComputeSpectrumUsingRealFFTf
    (float * __restrict buffer, const FFTParam *hFFT,
     const float * __restrict window, size_t len, float * __restrict out)
@@ -95,7 +128,8 @@ bool SpecCache::CalculateOneSpectrum(
    const SpectrogramSettings& settings, const WaveChannelInterval& clip,
    const int xx, double pixelsPerSecond, int lowerBoundX, int upperBoundX,
    const std::vector<float>& gainFactors, float* __restrict scratch,
-   float* __restrict out) const
+   std::optional<AudioSegmentSampleView> &sampleCacheHolder,
+   Contributions *contributions, float* __restrict out) const
 {
    bool result = false;
    const bool reassignment =
@@ -169,10 +203,10 @@ bool SpecCache::CalculateOneSpectrum(
          if (myLen > 0) {
             constexpr auto iChannel = 0u;
             constexpr auto mayThrow = false; // Don't throw just for display
-            mSampleCacheHolder.emplace(
+            sampleCacheHolder.emplace(
                clip.GetSampleView(from, myLen, mayThrow));
             floats.resize(myLen);
-            mSampleCacheHolder->Copy(floats.data(), myLen);
+            sampleCacheHolder->Copy(floats.data(), myLen);
             useBuffer = floats.data();
             if (copy) {
                if (useBuffer)
@@ -280,13 +314,9 @@ bool SpecCache::CalculateOneSpectrum(
 
                   // This is non-negative, because bin and correctedX are
                   auto ind = (int)nBins * correctedX + bin;
-#ifdef _OPENMP
-                  // This assignment can race if index reaches into another thread's bins.
-                  // The probability of a race very low, so this carries little overhead,
-                  // about 5% slower vs allowing it to race.
-                  #pragma omp atomic update
-#endif
-                  out[ind] += power;
+                  // The target may be in another column, perhaps one being
+                  // computed by another thread, so don't add to out here
+                  contributions->emplace_back(ind, power);
                }
             }
          }
@@ -341,8 +371,25 @@ void SpecCache::Grow(
 
 void SpecCache::Populate(
    const SpectrogramSettings& settings, const WaveChannelInterval& clip,
-   int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond)
+   int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond,
+   size_t maxThreads)
 {
+   // Compute the ranges before and after the copied portion anew.
+   // One of the ranges may be empty.
+   PopulateRange(
+      settings, clip, 0, copyBegin, pixelsPerSecond, maxThreads);
+   PopulateRange(
+      settings, clip, copyEnd, numPixels, pixelsPerSecond, maxThreads);
+}
+
+void SpecCache::PopulateRange(
+   const SpectrogramSettings& settings, const WaveChannelInterval& clip,
+   int lowerBoundX, int upperBoundX, double pixelsPerSecond,
+   size_t maxThreads)
+{
+   if (upperBoundX <= lowerBoundX)
+      return;
+
    const auto sampleRate = clip.GetRate();
    const int &frequencyGainSetting = settings.frequencyGain;
    const size_t windowSizeSetting = settings.WindowSize();
@@ -359,110 +406,140 @@ void SpecCache::Populate(
 
    const size_t bufferSize = fftLen;
    const size_t scratchSize = reassignment ? 3 * bufferSize : bufferSize;
-   std::vector<float> scratch(scratchSize);
 
    std::vector<float> gainFactors;
    if (!autocorrelation)
       ComputeSpectrogramGainFactors(
          fftLen, sampleRate, frequencyGainSetting, gainFactors);
 
-   // Loop over the ranges before and after the copied portion and compute anew.
-   // One of the ranges may be empty.
-   for (int jj = 0; jj < 2; ++jj) {
-      const int lowerBoundX = jj == 0 ? 0 : copyEnd;
-      const int upperBoundX = jj == 0 ? copyBegin : numPixels;
-
-// todo(mhodgkinson): I don't find an option to define _OPENMP anywhere. Is this
-// still of interest?
-#ifdef _OPENMP
-      // Storage for mutable per-thread data.
-      // private clause ensures one copy per thread
-      struct ThreadLocalStorage {
-         ThreadLocalStorage()  { }
-         ~ThreadLocalStorage() { }
-
-         void init(SampleTrackCache &waveTrackCache, size_t scratchSize) {
-            if (!cache) {
-               cache = std::make_unique<SampleTrackCache>(waveTrackCache.GetTrack());
-               scratch.resize(scratchSize);
-            }
+   // Mutable data for each thread.  The FFT tables in settings are only read
+   // by RealFFTf and so are shared.
+   struct Worker {
+      std::vector<float> scratch;
+      std::optional<AudioSegmentSampleView> sampleCacheHolder;
+   };
+   auto &pool = audacity::concurrency::ThreadPool::Get();
+   const size_t nWorkers = maxThreads > 0
+      ? std::min(maxThreads, pool.Size() + 1)
+      : pool.Size() + 1;
+   std::vector<Worker> workers(nWorkers);
+
+   // Call function(worker, xx) for each column in [begin, end), each column
+   // once, with no Worker used by two threads at once
+   const auto forEachColumn = [&](int begin, int end, const auto &function) {
+      if (end <= begin)
+         return;
+      const int nTasks = (end - begin + ColumnsPerTask - 1) / ColumnsPerTask;
+      std::atomic<int> next{ 0 };
+      pool.ParallelFor(std::min<size_t>(nWorkers, nTasks), [&](size_t iWorker){
+         auto &worker = workers[iWorker];
+         worker.scratch.resize(scratchSize);
+         for (int task; (task = next++) < nTasks;) {
+            const auto first = begin + task * ColumnsPerTask;
+            const auto last = std::min(end, first + ColumnsPerTask);
+            for (auto xx = first; xx < last; ++xx)
+               function(worker, xx);
          }
-         std::unique_ptr<SampleTrackCache> cache;
-         std::vector<float> scratch;
-      } tls;
+      }, nWorkers);
+   };
 
-      #pragma omp parallel for private(tls)
-#endif
-      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
-      {
-#ifdef _OPENMP
-         tls.init(waveTrackCache, scratchSize);
-         SampleTrackCache& cache = *tls.cache;
-         float* buffer = &tls.scratch[0];
-#else
-         float* buffer = &scratch[0];
-#endif
+   const auto accumulate = [&](const Contributions &contributions) {
+      for (const auto &[index, power] : contributions)
+         freq[index] += power;
+   };
+
+   if (!reassignment) {
+      // Each column writes only its own part of freq
+      forEachColumn(lowerBoundX, upperBoundX, [&](Worker &worker, int xx){
          CalculateOneSpectrum(
             settings, clip, xx, pixelsPerSecond, lowerBoundX, upperBoundX,
-            gainFactors, buffer, &freq[0]);
-      }
+            gainFactors, worker.scratch.data(), worker.sampleCacheHolder,
+            nullptr, &freq[0]);
+      });
+      return;
+   }
 
-      if (reassignment) {
-         // Need to look beyond the edges of the range to accumulate more
-         // time reassignments.
-         // I'm not sure what's a good stopping criterion?
-         auto xx = lowerBoundX;
-         const double pixelsPerSample =
-            pixelsPerSecond * clip.GetStretchRatio() / sampleRate;
-         const int limit = std::min((int)(0.5 + fftLen * pixelsPerSample), 100);
-         for (int ii = 0; ii < limit; ++ii)
-         {
-            const bool result = CalculateOneSpectrum(
-               settings, clip, --xx, pixelsPerSecond, lowerBoundX, upperBoundX,
-               gainFactors, &scratch[0], &freq[0]);
-            if (!result)
-               break;
-         }
+   // Reassignment may move power into neighboring columns.  Compute
+   // columns in parallel, but accumulate in order of columns, so that
+   // the sums are the same as when computed serially.
+   std::vector<Contributions> batch(
+      std::min(ColumnsPerBatch, upperBoundX - lowerBoundX));
+   for (auto first = lowerBoundX; first < upperBoundX;
+      first += ColumnsPerBatch
+   ) {
+      const auto last = std::min(upperBoundX, first + ColumnsPerBatch);
+      forEachColumn(first, last, [&](Worker &worker, int xx){
+         auto &contributions = batch[xx - first];
+         contributions.clear();
+         CalculateOneSpectrum(
+            settings, clip, xx, pixelsPerSecond, lowerBoundX, upperBoundX,
+            gainFactors, worker.scratch.data(), worker.sampleCacheHolder,
+            &contributions, &freq[0]);
+      });
+      for (auto xx = first; xx < last; ++xx)
+         accumulate(batch[xx - first]);
+   }
 
-         xx = upperBoundX;
-         for (int ii = 0; ii < limit; ++ii)
-         {
-            const bool result = CalculateOneSpectrum(
-               settings, clip, xx++, pixelsPerSecond, lowerBoundX, upperBoundX,
-               gainFactors, &scratch[0], &freq[0]);
-            if (!result)
-               break;
-         }
+   {
+      // Need to look beyond the edges of the range to accumulate more
+      // time reassignments.
+      // I'm not sure what's a good stopping criterion?
+      // Each column decides whether to continue, so this stays serial.
+      auto &worker = workers[0];
+      worker.scratch.resize(scratchSize);
+      Contributions contributions;
+      const auto calculate = [&](int xx) {
+         contributions.clear();
+         const bool result = CalculateOneSpectrum(
+            settings, clip, xx, pixelsPerSecond, lowerBoundX, upperBoundX,
+            gainFactors, worker.scratch.data(), worker.sampleCacheHolder,
+            &contributions, &freq[0]);
+         accumulate(contributions);
+         return result;
+      };
+
+      auto xx = lowerBoundX;
+      const double pixelsPerSample =
+         pixelsPerSecond * clip.GetStretchRatio() / sampleRate;
+      const int limit = std::min((int)(0.5 + fftLen * pixelsPerSample), 100);
+      for (int ii = 0; ii < limit; ++ii)
+      {
+         if (!calculate(--xx))
+            break;
+      }
 
-         // Now Convert to dB terms.  Do this only after accumulating
-         // power values, which may cross columns with the time correction.
-#ifdef _OPENMP
-         #pragma omp parallel for
-#endif
-         for (xx = lowerBoundX; xx < upperBoundX; ++xx) {
-            float *const results = &freq[nBins * xx];
-            for (size_t ii = 0; ii < nBins; ++ii) {
-               float &power = results[ii];
-               if (power <= 0)
-                  power = -160.0;
-               else
-                  power = 10.0*log10f(power);
-            }
-            if (!gainFactors.empty()) {
-               // Apply a frequency-dependent gain factor
-               for (size_t ii = 0; ii < nBins; ++ii)
-                  results[ii] += gainFactors[ii];
-            }
-         }
+      xx = upperBoundX;
+      for (int ii = 0; ii < limit; ++ii)
+      {
+         if (!calculate(xx++))
+            break;
       }
    }
+
+   // Now Convert to dB terms.  Do this only after accumulating
+   // power values, which may cross columns with the time correction.
+   forEachColumn(lowerBoundX, upperBoundX, [&](Worker &, int xx){
+      float *const results = &freq[nBins * xx];
+      for (size_t ii = 0; ii < nBins; ++ii) {
+         float &power = results[ii];
+         if (power <= 0)
+            power = -160.0;
+         else
+            power = 10.0*log10f(power);
+      }
+      if (!gainFactors.empty()) {
+         // Apply a frequency-dependent gain factor
+         for (size_t ii = 0; ii < nBins; ++ii)
+            results[ii] += gainFactors[ii];
+      }
+   });
 }
 
 bool WaveClipSpectrumCache::GetSpectrogram(
    const WaveChannelInterval &clip,
    const float*& spectrogram, SpectrogramSettings& settings,
    const sampleCount*& where, size_t numPixels, double t0,
-   double pixelsPerSecond)
+   double pixelsPerSecond, ProjectCache *pStore)
 
 {
    auto &mSpecCache = mSpecCaches[clip.GetChannelIndex()];
@@ -503,14 +580,44 @@ bool WaveClipSpectrumCache::GetSpectrogram(
       mSpecCache = std::make_unique<SpecCache>();
    }
 
+   const auto budget =
+      size_t(std::max(0, SpectrogramTileCacheSize.Read())) << 20;
+   // Reassignment columns depend on the bounds of the range computed, so
+   // they can't be reused in another range.  Samples not yet in blocks, as
+   // while recording, can't be identified.
+   const bool tiled = pStore && budget > 0 &&
+      settings.algorithm != SpectrogramSettings::algReassignment &&
+      clip.GetSequence().GetAppendBufferLen() == 0;
+
    int oldX0 = 0;
    double correction = 0.0;
 
+   // Columns saved in tiles are at whole multiples of samplesPerPixel from
+   // the start of the clip, so that their positions depend on the zoom, but
+   // not on the scrolling
+   std::optional<long long> gridColumn;
+   if (tiled) {
+      const auto position = t0 * sampleRate / stretchRatio;
+      gridColumn = std::llround(position / samplesPerPixel);
+      correction = *gridColumn * samplesPerPixel - position;
+   }
+
    int copyBegin = 0, copyEnd = 0;
-   if (match) {
+   if (match && tiled) {
+      // Copy only from columns on the same grid
+      const auto &oldGridColumn = mSpecCache->gridColumn;
+      const auto range = (long long)(mSpecCache->len + numPixels);
+      if (oldGridColumn && mSpecCache->spp == samplesPerPixel &&
+         std::abs(*gridColumn - *oldGridColumn) < range)
+         oldX0 = *gridColumn - *oldGridColumn;
+      else
+         match = false;
+   }
+   else if (match)
       WaveClipUIUtilities::findCorrection(
          mSpecCache->where, mSpecCache->len, numPixels, t0, sampleRate,
          stretchRatio, samplesPerPixel, oldX0, correction);
+   if (match) {
       // Remember our first pixel maps to oldX0 in the old cache,
       // possibly out of bounds.
       // For what range of pixels can data be copied?
@@ -524,6 +631,7 @@ bool WaveClipSpectrumCache::GetSpectrogram(
    mSpecCache->Grow(numPixels, settings, samplesPerPixel, t0);
    mSpecCache->leftTrim = clip.GetTrimLeft();
    mSpecCache->rightTrim = clip.GetTrimRight();
+   mSpecCache->gridColumn = gridColumn;
    auto nBins = settings.NBins();
 
    // Optimization: if the old cache is good and overlaps
@@ -562,8 +670,12 @@ bool WaveClipSpectrumCache::GetSpectrogram(
       mSpecCache->where, numPixels, addBias, correction, t0, sampleRate,
       stretchRatio, samplesPerPixel);
 
-   mSpecCache->Populate(
-      settings, clip, copyBegin, copyEnd, numPixels, pixelsPerSecond);
+   if (tiled)
+      PopulateWithTiles(*pStore, budget,
+         clip, settings, copyBegin, copyEnd, numPixels, pixelsPerSecond);
+   else
+      mSpecCache->Populate(
+         settings, clip, copyBegin, copyEnd, numPixels, pixelsPerSecond);
 
    mSpecCache->dirty = mDirty;
    spectrogram = &mSpecCache->freq[0];
@@ -572,6 +684,90 @@ bool WaveClipSpectrumCache::GetSpectrogram(
    return true;
 }
 
+void WaveClipSpectrumCache::PopulateWithTiles(ProjectCache &store,
+   size_t budget, const WaveChannelInterval &clip,
+   const SpectrogramSettings &settings,
+   int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond)
+{
+   auto &cache = *mSpecCaches[clip.GetChannelIndex()];
+   const auto &sequence = clip.GetSequence();
+
+   // The group identifies the samples of the clip, by the ids of the
+   // blocks, which change whenever the samples do
+   Hasher groupHasher;
+   for (const auto &block : sequence.GetBlockArray())
+      groupHasher(block.sb->GetBlockID())(block.start.as_long_long());
+   groupHasher(sequence.GetNumSamples().as_long_long())
+      (clip.GetTrimLeft())(clip.GetRate())(clip.GetStretchRatio());
+   const auto group = groupHasher.Get();
+
+   // Discard what was saved for contents replaced since
+   if (mTileGroupsStale) {
+      for (const auto other : mTileGroups)
+         if (other != group)
+            store.Invalidate(other);
+      mTileGroups.clear();
+      mTileGroupsStale = false;
+   }
+   if (std::find(mTileGroups.begin(), mTileGroups.end(), group) ==
+      mTileGroups.end())
+      mTileGroups.push_back(group);
+
+   Hasher settingsHasher;
+   settingsHasher(cache.algorithm)(cache.windowType)(cache.windowSize)
+      (cache.zeroPaddingFactor)(cache.frequencyGain)(cache.spp);
+   const auto nBins = settings.NBins();
+   const auto whereBytes = TileColumns * sizeof(sampleCount);
+   const auto freqBytes = TileColumns * nBins * sizeof(float);
+
+   // Each tile is the positions of its columns, followed by their values.
+   // Tile k holds the columns of the grid from k * TileColumns, which are the
+   // same at this zoom however the view is scrolled.
+   const auto gridColumn = *cache.gridColumn;
+   const auto item = [&](long long tile) {
+      return Hasher{ settingsHasher }(tile).Get();
+   };
+   const auto load = [&](long long tile, int x0) {
+      const auto data = store.Read(group, item(tile));
+      if (data.size() != whereBytes + freqBytes ||
+         memcmp(data.data(), &cache.where[x0], whereBytes) != 0)
+         return false;
+      memcpy(&cache.freq[nBins * x0], data.data() + whereBytes, freqBytes);
+      return true;
+   };
+   const auto save = [&](long long tile, int x0) {
+      std::vector<char> data(whereBytes + freqBytes);
+      memcpy(data.data(), &cache.where[x0], whereBytes);
+      memcpy(data.data() + whereBytes, &cache.freq[nBins * x0], freqBytes);
+      store.Write(group, item(tile), data.data(), data.size(), budget);
+   };
+
+   for (int jj = 0; jj < 2; ++jj) {
+      const int lowerBoundX = jj == 0 ? 0 : copyEnd;
+      const int upperBoundX = jj == 0 ? copyBegin : numPixels;
+      std::vector<std::pair<long long, int>> computed;
+      // The first tile that starts in the range; division truncates toward
+      // zero, which rounds up negative quotients
+      const auto first = gridColumn + lowerBoundX;
+      auto tile = first / TileColumns + (first % TileColumns > 0);
+      // Compute the columns between tiles found in the store
+      auto xx = lowerBoundX;
+      for (auto x0 = int(tile * TileColumns - gridColumn);
+         x0 + TileColumns <= upperBoundX; x0 += TileColumns, ++tile
+      ) {
+         if (load(tile, x0)) {
+            cache.PopulateRange(settings, clip, xx, x0, pixelsPerSecond);
+            xx = x0 + TileColumns;
+         }
+         else
+            computed.emplace_back(tile, x0);
+      }
+      cache.PopulateRange(settings, clip, xx, upperBoundX, pixelsPerSecond);
+      for (const auto &[computedTile, x0] : computed)
+         save(computedTile, x0);
+   }
+}
+
 WaveClipSpectrumCache::WaveClipSpectrumCache(size_t nChannels)
    : mSpecCaches(nChannels)
    , mSpecPxCaches(nChannels)
@@ -604,10 +800,13 @@ WaveClipSpectrumCache::Get(const WaveChannelInterval &clip)
 void WaveClipSpectrumCache::MarkChanged() noexcept
 {
    ++mDirty;
+   mTileGroupsStale = true;
 }
 
 void WaveClipSpectrumCache::Invalidate()
 {
+   mTileGroupsStale = true;
+
    // Invalidate the spectrum display cache
    for (auto &pCache : mSpecCaches)
       pCache = std::make_unique<SpecCache>();
@@ -636,3 +835,5 @@ void WaveClipSpectrumCache::Erase(size_t index)
    if (index < mSpecPxCaches.size())
       mSpecPxCaches.erase(mSpecPxCaches.begin() + index);
 }
+
+IntSetting SpectrogramTileCacheSize{ L"/Spectrum/TileCacheSize", 0 };
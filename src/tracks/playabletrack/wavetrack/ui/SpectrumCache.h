@@ -12,13 +12,18 @@
 #define __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 
 class sampleCount;
+class ProjectCache;
 class SpectrogramSettings;
 class WaveClipChannel;
 using WaveChannelInterval = WaveClipChannel;
 class WideSampleSequence;
 
+#include <cstdint>
+#include <optional>
+#include <utility>
 #include <vector>
 #include "MemoryX.h"
+#include "Prefs.h"
 #include "WaveClip.h" // to inherit WaveClipListener
 
 using Floats = ArrayOf<float>;
@@ -51,9 +56,23 @@ public:
       double start /*relative to clip play start time*/);
 
    // Calculate the dirty columns at the begin and end of the cache
+   /*!
+    Columns are computed on the shared thread pool; the results do not depend
+    on the number of threads.
+
+    @param maxThreads limits the threads working at once, including the
+    caller; zero means no limit; one computes serially on the calling thread
+    */
    void Populate(
       const SpectrogramSettings& settings, const WaveChannelInterval& clip,
-      int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond);
+      int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond,
+      size_t maxThreads = 0);
+
+   // Calculate the columns in [lowerBoundX, upperBoundX)
+   void PopulateRange(
+      const SpectrogramSettings& settings, const WaveChannelInterval& clip,
+      int lowerBoundX, int upperBoundX, double pixelsPerSecond,
+      size_t maxThreads = 0);
 
    size_t       len { 0 }; // counts pixels, not samples
    int          algorithm;
@@ -61,6 +80,9 @@ public:
    double       leftTrim{ .0 };
    double       rightTrim{ .0 };
    double       start; // relative to clip start
+   //! When columns are saved in tiles, the index of the first column, in
+   //! multiples of spp from the clip start
+   std::optional<long long> gridColumn;
    int          windowType;
    size_t       windowSize { 0 };
    unsigned     zeroPaddingFactor { 0 };
@@ -71,14 +93,21 @@ public:
    int          dirty;
 
 private:
+   //! Index into freq, and power to add there, found by time reassignment
+   using Contribution = std::pair<size_t, double>;
+   using Contributions = std::vector<Contribution>;
+
    // Calculate one column of the spectrum
+   /*!
+    For reassignment, nothing is written to `out`, but powers are appended to
+    `contributions`, so that the caller can accumulate them in a fixed order
+    */
    bool CalculateOneSpectrum(
       const SpectrogramSettings& settings, const WaveChannelInterval &clip,
       const int xx, double pixelsPerSecond, int lowerBoundX, int upperBoundX,
       const std::vector<float>& gainFactors, float* __restrict scratch,
-      float* __restrict out) const;
-
-   mutable std::optional<AudioSegmentSampleView> mSampleCacheHolder;
+      std::optional<AudioSegmentSampleView> &sampleCacheHolder,
+      Contributions *contributions, float* __restrict out) const;
 };
 
 class SpecPxCache {
@@ -124,15 +153,34 @@ struct WaveClipSpectrumCache final : WaveClipListener
    // > only the 0th channel of sequence is really used
    // > In the interim, this still works correctly for WideSampleSequence backed
    // > by a right channel track, which always ignores its partner.
+   /*!
+    @param pStore if not null, and SpectrogramTileCacheSize is positive,
+    columns are read from and saved to the project file in tiles
+    */
    bool GetSpectrogram(const WaveChannelInterval &clip,
       const float *&spectrogram,
       SpectrogramSettings &spectrogramSettings,
       const sampleCount *&where, size_t numPixels,
-      double t0 /*absolute time*/, double pixelsPerSecond);
+      double t0 /*absolute time*/, double pixelsPerSecond,
+      ProjectCache *pStore = nullptr);
 
    void MakeStereo(WaveClipListener &&other, bool aligned) override;
    void SwapChannels() override;
    void Erase(size_t index) override;
+
+private:
+   void PopulateWithTiles(ProjectCache &store, size_t budget,
+      const WaveChannelInterval &clip, const SpectrogramSettings &settings,
+      int copyBegin, int copyEnd, size_t numPixels, double pixelsPerSecond);
+
+   // Groups of tiles saved since the last change of the clip, which are
+   // discarded from the store at the next saving after a change
+   std::vector<int64_t> mTileGroups;
+   bool mTileGroupsStale{ false };
 };
 
+//! Megabytes of spectrogram columns to keep in each project file; zero, the
+//! default, disables saving them
+extern AUDACITY_DLL_API IntSetting SpectrogramTileCacheSize;
+
 #endif
@@ -26,6 +26,7 @@ Paul Licameli split from WaveChannelView.cpp
 #include "AColor.h"
 #include "PendingTracks.h"
 #include "Prefs.h"
+#include "ProjectCache.h"
 #include "NumberScale.h"
 #include "../../../../TrackArt.h"
 #include "../../../../TrackArtist.h"
@@ -424,9 +425,12 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    const double binUnit = sampleRate / (2 * half);
    const float *freq = 0;
    const sampleCount *where = 0;
+   const auto pTracks = channel.GetTrack().GetOwner();
+   const auto pProject = pTracks ? pTracks->GetOwner() : nullptr;
    bool updated = WaveClipSpectrumCache::Get(clip).GetSpectrogram(
       clip, freq, settings, where, (size_t)hiddenMid.width, t0,
-      averagePixelsPerSecond);
+      averagePixelsPerSecond,
+      pProject ? &ProjectCache::Get(*pProject) : nullptr);
    auto nBins = settings.NBins();
 
    float minFreq, maxFreq;